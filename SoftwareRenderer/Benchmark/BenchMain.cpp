@@ -0,0 +1,429 @@
+//****************************************************************************
+//**
+//**    BenchMain.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "BenchScenes.h"
+
+#include "RenderDevice.h"
+#include "Vertex.h"
+#include "IndexBuffer.h"
+#include "Colour.h"
+#include "Timer.h"
+#include "FrameTimeHistogram.h"
+#include "Profiler.h"
+#include "AllocationTracker.h"
+
+using namespace SWR;
+
+#ifndef SWR_BENCH_RESOURCE_DIR
+#define SWR_BENCH_RESOURCE_DIR "Resources"
+#endif
+
+// Magenta, so pixels that are drawn but lit to black still count as covered.
+static const U32 CLEAR_COLOUR = 0x00FF00FF;
+
+// The triangle sizes, in pixels along a side, of the sweep scenes.
+static const int SWEEP_SIZES[] = { 2, 4, 8, 16, 32, 64, 128 };
+static const int TOTAL_SWEEP_SIZES = sizeof(SWEEP_SIZES) / sizeof(SWEEP_SIZES[0]);
+
+struct BenchOptions
+{
+	int frames;
+	int warmupFrames;
+	int width;
+	int height;
+	int threads;
+	const char* resourceDir;
+	const char* filter;
+	const char* outFile;
+	const char* tracePrefix;
+	const char* capturePrefix;
+	bool checkAllocations;
+	bool list;
+};
+
+struct BenchResult
+{
+	char scene[32];
+	const char* path;
+	int frames;
+	int trisSubmitted;	// A frame.
+	int trisDrawn;		// A frame, after culling and clipping. Zero for paths that don't count them.
+	int pixelsCovered;	// Pixels of the last frame that differ from the clear colour.
+
+	// A frame, from the device's stats.
+	U64 vertsTransformed;
+	U64 pixelsShaded;
+	U64 texelsFetched;
+	U64 bytesWritten;
+	U64 transientBytes;
+	Real coverage;		// Pixels shaded per pixel of the target.
+	Real overdraw;		// Pixels shaded per pixel covered.
+
+	// Timed frames that allocated, with --check-allocations.
+	U32 allocatingFrames;
+
+	double minMs, meanMs, p50Ms, p90Ms, p99Ms, maxMs;
+};
+
+static int CountCoveredPixels(const U8* pixels, int width, int height, U32 pitch)
+{
+	int covered = 0;
+	for (int y = 0; y < height; y++)
+	{
+		const U32* row = (const U32*)(pixels + y * pitch);
+		for (int x = 0; x < width; x++)
+		{
+			if (row[x] != CLEAR_COLOUR)
+				covered++;
+		}
+	}
+
+	return covered;
+}
+
+static void RunBench(RenderDevice &device, const BenchOptions &options, const BenchPath &path, const BenchScene &scene, BenchResult &result)
+{
+	BindBenchScene(device, path, scene);
+
+	Timer timer;
+	FrameTimeHistogram frameMs(options.frames);
+
+	for (int i = 0; i < options.warmupFrames + options.frames; i++)
+	{
+		if (i == options.warmupFrames)
+		{
+			device.ResetStatsCounters();
+
+			// Warmed up; from here on a frame should not touch the heap.
+			if (options.checkAllocations)
+			{
+#ifdef SWR_TRACK_ALLOCATIONS
+				AllocationTracker::SetExpectNoAllocations(true);
+				result.allocatingFrames = AllocationTracker::GetTotalFailedFrames();
+#endif
+			}
+		}
+
+		timer.Tick();
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		DrawBenchScene(device, path, scene);
+		const U8* frame = device.Present();
+		timer.Tick();
+
+		if (i >= options.warmupFrames)
+		{
+			frameMs.AddSample(timer.getDeltaTime() * 1000.0);
+		}
+
+		if (i == options.warmupFrames + options.frames - 1)
+		{
+			result.pixelsCovered = CountCoveredPixels(frame, options.width, options.height, device.GetBackBufferPitch());
+		}
+	}
+
+#ifdef SWR_TRACK_ALLOCATIONS
+	if (options.checkAllocations)
+	{
+		AllocationTracker::SetExpectNoAllocations(false);
+		result.allocatingFrames = AllocationTracker::GetTotalFailedFrames() - result.allocatingFrames;
+	}
+#endif
+
+	strcpy(result.scene, scene.name);
+	result.path = path.name;
+	result.frames = options.frames;
+	result.trisSubmitted = scene.totalTris;
+	result.trisDrawn = device.GetTrisRendered() / options.frames;
+
+	RenderStats stats = device.GetStats();
+	result.vertsTransformed = stats.vertsTransformed / options.frames;
+	result.pixelsShaded = stats.pixelsShaded / options.frames;
+	result.texelsFetched = stats.texelsFetched / options.frames;
+	result.bytesWritten = stats.bytesWritten / options.frames;
+	result.transientBytes = stats.transientBytes / options.frames;
+	result.coverage = stats.GetCoverageRatio();
+	result.overdraw = result.pixelsCovered > 0 ? (Real)((double)result.pixelsShaded / result.pixelsCovered) : 0.0f;
+
+	result.minMs = frameMs.GetMin();
+	result.maxMs = frameMs.GetMax();
+	result.meanMs = frameMs.GetMean();
+	result.p50Ms = frameMs.GetPercentile(50.0);
+	result.p90Ms = frameMs.GetPercentile(90.0);
+	result.p99Ms = frameMs.GetPercentile(99.0);
+
+	// One more frame, untimed, for swr_replay.
+	if (options.capturePrefix != NULL)
+	{
+		char captureFile[512];
+		sprintf(captureFile, "%.400s%s_%s.swrc", options.capturePrefix, scene.name, path.name);
+		if (device.BeginCapture(captureFile) == SWR_OK)
+		{
+			device.ClearBackBuffer(CLEAR_COLOUR);
+			device.ClearZBuffer();
+			DrawBenchScene(device, path, scene);
+			device.Present();
+		}
+	}
+
+	UnbindBenchScene(device);
+}
+
+static void WriteResults(FILE* out, const BenchOptions &options, const std::vector<BenchResult> &results)
+{
+	fprintf(out, "{\n");
+	fprintf(out, "  \"config\": { \"width\": %d, \"height\": %d, \"threads\": %d, \"frames\": %d, \"warmup_frames\": %d, \"simd\": %s },\n",
+		options.width, options.height, options.threads, options.frames, options.warmupFrames,
+#ifdef SWR_NO_SIMD
+		"false"
+#else
+		"true"
+#endif
+		);
+	fprintf(out, "  \"results\": [\n");
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult &r = results[i];
+		double seconds = r.meanMs / 1000.0;
+		double trisPerSecond = seconds > 0.0 ? r.trisDrawn / seconds : 0.0;
+		double mpixelsPerSecond = seconds > 0.0 ? r.pixelsCovered / seconds / 1000000.0 : 0.0;
+		double nsPerVertex = r.trisSubmitted > 0 ? r.meanMs * 1000000.0 / (r.trisSubmitted * 3.0) : 0.0;
+
+		fprintf(out, "    { \"scene\": \"%s\", \"path\": \"%s\", \"frames\": %d, ", r.scene, r.path, r.frames);
+		fprintf(out, "\"tris_submitted\": %d, \"tris_drawn\": %d, \"pixels_covered\": %d, ", r.trisSubmitted, r.trisDrawn, r.pixelsCovered);
+		fprintf(out, "\"verts_transformed\": %llu, \"pixels_shaded\": %llu, \"texels_fetched\": %llu, \"bytes_written\": %llu, \"transient_bytes\": %llu, \"coverage\": %.3f, \"overdraw\": %.3f, ",
+			r.vertsTransformed, r.pixelsShaded, r.texelsFetched, r.bytesWritten, r.transientBytes, r.coverage, r.overdraw);
+		fprintf(out, "\"tris_per_sec\": %.0f, \"mpixels_per_sec\": %.2f, \"ns_per_vertex\": %.2f, ", trisPerSecond, mpixelsPerSecond, nsPerVertex);
+		fprintf(out, "\"frame_ms\": { \"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f } }%s\n",
+			r.minMs, r.meanMs, r.p50Ms, r.p90Ms, r.p99Ms, r.maxMs, i + 1 < results.size() ? "," : "");
+	}
+
+	fprintf(out, "  ]\n}\n");
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions &options)
+{
+	options.frames = 100;
+	options.warmupFrames = 10;
+	options.width = 800;
+	options.height = 600;
+	options.threads = 4;
+	options.resourceDir = SWR_BENCH_RESOURCE_DIR;
+	options.filter = NULL;
+	options.outFile = NULL;
+	options.tracePrefix = NULL;
+	options.capturePrefix = NULL;
+	options.checkAllocations = false;
+	options.list = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--list") == 0)
+		{
+			options.list = true;
+			continue;
+		}
+
+		if (strcmp(arg, "--check-allocations") == 0)
+		{
+			options.checkAllocations = true;
+			continue;
+		}
+
+		if (value == NULL)
+		{
+			fprintf(stderr, "Missing value for %s\n", arg);
+			return false;
+		}
+
+		if (strcmp(arg, "--frames") == 0)			options.frames = atoi(value);
+		else if (strcmp(arg, "--warmup") == 0)		options.warmupFrames = atoi(value);
+		else if (strcmp(arg, "--width") == 0)		options.width = atoi(value);
+		else if (strcmp(arg, "--height") == 0)		options.height = atoi(value);
+		else if (strcmp(arg, "--threads") == 0)		options.threads = atoi(value);
+		else if (strcmp(arg, "--resources") == 0)	options.resourceDir = value;
+		else if (strcmp(arg, "--filter") == 0)		options.filter = value;
+		else if (strcmp(arg, "--out") == 0)			options.outFile = value;
+		else if (strcmp(arg, "--trace") == 0)		options.tracePrefix = value;
+		else if (strcmp(arg, "--capture") == 0)		options.capturePrefix = value;
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", arg);
+			return false;
+		}
+
+		i++;
+	}
+
+	return options.frames > 0 && options.warmupFrames >= 0 && options.width > 0 && options.height > 0 && options.threads > 0;
+}
+
+// Renders each scene through every drawing path and writes the timings as JSON.
+// Usage: swr_bench [--frames N] [--warmup N] [--width W] [--height H] [--threads N]
+//                  [--resources DIR] [--filter TEXT] [--out FILE] [--trace PREFIX] [--capture PREFIX]
+//                  [--check-allocations] [--list]
+// --filter keeps the benchmarks whose "scene/path" name contains TEXT.
+// --trace writes the last frame of each benchmark as a Chrome trace to PREFIX<scene>_<path>.json;
+// it needs a build with SWR_PROFILE defined.
+// --capture writes a frame of each benchmark, drawn after the timed ones, to PREFIX<scene>_<path>.swrc
+// for swr_replay.
+// --check-allocations fails the run if any timed frame allocates from the heap; it needs a build
+// with SWR_TRACK_ALLOCATIONS defined.
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (ParseOptions(argc, argv, options) == false)
+	{
+		fprintf(stderr, "Usage: swr_bench [--frames N] [--warmup N] [--width W] [--height H] [--threads N] "
+			"[--resources DIR] [--filter TEXT] [--out FILE] [--trace PREFIX] [--capture PREFIX] [--check-allocations] [--list]\n");
+		return 1;
+	}
+
+#ifndef SWR_PROFILE
+	if (options.tracePrefix != NULL)
+	{
+		fprintf(stderr, "Ignoring --trace; the profiler is not built in (configure with SWR_ENABLE_PROFILER).\n");
+		options.tracePrefix = NULL;
+	}
+#endif
+
+#ifndef SWR_TRACK_ALLOCATIONS
+	if (options.checkAllocations)
+	{
+		fprintf(stderr, "Ignoring --check-allocations; allocation tracking is not built in (configure with SWR_TRACK_ALLOCATIONS).\n");
+		options.checkAllocations = false;
+	}
+#endif
+
+	RenderDevice device;
+	if (CreateBenchDevice(device, (U16)options.width, (U16)options.height, (U16)options.threads) != SWR_OK)
+	{
+		fprintf(stderr, "Failed to create the render device.\n");
+		return 1;
+	}
+
+	// Build the scenes.
+	std::vector<BenchScene*> scenes;
+
+	BenchScene* scene = new BenchScene();
+	if (CreateBlazeScene(options.resourceDir, *scene) == SWR_OK)
+		scenes.push_back(scene);
+	else
+	{
+		fprintf(stderr, "Skipping the Blaze model; it could not be loaded from %s.\n", options.resourceDir);
+		delete scene;
+	}
+
+	scene = new BenchScene();
+	if (CreateCrateScene(options.resourceDir, *scene) == SWR_OK)
+		scenes.push_back(scene);
+	else
+	{
+		fprintf(stderr, "Skipping the crate; its texture could not be loaded from %s.\n", options.resourceDir);
+		delete scene;
+	}
+
+	scene = new BenchScene();
+	CreateCasterScene(*scene);
+	scenes.push_back(scene);
+
+	for (int i = 0; i < TOTAL_SWEEP_SIZES; i++)
+	{
+		scene = new BenchScene();
+		if (CreateSweepScene(SWEEP_SIZES[i], options.width, options.height, device.GetFocalX(), device.GetFocalY(), *scene) == SWR_OK)
+			scenes.push_back(scene);
+		else
+			delete scene;
+	}
+
+	// Run them.
+	std::vector<BenchResult> results;
+	U32 allocatingFrames = 0;
+	for (size_t s = 0; s < scenes.size(); s++)
+	{
+		for (int p = 0; p < TOTAL_BENCH_PATHS; p++)
+		{
+			char name[64];
+			sprintf(name, "%s/%s", scenes[s]->name, BENCH_PATHS[p].name);
+			if (options.filter != NULL && strstr(name, options.filter) == NULL)
+				continue;
+
+			if (options.list)
+			{
+				printf("%s\n", name);
+				continue;
+			}
+
+			BenchResult result;
+			memset(&result, 0, sizeof(BenchResult));
+			RunBench(device, options, BENCH_PATHS[p], *scenes[s], result);
+			results.push_back(result);
+
+			fprintf(stderr, "%-32s %9.3f ms (p99 %9.3f ms)\n", name, result.meanMs, result.p99Ms);
+
+			if (result.allocatingFrames > 0)
+			{
+				fprintf(stderr, "%-32s %u of %d frames allocated after warm up\n", name, result.allocatingFrames, options.frames);
+				allocatingFrames += result.allocatingFrames;
+			}
+
+#ifdef SWR_PROFILE
+			if (options.tracePrefix != NULL)
+			{
+				char traceFile[512];
+				sprintf(traceFile, "%.400s%s_%s.json", options.tracePrefix, scenes[s]->name, BENCH_PATHS[p].name);
+				Profiler::Instance().WriteFrameTrace(traceFile);
+			}
+
+			Profiler::Instance().Clear();
+#endif
+		}
+	}
+
+	for (size_t s = 0; s < scenes.size(); s++)
+	{
+		delete scenes[s];
+	}
+
+	device.Release();
+
+	if (options.list)
+		return 0;
+
+	FILE* out = stdout;
+	if (options.outFile != NULL)
+	{
+		out = fopen(options.outFile, "w");
+		if (out == NULL)
+		{
+			fprintf(stderr, "Could not open %s for writing.\n", options.outFile);
+			return 1;
+		}
+	}
+
+	WriteResults(out, options, results);
+
+	if (out != stdout)
+	{
+		fclose(out);
+	}
+
+	return allocatingFrames > 0 ? 1 : 0;
+}
@@ -0,0 +1,500 @@
+//****************************************************************************
+//**
+//**    BenchScenes.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BenchScenes.h"
+
+#include "Vertex.h"
+#include "IndexBuffer.h"
+#include "Texture.h"
+#include "TextureManager.h"
+#include "Colour.h"
+#include "Vector3.h"
+#include "LightingManager.h"
+
+namespace SWR
+{
+	const BenchPath BENCH_PATHS[] =
+	{
+		{ "col",				BENCHDRAW_Col,			PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "col_lit",			BENCHDRAW_ColLit,		PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "col_phong",			BENCHDRAW_ColPhong,		PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "col_phong_deferred",	BENCHDRAW_ColPhong,		PIPELINE_Deferred,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "col_phong_shadowed",	BENCHDRAW_ColPhongShadowed,	PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "col_phong_shadowed_deferred",	BENCHDRAW_ColPhongShadowed,	PIPELINE_Deferred,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "col_batched",		BENCHDRAW_Col,			PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	true },
+		{ "tex_affine",			BENCHDRAW_Tex,			PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "tex_perspective",	BENCHDRAW_Tex,			PIPELINE_Forward,	TEX_MAP_Perspective,	TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "tex_tiled",			BENCHDRAW_Tex,			PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Tiled,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "tex_mipmapped",		BENCHDRAW_Tex,			PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	true,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "tex_wrap",			BENCHDRAW_Tex,			PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Wrap,	TEXFILTER_Nearest,	false },
+		{ "tex_bilinear",		BENCHDRAW_Tex,			PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Bilinear,	false },
+		{ "tex_batched",		BENCHDRAW_Tex,			PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	true },
+		{ "tex_lit",			BENCHDRAW_TexLit,		PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "tex_lit_perspective",	BENCHDRAW_TexLit,		PIPELINE_Forward,	TEX_MAP_Perspective,	TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "shadow",				BENCHDRAW_Shadow,		PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+		{ "wireframe",			BENCHDRAW_WireFrame,	PIPELINE_Forward,	TEX_MAP_Affine,			TEXLAYOUT_Linear,	false,	TEXADDRESS_Clamp,	TEXFILTER_Nearest,	false },
+	};
+
+	const int TOTAL_BENCH_PATHS = sizeof(BENCH_PATHS) / sizeof(BENCH_PATHS[0]);
+
+	const Real BENCH_FOV = 70.0f;
+
+	// The most cells the sweep grid has along a side; 6 indices a cell must fit in a U16 count.
+	static const int MAX_SWEEP_CELLS = 104;
+
+	// The depth of the sweep grid in camera space.
+	static const Real SWEEP_DEPTH = 10.0f;
+
+	// The bench light, above the camera.
+	static const Real LIGHT_HEIGHT = 1.0f;
+
+	// A 64x64 checker board of 8 texel squares.
+	static void CreateCheckerTexture(Texture* &texture)
+	{
+		TextureManager::Instance().CreateTexture(64, 64, texture);
+		U32* texels = (U32*)texture->GetBytes();
+		for (int i = 0; i < 64 * 64; i++)
+		{
+			texels[i] = ((i / 8) + (i / (64 * 8))) & 1 ? 0x00E0E0E0 : 0x00404040;
+		}
+	}
+
+	static std::string ResourcePath(const char* resourceDir, const char* file)
+	{
+		std::string path(resourceDir);
+		if (path.empty() == false && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\')
+		{
+			path += '/';
+		}
+
+		return path + file;
+	}
+
+	BenchScene::BenchScene()
+		: verts(NULL)
+		, indices(NULL)
+		, texture(NULL)
+		, totalTris(0)
+	{
+		name[0] = '\0';
+		world.Identity();
+	}
+
+	BenchScene::~BenchScene()
+	{
+		Release();
+	}
+
+	void BenchScene::Release()
+	{
+		if (verts != NULL)
+		{
+			delete verts;
+			verts = NULL;
+		}
+
+		if (indices != NULL)
+		{
+			delete indices;
+			indices = NULL;
+		}
+
+		if (texture != NULL)
+		{
+			delete texture;
+			texture = NULL;
+		}
+
+		totalTris = 0;
+	}
+
+	SWR_ERR CreateBlazeScene(const char* resourceDir, BenchScene &scene)
+	{
+		scene.Release();
+		strcpy(scene.name, "blaze");
+
+		const int totalVerts = 5733;
+		const int totalTris = totalVerts / 3;
+
+		Vertex* tempVerts = NULL;
+		if (LoadVertsFromFile(tempVerts, ResourcePath(resourceDir, "BlazeVertexBinary.txt").c_str(), totalVerts) != SWR_OK)
+		{
+			if (tempVerts != NULL)
+			{
+				delete [] tempVerts;
+			}
+
+			return SWR_FAIL;
+		}
+
+		CreateVertexBuffer(tempVerts, totalVerts, scene.verts);
+		delete [] tempVerts;
+
+		// The vertex file holds every triangle's corners in order (BlazeIndexBinary.txt indexes
+		// a different, welded vertex list), so index it straight through.
+		std::vector<U16> indices(totalVerts);
+		for (int i = 0; i < totalVerts; i++)
+		{
+			indices[i] = (U16)i;
+		}
+
+		CreateIndexBuffer(&indices[0], totalVerts, scene.indices);
+
+		if (TextureManager::Instance().LoadTexture(ResourcePath(resourceDir, "Blaze24.bmp").c_str(), scene.texture, 512, 512, false) != SWR_OK)
+		{
+			scene.Release();
+			return SWR_FAIL;
+		}
+
+		scene.totalTris = totalTris;
+
+		// Built the same way as the demo's model transform, which stands the model up, but closer.
+		Matrix4 rotateZ, rotateX, translate;
+		RotateMatrix4Z(90.0f, rotateZ);
+		RotateMatrix4X(0.0f, rotateX);
+		TranslateMatrix4(Vector3(0.0f, 0.0f, 2.5f), translate);
+
+		scene.world.Identity();
+		scene.world *= rotateZ;
+		scene.world *= rotateX;
+		scene.world *= translate;
+		return SWR_OK;
+	}
+
+	SWR_ERR CreateCrateScene(const char* resourceDir, BenchScene &scene)
+	{
+		scene.Release();
+		strcpy(scene.name, "crate");
+
+		// The cube from the demo's MainListener::GenerateCube.
+		Vertex verts[] =
+		{
+			Vertex( -0.5f, -0.5f, 0.5f, Colour32::WHITE,     0.0f, 0.0f,  0.0f, 0.0f, 1.0f),    // side 1
+			Vertex( 0.5f, -0.5f, 0.5f,  Colour32::WHITE,     1.0f, 0.0f,  0.0f, 0.0f, 1.0f),
+			Vertex( -0.5f, 0.5f, 0.5f,  Colour32::WHITE,     0.0f, 1.0f,  0.0f, 0.0f, 1.0f),
+			Vertex( 0.5f, 0.5f, 0.5f,   Colour32::WHITE,     1.0f, 1.0f,  0.0f, 0.0f, 1.0f),
+
+			Vertex( -0.5f, -0.5f, -0.5f,Colour32::WHITE,     0.0f, 0.0f,  0.0f, 0.0f, -1.0f),    // side 2
+			Vertex( -0.5f, 0.5f, -0.5f, Colour32::WHITE,     1.0f, 0.0f,  0.0f, 0.0f, -1.0f),
+			Vertex( 0.5f, -0.5f, -0.5f, Colour32::WHITE,     0.0f, 1.0f,  0.0f, 0.0f, -1.0f),
+			Vertex( 0.5f, 0.5f, -0.5f,  Colour32::WHITE,     1.0f, 1.0f, 0.0f, 0.0f, -1.0f),
+
+			Vertex( -0.5f, 0.5f, -0.5f, Colour32::WHITE,     0.0f, 0.0f,  0.0f, 1.0f, 0.0f),    // side 3
+			Vertex( -0.5f, 0.5f, 0.5f,  Colour32::WHITE,     1.0f, 0.0f,  0.0f, 1.0f, 0.0f),
+			Vertex( 0.5f, 0.5f, -0.5f,  Colour32::WHITE,     0.0f, 1.0f,  0.0f, 1.0f, 0.0f),
+			Vertex( 0.5f, 0.5f, 0.5f,   Colour32::WHITE,     1.0f, 1.0f,  0.0f, 1.0f, 0.0f),
+
+			Vertex( -0.5f, -0.5f, -0.5f, Colour32::WHITE,     0.0f, 0.0f,  0.0f, -1.0f, 0.0f),    // side 4
+			Vertex( 0.5f, -0.5f, -0.5f,  Colour32::WHITE,     1.0f, 0.0f,  0.0f, -1.0f, 0.0f),
+			Vertex( -0.5f, -0.5f, 0.5f,  Colour32::WHITE,     0.0f, 1.0f,  0.0f, -1.0f, 0.0f),
+			Vertex( 0.5f, -0.5f, 0.5f,   Colour32::WHITE,     1.0f, 1.0f,  0.0f, -1.0f, 0.0f),
+
+			Vertex( 0.5f, -0.5f, -0.5f,  Colour32::WHITE,     0.0f, 0.0f,  1.0f, 0.0f, 0.0f),    // side 5
+			Vertex( 0.5f, 0.5f, -0.5f,   Colour32::WHITE,     1.0f, 0.0f,  1.0f, 0.0f, 0.0f),
+			Vertex( 0.5f, -0.5f, 0.5f,   Colour32::WHITE,     0.0f, 1.0f,  1.0f, 0.0f, 0.0f),
+			Vertex( 0.5f, 0.5f, 0.5f,    Colour32::WHITE,     1.0f, 1.0f,  1.0f, 0.0f, 0.0f),
+
+			Vertex( -0.5f, -0.5f, -0.5f, Colour32::WHITE,     0.0f, 0.0f,  -1.0f, 0.0f, 0.0f),    // side 6
+			Vertex( -0.5f, -0.5f, 0.5f,  Colour32::WHITE,     1.0f, 0.0f,  -1.0f, 0.0f, 0.0f),
+			Vertex( -0.5f, 0.5f, -0.5f,  Colour32::WHITE,     0.0f, 1.0f,  -1.0f, 0.0f, 0.0f),
+			Vertex( -0.5f, 0.5f, 0.5f,   Colour32::WHITE,     1.0f, 1.0f,  -1.0f, 0.0f, 0.0f),
+		};
+
+		U16 indices[] =
+		{
+			0, 1, 2,    // side 1
+			2, 1, 3,
+			4, 5, 6,    // side 2
+			6, 5, 7,
+			8, 9, 10,    // side 3
+			10, 9, 11,
+			12, 13, 14,    // side 4
+			14, 13, 15,
+			16, 17, 18,    // side 5
+			18, 17, 19,
+			20, 21, 22,    // side 6
+			22, 21, 23,
+		};
+
+		CreateVertexBuffer(verts, 24, scene.verts);
+		CreateIndexBuffer(indices, 36, scene.indices);
+		if (TextureManager::Instance().LoadTexture(ResourcePath(resourceDir, "crate24.bmp").c_str(), scene.texture, 256, 256, true) != SWR_OK)
+		{
+			scene.Release();
+			return SWR_FAIL;
+		}
+
+		scene.totalTris = 12;
+
+		// Turned so three faces are in view, close enough to fill much of the screen.
+		Matrix4 rotateX, rotateY, translate;
+		RotateMatrix4X(30.0f, rotateX);
+		RotateMatrix4Y(30.0f, rotateY);
+		TranslateMatrix4(Vector3(0.0f, 0.0f, 2.0f), translate);
+
+		scene.world.Identity();
+		scene.world *= rotateX;
+		scene.world *= rotateY;
+		scene.world *= translate;
+		return SWR_OK;
+	}
+
+	SWR_ERR CreateSweepScene(int triangleSize, U32 width, U32 height, Real focalX, Real focalY, BenchScene &scene)
+	{
+		scene.Release();
+		sprintf(scene.name, "sweep_%dpx", triangleSize);
+
+		if (triangleSize < 1 || (U32)triangleSize + 2 > width || (U32)triangleSize + 2 > height)
+			return SWR_FAIL;
+
+		// As many cells as fit on screen, centred, keeping a pixel clear of the edges.
+		int cellsX = (width - 2) / triangleSize;
+		int cellsY = (height - 2) / triangleSize;
+		cellsX = cellsX > MAX_SWEEP_CELLS ? MAX_SWEEP_CELLS : cellsX;
+		cellsY = cellsY > MAX_SWEEP_CELLS ? MAX_SWEEP_CELLS : cellsY;
+
+		Real left = (width - cellsX * triangleSize) * 0.5f;
+		Real top = (height - cellsY * triangleSize) * 0.5f;
+		Real halfWidth = width * 0.5f;
+		Real halfHeight = height * 0.5f;
+
+		// Place the corners in camera space so they project onto the pixel grid. The normals point
+		// away from the camera, which is how the lighting expects a face towards it to be lit.
+		std::vector<Vertex> verts((cellsX + 1) * (cellsY + 1));
+		for (int y = 0; y <= cellsY; y++)
+		{
+			for (int x = 0; x <= cellsX; x++)
+			{
+				Real screenX = left + x * triangleSize;
+				Real screenY = top + y * triangleSize;
+				Real u = (Real)x / cellsX;
+				Real v = (Real)y / cellsY;
+
+				verts[y * (cellsX + 1) + x] = Vertex(
+					(screenX - halfWidth) * SWEEP_DEPTH / focalX,
+					-(screenY - halfHeight) * SWEEP_DEPTH / focalY,
+					SWEEP_DEPTH,
+					Colour32((U8)(u * 255.0f), (U8)(v * 255.0f), 128, 0),
+					u, v,
+					0.0f, 0.0f, 1.0f);
+			}
+		}
+
+		// Two triangles a cell, wound the same way as the rest of the scenes.
+		std::vector<U16> indices(cellsX * cellsY * 6);
+		U16* index = &indices[0];
+		for (int y = 0; y < cellsY; y++)
+		{
+			for (int x = 0; x < cellsX; x++)
+			{
+				U16 topLeft = (U16)(y * (cellsX + 1) + x);
+				U16 topRight = topLeft + 1;
+				U16 bottomLeft = (U16)(topLeft + cellsX + 1);
+				U16 bottomRight = bottomLeft + 1;
+
+				*index++ = bottomLeft;
+				*index++ = topLeft;
+				*index++ = topRight;
+				*index++ = bottomLeft;
+				*index++ = topRight;
+				*index++ = bottomRight;
+			}
+		}
+
+		CreateVertexBuffer(&verts[0], (U16)verts.size(), scene.verts);
+		CreateIndexBuffer(&indices[0], (U16)indices.size(), scene.indices);
+
+		// A checker board, so the texture paths have something to fetch.
+		CreateCheckerTexture(scene.texture);
+
+		scene.totalTris = cellsX * cellsY * 2;
+		scene.world.Identity();
+		return SWR_OK;
+	}
+
+	SWR_ERR CreateCasterScene(BenchScene &scene)
+	{
+		scene.Release();
+		strcpy(scene.name, "caster");
+
+		// Both quads face the camera with their normals pointing away from it, as the sweep's do.
+		// The light is a unit above the camera, so the square's shadow on the wall is twice its
+		// size and reaches below the middle of the screen.
+		Vertex verts[] =
+		{
+			Vertex(-5.0f, -3.5f, 8.0f,  Colour32::WHITE,  0.0f, 1.0f,  0.0f, 0.0f, 1.0f),    // wall
+			Vertex(-5.0f, 3.5f, 8.0f,   Colour32::WHITE,  0.0f, 0.0f,  0.0f, 0.0f, 1.0f),
+			Vertex(5.0f, 3.5f, 8.0f,    Colour32::WHITE,  1.0f, 0.0f,  0.0f, 0.0f, 1.0f),
+			Vertex(5.0f, -3.5f, 8.0f,   Colour32::WHITE,  1.0f, 1.0f,  0.0f, 0.0f, 1.0f),
+
+			Vertex(-0.5f, 0.0f, 4.0f,   Colour32(255, 160, 64, 0),  0.0f, 1.0f,  0.0f, 0.0f, 1.0f),    // caster
+			Vertex(-0.5f, 1.0f, 4.0f,   Colour32(255, 160, 64, 0),  0.0f, 0.0f,  0.0f, 0.0f, 1.0f),
+			Vertex(0.5f, 1.0f, 4.0f,    Colour32(255, 160, 64, 0),  1.0f, 0.0f,  0.0f, 0.0f, 1.0f),
+			Vertex(0.5f, 0.0f, 4.0f,    Colour32(255, 160, 64, 0),  1.0f, 1.0f,  0.0f, 0.0f, 1.0f),
+		};
+
+		U16 indices[] =
+		{
+			0, 1, 2,    // wall
+			0, 2, 3,
+			4, 5, 6,    // caster
+			4, 6, 7,
+		};
+
+		CreateVertexBuffer(verts, 8, scene.verts);
+		CreateIndexBuffer(indices, 12, scene.indices);
+		CreateCheckerTexture(scene.texture);
+
+		scene.totalTris = 4;
+		scene.world.Identity();
+		return SWR_OK;
+	}
+
+	const BenchPath* FindBenchPath(const char* name)
+	{
+		for (int i = 0; i < TOTAL_BENCH_PATHS; i++)
+		{
+			if (strcmp(BENCH_PATHS[i].name, name) == 0)
+				return &BENCH_PATHS[i];
+		}
+
+		return NULL;
+	}
+
+	SWR_ERR CreateBenchDevice(RenderDevice &device, U16 width, U16 height, U16 threads)
+	{
+		SWRInitParams params;
+		params.bufferWidth = width;
+		params.bufferHeight = height;
+		params.totalRenderThreads = threads;
+
+		if (device.Initilise(params) != SWR_OK)
+			return SWR_FAIL;
+
+		device.SetFOV(BENCH_FOV);
+		device.SetClipPlanes(1.0f, 100.0f);
+		device.EnableBackfaceCulling(true);
+
+		Matrix4 identity;
+		identity.Identity();
+		device.SetCameraTransform(identity);
+
+		Light light;
+		light.type = LIGHT_Point;
+		light.position = Vector3(0.0f, LIGHT_HEIGHT, 0.0f);
+		light.colour.FromColour32(Colour32::WHITE);
+		light.falloff = 50.0f;
+		light.atten[0] = 0.0f;
+		light.atten[1] = 0.125f;
+		light.atten[2] = 0.0f;
+		device.GetLightingManager()->AddLight(light, 0);
+		device.GetLightingManager()->EnableLight(0);
+
+		return SWR_OK;
+	}
+
+	void BindBenchScene(RenderDevice &device, const BenchPath &path, const BenchScene &scene)
+	{
+		device.SetRenderPipeline(path.pipeline);
+		device.SetTextureMappingType(path.texMapType);
+		device.EnableSpanBatching(path.batchSpans);
+		device.SetWorldTransform(scene.world);
+		device.CommitMatrixChanges();
+		device.SetVertexBuffer(scene.verts);
+		device.SetIndexBuffer(scene.indices);
+
+		// Before the first frame, so the conversion isn't timed.
+		if (scene.texture != NULL && scene.texture->GetLayout() != path.texLayout)
+		{
+			TextureManager::Instance().SetTextureLayout(scene.texture, path.texLayout);
+		}
+
+		if (scene.texture != NULL)
+		{
+			scene.texture->SetAddressMode(path.texAddress);
+			scene.texture->SetFilter(path.texFilter);
+		}
+
+		if (scene.texture != NULL && (scene.texture->GetTotalLevels() > 1) != path.mipmaps)
+		{
+			if (path.mipmaps)
+				TextureManager::Instance().GenerateMipmaps(scene.texture);
+			else
+				TextureManager::Instance().ReleaseMipmaps(scene.texture);
+		}
+
+		device.SetSourceTexture(scene.texture);
+		device.ClearLightingCache();
+	}
+
+	void DrawBenchScene(RenderDevice &device, const BenchPath &path, const BenchScene &scene)
+	{
+		switch (path.draw)
+		{
+		case BENCHDRAW_Col:
+			device.DrawTrisColList(true, scene.totalTris, 0);
+			break;
+		case BENCHDRAW_ColLit:
+			device.DrawTrisColLitList(true, scene.totalTris, 0);
+			break;
+		case BENCHDRAW_ColPhong:
+			device.DrawTrisColPhongList(true, scene.totalTris, 0);
+			break;
+		case BENCHDRAW_ColPhongShadowed:
+			{
+				// The scene casts onto itself from the bench light, looking down +z like the camera.
+				Matrix4 lightTransform;
+				TranslateMatrix4(Vector3(0.0f, LIGHT_HEIGHT, 0.0f), lightTransform);
+				if (device.BeginShadowPass(0, lightTransform, 90.0f, 1.0f, 100.0f) == SWR_OK)
+				{
+					device.DrawTrisShadowList(true, scene.totalTris, 0);
+					device.EndShadowPass();
+				}
+
+				device.DrawTrisColPhongList(true, scene.totalTris, 0);
+			}
+			break;
+		case BENCHDRAW_Tex:
+			device.DrawTrisTexList(true, scene.totalTris, 0);
+			break;
+		case BENCHDRAW_TexLit:
+			device.DrawTrisTexLitList(true, scene.totalTris, 0);
+			break;
+		case BENCHDRAW_Shadow:
+			{
+				// The shadow map of a light sitting on the camera.
+				Matrix4 identity;
+				identity.Identity();
+				if (device.BeginShadowPass(0, identity, BENCH_FOV, 1.0f, 100.0f) == SWR_OK)
+				{
+					device.DrawTrisShadowList(true, scene.totalTris, 0);
+					device.EndShadowPass();
+				}
+			}
+			break;
+		case BENCHDRAW_WireFrame:
+			device.DrawWireFrame(true, scene.totalTris, 0, Colour32::WHITE);
+			break;
+		};
+	}
+
+	void UnbindBenchScene(RenderDevice &device)
+	{
+		device.DisableShadows();
+		device.SetRenderPipeline(PIPELINE_Forward);
+	}
+
+}; // End namespace SWR.
@@ -0,0 +1,127 @@
+#pragma once
+
+#ifndef BENCH_SCENES_H
+#define BENCH_SCENES_H
+
+//****************************************************************************
+//**
+//**    BenchScenes.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "DataTypes.h"
+#include "Matrix4.h"
+#include "RenderDevice.h"
+#include "Texture.h"
+
+// Forward Declarations
+namespace SWR
+{
+	class VertexBuffer;
+	class IndexBuffer;
+	class Texture;
+};
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								BenchScene
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A fixed piece of geometry the benchmark renders every frame; the buffers,
+	// the texture and the world transform to draw it with. Scenes never move,
+	// so every run of the benchmark draws exactly the same pixels.
+	// ------------------------------------------------------------------------
+	struct BenchScene
+	{
+		char name[32];
+
+		VertexBuffer* verts;
+		IndexBuffer* indices;
+		Texture* texture;
+		int totalTris;
+
+		Matrix4 world;
+
+		BenchScene();
+		~BenchScene();
+
+		void Release();
+	};
+
+	// The Blaze model from the demo, facing the camera.
+	SWR_ERR CreateBlazeScene(const char* resourceDir, BenchScene &scene);
+
+	// The textured crate from the demo, turned to show three faces.
+	SWR_ERR CreateCrateScene(const char* resourceDir, BenchScene &scene);
+
+	// A grid of right angled triangles whose sides are triangleSize pixels on screen, for
+	// measuring how the cost per triangle changes with its size. focalX and focalY are the
+	// device's focal lengths for a target of width x height.
+	SWR_ERR CreateSweepScene(int triangleSize, U32 width, U32 height, Real focalX, Real focalY, BenchScene &scene);
+
+	// A wall facing the camera with a smaller square in front of it, above the middle of the
+	// screen, whose shadow from the bench light falls on the wall below it.
+	SWR_ERR CreateCasterScene(BenchScene &scene);
+
+	// ------------------------------------------------------------------------
+	// The ways a scene can be drawn; one entry per DrawTris* path and mode.
+	// ------------------------------------------------------------------------
+	enum BenchDraw
+	{
+		BENCHDRAW_Col,
+		BENCHDRAW_ColLit,
+		BENCHDRAW_ColPhong,
+		BENCHDRAW_ColPhongShadowed,
+		BENCHDRAW_Tex,
+		BENCHDRAW_TexLit,
+		BENCHDRAW_Shadow,
+		BENCHDRAW_WireFrame,
+	};
+
+	struct BenchPath
+	{
+		const char* name;
+		BenchDraw draw;
+		RenderPipeline pipeline;
+		TextureMappingTypeSet texMapType;
+		TextureLayout texLayout;
+		bool mipmaps;
+		TextureAddressMode texAddress;
+		TextureFilter texFilter;
+		bool batchSpans;
+	};
+
+	extern const BenchPath BENCH_PATHS[];
+	extern const int TOTAL_BENCH_PATHS;
+
+	// The field of view the scenes are framed for.
+	extern const Real BENCH_FOV;
+
+	// Returns the path with the name, or NULL.
+	const BenchPath* FindBenchPath(const char* name);
+
+	// Creates a headless device set up to draw the scenes; the camera at the origin looking down +z,
+	// back faces culled, and a white point light just above the camera for the lit paths and
+	// the shadowed ones.
+	SWR_ERR CreateBenchDevice(RenderDevice &device, U16 width, U16 height, U16 threads);
+
+	// Binds the scene's buffers, texture and transform, and the path's pipeline and mapping.
+	// The scene's texture is put into the path's layout and address mode, and given mip levels or
+	// has them taken away.
+	void BindBenchScene(RenderDevice &device, const BenchPath &path, const BenchScene &scene);
+
+	// Draws the scene through the path. Doesn't clear or present.
+	void DrawBenchScene(RenderDevice &device, const BenchPath &path, const BenchScene &scene);
+
+	// Puts back the state BindBenchScene and DrawBenchScene change that the other paths rely on.
+	void UnbindBenchScene(RenderDevice &device);
+
+}; // End namespace SWR.
+
+#endif // #ifndef BENCH_SCENES_H
@@ -0,0 +1,520 @@
+//****************************************************************************
+//**
+//**    RegressMain.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "BenchScenes.h"
+
+#include "RenderDevice.h"
+#include "FrameReplay.h"
+#include "PPMFile.h"
+#include "Timer.h"
+#include "FrameTimeHistogram.h"
+
+using namespace SWR;
+
+#ifndef SWR_REGRESS_RESOURCE_DIR
+#define SWR_REGRESS_RESOURCE_DIR "Resources"
+#endif
+
+#ifndef SWR_REGRESS_GOLDEN_DIR
+#define SWR_REGRESS_GOLDEN_DIR "Golden"
+#endif
+
+static const U32 CLEAR_COLOUR = 0x00FF00FF;
+
+// The scripted cases, as "scene/path" of the benchmark's scenes and paths, and the size they're
+// rendered at. Kept small so the golden images stay small.
+static const char* SCRIPTED_CASES[] =
+{
+	"blaze/col",
+	"blaze/col_lit",
+	"blaze/wireframe",
+	"crate/col_phong",
+	"crate/col_phong_deferred",
+	"crate/tex_affine",
+	"crate/tex_perspective",
+	"crate/tex_tiled",
+	"crate/tex_mipmapped",
+	"crate/tex_bilinear",
+	"crate/tex_batched",
+	"crate/tex_lit",
+	"crate/tex_lit_perspective",
+	"caster/col_phong_shadowed",
+	"caster/col_phong_shadowed_deferred",
+	"sweep_8px/col",
+	"sweep_8px/col_batched",
+	"sweep_32px/tex_perspective",
+};
+
+static const int TOTAL_SCRIPTED_CASES = sizeof(SCRIPTED_CASES) / sizeof(SCRIPTED_CASES[0]);
+static const U16 SCRIPTED_WIDTH = 160;
+static const U16 SCRIPTED_HEIGHT = 120;
+
+struct RegressOptions
+{
+	const char* goldenDir;
+	const char* resourceDir;
+	const char* filter;
+	const char* baselineFile;
+	const char* writeBaselineFile;
+	const char* diffDir;
+	std::vector<const char*> captures;
+	int tolerance;				// Per channel.
+	double maxDiffPercent;		// Of the pixels, allowed past the tolerance.
+	double thresholdPercent;	// Slow down over the baseline allowed.
+	int frames;
+	int warmupFrames;
+	int threads;
+	bool update;
+};
+
+struct RegressCase
+{
+	std::string name;
+	std::vector<U8> frame;
+	U32 width;
+	U32 height;
+	double p50Ms;
+	bool failed;
+};
+
+static std::string GoldenPath(const RegressOptions &options, const std::string &name, const char* suffix)
+{
+	// Case names may contain a slash; keep the files in a single directory.
+	std::string file(name);
+	std::replace(file.begin(), file.end(), '/', '_');
+	return std::string(options.goldenDir) + "/" + file + suffix;
+}
+
+// Keeps a copy of the frame without the padding at the end of its rows.
+static void CopyFrame(const U8* frame, U32 pitch, RegressCase &test)
+{
+	test.frame.resize(test.width * test.height * 4);
+	for (U32 y = 0; y < test.height; y++)
+	{
+		memcpy(&test.frame[y * test.width * 4], frame + y * pitch, test.width * 4);
+	}
+}
+
+// Renders a benchmark scene through a path, keeping the last frame and the median frame time.
+static bool RunScripted(RenderDevice &device, const RegressOptions &options, std::map<std::string, BenchScene*> &scenes, RegressCase &test)
+{
+	size_t split = test.name.find('/');
+	std::string sceneName = test.name.substr(0, split);
+	const BenchPath* path = split != std::string::npos ? FindBenchPath(test.name.c_str() + split + 1) : NULL;
+	if (path == NULL)
+	{
+		fprintf(stderr, "%s: unknown path.\n", test.name.c_str());
+		return false;
+	}
+
+	BenchScene* &scene = scenes[sceneName];
+	if (scene == NULL)
+	{
+		scene = new BenchScene();
+		int triangleSize = 0;
+		SWR_ERR result = SWR_FAIL;
+		if (sceneName == "blaze")
+			result = CreateBlazeScene(options.resourceDir, *scene);
+		else if (sceneName == "crate")
+			result = CreateCrateScene(options.resourceDir, *scene);
+		else if (sceneName == "caster")
+			result = CreateCasterScene(*scene);
+		else if (sscanf(sceneName.c_str(), "sweep_%dpx", &triangleSize) == 1)
+			result = CreateSweepScene(triangleSize, SCRIPTED_WIDTH, SCRIPTED_HEIGHT, device.GetFocalX(), device.GetFocalY(), *scene);
+
+		if (result != SWR_OK)
+		{
+			fprintf(stderr, "%s: the scene could not be created from %s.\n", test.name.c_str(), options.resourceDir);
+			delete scene;
+			scene = NULL;
+			return false;
+		}
+	}
+
+	BindBenchScene(device, *path, *scene);
+
+	Timer timer;
+	FrameTimeHistogram frameMs(options.frames);
+	const U8* frame = NULL;
+	for (int i = 0; i < options.warmupFrames + options.frames; i++)
+	{
+		timer.Tick();
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		DrawBenchScene(device, *path, *scene);
+		frame = device.Present();
+		timer.Tick();
+
+		if (i >= options.warmupFrames)
+		{
+			frameMs.AddSample(timer.getDeltaTime() * 1000.0);
+		}
+	}
+
+	UnbindBenchScene(device);
+
+	test.width = SCRIPTED_WIDTH;
+	test.height = SCRIPTED_HEIGHT;
+	CopyFrame(frame, device.GetBackBufferPitch(), test);
+	test.p50Ms = frameMs.GetPercentile(50.0);
+	return true;
+}
+
+// Plays a frame capture on a device of its own, keeping the last frame and the median frame time.
+static bool RunCapture(const RegressOptions &options, const char* captureFile, RegressCase &test)
+{
+	FrameReplay replay;
+	if (replay.Load(captureFile) != SWR_OK)
+	{
+		fprintf(stderr, "%s: the capture could not be loaded.\n", test.name.c_str());
+		return false;
+	}
+
+	SWRInitParams params;
+	replay.GetInitParams(params);
+	params.totalRenderThreads = (U16)options.threads;
+
+	RenderDevice device;
+	if (device.Initilise(params) != SWR_OK)
+	{
+		fprintf(stderr, "%s: the render device could not be created.\n", test.name.c_str());
+		return false;
+	}
+
+	Timer timer;
+	FrameTimeHistogram frameMs(options.frames);
+	bool played = true;
+	for (int i = 0; i < options.warmupFrames + options.frames && played; i++)
+	{
+		timer.Tick();
+		played = replay.Play(device) == SWR_OK && replay.GetFrame() != NULL;
+		timer.Tick();
+
+		if (i >= options.warmupFrames)
+		{
+			frameMs.AddSample(timer.getDeltaTime() * 1000.0);
+		}
+	}
+
+	if (played)
+	{
+		test.width = replay.GetWidth();
+		test.height = replay.GetHeight();
+		CopyFrame(replay.GetFrame(), replay.GetFramePitch(), test);
+		test.p50Ms = frameMs.GetPercentile(50.0);
+	}
+	else
+	{
+		fprintf(stderr, "%s: the capture failed to play.\n", test.name.c_str());
+	}
+
+	device.Release();
+	return played;
+}
+
+// Compares the frame against its golden image. Pixels with a channel further than the tolerance
+// from the golden one are counted as different, and drawn red in the diff image.
+static bool CheckGolden(const RegressOptions &options, const RegressCase &test, char* report)
+{
+	std::vector<U8> golden;
+	U32 width = 0;
+	U32 height = 0;
+	std::string goldenFile = GoldenPath(options, test.name, ".ppm");
+	if (ReadPPM(goldenFile.c_str(), golden, width, height) != SWR_OK)
+	{
+		sprintf(report, "no golden image %.200s; create it with --update", goldenFile.c_str());
+		return false;
+	}
+
+	if (width != test.width || height != test.height)
+	{
+		sprintf(report, "golden image is %ux%u, frame is %ux%u", width, height, test.width, test.height);
+		return false;
+	}
+
+	U32 totalPixels = width * height;
+	U32 differentPixels = 0;
+	int maxDifference = 0;
+	std::vector<U8> diff(totalPixels * 4);
+	for (U32 i = 0; i < totalPixels; i++)
+	{
+		int difference = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			int channel = abs((int)test.frame[i * 4 + c] - (int)golden[i * 4 + c]);
+			difference = channel > difference ? channel : difference;
+		}
+
+		maxDifference = difference > maxDifference ? difference : maxDifference;
+		bool different = difference > options.tolerance;
+		if (different)
+			differentPixels++;
+
+		// Different pixels in red over a faded copy of the frame.
+		diff[i * 4 + 0] = different ? 0 : test.frame[i * 4 + 0] / 4;
+		diff[i * 4 + 1] = different ? 0 : test.frame[i * 4 + 1] / 4;
+		diff[i * 4 + 2] = different ? 255 : test.frame[i * 4 + 2] / 4;
+		diff[i * 4 + 3] = 0;
+	}
+
+	double differentPercent = 100.0 * differentPixels / totalPixels;
+	bool passed = differentPercent <= options.maxDiffPercent;
+	sprintf(report, "%u px differ (%.3f%%), max channel difference %d", differentPixels, differentPercent, maxDifference);
+
+	if (passed == false && options.diffDir != NULL)
+	{
+		std::string file(test.name);
+		std::replace(file.begin(), file.end(), '/', '_');
+		std::string prefix = std::string(options.diffDir) + "/" + file;
+		WritePPM((prefix + "_actual.ppm").c_str(), &test.frame[0], test.width, test.height, test.width * 4);
+		WritePPM((prefix + "_diff.ppm").c_str(), &diff[0], test.width, test.height, test.width * 4);
+	}
+
+	return passed;
+}
+
+// The baseline is the JSON written by --write-baseline; a case per line.
+static bool ReadBaseline(const char* filename, std::map<std::string, double> &baseline)
+{
+	FILE* file = fopen(filename, "r");
+	if (file == NULL)
+		return false;
+
+	char line[512];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		char name[256];
+		double p50Ms = 0.0;
+		const char* entry = strstr(line, "{ \"name\"");
+		if (entry != NULL && sscanf(entry, "{ \"name\": \"%255[^\"]\", \"p50_ms\": %lf", name, &p50Ms) == 2)
+		{
+			baseline[name] = p50Ms;
+		}
+	}
+
+	fclose(file);
+	return true;
+}
+
+static bool WriteBaseline(const RegressOptions &options, const std::vector<RegressCase> &cases)
+{
+	FILE* file = fopen(options.writeBaselineFile, "w");
+	if (file == NULL)
+		return false;
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"config\": { \"threads\": %d, \"frames\": %d, \"warmup_frames\": %d },\n", options.threads, options.frames, options.warmupFrames);
+	fprintf(file, "  \"cases\": [\n");
+	for (size_t i = 0; i < cases.size(); i++)
+	{
+		fprintf(file, "    { \"name\": \"%s\", \"p50_ms\": %.4f }%s\n", cases[i].name.c_str(), cases[i].p50Ms, i + 1 < cases.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+
+	fclose(file);
+	return true;
+}
+
+static bool ParseOptions(int argc, char** argv, RegressOptions &options)
+{
+	options.goldenDir = SWR_REGRESS_GOLDEN_DIR;
+	options.resourceDir = SWR_REGRESS_RESOURCE_DIR;
+	options.filter = NULL;
+	options.baselineFile = NULL;
+	options.writeBaselineFile = NULL;
+	options.diffDir = ".";
+	options.tolerance = 2;
+	options.maxDiffPercent = 0.1;
+	options.thresholdPercent = 10.0;
+	options.frames = 20;
+	options.warmupFrames = 3;
+	options.threads = 2;
+	options.update = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--update") == 0)
+		{
+			options.update = true;
+			continue;
+		}
+
+		if (value == NULL)
+		{
+			fprintf(stderr, "Missing value for %s\n", arg);
+			return false;
+		}
+
+		if (strcmp(arg, "--golden") == 0)				options.goldenDir = value;
+		else if (strcmp(arg, "--resources") == 0)		options.resourceDir = value;
+		else if (strcmp(arg, "--filter") == 0)			options.filter = value;
+		else if (strcmp(arg, "--capture") == 0)			options.captures.push_back(value);
+		else if (strcmp(arg, "--baseline") == 0)		options.baselineFile = value;
+		else if (strcmp(arg, "--write-baseline") == 0)	options.writeBaselineFile = value;
+		else if (strcmp(arg, "--diff-dir") == 0)		options.diffDir = value;
+		else if (strcmp(arg, "--tolerance") == 0)		options.tolerance = atoi(value);
+		else if (strcmp(arg, "--max-diff") == 0)		options.maxDiffPercent = atof(value);
+		else if (strcmp(arg, "--threshold") == 0)		options.thresholdPercent = atof(value);
+		else if (strcmp(arg, "--frames") == 0)			options.frames = atoi(value);
+		else if (strcmp(arg, "--warmup") == 0)			options.warmupFrames = atoi(value);
+		else if (strcmp(arg, "--threads") == 0)			options.threads = atoi(value);
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", arg);
+			return false;
+		}
+
+		i++;
+	}
+
+	return options.frames > 0 && options.warmupFrames >= 0 && options.threads > 0 && options.tolerance >= 0;
+}
+
+// Renders the scripted scenes and any frame captures, and checks each frame against its golden
+// image and, given a baseline, its median frame time against the baseline's. Exits with 1 when
+// any case regresses.
+// Usage: swr_regress [--golden DIR] [--resources DIR] [--filter TEXT] [--capture FILE]...
+//                    [--tolerance N] [--max-diff PERCENT] [--diff-dir DIR]
+//                    [--baseline FILE] [--threshold PERCENT] [--write-baseline FILE]
+//                    [--frames N] [--warmup N] [--threads N] [--update]
+// --update rewrites the golden images from the frames rendered rather than checking them.
+// A capture's case is named after its file, without the directory or extension.
+int main(int argc, char** argv)
+{
+	RegressOptions options;
+	if (ParseOptions(argc, argv, options) == false)
+	{
+		fprintf(stderr, "Usage: swr_regress [--golden DIR] [--resources DIR] [--filter TEXT] [--capture FILE]... "
+			"[--tolerance N] [--max-diff PERCENT] [--diff-dir DIR] [--baseline FILE] [--threshold PERCENT] "
+			"[--write-baseline FILE] [--frames N] [--warmup N] [--threads N] [--update]\n");
+		return 1;
+	}
+
+	std::map<std::string, double> baseline;
+	if (options.baselineFile != NULL && ReadBaseline(options.baselineFile, baseline) == false)
+	{
+		fprintf(stderr, "Could not read the baseline %s.\n", options.baselineFile);
+		return 1;
+	}
+
+	RenderDevice device;
+	if (CreateBenchDevice(device, SCRIPTED_WIDTH, SCRIPTED_HEIGHT, (U16)options.threads) != SWR_OK)
+	{
+		fprintf(stderr, "Failed to create the render device.\n");
+		return 1;
+	}
+
+	// Render everything first, so the timings aren't disturbed by the image checks.
+	std::vector<RegressCase> cases;
+	std::map<std::string, BenchScene*> scenes;
+	int failures = 0;
+
+	for (int i = 0; i < TOTAL_SCRIPTED_CASES + (int)options.captures.size(); i++)
+	{
+		RegressCase test;
+		test.width = 0;
+		test.height = 0;
+		test.p50Ms = 0.0;
+		test.failed = false;
+
+		const char* captureFile = i < TOTAL_SCRIPTED_CASES ? NULL : options.captures[i - TOTAL_SCRIPTED_CASES];
+		if (captureFile == NULL)
+		{
+			test.name = SCRIPTED_CASES[i];
+		}
+		else
+		{
+			std::string file(captureFile);
+			size_t start = file.find_last_of("/\\");
+			start = start == std::string::npos ? 0 : start + 1;
+			size_t end = file.rfind('.');
+			test.name = file.substr(start, end != std::string::npos && end > start ? end - start : std::string::npos);
+		}
+
+		if (options.filter != NULL && strstr(test.name.c_str(), options.filter) == NULL)
+			continue;
+
+		bool rendered = captureFile == NULL ? RunScripted(device, options, scenes, test) : RunCapture(options, captureFile, test);
+		if (rendered == false)
+		{
+			printf("[FAIL] %s: not rendered\n", test.name.c_str());
+			failures++;
+			continue;
+		}
+
+		cases.push_back(test);
+	}
+
+	for (std::map<std::string, BenchScene*>::iterator it = scenes.begin(); it != scenes.end(); ++it)
+	{
+		delete it->second;
+	}
+
+	device.Release();
+
+	for (size_t i = 0; i < cases.size(); i++)
+	{
+		RegressCase &test = cases[i];
+
+		if (options.update)
+		{
+			std::string goldenFile = GoldenPath(options, test.name, ".ppm");
+			bool written = WritePPM(goldenFile.c_str(), &test.frame[0], test.width, test.height, test.width * 4) == SWR_OK;
+			printf("[%s] %s: %s %s\n", written ? "UPDT" : "FAIL", test.name.c_str(), written ? "wrote" : "could not write", goldenFile.c_str());
+			failures += written ? 0 : 1;
+			continue;
+		}
+
+		char imageReport[512];
+		bool imagePassed = CheckGolden(options, test, imageReport);
+
+		char timeReport[128];
+		bool timePassed = true;
+		std::map<std::string, double>::const_iterator base = baseline.find(test.name);
+		if (base != baseline.end() && base->second > 0.0)
+		{
+			double change = (test.p50Ms / base->second - 1.0) * 100.0;
+			timePassed = change <= options.thresholdPercent;
+			sprintf(timeReport, "%.4f ms, baseline %.4f ms (%+.1f%%)", test.p50Ms, base->second, change);
+		}
+		else
+		{
+			sprintf(timeReport, "%.4f ms%s", test.p50Ms, options.baselineFile != NULL ? ", not in the baseline" : "");
+		}
+
+		test.failed = imagePassed == false || timePassed == false;
+		failures += test.failed ? 1 : 0;
+
+		printf("[%s] %s\n", test.failed ? "FAIL" : " OK ", test.name.c_str());
+		printf("    image: %s%s\n", imageReport, imagePassed ? "" : " -- REGRESSED");
+		printf("    time:  %s%s\n", timeReport, timePassed ? "" : " -- REGRESSED");
+	}
+
+	if (options.writeBaselineFile != NULL && WriteBaseline(options, cases) == false)
+	{
+		fprintf(stderr, "Could not write the baseline %s.\n", options.writeBaselineFile);
+		failures++;
+	}
+
+	printf("%u case(s) run, %i failed.\n", (U32)cases.size(), failures);
+	return failures == 0 && cases.empty() == false ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+//****************************************************************************
+//**
+//**    ReplayMain.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "FrameReplay.h"
+#include "PPMFile.h"
+#include "Timer.h"
+#include "FrameTimeHistogram.h"
+
+using namespace SWR;
+
+struct ReplayOptions
+{
+	const char* captureFile;
+	int frames;
+	int warmupFrames;
+	int threads;
+	const char* outFile;
+	const char* imageFile;
+};
+
+static bool ParseOptions(int argc, char** argv, ReplayOptions &options)
+{
+	options.captureFile = NULL;
+	options.frames = 100;
+	options.warmupFrames = 10;
+	options.threads = 4;
+	options.outFile = NULL;
+	options.imageFile = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (arg[0] != '-')
+		{
+			options.captureFile = arg;
+			continue;
+		}
+
+		if (value == NULL)
+		{
+			fprintf(stderr, "Missing value for %s\n", arg);
+			return false;
+		}
+
+		if (strcmp(arg, "--frames") == 0)			options.frames = atoi(value);
+		else if (strcmp(arg, "--warmup") == 0)		options.warmupFrames = atoi(value);
+		else if (strcmp(arg, "--threads") == 0)		options.threads = atoi(value);
+		else if (strcmp(arg, "--out") == 0)			options.outFile = value;
+		else if (strcmp(arg, "--image") == 0)		options.imageFile = value;
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", arg);
+			return false;
+		}
+
+		i++;
+	}
+
+	return options.captureFile != NULL && options.frames > 0 && options.warmupFrames >= 0 && options.threads > 0;
+}
+
+// Plays a frame captured with RenderDevice::BeginCapture over and over, and writes its timings as JSON.
+// Usage: swr_replay CAPTURE [--frames N] [--warmup N] [--threads N] [--out FILE] [--image FILE]
+// --image writes the last frame played as a PPM.
+int main(int argc, char** argv)
+{
+	ReplayOptions options;
+	if (ParseOptions(argc, argv, options) == false)
+	{
+		fprintf(stderr, "Usage: swr_replay CAPTURE [--frames N] [--warmup N] [--threads N] [--out FILE] [--image FILE]\n");
+		return 1;
+	}
+
+	FrameReplay replay;
+	if (replay.Load(options.captureFile) != SWR_OK)
+	{
+		fprintf(stderr, "Failed to load the frame capture %s.\n", options.captureFile);
+		return 1;
+	}
+
+	SWRInitParams params;
+	replay.GetInitParams(params);
+	params.totalRenderThreads = (U16)options.threads;
+
+	RenderDevice device;
+	if (device.Initilise(params) != SWR_OK)
+	{
+		fprintf(stderr, "Failed to create the render device.\n");
+		return 1;
+	}
+
+	Timer timer;
+	FrameTimeHistogram frameMs(options.frames);
+
+	for (int i = 0; i < options.warmupFrames + options.frames; i++)
+	{
+		if (i == options.warmupFrames)
+		{
+			device.ResetStatsCounters();
+		}
+
+		timer.Tick();
+		SWR_ERR result = replay.Play(device);
+		timer.Tick();
+
+		if (result != SWR_OK)
+		{
+			fprintf(stderr, "Failed to play the frame capture %s.\n", options.captureFile);
+			device.Release();
+			return 1;
+		}
+
+		if (i >= options.warmupFrames)
+		{
+			frameMs.AddSample(timer.getDeltaTime() * 1000.0);
+		}
+	}
+
+	if (options.imageFile != NULL && replay.GetFrame() != NULL)
+	{
+		if (WritePPM(options.imageFile, replay.GetFrame(), replay.GetWidth(), replay.GetHeight(), replay.GetFramePitch()) != SWR_OK)
+		{
+			fprintf(stderr, "Could not write the frame to %s.\n", options.imageFile);
+		}
+	}
+
+	RenderStats stats = device.GetStats();
+	device.Release();
+
+	FILE* out = stdout;
+	if (options.outFile != NULL)
+	{
+		out = fopen(options.outFile, "w");
+		if (out == NULL)
+		{
+			fprintf(stderr, "Could not open %s for writing.\n", options.outFile);
+			return 1;
+		}
+	}
+
+	U64 frames = (U64)options.frames;
+	fprintf(out, "{\n");
+	fprintf(out, "  \"config\": { \"capture\": \"%s\", \"width\": %u, \"height\": %u, \"threads\": %d, \"frames\": %d, \"warmup_frames\": %d },\n",
+		options.captureFile, replay.GetWidth(), replay.GetHeight(), options.threads, options.frames, options.warmupFrames);
+	fprintf(out, "  \"tris_submitted\": %llu, \"tris_drawn\": %llu, \"verts_transformed\": %llu, \"pixels_shaded\": %llu, \"texels_fetched\": %llu, \"bytes_written\": %llu, \"transient_bytes\": %llu, \"coverage\": %.3f,\n",
+		stats.trisSubmitted / frames, stats.trisDrawn / frames, stats.vertsTransformed / frames, stats.pixelsShaded / frames,
+		stats.texelsFetched / frames, stats.bytesWritten / frames, stats.transientBytes / frames, stats.GetCoverageRatio());
+	fprintf(out, "  \"frame_ms\": { \"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }\n",
+		frameMs.GetMin(), frameMs.GetMean(), frameMs.GetPercentile(50.0), frameMs.GetPercentile(90.0), frameMs.GetPercentile(99.0), frameMs.GetMax());
+	fprintf(out, "}\n");
+
+	if (out != stdout)
+	{
+		fclose(out);
+	}
+
+	return 0;
+}
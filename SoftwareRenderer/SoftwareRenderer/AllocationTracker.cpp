@@ -0,0 +1,285 @@
+//****************************************************************************
+//**
+//**    AllocationTracker.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "AllocationTracker.h"
+
+#ifdef SWR_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include "Logger.h"
+
+// No MemoryLeak.h; this file is what new and delete go through.
+
+namespace SWR
+{
+	// Put in front of each block; padded to malloc's alignment so the block keeps it, on 32 bit
+	// builds as well as 64 bit ones.
+	struct alignas(std::max_align_t) AllocationHeader
+	{
+		size_t size;
+		size_t subsystem;
+	};
+
+	struct SubsystemCounts
+	{
+		std::atomic<U64> allocations;
+		std::atomic<U64> bytes;
+	};
+
+	// Frames that failed the check are only logged in full for the first few.
+	static const U32 MAX_LOGGED_FAILURES = 10;
+
+	// Subsystem 0 is everything outside a scope. Names are only added, under the lock.
+	static const char* s_names[AllocationTracker::MAX_SUBSYSTEMS] = { "Other" };
+	static std::atomic<int> s_totalSubsystems(1);
+	static std::mutex s_registerLock;
+
+	static SubsystemCounts s_frame[AllocationTracker::MAX_SUBSYSTEMS];
+	static AllocationCounts s_lastFrame[AllocationTracker::MAX_SUBSYSTEMS];
+
+	static std::atomic<U64> s_totalAllocations(0);
+	static std::atomic<U64> s_totalBytes(0);
+	static std::atomic<U64> s_liveBytes(0);
+
+	static std::atomic<bool> s_expectNone(false);
+	static std::atomic<U32> s_totalFailedFrames(0);
+
+	static thread_local const char* t_name = NULL;
+	static thread_local int t_subsystem = 0;
+
+	static int FindSubsystem(const char* name, int total)
+	{
+		for (int i = 0; i < total; i++)
+		{
+			if (s_names[i] == name)
+				return i;
+		}
+
+		for (int i = 0; i < total; i++)
+		{
+			if (strcmp(s_names[i], name) == 0)
+				return i;
+		}
+
+		return -1;
+	}
+
+	static int RegisterSubsystem(const char* name)
+	{
+		if (name == NULL)
+			return 0;
+
+		int subsystem = FindSubsystem(name, s_totalSubsystems.load(std::memory_order_acquire));
+		if (subsystem >= 0)
+			return subsystem;
+
+		std::lock_guard<std::mutex> lock(s_registerLock);
+
+		int total = s_totalSubsystems.load(std::memory_order_relaxed);
+		subsystem = FindSubsystem(name, total);
+		if (subsystem >= 0)
+			return subsystem;
+
+		// Out of room; charge the rest to Other.
+		if (total == AllocationTracker::MAX_SUBSYSTEMS)
+			return 0;
+
+		s_names[total] = name;
+		s_totalSubsystems.store(total + 1, std::memory_order_release);
+		return total;
+	}
+
+	void* AllocationTracker::Allocate(size_t size)
+	{
+		AllocationHeader* header = (AllocationHeader*)malloc(sizeof(AllocationHeader) + size);
+		if (header == NULL)
+			return NULL;
+
+		header->size = size;
+		header->subsystem = (size_t)t_subsystem;
+
+		SubsystemCounts& counts = s_frame[t_subsystem];
+		counts.allocations.fetch_add(1, std::memory_order_relaxed);
+		counts.bytes.fetch_add(size, std::memory_order_relaxed);
+
+		s_totalAllocations.fetch_add(1, std::memory_order_relaxed);
+		s_totalBytes.fetch_add(size, std::memory_order_relaxed);
+		s_liveBytes.fetch_add(size, std::memory_order_relaxed);
+
+		return header + 1;
+	}
+
+	void AllocationTracker::Free(void* memory)
+	{
+		if (memory == NULL)
+			return;
+
+		AllocationHeader* header = (AllocationHeader*)memory - 1;
+		s_liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+		free(header);
+	}
+
+	const char* AllocationTracker::SetSubsystem(const char* name)
+	{
+		const char* previous = t_name;
+		t_name = name;
+		t_subsystem = RegisterSubsystem(name);
+		return previous;
+	}
+
+	void AllocationTracker::EndFrame()
+	{
+		AllocationCounts frame = { 0, 0 };
+		int total = s_totalSubsystems.load(std::memory_order_acquire);
+		for (int i = 0; i < total; i++)
+		{
+			s_lastFrame[i].allocations = s_frame[i].allocations.exchange(0, std::memory_order_relaxed);
+			s_lastFrame[i].bytes = s_frame[i].bytes.exchange(0, std::memory_order_relaxed);
+			frame.allocations += s_lastFrame[i].allocations;
+			frame.bytes += s_lastFrame[i].bytes;
+		}
+
+		if (s_expectNone.load(std::memory_order_relaxed) == false || frame.allocations == 0)
+			return;
+
+		U32 failed = ++s_totalFailedFrames;
+		if (failed > MAX_LOGGED_FAILURES)
+			return;
+
+		LOGF(LOG_Error, "AllocationTracker: frame made %llu allocations (%llu bytes) after warm up", frame.allocations, frame.bytes);
+		for (int i = 0; i < total; i++)
+		{
+			if (s_lastFrame[i].allocations > 0)
+			{
+				LOGF(LOG_Error, "AllocationTracker:   %-16.64s %llu allocations, %llu bytes", s_names[i], s_lastFrame[i].allocations, s_lastFrame[i].bytes);
+			}
+		}
+
+		if (failed == MAX_LOGGED_FAILURES)
+		{
+			LOG("AllocationTracker: further failed frames are only counted", LOG_Error);
+		}
+	}
+
+	AllocationCounts AllocationTracker::GetFrameCounts()
+	{
+		AllocationCounts frame = { 0, 0 };
+		int total = s_totalSubsystems.load(std::memory_order_acquire);
+		for (int i = 0; i < total; i++)
+		{
+			frame.allocations += s_lastFrame[i].allocations;
+			frame.bytes += s_lastFrame[i].bytes;
+		}
+
+		return frame;
+	}
+
+	int AllocationTracker::GetTotalSubsystems()
+	{
+		return s_totalSubsystems.load(std::memory_order_acquire);
+	}
+
+	const char* AllocationTracker::GetSubsystemName(int subsystem)
+	{
+		return subsystem >= 0 && subsystem < GetTotalSubsystems() ? s_names[subsystem] : NULL;
+	}
+
+	AllocationCounts AllocationTracker::GetSubsystemFrameCounts(int subsystem)
+	{
+		AllocationCounts none = { 0, 0 };
+		return subsystem >= 0 && subsystem < GetTotalSubsystems() ? s_lastFrame[subsystem] : none;
+	}
+
+	AllocationCounts AllocationTracker::GetTotalCounts()
+	{
+		AllocationCounts counts = { s_totalAllocations.load(std::memory_order_relaxed), s_totalBytes.load(std::memory_order_relaxed) };
+		return counts;
+	}
+
+	U64 AllocationTracker::GetLiveBytes()
+	{
+		return s_liveBytes.load(std::memory_order_relaxed);
+	}
+
+	void AllocationTracker::SetExpectNoAllocations(bool expect)
+	{
+		s_expectNone.store(expect, std::memory_order_relaxed);
+	}
+
+	U32 AllocationTracker::GetTotalFailedFrames()
+	{
+		return s_totalFailedFrames.load(std::memory_order_relaxed);
+	}
+
+}; // End namespace SWR.
+
+// The global new and delete, so the standard containers are counted too.
+
+void* operator new(size_t size)
+{
+	void* memory = SWR::AllocationTracker::Allocate(size);
+	if (memory == NULL)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return SWR::AllocationTracker::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return SWR::AllocationTracker::Allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	SWR::AllocationTracker::Free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	SWR::AllocationTracker::Free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	SWR::AllocationTracker::Free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	SWR::AllocationTracker::Free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	SWR::AllocationTracker::Free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	SWR::AllocationTracker::Free(memory);
+}
+
+#endif // #ifdef SWR_TRACK_ALLOCATIONS
@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+//****************************************************************************
+//**
+//**    AllocationTracker.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+// Counting of heap allocations per frame and per subsystem. Only built when SWR_TRACK_ALLOCATIONS
+// is defined; it then replaces the global operator new and delete, and SWR_MALLOC and SWR_FREE
+// count the renderer's own malloc calls. Otherwise the macros below are plain malloc and free, or
+// nothing, and none of the tracker is compiled.
+//
+//     SWR_ALLOC_SCOPE("Textures");  // Charges the rest of the block's allocations to Textures.
+//     SWR_ALLOC_FRAME();            // Ends a frame's counts; the render device does this in Present.
+//
+// The profiler's stage scopes are allocation scopes as well, so allocations are charged to the
+// pipeline stage that made them. Allocations outside any scope are charged to "Other".
+//
+// Once the renderer has warmed up a frame should not allocate at all. SetExpectNoAllocations
+// turns on the check; each frame that allocates after that is logged with its subsystems and
+// counted as failed.
+
+#include <cstdlib>
+
+#ifdef SWR_TRACK_ALLOCATIONS
+
+#include <cstddef>
+
+#include "DataTypes.h"
+
+namespace SWR
+{
+	struct AllocationCounts
+	{
+		U64 allocations;
+		U64 bytes;
+	};
+
+	// ------------------------------------------------------------------------
+	//								AllocationTracker
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Every tracked block carries a small header with its size and the
+	// subsystem that allocated it, so frees can be counted as well. Counting
+	// takes no locks; the counters are atomics, and the subsystem being
+	// charged is per thread.
+	// ------------------------------------------------------------------------
+	class AllocationTracker
+	{
+	public:
+		enum { MAX_SUBSYSTEMS = 32 };
+
+		static void* Allocate(size_t size);
+		static void Free(void* memory);
+
+		// Sets the subsystem the calling thread's allocations are charged to, returning the last.
+		// The name must be a string literal, or otherwise outlive the tracker.
+		static const char* SetSubsystem(const char* name);
+
+		// Ends the frame's counts, checking them if no allocations are expected.
+		static void EndFrame();
+
+		// The counts of the last finished frame, in total and per subsystem.
+		static AllocationCounts GetFrameCounts();
+		static int GetTotalSubsystems();
+		static const char* GetSubsystemName(int subsystem);
+		static AllocationCounts GetSubsystemFrameCounts(int subsystem);
+
+		// Since the start of the program.
+		static AllocationCounts GetTotalCounts();
+		static U64 GetLiveBytes();
+
+		// From the next frame on, frames that allocate are logged and counted as failed.
+		static void SetExpectNoAllocations(bool expect);
+		static U32 GetTotalFailedFrames();
+	};
+
+	// Charges the allocations made until its destruction to a subsystem.
+	class AllocationScope
+	{
+	private:
+		const char* m_previous;
+	public:
+		inline AllocationScope(const char* name)
+			: m_previous(AllocationTracker::SetSubsystem(name))
+		{
+		}
+
+		inline ~AllocationScope()
+		{
+			AllocationTracker::SetSubsystem(m_previous);
+		}
+	};
+
+}; // End namespace SWR.
+
+#define SWR_ALLOC_CONCAT_INNER(a, b) a##b
+#define SWR_ALLOC_CONCAT(a, b) SWR_ALLOC_CONCAT_INNER(a, b)
+#define SWR_ALLOC_SCOPE(name) SWR::AllocationScope SWR_ALLOC_CONCAT(allocScope, __LINE__)(name)
+#define SWR_ALLOC_FRAME() SWR::AllocationTracker::EndFrame()
+#define SWR_MALLOC(size) SWR::AllocationTracker::Allocate(size)
+#define SWR_FREE(memory) SWR::AllocationTracker::Free(memory)
+
+#else
+
+#define SWR_ALLOC_SCOPE(name)
+#define SWR_ALLOC_FRAME()
+#define SWR_MALLOC(size) malloc(size)
+#define SWR_FREE(memory) free(memory)
+
+#endif // #ifdef SWR_TRACK_ALLOCATIONS
+
+#endif // #ifndef ALLOCATION_TRACKER_H
@@ -24,6 +24,11 @@
 namespace SWR
 {
 	bool inFocus = false;
+
+	// The budgets of a 60 FPS frame, in seconds; times over them are counted by the timer.
+	static const float FRAME_BUDGET = 1.0f / 60.0f;
+	static const float UPDATE_BUDGET = 0.004f;
+	static const float RENDER_BUDGET = 0.012f;
 	
 	// Windows message handling function.
 	LRESULT CALLBACK Application::WinProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -106,11 +111,15 @@ namespace SWR
 	SWR_ERR Application::Startup(const ApplicationSettings &settings)
 	{
 		gLogger.EnableConsoleDumping(true);
+		gLogger.SetLogFile("SWRDebugLog.txt");
 
 		m_settings = new ApplicationSettings(settings);
 		inFocus = false;
 
 		m_timer = new Timer();
+		m_timer->SetFrameBudget(FRAME_BUDGET);
+		m_updateStage = m_timer->AddStage("Update", UPDATE_BUDGET);
+		m_renderStage = m_timer->AddStage("Render", RENDER_BUDGET);
 		m_timer->Tick();
 
 		ZeroMemory(&wc, sizeof(WNDCLASS));
@@ -243,6 +252,7 @@ namespace SWR
 
 		if (m_timer != NULL)
 		{
+			m_timer->LogReport();
 			delete m_timer;
 			m_timer = NULL;
 		}
@@ -314,8 +324,14 @@ namespace SWR
 			}
 
 			// Update and render the applications.
+			m_timer->BeginStage(m_updateStage);
 			FrameStartTick();
+			m_timer->EndStage(m_updateStage);
+
+			m_timer->BeginStage(m_renderStage);
 			RenderFrame();
+			m_timer->EndStage(m_renderStage);
+
 			FrameEndTick();
 		}
 
@@ -379,4 +395,9 @@ namespace SWR
 		return this->m_timer->GetFPS();
 	}
 
+	const Timer* Application::GetTimer() const
+	{
+		return m_timer;
+	}
+
 }; // End namespace SWR.
\ No newline at end of file
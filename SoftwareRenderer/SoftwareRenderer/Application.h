@@ -49,6 +49,10 @@ namespace SWR
 		ApplicationSettings* m_settings;
 		Timer* m_timer;
 
+		// The stages of the frame the timer keeps times for.
+		int m_updateStage;
+		int m_renderStage;
+
 		// The frame listeners for the application
 		std::vector<FrameListener*> m_listeners;
 
@@ -86,6 +90,9 @@ namespace SWR
 
 		int GetFPS();
 
+		// The frame and stage times, for their percentiles and budgets.
+		const Timer* GetTimer() const;
+
 		RenderDevice* GetRenderDevice();
 	};
 	
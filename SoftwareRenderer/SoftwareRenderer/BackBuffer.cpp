@@ -10,6 +10,8 @@
 //****************************************************************************
 
 #include <assert.h>
+#include <cstdio>
+#include <cstring>
 
 #include "BackBuffer.h"
 #include "Colour.h"
@@ -24,12 +26,19 @@
 namespace SWR
 {
 	BackBuffer::BackBuffer()
-		: bufDevContext(NULL)
-		, parentDevContext(NULL)
-		, bufferBmp(NULL)
-		, defBmp(NULL)
+		: m_heapBuffer(false)
 		, bitBuffer(NULL)
+		, byteBuffer(NULL)
+		, m_width(0)
+		, m_height(0)
+		, m_pitch(0)
 	{
+#ifdef SWR_PLATFORM_WIN32
+		bufDevContext = NULL;
+		parentDevContext = NULL;
+		bufferBmp = NULL;
+		defBmp = NULL;
+#endif
 		// Constructor only initilises to default.
 	}
 
@@ -38,6 +47,46 @@ namespace SWR
 		// All releasing is done through the release method.
 	}
 
+	void BackBuffer::SetDimensions(U16 width, U16 height, U32 pitch)
+	{
+		m_width	= width;
+		m_height = height;
+		m_pitch = pitch;
+
+		// Clear in whole chunks of PIXELS_PER_WRITE pixels, then pixel by pixel for the rest.
+		m_buffSize = (m_pitch >> 2) * (U32)m_height;
+		m_buffChunks = m_buffSize / PIXELS_PER_WRITE;
+		m_buffChunkSize = m_buffChunks * PIXELS_PER_WRITE;
+		m_buffSizeRemainder = m_buffSize - m_buffChunkSize;
+	}
+
+	SWR_ERR BackBuffer::CreateBuffer(U16 width, U16 height)
+	{
+		assert(bitBuffer == NULL);
+
+		if (width < 1 || height < 1)
+		{
+			LOG("Invalid back-buffer dimensions.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		U32 pitch = AlignPitch((U32)width * 4);
+		bitBuffer = AlignedAlloc((size_t)pitch * height, SWR_SURFACE_ALIGNMENT);
+		if (bitBuffer == NULL)
+		{
+			LOG("Back-buffer allocation has failed.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		m_heapBuffer = true;
+		byteBuffer = (U8*)bitBuffer;
+		SetDimensions(width, height, pitch);
+
+		LOG("Headless back-buffer initilisation successful.", LOG_Init);
+		return SWR_OK;
+	}
+
+#ifdef SWR_PLATFORM_WIN32
 	SWR_ERR BackBuffer::CreateBuffer(U16 width, U16 height, HDC winDevContext)
 	{
 		// The following code is modified from an application called simple3D.
@@ -53,7 +102,7 @@ namespace SWR
 		bmpInfo = (BITMAPINFO*)data;
 		bmpInfo->bmiHeader.biSize			= sizeof(BITMAPINFOHEADER);
 		bmpInfo->bmiHeader.biWidth			= width;
-		bmpInfo->bmiHeader.biHeight			= -((long)width);		// DIBs are initially flipped
+		bmpInfo->bmiHeader.biHeight			= -((long)height);		// DIBs are initially flipped
 		bmpInfo->bmiHeader.biBitCount		= 32;
 		bmpInfo->bmiHeader.biPlanes			= 1;
 		bmpInfo->bmiHeader.biCompression	= BI_RGB;
@@ -90,26 +139,10 @@ namespace SWR
 		delete [] data;
 
 		parentDevContext = winDevContext;
+		m_heapBuffer = false;
 
-		m_width	= width;
-		m_height = height;
-		//pitch	= width;
-
-		m_buffSize = (U32)m_width * (U32)m_height;
-		m_buffChunks = m_buffSize / (PIXELS_PER_WRITE * 4); // Calculate how many byte chunks we have that are within the buffer size.
-		m_buffSizeRemainder = m_buffSize % m_buffChunks;
-		m_buffChunkSize = m_buffSize - m_buffSizeRemainder;
-
-		// Just for sanities sake, check to see if the user created a back-buffer with a size that isnt going to 
-		// break the cache optimising technique. 
-		if (m_buffSize < PIXELS_PER_WRITE *4)
-		{
-			char buff[256] = {0};
-			sprintf(buff, "Back-buffer size is less that the optimised pixel cache size of: %i", PIXELS_PER_WRITE);
-			LOG(buff, LOG_Error);
-			return SWR_FAIL;
-
-		}
+		// 32 bit DIB rows are never padded.
+		SetDimensions(width, height, (U32)width * 4);
 
 		// Cast the bit buffer to the byteBuffer so we dont have to do a cast every time we want to plot a pixel.
 		byteBuffer = (U8*)bitBuffer;
@@ -117,9 +150,17 @@ namespace SWR
 		LOG("Back-buffer initilisation successful.", LOG_Init);
 		return SWR_OK;
 	}
+#endif // #ifdef SWR_PLATFORM_WIN32
 	
 	void BackBuffer::ReleaseBuffer()
 	{
+		if (m_heapBuffer)
+		{
+			AlignedFree(bitBuffer);
+			m_heapBuffer = false;
+		}
+
+#ifdef SWR_PLATFORM_WIN32
 		if(bufferBmp != NULL)
 		{
 			if(bufDevContext != NULL)
@@ -137,6 +178,7 @@ namespace SWR
 			DeleteObject(bufferBmp);
 			bufferBmp = NULL;
 		}
+#endif
 
 		bitBuffer = NULL;
 		byteBuffer = NULL;
@@ -194,21 +236,23 @@ namespace SWR
 	// Uh yeah, this is extremely slow and should never be used.
 	void BackBuffer::PlotPixel(U16 x, U16 y, U32 color)
 	{
-		// Calculate the index into the buffer.
-		U32 index = (x + (y * m_width)) << 2; // or *4
-
 		// Check for overflow.
-		if (x + (y * m_width) > m_width * m_height)
+		if (x >= m_width || y >= m_height)
 			return;
 
+		// Calculate the index into the buffer.
+		U32 index = (x << 2) + y * m_pitch;
+
 		// Copy the 4 bytes of the clear colour into our buffer.
 		memcpy(&(byteBuffer[index]), &color, 4);
 	}
 
+#ifdef SWR_PLATFORM_WIN32
 	HDC BackBuffer::GetDeviceContext()
 	{
 		return bufDevContext;
 	}
+#endif
 
 	void* BackBuffer::GetBitBuffer()
 	{
@@ -229,5 +273,10 @@ namespace SWR
 	{
 		return m_height;
 	}
+
+	U32 BackBuffer::GetPitch() const
+	{
+		return m_pitch;
+	}
 	
 }; // End namespace SWR.
\ No newline at end of file
@@ -14,7 +14,7 @@
 //**
 //****************************************************************************
 
-#include <windows.h>
+#include "Platform.h"
 #include "DataTypes.h"
 
 // Forward Declarations
@@ -30,10 +30,14 @@ namespace SWR
 	// ------------------------------------------------------------------------
 	// Desc:
 	// Represents the back-buffer that is presented to a window.
+	// Without a window the pixels are kept in aligned heap memory instead,
+	// and read back by the application. Heap rows are padded so each starts
+	// on a cache line, so rows are GetPitch() bytes apart, not width * 4.
 	// ------------------------------------------------------------------------
 	class BackBuffer
 	{
 	private:
+#ifdef SWR_PLATFORM_WIN32
 		// The windows device contexts.
 		HDC bufDevContext;
 		HDC parentDevContext;
@@ -41,6 +45,10 @@ namespace SWR
 		// Bitmap buffer.
 		HBITMAP		bufferBmp;
 		HBITMAP		defBmp;
+#endif
+
+		// If the pixels are in heap memory rather than a DIB section.
+		bool m_heapBuffer;
 
 		void* bitBuffer;
 		U8* byteBuffer; // Just the bitbuffer casted so we dont have to cast every pixel we plot.
@@ -48,19 +56,28 @@ namespace SWR
 
 		U16 m_width;
 		U16 m_height;
+		U32 m_pitch; // Bytes between the start of each row.
 
 		// These are precalculated buffer/chunk sizes to help optimise buffer clearing.
+		// They cover the padding at the end of the rows as well.
 		U32 m_buffSize;
 		U32 m_buffChunks; // The number of 2048 byte chunks in the buffer.
 		U32 m_buffChunkSize;
 		U32 m_buffSizeRemainder;
 
+		// Sets the size and precalculates the clearing chunks.
+		void SetDimensions(U16 width, U16 height, U32 pitch);
+
 	protected:
 	public:
 		BackBuffer();
 		~BackBuffer();
 
+		// Creates the buffer in heap memory, for rendering without a window.
+		SWR_ERR CreateBuffer(U16 width, U16 height);
+#ifdef SWR_PLATFORM_WIN32
 		SWR_ERR CreateBuffer(U16 width, U16 height, HDC winDevContext);
+#endif
 		void ReleaseBuffer();
 
 		// Optimised clear function.
@@ -72,12 +89,15 @@ namespace SWR
 		// Retrieve the byte buffer and write pixels that way, your code will perform better methinks.
 		void PlotPixel(U16 x, U16 y, U32 color); 
 
+#ifdef SWR_PLATFORM_WIN32
 		HDC GetDeviceContext();
+#endif
 		void* GetBitBuffer();
 		U8* GetByteBuffer();
 
 		U32 GetWidth() const;
 		U32 GetHeight() const;
+		U32 GetPitch() const;
 	};
 	
 }; // End namespace SWR.
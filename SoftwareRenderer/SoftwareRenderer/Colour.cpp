@@ -9,7 +9,7 @@
 //**
 //****************************************************************************
 
-#include <Windows.h>
+#include <cstdlib>
 
 #include "Colour.h"
 #include "MemoryLeak.h"
@@ -32,6 +32,8 @@ namespace SWR
 	typedef signed short S16;
 	typedef unsigned int U32;
 	typedef signed int S32;
+	typedef unsigned long long U64;
+	typedef signed long long S64;
 	typedef float Real;
 	
 }; // End namespace SWR.
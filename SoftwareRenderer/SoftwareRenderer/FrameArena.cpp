@@ -0,0 +1,165 @@
+//****************************************************************************
+//**
+//**    FrameArena.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstddef>
+
+#include "FrameArena.h"
+
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	// Rounds the address up to the alignment, a power of 2.
+	static inline U8* AlignUp(U8* address, U32 alignment)
+	{
+		size_t mask = (size_t)alignment - 1;
+		return (U8*)(((size_t)address + mask) & ~mask);
+	}
+
+	FrameArena::FrameArena()
+		: m_block(NULL)
+		, m_capacity(0)
+		, m_offset(0)
+		, m_overflowBlock(NULL)
+		, m_overflowCapacity(0)
+		, m_overflowOffset(0)
+		, m_used(0)
+		, m_highWaterMark(0)
+		, m_totalGrowths(0)
+	{
+	}
+
+	FrameArena::~FrameArena()
+	{
+		Release();
+	}
+
+	SWR_ERR FrameArena::Initilise(U32 capacity)
+	{
+		Release();
+
+		if (capacity > 0)
+		{
+			m_block = new U8[capacity];
+			m_capacity = capacity;
+		}
+
+		return SWR_OK;
+	}
+
+	void FrameArena::Release()
+	{
+		FreeOverflow();
+
+		if (m_block != NULL)
+		{
+			delete [] m_block;
+			m_block = NULL;
+		}
+
+		m_capacity = 0;
+		m_offset = 0;
+		m_used = 0;
+	}
+
+	void* FrameArena::Allocate(U32 size, U32 alignment)
+	{
+		if (m_block != NULL)
+		{
+			U8* start = AlignUp(m_block + m_offset, alignment);
+			U32 end = (U32)(start - m_block) + size;
+			if (end <= m_capacity)
+			{
+				m_used += end - m_offset;
+				m_offset = end;
+				return start;
+			}
+		}
+
+		return AllocateOverflow(size, alignment);
+	}
+
+	void* FrameArena::AllocateOverflow(U32 size, U32 alignment)
+	{
+		U8* start = NULL;
+		U32 end = 0;
+		if (m_overflowBlock != NULL)
+		{
+			start = AlignUp(m_overflowBlock + m_overflowOffset, alignment);
+			end = (U32)(start - m_overflowBlock) + size;
+		}
+
+		if (m_overflowBlock == NULL || end > m_overflowCapacity)
+		{
+			// At least as big as the main block, so a frame that overflows takes few of them.
+			m_overflowCapacity = size + alignment > m_capacity ? size + alignment : m_capacity;
+			m_overflowBlock = new U8[m_overflowCapacity];
+			m_overflow.push_back(m_overflowBlock);
+
+			start = AlignUp(m_overflowBlock, alignment);
+			end = (U32)(start - m_overflowBlock) + size;
+			m_overflowOffset = 0;
+		}
+
+		m_used += end - m_overflowOffset;
+		m_overflowOffset = end;
+		return start;
+	}
+
+	void FrameArena::FreeOverflow()
+	{
+		for (size_t i = 0; i < m_overflow.size(); i++)
+		{
+			delete [] m_overflow[i];
+		}
+
+		m_overflow.clear();
+		m_overflowBlock = NULL;
+		m_overflowCapacity = 0;
+		m_overflowOffset = 0;
+	}
+
+	void FrameArena::Reset()
+	{
+		m_highWaterMark = m_used > m_highWaterMark ? m_used : m_highWaterMark;
+
+		// The frame didn't fit; make room for the most any frame has used, and a quarter more.
+		if (m_overflow.empty() == false)
+		{
+			Initilise(m_highWaterMark + m_highWaterMark / 4);
+			m_totalGrowths++;
+		}
+
+		m_offset = 0;
+		m_used = 0;
+	}
+
+	U32 FrameArena::GetUsed() const
+	{
+		return m_used;
+	}
+
+	U32 FrameArena::GetCapacity() const
+	{
+		return m_capacity;
+	}
+
+	U32 FrameArena::GetHighWaterMark() const
+	{
+		return m_used > m_highWaterMark ? m_used : m_highWaterMark;
+	}
+
+	U32 FrameArena::GetTotalGrowths() const
+	{
+		return m_totalGrowths;
+	}
+
+}; // End namespace SWR.
@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+//****************************************************************************
+//**
+//**    FrameArena.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <new>
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								FrameArena
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A linear allocator for the data that only lives until the end of the
+	// frame; clipped geometry, light lists and the like. Allocating bumps
+	// an offset and Reset frees everything at once.
+	// When the block runs out the arena takes overflow blocks from the heap
+	// for the rest of the frame, and Reset grows the block to the high water
+	// mark, so once the frames settle the arena never touches the heap.
+	// Only the thread that submits the draws uses it, so there is no locking.
+	// ------------------------------------------------------------------------
+	class FrameArena
+	{
+	private:
+		U8* m_block;
+		U32 m_capacity;
+		U32 m_offset;
+
+		// Blocks taken when the main one ran out; freed by Reset.
+		std::vector<U8*> m_overflow;
+		U8* m_overflowBlock;
+		U32 m_overflowCapacity;
+		U32 m_overflowOffset;
+
+		// Bytes allocated this frame, including the overflow, and the most of any frame.
+		U32 m_used;
+		U32 m_highWaterMark;
+		U32 m_totalGrowths;
+
+		void* AllocateOverflow(U32 size, U32 alignment);
+		void FreeOverflow();
+
+	protected:
+	public:
+		enum { DEFAULT_ALIGNMENT = 16 };
+
+		FrameArena();
+		~FrameArena();
+
+		SWR_ERR Initilise(U32 capacity);
+		void Release();
+
+		// Returns uninitialised memory valid until the next Reset; never NULL unless the heap is exhausted.
+		void* Allocate(U32 size, U32 alignment = DEFAULT_ALIGNMENT);
+
+		// An array of count default constructed Ts. Reset never destroys them, so T mustn't own
+		// anything that needs freeing.
+		template <typename T>
+		inline T* AllocateArray(U32 count)
+		{
+			T* items = (T*)Allocate(count * sizeof(T));
+			for (U32 i = 0; i < count; i++)
+			{
+				new (&items[i]) T;
+			}
+
+			return items;
+		}
+
+		// Frees everything allocated since the last reset.
+		void Reset();
+
+		U32 GetUsed() const;
+		U32 GetCapacity() const;
+		U32 GetHighWaterMark() const;
+
+		// How many times the block has been grown; stops rising once the frames settle.
+		U32 GetTotalGrowths() const;
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef FRAME_ARENA_H
@@ -0,0 +1,284 @@
+//****************************************************************************
+//**
+//**    FrameCapture.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "FrameCapture.h"
+
+#include "Vertex.h"
+#include "IndexBuffer.h"
+#include "Texture.h"
+#include "RenderTarget.h"
+#include "LightingManager.h"
+#include "Matrix4.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	FrameCapture::FrameCapture()
+		: m_file(NULL)
+		, m_lightsWritten(false)
+	{
+	}
+
+	FrameCapture::~FrameCapture()
+	{
+		Close();
+	}
+
+	SWR_ERR FrameCapture::Open(const char* filename, U32 width, U32 height, U32 totalLights, U32 shadowMapSize)
+	{
+		Close();
+
+		m_file = fopen(filename, "wb");
+		if (m_file == NULL)
+		{
+			LOG("Failed to create the frame capture file.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		WriteBytes(SWR_CAPTURE_MAGIC, 4);
+		WriteU32(SWR_CAPTURE_VERSION);
+		WriteU32(width);
+		WriteU32(height);
+		WriteU32(totalLights);
+		WriteU32(shadowMapSize);
+		WriteU32((U32)sizeof(Vertex));
+
+		return SWR_OK;
+	}
+
+	void FrameCapture::Close()
+	{
+		if (m_file != NULL)
+		{
+			fclose(m_file);
+			m_file = NULL;
+		}
+
+		m_vertexBuffers.clear();
+		m_indexBuffers.clear();
+		m_textures.clear();
+		m_renderTargets.clear();
+		m_lightRevisions.clear();
+		m_lightsWritten = false;
+	}
+
+	bool FrameCapture::IsOpen() const
+	{
+		return m_file != NULL;
+	}
+
+	void FrameCapture::WriteCommand(CaptureCommand command)
+	{
+		WriteU8((U8)command);
+	}
+
+	void FrameCapture::WriteBool(bool value)
+	{
+		WriteU8(value ? 1 : 0);
+	}
+
+	void FrameCapture::WriteU8(U8 value)
+	{
+		WriteBytes(&value, sizeof(value));
+	}
+
+	void FrameCapture::WriteU16(U16 value)
+	{
+		WriteBytes(&value, sizeof(value));
+	}
+
+	void FrameCapture::WriteU32(U32 value)
+	{
+		WriteBytes(&value, sizeof(value));
+	}
+
+	void FrameCapture::WriteS32(S32 value)
+	{
+		WriteBytes(&value, sizeof(value));
+	}
+
+	void FrameCapture::WriteReal(Real value)
+	{
+		WriteBytes(&value, sizeof(value));
+	}
+
+	void FrameCapture::WriteMatrix(const Matrix4 &m)
+	{
+		float values[16] = {m.xX, m.xY, m.xZ, m.xW,
+							m.yX, m.yY, m.yZ, m.yW,
+							m.zX, m.zY, m.zZ, m.zW,
+							m.wX, m.wY, m.wZ, m.wW};
+		WriteBytes(values, sizeof(values));
+	}
+
+	void FrameCapture::WriteBytes(const void* data, size_t size)
+	{
+		if (m_file != NULL && size > 0)
+		{
+			fwrite(data, 1, size, m_file);
+		}
+	}
+
+	void FrameCapture::WriteDraw(CaptureCommand command, bool useIndexBuffer, int totalTris, int start)
+	{
+		WriteCommand(command);
+		WriteBool(useIndexBuffer);
+		WriteS32(totalTris);
+		WriteS32(start);
+	}
+
+	U32 FrameCapture::FindResource(std::vector<const void*> &resources, const void* resource, bool &isNew)
+	{
+		isNew = false;
+		if (resource == NULL)
+			return 0;
+
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			if (resources[i] == resource)
+				return (U32)i + 1;
+		}
+
+		isNew = true;
+		resources.push_back(resource);
+		return (U32)resources.size();
+	}
+
+	U32 FrameCapture::DefineVertexBuffer(VertexBuffer* buffer)
+	{
+		bool isNew;
+		U32 ID = FindResource(m_vertexBuffers, buffer, isNew);
+		if (isNew)
+		{
+			WriteCommand(CAPTURE_DefineVertexBuffer);
+			WriteU32(ID);
+			WriteU16(buffer->GetTotalVerts());
+			WriteBytes(buffer->GetVertices(), buffer->GetTotalVerts() * sizeof(Vertex));
+		}
+
+		return ID;
+	}
+
+	U32 FrameCapture::DefineIndexBuffer(IndexBuffer* buffer)
+	{
+		bool isNew;
+		U32 ID = FindResource(m_indexBuffers, buffer, isNew);
+		if (isNew)
+		{
+			WriteCommand(CAPTURE_DefineIndexBuffer);
+			WriteU32(ID);
+			WriteU16(buffer->GetTotalIndices());
+			WriteBytes(buffer->GetBuffer(), buffer->GetTotalIndices() * sizeof(U16));
+		}
+
+		return ID;
+	}
+
+	U32 FrameCapture::DefineTexture(Texture* texture)
+	{
+		bool isNew;
+		U32 ID = FindResource(m_textures, texture, isNew);
+		if (isNew)
+		{
+			WriteCommand(CAPTURE_DefineTexture);
+			WriteU32(ID);
+			WriteU16(texture->GetWidth());
+			WriteU16(texture->GetHeight());
+			WriteU8((U8)texture->GetLayout());
+			WriteU8((U8)texture->GetAddressMode());
+			WriteU8((U8)texture->GetFilter());
+
+			// The mip levels are rebuilt from the texels on replay.
+			WriteBool(texture->GetTotalLevels() > 1);
+
+			// In rows without the padding, so captures don't depend on the pitch or the layout.
+			const U32* texels = (const U32*)texture->GetBytes();
+			for (U32 y = 0; y < texture->GetHeight(); y++)
+			{
+				if (texture->GetLayout() == TEXLAYOUT_Linear)
+				{
+					WriteBytes(texels + texture->GetTexelIndex(0, y), texture->GetWidth() * 4);
+					continue;
+				}
+
+				for (U32 x = 0; x < texture->GetWidth(); x++)
+				{
+					WriteU32(texels[texture->GetTexelIndex(x, y)]);
+				}
+			}
+		}
+
+		return ID;
+	}
+
+	U32 FrameCapture::DefineRenderTarget(RenderTarget* target)
+	{
+		bool isNew;
+		U32 ID = FindResource(m_renderTargets, target, isNew);
+		if (isNew)
+		{
+			// The texture must be defined before the target that renders into it.
+			U32 textureID = target->GetTexture() != NULL ? DefineTexture(target->GetTexture()) : 0;
+
+			WriteCommand(CAPTURE_DefineRenderTarget);
+			WriteU32(ID);
+			WriteU32(textureID);
+			WriteU32(target->GetWidth());
+			WriteU32(target->GetHeight());
+			WriteBool(target->GetDepth() != NULL);
+		}
+
+		return ID;
+	}
+
+	void FrameCapture::SyncLights(const LightingManager* lights)
+	{
+		int total = lights->GetTotalSceneLights();
+		if (m_lightRevisions.size() != (size_t)total)
+		{
+			m_lightRevisions.resize(total, 0);
+		}
+
+		for (int i = 0; i < total; i++)
+		{
+			U32 revision = lights->GetLightRevision(i);
+			if (m_lightsWritten && m_lightRevisions[i] == revision)
+				continue;
+
+			const Light &light = lights->GetLight(i);
+			WriteCommand(CAPTURE_SetLight);
+			WriteS32(i);
+			WriteReal(light.colour.R);
+			WriteReal(light.colour.G);
+			WriteReal(light.colour.B);
+			WriteReal(light.colour.A);
+			WriteReal(light.direction.x);
+			WriteReal(light.direction.y);
+			WriteReal(light.direction.z);
+			WriteReal(light.position.x);
+			WriteReal(light.position.y);
+			WriteReal(light.position.z);
+			WriteS32((S32)light.type);
+			WriteReal(light.falloff);
+			WriteReal(light.atten[0]);
+			WriteReal(light.atten[1]);
+			WriteReal(light.atten[2]);
+			WriteBool(light.active);
+
+			m_lightRevisions[i] = revision;
+		}
+
+		m_lightsWritten = true;
+	}
+
+}; // End namespace SWR.
@@ -0,0 +1,176 @@
+#pragma once
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+//****************************************************************************
+//**
+//**    FrameCapture.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <vector>
+
+#include "DataTypes.h"
+
+// Forward Declarations
+namespace SWR
+{
+	class VertexBuffer;
+	class IndexBuffer;
+	class Texture;
+	class RenderTarget;
+	class LightingManager;
+	class Matrix4;
+};
+
+// The capture file layout. Bump the version whenever a command or its payload changes; the
+// replayer refuses files of any other version.
+#define SWR_CAPTURE_MAGIC "SWRC"
+#define SWR_CAPTURE_VERSION 6
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								CaptureCommand
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The commands of a capture file. Each is a single byte followed by the
+	// arguments of the render device call it records, in the order they are
+	// passed. Buffers, textures and render targets are referred to by an ID,
+	// 0 being NULL (or the back-buffer for targets), and are defined by a
+	// Define command the first time they appear.
+	// ------------------------------------------------------------------------
+	enum CaptureCommand
+	{
+		// Resources and lights.
+		CAPTURE_DefineVertexBuffer,		// ID, total verts, the vertices.
+		CAPTURE_DefineIndexBuffer,		// ID, total indices, the indices.
+		CAPTURE_DefineTexture,			// ID, width, height, layout, address mode, filter, if it has mip levels, the 32 bit texels in rows.
+		CAPTURE_DefineRenderTarget,		// ID, texture ID, width, height, if it has depth.
+		CAPTURE_SetLight,				// Light ID, the light, if it is active.
+
+		// Device state.
+		CAPTURE_ClearBackBuffer,
+		CAPTURE_ClearZBuffer,
+		CAPTURE_SetFOV,
+		CAPTURE_SetTextureMappingType,
+		CAPTURE_SetClipPlanes,
+		CAPTURE_EnableBackfaceCulling,
+		CAPTURE_EnableSpanBatching,
+		CAPTURE_SetVertexBuffer,
+		CAPTURE_SetIndexBuffer,
+		CAPTURE_SetSourceTexture,
+		CAPTURE_SetRenderTarget,
+		CAPTURE_SetRenderPipeline,
+		CAPTURE_SetMaterialID,
+		CAPTURE_ResolveGBuffer,
+		CAPTURE_BeginShadowPass,
+		CAPTURE_EndShadowPass,
+		CAPTURE_DisableShadows,
+		CAPTURE_SetShadowBias,
+		CAPTURE_SetInstanceID,
+		CAPTURE_InvalidateLightingCache,
+		CAPTURE_ClearLightingCache,
+		CAPTURE_SetWorldTransform,
+		CAPTURE_SetCameraTransform,
+		CAPTURE_CommitMatrixChanges,
+		CAPTURE_SetPixelColour,
+
+		// Draws; those taking a triangle range are followed by the index buffer flag, the triangle
+		// count and the start.
+		CAPTURE_DrawTrisShadowList,
+		CAPTURE_DrawTrisColList,
+		CAPTURE_DrawTrisColStrip,
+		CAPTURE_DrawTrisColLitList,
+		CAPTURE_DrawTrisColLitStrip,
+		CAPTURE_DrawTrisColPhongList,
+		CAPTURE_DrawTrisTexList,
+		CAPTURE_DrawTrisTexStrip,
+		CAPTURE_DrawTrisTexLitList,
+		CAPTURE_DrawTrisTexLitStrip,
+		CAPTURE_DrawTrisTex2D,
+		CAPTURE_DrawNormals,
+		CAPTURE_DrawWireFrame,
+		CAPTURE_DrawTexture2D,			// X, y, texture ID, if it has a source rectangle and the rectangle, alpha filter.
+
+		// The end of the frame.
+		CAPTURE_Present,
+
+		CAPTURE_Invalid,
+	};
+
+	// ------------------------------------------------------------------------
+	//								FrameCapture
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Writes the calls made to the render device during a frame to a file
+	// FrameReplay can play back, so a frame taken from the application can
+	// be rendered and profiled on its own.
+	// The contents of a buffer or texture are written when it is first used
+	// in the capture, so changes made to it later in the frame are lost.
+	// The lights are compared against their revisions before each draw, and
+	// those that changed are written out.
+	// The file is written in the byte order of the machine and with its
+	// layout of Vertex, so it is only replayed on the same kind of machine.
+	// ------------------------------------------------------------------------
+	class FrameCapture
+	{
+	private:
+		FILE* m_file;
+
+		// The resources defined so far; a resource's ID is its index plus one.
+		std::vector<const void*> m_vertexBuffers;
+		std::vector<const void*> m_indexBuffers;
+		std::vector<const void*> m_textures;
+		std::vector<const void*> m_renderTargets;
+
+		// The revision of each light when it was last written; the first sync writes all of them.
+		std::vector<U32> m_lightRevisions;
+		bool m_lightsWritten;
+
+		static U32 FindResource(std::vector<const void*> &resources, const void* resource, bool &isNew);
+
+	protected:
+	public:
+		FrameCapture();
+		~FrameCapture();
+
+		// Creates the file and writes its header; the device settings a replay has to match.
+		SWR_ERR Open(const char* filename, U32 width, U32 height, U32 totalLights, U32 shadowMapSize);
+		void Close();
+		bool IsOpen() const;
+
+		void WriteCommand(CaptureCommand command);
+		void WriteBool(bool value);
+		void WriteU8(U8 value);
+		void WriteU16(U16 value);
+		void WriteU32(U32 value);
+		void WriteS32(S32 value);
+		void WriteReal(Real value);
+		void WriteMatrix(const Matrix4 &m);
+		void WriteBytes(const void* data, size_t size);
+
+		// Writes the triangle range of a draw.
+		void WriteDraw(CaptureCommand command, bool useIndexBuffer, int totalTris, int start);
+
+		// Return the ID of the resource, defining it first if this is its first use.
+		// The back-buffer's target is passed as NULL.
+		U32 DefineVertexBuffer(VertexBuffer* buffer);
+		U32 DefineIndexBuffer(IndexBuffer* buffer);
+		U32 DefineTexture(Texture* texture);
+		U32 DefineRenderTarget(RenderTarget* target);
+
+		// Writes the lights that have changed since the last sync.
+		void SyncLights(const LightingManager* lights);
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef FRAME_CAPTURE_H
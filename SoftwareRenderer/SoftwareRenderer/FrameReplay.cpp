@@ -0,0 +1,706 @@
+//****************************************************************************
+//**
+//**    FrameReplay.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cstring>
+
+#include "FrameReplay.h"
+#include "FrameCapture.h"
+
+#include "RenderDevice.h"
+#include "RenderTarget.h"
+#include "LightingManager.h"
+#include "TextureManager.h"
+#include "Texture.h"
+#include "IndexBuffer.h"
+#include "Vertex.h"
+#include "Rectangle.h"
+#include "Matrix4.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	FrameReplay::FrameReplay()
+		: m_width(0)
+		, m_height(0)
+		, m_totalLights(0)
+		, m_shadowMapSize(0)
+		, m_frame(NULL)
+		, m_framePitch(0)
+		, m_readPosition(0)
+		, m_readFailed(false)
+	{
+	}
+
+	FrameReplay::~FrameReplay()
+	{
+		Release();
+	}
+
+	SWR_ERR FrameReplay::Load(const char* filename)
+	{
+		Release();
+
+		FILE* file = fopen(filename, "rb");
+		if (file == NULL)
+		{
+			LOG("Failed to open the frame capture file.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		char magic[4] = {0};
+		U32 header[6] = {0}; // Version, width, height, lights, shadow map size, vertex size.
+		bool valid = fread(magic, 1, 4, file) == 4 && memcmp(magic, SWR_CAPTURE_MAGIC, 4) == 0
+			&& fread(header, sizeof(U32), 6, file) == 6;
+
+		if (valid == false)
+		{
+			LOG("The file is not a frame capture.", LOG_Error);
+			fclose(file);
+			return SWR_FAIL;
+		}
+
+		if (header[0] != SWR_CAPTURE_VERSION || header[5] != sizeof(Vertex))
+		{
+			LOG("The frame capture was written by a different version of the renderer.", LOG_Error);
+			fclose(file);
+			return SWR_FAIL;
+		}
+
+		m_width = header[1];
+		m_height = header[2];
+		m_totalLights = header[3];
+		m_shadowMapSize = header[4];
+
+		// The commands make up the rest of the file.
+		long start = ftell(file);
+		fseek(file, 0, SEEK_END);
+		long end = ftell(file);
+		fseek(file, start, SEEK_SET);
+
+		m_commands.resize(end - start);
+		if (m_commands.empty() == false && fread(&m_commands[0], 1, m_commands.size(), file) != m_commands.size())
+		{
+			LOG("Failed to read the frame capture.", LOG_Error);
+			fclose(file);
+			Release();
+			return SWR_FAIL;
+		}
+
+		fclose(file);
+		return SWR_OK;
+	}
+
+	void FrameReplay::Release()
+	{
+		ReleaseResources();
+		m_commands.clear();
+		m_width = 0;
+		m_height = 0;
+		m_totalLights = 0;
+		m_shadowMapSize = 0;
+		m_frame = NULL;
+	}
+
+	void FrameReplay::ReleaseResources()
+	{
+		// Targets first; they may render into the textures.
+		for (size_t i = 0; i < m_renderTargets.size(); i++)
+		{
+			delete m_renderTargets[i];
+		}
+
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			delete m_textures[i];
+		}
+
+		for (size_t i = 0; i < m_vertexBuffers.size(); i++)
+		{
+			delete m_vertexBuffers[i];
+		}
+
+		for (size_t i = 0; i < m_indexBuffers.size(); i++)
+		{
+			delete m_indexBuffers[i];
+		}
+
+		m_renderTargets.clear();
+		m_textures.clear();
+		m_vertexBuffers.clear();
+		m_indexBuffers.clear();
+	}
+
+	U32 FrameReplay::GetWidth() const
+	{
+		return m_width;
+	}
+
+	U32 FrameReplay::GetHeight() const
+	{
+		return m_height;
+	}
+
+	void FrameReplay::GetInitParams(SWRInitParams &params) const
+	{
+		params.bufferWidth = (U16)m_width;
+		params.bufferHeight = (U16)m_height;
+		params.maxSceneLights = (U16)m_totalLights;
+		params.shadowMapSize = (U16)m_shadowMapSize;
+	}
+
+	const U8* FrameReplay::GetFrame() const
+	{
+		return m_frame;
+	}
+
+	U32 FrameReplay::GetFramePitch() const
+	{
+		return m_framePitch;
+	}
+
+	// *****************************************************************************************
+	// Reading.
+	// *****************************************************************************************
+
+	const U8* FrameReplay::ReadBytes(size_t size)
+	{
+		if (m_readFailed || size > m_commands.size() - m_readPosition)
+		{
+			m_readFailed = true;
+			return NULL;
+		}
+
+		const U8* bytes = &m_commands[0] + m_readPosition;
+		m_readPosition += size;
+		return bytes;
+	}
+
+	void FrameReplay::Read(void* out, size_t size)
+	{
+		const U8* bytes = ReadBytes(size);
+		if (bytes != NULL)
+		{
+			memcpy(out, bytes, size);
+		}
+		else
+		{
+			memset(out, 0, size);
+		}
+	}
+
+	bool FrameReplay::ReadBool()
+	{
+		return ReadU8() != 0;
+	}
+
+	U8 FrameReplay::ReadU8()
+	{
+		U8 value;
+		Read(&value, sizeof(value));
+		return value;
+	}
+
+	U16 FrameReplay::ReadU16()
+	{
+		U16 value;
+		Read(&value, sizeof(value));
+		return value;
+	}
+
+	U32 FrameReplay::ReadU32()
+	{
+		U32 value;
+		Read(&value, sizeof(value));
+		return value;
+	}
+
+	S32 FrameReplay::ReadS32()
+	{
+		S32 value;
+		Read(&value, sizeof(value));
+		return value;
+	}
+
+	Real FrameReplay::ReadReal()
+	{
+		Real value;
+		Read(&value, sizeof(value));
+		return value;
+	}
+
+	void FrameReplay::ReadMatrix(Matrix4 &m)
+	{
+		float values[16];
+		Read(values, sizeof(values));
+		m.xX = values[0];  m.xY = values[1];  m.xZ = values[2];  m.xW = values[3];
+		m.yX = values[4];  m.yY = values[5];  m.yZ = values[6];  m.yW = values[7];
+		m.zX = values[8];  m.zY = values[9];  m.zZ = values[10]; m.zW = values[11];
+		m.wX = values[12]; m.wY = values[13]; m.wZ = values[14]; m.wW = values[15];
+	}
+
+	// *****************************************************************************************
+	// Resources.
+	// *****************************************************************************************
+
+	template <typename T>
+	static T* FindResource(std::vector<T*> &resources, U32 ID, bool &failed)
+	{
+		if (ID == 0)
+			return NULL;
+
+		if (ID > resources.size() || resources[ID - 1] == NULL)
+		{
+			failed = true;
+			return NULL;
+		}
+
+		return resources[ID - 1];
+	}
+
+	// Makes room for the resource, and returns if it has yet to be created.
+	template <typename T>
+	static bool NeedsResource(std::vector<T*> &resources, U32 ID)
+	{
+		if (ID > resources.size())
+		{
+			resources.resize(ID, NULL);
+		}
+
+		return resources[ID - 1] == NULL;
+	}
+
+	VertexBuffer* FrameReplay::GetVertexBuffer(U32 ID)
+	{
+		return FindResource(m_vertexBuffers, ID, m_readFailed);
+	}
+
+	IndexBuffer* FrameReplay::GetIndexBuffer(U32 ID)
+	{
+		return FindResource(m_indexBuffers, ID, m_readFailed);
+	}
+
+	Texture* FrameReplay::GetTexture(U32 ID)
+	{
+		return FindResource(m_textures, ID, m_readFailed);
+	}
+
+	RenderTarget* FrameReplay::GetRenderTarget(U32 ID)
+	{
+		return FindResource(m_renderTargets, ID, m_readFailed);
+	}
+
+	SWR_ERR FrameReplay::DefineVertexBuffer()
+	{
+		U32 ID = ReadU32();
+		U16 totalVerts = ReadU16();
+		const U8* verts = ReadBytes(totalVerts * sizeof(Vertex));
+		if (m_readFailed || ID == 0)
+			return SWR_FAIL;
+
+		if (NeedsResource(m_vertexBuffers, ID))
+		{
+			return CreateVertexBuffer((void*)verts, totalVerts, m_vertexBuffers[ID - 1]);
+		}
+
+		return SWR_OK;
+	}
+
+	SWR_ERR FrameReplay::DefineIndexBuffer()
+	{
+		U32 ID = ReadU32();
+		U16 totalIndices = ReadU16();
+		const U8* indices = ReadBytes(totalIndices * sizeof(U16));
+		if (m_readFailed || ID == 0)
+			return SWR_FAIL;
+
+		if (NeedsResource(m_indexBuffers, ID))
+		{
+			// The indices may not be aligned within the file.
+			std::vector<U16> aligned(totalIndices);
+			if (totalIndices > 0)
+			{
+				memcpy(&aligned[0], indices, totalIndices * sizeof(U16));
+			}
+
+			return CreateIndexBuffer(totalIndices > 0 ? &aligned[0] : NULL, totalIndices, m_indexBuffers[ID - 1]);
+		}
+
+		return SWR_OK;
+	}
+
+	SWR_ERR FrameReplay::DefineTexture()
+	{
+		U32 ID = ReadU32();
+		U16 width = ReadU16();
+		U16 height = ReadU16();
+		U8 layout = ReadU8();
+		U8 addressMode = ReadU8();
+		U8 filter = ReadU8();
+		bool mipmaps = ReadBool();
+		const U8* texels = ReadBytes(width * height * 4);
+		if (m_readFailed || ID == 0 || layout >= TEXLAYOUT_Invalid || addressMode >= TEXADDRESS_Invalid || filter >= TEXFILTER_Invalid)
+			return SWR_FAIL;
+
+		if (NeedsResource(m_textures, ID))
+		{
+			if (TextureManager::Instance().CreateTexture(width, height, m_textures[ID - 1]) != SWR_OK)
+				return SWR_FAIL;
+
+			Texture* texture = m_textures[ID - 1];
+			for (U32 y = 0; y < height; y++)
+			{
+				memcpy(texture->GetBytes() + y * texture->GetPitch(), texels + y * width * 4, width * 4);
+			}
+
+			texture->SetAddressMode((TextureAddressMode)addressMode);
+			texture->SetFilter((TextureFilter)filter);
+			if (mipmaps && TextureManager::Instance().GenerateMipmaps(texture) != SWR_OK)
+				return SWR_FAIL;
+
+			return TextureManager::Instance().SetTextureLayout(texture, (TextureLayout)layout);
+		}
+
+		return SWR_OK;
+	}
+
+	SWR_ERR FrameReplay::DefineRenderTarget()
+	{
+		U32 ID = ReadU32();
+		U32 textureID = ReadU32();
+		U32 width = ReadU32();
+		U32 height = ReadU32();
+		bool useDepth = ReadBool();
+		Texture* texture = GetTexture(textureID);
+		if (m_readFailed || ID == 0)
+			return SWR_FAIL;
+
+		if (NeedsResource(m_renderTargets, ID))
+		{
+			RenderTarget* target = new RenderTarget();
+			SWR_ERR result = texture != NULL ? target->Initilise(texture, useDepth) : target->Initilise(width, height, useDepth);
+			if (result != SWR_OK)
+			{
+				delete target;
+				return SWR_FAIL;
+			}
+
+			m_renderTargets[ID - 1] = target;
+		}
+
+		return SWR_OK;
+	}
+
+	SWR_ERR FrameReplay::SetLight(RenderDevice &device)
+	{
+		S32 ID = ReadS32();
+
+		Light light;
+		light.colour.R = ReadReal();
+		light.colour.G = ReadReal();
+		light.colour.B = ReadReal();
+		light.colour.A = ReadReal();
+		light.direction.x = ReadReal();
+		light.direction.y = ReadReal();
+		light.direction.z = ReadReal();
+		light.position.x = ReadReal();
+		light.position.y = ReadReal();
+		light.position.z = ReadReal();
+		light.type = (LightType)ReadS32();
+		light.falloff = ReadReal();
+		light.atten[0] = ReadReal();
+		light.atten[1] = ReadReal();
+		light.atten[2] = ReadReal();
+		bool active = ReadBool();
+
+		LightingManager* lights = device.GetLightingManager();
+		if (m_readFailed || ID < 0 || ID >= lights->GetTotalSceneLights())
+		{
+			LOG("The frame capture has more lights than the render device.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		lights->AddLight(light, ID);
+		if (active)
+		{
+			lights->EnableLight(ID);
+		}
+		else
+		{
+			lights->DisableLight(ID);
+		}
+
+		return SWR_OK;
+	}
+
+	// *****************************************************************************************
+	// Playing.
+	// *****************************************************************************************
+
+	SWR_ERR FrameReplay::Play(RenderDevice &device)
+	{
+		if (m_commands.empty())
+		{
+			LOG("There is no frame capture loaded to play.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		m_readPosition = 0;
+		m_readFailed = false;
+		m_frame = NULL;
+
+		while (m_readPosition < m_commands.size())
+		{
+			CaptureCommand command = (CaptureCommand)ReadU8();
+			SWR_ERR result = SWR_OK;
+
+			switch (command)
+			{
+			case CAPTURE_DefineVertexBuffer:
+				result = DefineVertexBuffer();
+				break;
+			case CAPTURE_DefineIndexBuffer:
+				result = DefineIndexBuffer();
+				break;
+			case CAPTURE_DefineTexture:
+				result = DefineTexture();
+				break;
+			case CAPTURE_DefineRenderTarget:
+				result = DefineRenderTarget();
+				break;
+			case CAPTURE_SetLight:
+				result = SetLight(device);
+				break;
+
+			case CAPTURE_ClearBackBuffer:
+				device.ClearBackBuffer(ReadU32());
+				break;
+			case CAPTURE_ClearZBuffer:
+				device.ClearZBuffer();
+				break;
+			case CAPTURE_SetFOV:
+				device.SetFOV(ReadReal());
+				break;
+			case CAPTURE_SetTextureMappingType:
+				device.SetTextureMappingType((TextureMappingTypeSet)ReadU8());
+				break;
+			case CAPTURE_SetClipPlanes:
+				{
+					Real nearPlane = ReadReal();
+					Real farPlane = ReadReal();
+					device.SetClipPlanes(nearPlane, farPlane);
+				}
+				break;
+			case CAPTURE_EnableBackfaceCulling:
+				device.EnableBackfaceCulling(ReadBool());
+				break;
+			case CAPTURE_EnableSpanBatching:
+				device.EnableSpanBatching(ReadBool());
+				break;
+			case CAPTURE_SetVertexBuffer:
+				device.SetVertexBuffer(GetVertexBuffer(ReadU32()));
+				break;
+			case CAPTURE_SetIndexBuffer:
+				device.SetIndexBuffer(GetIndexBuffer(ReadU32()));
+				break;
+			case CAPTURE_SetSourceTexture:
+				device.SetSourceTexture(GetTexture(ReadU32()));
+				break;
+			case CAPTURE_SetRenderTarget:
+				device.SetRenderTarget(GetRenderTarget(ReadU32()));
+				break;
+			case CAPTURE_SetRenderPipeline:
+				device.SetRenderPipeline((RenderPipeline)ReadU8());
+				break;
+			case CAPTURE_SetMaterialID:
+				device.SetMaterialID(ReadU8());
+				break;
+			case CAPTURE_ResolveGBuffer:
+				device.ResolveGBuffer();
+				break;
+			case CAPTURE_BeginShadowPass:
+				{
+					S32 lightID = ReadS32();
+					Matrix4 lightTransform;
+					ReadMatrix(lightTransform);
+					Real FOV = ReadReal();
+					Real nearPlane = ReadReal();
+					Real farPlane = ReadReal();
+					result = device.BeginShadowPass(lightID, lightTransform, FOV, nearPlane, farPlane);
+				}
+				break;
+			case CAPTURE_EndShadowPass:
+				device.EndShadowPass();
+				break;
+			case CAPTURE_DisableShadows:
+				device.DisableShadows();
+				break;
+			case CAPTURE_SetShadowBias:
+				device.SetShadowBias(ReadReal());
+				break;
+			case CAPTURE_SetInstanceID:
+				device.SetInstanceID(ReadU32());
+				break;
+			case CAPTURE_InvalidateLightingCache:
+				device.InvalidateLightingCache(GetVertexBuffer(ReadU32()));
+				break;
+			case CAPTURE_ClearLightingCache:
+				device.ClearLightingCache();
+				break;
+			case CAPTURE_SetWorldTransform:
+			case CAPTURE_SetCameraTransform:
+				{
+					Matrix4 m;
+					ReadMatrix(m);
+					if (command == CAPTURE_SetWorldTransform)
+						device.SetWorldTransform(m);
+					else
+						device.SetCameraTransform(m);
+				}
+				break;
+			case CAPTURE_CommitMatrixChanges:
+				device.CommitMatrixChanges();
+				break;
+			case CAPTURE_SetPixelColour:
+				{
+					U16 x = ReadU16();
+					U16 y = ReadU16();
+					device.SetPixelColour(x, y, ReadU32());
+				}
+				break;
+
+			case CAPTURE_DrawTrisShadowList:
+			case CAPTURE_DrawTrisColList:
+			case CAPTURE_DrawTrisColStrip:
+			case CAPTURE_DrawTrisColLitList:
+			case CAPTURE_DrawTrisColLitStrip:
+			case CAPTURE_DrawTrisColPhongList:
+			case CAPTURE_DrawTrisTexList:
+			case CAPTURE_DrawTrisTexStrip:
+			case CAPTURE_DrawTrisTexLitList:
+			case CAPTURE_DrawTrisTexLitStrip:
+			case CAPTURE_DrawTrisTex2D:
+			case CAPTURE_DrawWireFrame:
+				{
+					bool useIndexBuffer = ReadBool();
+					int totalTris = ReadS32();
+					int start = ReadS32();
+					if (m_readFailed)
+						break;
+
+					switch (command)
+					{
+					case CAPTURE_DrawTrisShadowList:	device.DrawTrisShadowList(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisColList:		device.DrawTrisColList(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisColStrip:		device.DrawTrisColStrip(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisColLitList:	device.DrawTrisColLitList(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisColLitStrip:	device.DrawTrisColLitStrip(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisColPhongList:	device.DrawTrisColPhongList(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisTexList:		device.DrawTrisTexList(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisTexStrip:		device.DrawTrisTexStrip(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisTexLitList:	device.DrawTrisTexLitList(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisTexLitStrip:	device.DrawTrisTexLitStrip(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawTrisTex2D:			device.DrawTrisTex2D(useIndexBuffer, totalTris, start); break;
+					case CAPTURE_DrawWireFrame:
+						{
+							Colour32 colour;
+							Read(&colour, sizeof(colour));
+							if (m_readFailed == false)
+							{
+								device.DrawWireFrame(useIndexBuffer, totalTris, start, colour);
+							}
+						}
+						break;
+					default:
+						break;
+					}
+				}
+				break;
+			case CAPTURE_DrawNormals:
+				{
+					VertexBuffer* buffer = GetVertexBuffer(ReadU32());
+					Colour32 colour;
+					Read(&colour, sizeof(colour));
+					Real normalLength = ReadReal();
+					if (m_readFailed == false && buffer != NULL)
+					{
+						device.DrawNormals(buffer, colour, normalLength);
+					}
+				}
+				break;
+			case CAPTURE_DrawTexture2D:
+				{
+					U16 x = ReadU16();
+					U16 y = ReadU16();
+					Texture* texture = GetTexture(ReadU32());
+					U8 overload = ReadU8(); // 0 for the whole texture, 1 with a source rectangle, 2 with an alpha filter as well.
+					Rectangle srcRect;
+					srcRect.left = srcRect.right = srcRect.top = srcRect.bottom = 0;
+					U32 alphaFilter = 0;
+					if (overload > 0)
+					{
+						srcRect.left = ReadS32();
+						srcRect.right = ReadS32();
+						srcRect.top = ReadS32();
+						srcRect.bottom = ReadS32();
+					}
+
+					if (overload > 1)
+					{
+						alphaFilter = ReadU32();
+					}
+
+					if (m_readFailed || texture == NULL)
+						break;
+
+					if (overload == 0)
+						device.DrawTexture2D(x, y, texture);
+					else if (overload == 1)
+						device.DrawTexture2D(x, y, texture, &srcRect);
+					else
+						device.DrawTexture2D(x, y, texture, &srcRect, alphaFilter);
+				}
+				break;
+
+			case CAPTURE_Present:
+				m_frame = device.Present();
+				m_framePitch = device.GetBackBufferPitch();
+				break;
+
+			default:
+				LOG("Unknown command in the frame capture.", LOG_Error);
+				return SWR_FAIL;
+			};
+
+			if (m_readFailed)
+			{
+				LOG("The frame capture is truncated or refers to a resource it never defined.", LOG_Error);
+				return SWR_FAIL;
+			}
+
+			if (result != SWR_OK)
+			{
+				LOG("Failed to play a command of the frame capture.", LOG_Error);
+				return SWR_FAIL;
+			}
+		}
+
+		if (m_frame == NULL)
+		{
+			LOG("The frame capture ends before the frame is presented.", LOG_Warning);
+		}
+
+		return SWR_OK;
+	}
+
+}; // End namespace SWR.
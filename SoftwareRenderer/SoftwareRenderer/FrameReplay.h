@@ -0,0 +1,120 @@
+#pragma once
+
+#ifndef FRAME_REPLAY_H
+#define FRAME_REPLAY_H
+
+//****************************************************************************
+//**
+//**    FrameReplay.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <vector>
+
+#include "DataTypes.h"
+
+// Forward Declarations
+namespace SWR
+{
+	class RenderDevice;
+	struct SWRInitParams;
+	class VertexBuffer;
+	class IndexBuffer;
+	class Texture;
+	class RenderTarget;
+	class Matrix4;
+};
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								FrameReplay
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Plays a frame written by FrameCapture back on a render device, so it
+	// can be rendered as many times as needed to time it.
+	// The buffers, textures and render targets of the frame are created the
+	// first time it is played and reused by the plays that follow, so only
+	// the first play pays for them.
+	// ------------------------------------------------------------------------
+	class FrameReplay
+	{
+	private:
+		// The commands of the file, following its header.
+		std::vector<U8> m_commands;
+		U32 m_width;
+		U32 m_height;
+		U32 m_totalLights;
+		U32 m_shadowMapSize;
+
+		// The resources of the frame, by ID less one.
+		std::vector<VertexBuffer*> m_vertexBuffers;
+		std::vector<IndexBuffer*> m_indexBuffers;
+		std::vector<Texture*> m_textures;
+		std::vector<RenderTarget*> m_renderTargets;
+
+		// The frame presented by the last play.
+		const U8* m_frame;
+		U32 m_framePitch;
+
+		// Reading the commands. A read past the end fails the play rather than the reads.
+		size_t m_readPosition;
+		bool m_readFailed;
+
+		void Read(void* out, size_t size);
+		const U8* ReadBytes(size_t size);
+		bool ReadBool();
+		U8 ReadU8();
+		U16 ReadU16();
+		U32 ReadU32();
+		S32 ReadS32();
+		Real ReadReal();
+		void ReadMatrix(Matrix4 &m);
+
+		// Look up a resource by ID. 0 is NULL; an ID that hasn't been defined fails the play.
+		VertexBuffer* GetVertexBuffer(U32 ID);
+		IndexBuffer* GetIndexBuffer(U32 ID);
+		Texture* GetTexture(U32 ID);
+		RenderTarget* GetRenderTarget(U32 ID);
+
+		SWR_ERR DefineVertexBuffer();
+		SWR_ERR DefineIndexBuffer();
+		SWR_ERR DefineTexture();
+		SWR_ERR DefineRenderTarget();
+		SWR_ERR SetLight(RenderDevice &device);
+
+		void ReleaseResources();
+
+	protected:
+	public:
+		FrameReplay();
+		~FrameReplay();
+
+		// Reads the capture file into memory.
+		SWR_ERR Load(const char* filename);
+		void Release();
+
+		// The dimensions of the back-buffer the frame was captured from.
+		U32 GetWidth() const;
+		U32 GetHeight() const;
+
+		// Sets up the parameters of a device to play the frame on like the one it was captured from;
+		// the back-buffer dimensions, lights and shadow map size. The rest are left alone.
+		void GetInitParams(SWRInitParams &params) const;
+
+		// Plays the frame, ending with it being presented.
+		SWR_ERR Play(RenderDevice &device);
+
+		// The frame presented by the last play; 32 bit, GetFramePitch() bytes per row. Owned by the device.
+		const U8* GetFrame() const;
+		U32 GetFramePitch() const;
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef FRAME_REPLAY_H
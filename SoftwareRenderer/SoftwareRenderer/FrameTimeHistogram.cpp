@@ -0,0 +1,190 @@
+//****************************************************************************
+//**
+//**    FrameTimeHistogram.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <algorithm>
+
+#include "FrameTimeHistogram.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	// Around the frame rates that matter; 120, 60, 30, 20, 15 and 10 FPS.
+	const double FrameTimeHistogram::BUCKET_LIMITS_MS[TOTAL_BUCKETS] =
+	{
+		1.0, 4.0, 8.333, 16.667, 33.333, 50.0, 66.667, 100.0, 250.0, 1.0e30,
+	};
+
+	FrameTimeHistogram::FrameTimeHistogram(U32 windowSize)
+		: m_window(windowSize > 0 ? windowSize : 1, 0.0)
+		, m_budgetMs(0.0)
+	{
+		Reset();
+	}
+
+	void FrameTimeHistogram::AddSample(double ms)
+	{
+		m_window[m_next] = ms;
+		m_next = (m_next + 1) % m_window.size();
+		if (m_totalInWindow < m_window.size())
+		{
+			m_totalInWindow++;
+		}
+
+		m_sortedValid = false;
+
+		int bucket = 0;
+		while (bucket < TOTAL_BUCKETS - 1 && ms > BUCKET_LIMITS_MS[bucket])
+		{
+			bucket++;
+		}
+
+		m_buckets[bucket]++;
+		m_totalSamples++;
+		m_sessionMaxMs = ms > m_sessionMaxMs ? ms : m_sessionMaxMs;
+		if (m_budgetMs > 0.0 && ms > m_budgetMs)
+		{
+			m_totalOverBudget++;
+		}
+	}
+
+	void FrameTimeHistogram::Reset()
+	{
+		m_next = 0;
+		m_totalInWindow = 0;
+		m_sorted.clear();
+		m_sortedValid = false;
+		m_totalSamples = 0;
+		m_sessionMaxMs = 0.0;
+		m_totalOverBudget = 0;
+
+		for (int i = 0; i < TOTAL_BUCKETS; i++)
+		{
+			m_buckets[i] = 0;
+		}
+	}
+
+	void FrameTimeHistogram::Sort() const
+	{
+		if (m_sortedValid)
+			return;
+
+		m_sorted.assign(m_window.begin(), m_window.begin() + m_totalInWindow);
+		std::sort(m_sorted.begin(), m_sorted.end());
+		m_sortedValid = true;
+	}
+
+	U32 FrameTimeHistogram::GetWindowCount() const
+	{
+		return m_totalInWindow;
+	}
+
+	double FrameTimeHistogram::GetPercentile(double percent) const
+	{
+		if (m_totalInWindow == 0)
+			return 0.0;
+
+		Sort();
+		size_t rank = (size_t)(percent / 100.0 * m_sorted.size() + 0.5);
+		rank = rank < 1 ? 1 : (rank > m_sorted.size() ? m_sorted.size() : rank);
+		return m_sorted[rank - 1];
+	}
+
+	double FrameTimeHistogram::GetMin() const
+	{
+		if (m_totalInWindow == 0)
+			return 0.0;
+
+		Sort();
+		return m_sorted.front();
+	}
+
+	double FrameTimeHistogram::GetMax() const
+	{
+		if (m_totalInWindow == 0)
+			return 0.0;
+
+		Sort();
+		return m_sorted.back();
+	}
+
+	double FrameTimeHistogram::GetMean() const
+	{
+		if (m_totalInWindow == 0)
+			return 0.0;
+
+		double total = 0.0;
+		for (U32 i = 0; i < m_totalInWindow; i++)
+		{
+			total += m_window[i];
+		}
+
+		return total / m_totalInWindow;
+	}
+
+	U64 FrameTimeHistogram::GetTotalSamples() const
+	{
+		return m_totalSamples;
+	}
+
+	double FrameTimeHistogram::GetSessionMax() const
+	{
+		return m_sessionMaxMs;
+	}
+
+	U64 FrameTimeHistogram::GetBucketCount(int bucket) const
+	{
+		return bucket >= 0 && bucket < TOTAL_BUCKETS ? m_buckets[bucket] : 0;
+	}
+
+	void FrameTimeHistogram::SetBudget(double ms)
+	{
+		m_budgetMs = ms;
+	}
+
+	double FrameTimeHistogram::GetBudget() const
+	{
+		return m_budgetMs;
+	}
+
+	U64 FrameTimeHistogram::GetTotalOverBudget() const
+	{
+		return m_totalOverBudget;
+	}
+
+	void FrameTimeHistogram::LogReport(const char* name) const
+	{
+		LOGF(LOG_Standard, "%.64s: %llu samples, last %u p50 %.3fms p95 %.3fms p99 %.3fms max %.3fms, session max %.3fms",
+			name, m_totalSamples, m_totalInWindow, GetPercentile(50.0), GetPercentile(95.0), GetPercentile(99.0), GetMax(), m_sessionMaxMs);
+
+		if (m_budgetMs > 0.0)
+		{
+			double percent = m_totalSamples > 0 ? 100.0 * m_totalOverBudget / m_totalSamples : 0.0;
+			LOGF(m_totalOverBudget > 0 ? LOG_Warning : LOG_Standard, "%.64s: %llu over the %.3fms budget (%.2f%%)", name, m_totalOverBudget, m_budgetMs, percent);
+		}
+
+		double lower = 0.0;
+		for (int i = 0; i < TOTAL_BUCKETS; i++)
+		{
+			if (m_buckets[i] > 0)
+			{
+				if (i < TOTAL_BUCKETS - 1)
+					LOGF(LOG_Standard, "%.64s:   %8.3f - %8.3fms %llu", name, lower, BUCKET_LIMITS_MS[i], m_buckets[i]);
+				else
+					LOGF(LOG_Standard, "%.64s:   %8.3fms +       %llu", name, lower, m_buckets[i]);
+			}
+
+			lower = BUCKET_LIMITS_MS[i];
+		}
+	}
+
+}; // End namespace SWR.
@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef FRAME_TIME_HISTOGRAM_H
+#define FRAME_TIME_HISTOGRAM_H
+
+//****************************************************************************
+//**
+//**    FrameTimeHistogram.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								FrameTimeHistogram
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Collects frame (or stage) times in milliseconds. The last window of
+	// times are kept for the percentiles, so a hitch shows up in the p99 and
+	// max long after it would have been averaged out of the FPS. Every time
+	// is also counted into a fixed set of buckets, and against the budget
+	// when one is set, for the whole session.
+	// Not thread safe; add and query from the same thread.
+	// ------------------------------------------------------------------------
+	class FrameTimeHistogram
+	{
+	public:
+		enum { DEFAULT_WINDOW = 600, TOTAL_BUCKETS = 10 };
+
+		// The upper bound of each bucket in milliseconds; the last takes everything over the one before.
+		static const double BUCKET_LIMITS_MS[TOTAL_BUCKETS];
+
+	private:
+		// The window; a ring of the last times added.
+		std::vector<double> m_window;
+		U32 m_next;
+		U32 m_totalInWindow;
+
+		// The window sorted, rebuilt on the first query after a time is added.
+		mutable std::vector<double> m_sorted;
+		mutable bool m_sortedValid;
+
+		// The whole session.
+		U64 m_totalSamples;
+		U64 m_buckets[TOTAL_BUCKETS];
+		double m_sessionMaxMs;
+		double m_budgetMs;
+		U64 m_totalOverBudget;
+
+		void Sort() const;
+
+	protected:
+	public:
+		FrameTimeHistogram(U32 windowSize = DEFAULT_WINDOW);
+
+		void AddSample(double ms);
+		void Reset();
+
+		// The times of the window. All are 0 while it's empty.
+		U32 GetWindowCount() const;
+		double GetPercentile(double percent) const; // Nearest rank.
+		double GetMin() const;
+		double GetMax() const;
+		double GetMean() const;
+
+		// The whole session.
+		U64 GetTotalSamples() const;
+		double GetSessionMax() const;
+		U64 GetBucketCount(int bucket) const;
+
+		// Times over the budget are counted; 0 turns the budget off.
+		void SetBudget(double ms);
+		double GetBudget() const;
+		U64 GetTotalOverBudget() const;
+
+		// Logs the percentiles, budget and buckets under the name.
+		void LogReport(const char* name) const;
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef FRAME_TIME_HISTOGRAM_H
@@ -0,0 +1,135 @@
+//****************************************************************************
+//**
+//**    GBuffer.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstring>
+
+#include "GBuffer.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	GBuffer::GBuffer()
+		: m_width(0)
+		, m_height(0)
+		, m_capacity(0)
+		, m_depth(NULL)
+		, m_normalX(NULL)
+		, m_normalY(NULL)
+		, m_normalZ(NULL)
+		, m_albedo(NULL)
+		, m_material(NULL)
+	{
+	}
+
+	GBuffer::~GBuffer()
+	{
+		Release();
+	}
+
+	SWR_ERR GBuffer::Initilise(U16 width, U16 height)
+	{
+		Release();
+
+		if (width < 1 || height < 1)
+		{
+			LOG("Invalid G-buffer dimensions.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		m_width = width;
+		m_height = height;
+
+		U32 size = (U32)width * height;
+		m_capacity = size;
+		m_depth = new float[size];
+		m_normalX = new float[size];
+		m_normalY = new float[size];
+		m_normalZ = new float[size];
+		m_albedo = new U32[size];
+		m_material = new U8[size];
+
+		Clear();
+
+		LOG("G-buffer creation successful.", LOG_Init);
+		return SWR_OK;
+	}
+
+	void GBuffer::Release()
+	{
+		float** planes[4] = { &m_depth, &m_normalX, &m_normalY, &m_normalZ };
+		for (int i = 0; i < 4; i++)
+		{
+			if (*planes[i] != NULL)
+			{
+				delete [] *planes[i];
+				*planes[i] = NULL;
+			}
+		}
+
+		if (m_albedo != NULL)
+		{
+			delete [] m_albedo;
+			m_albedo = NULL;
+		}
+
+		if (m_material != NULL)
+		{
+			delete [] m_material;
+			m_material = NULL;
+		}
+
+		m_width = 0;
+		m_height = 0;
+		m_capacity = 0;
+	}
+
+	SWR_ERR GBuffer::Resize(U16 width, U16 height)
+	{
+		if (width < 1 || height < 1)
+		{
+			LOG("Invalid G-buffer dimensions.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		if ((U32)width * height > m_capacity)
+			return Initilise(width, height);
+
+		// The planes are indexed by the width, so a smaller size just uses the start of them.
+		m_width = width;
+		m_height = height;
+		Clear();
+
+		return SWR_OK;
+	}
+
+	void GBuffer::Clear()
+	{
+		// Only the depth marks a pixel as covered, so the other planes can be left as they are.
+		U32 size = (U32)m_width * m_height;
+		for (U32 i = 0; i < size; i++)
+		{
+			m_depth[i] = GBUFFER_EMPTY_DEPTH;
+		}
+	}
+
+	U16 GBuffer::GetWidth() const
+	{
+		return m_width;
+	}
+
+	U16 GBuffer::GetHeight() const
+	{
+		return m_height;
+	}
+
+}; // End namespace SWR.
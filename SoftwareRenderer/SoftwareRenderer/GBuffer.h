@@ -0,0 +1,99 @@
+#pragma once
+
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+//****************************************************************************
+//**
+//**    GBuffer.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "DataTypes.h"
+
+// The depth an empty G-buffer pixel is cleared to.
+#define GBUFFER_EMPTY_DEPTH 3.402823e+38f
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								GBufferMaterial
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The material byte stored per pixel. Lit materials have the scene lights
+	// applied in the lighting pass, unlit ones output their albedo as is.
+	// Values in between are free for the application to use and are lit.
+	// ------------------------------------------------------------------------
+	enum GBufferMaterial
+	{
+		GBUFFER_Lit = 0,
+		GBUFFER_Unlit = 255,
+	};
+
+	// ------------------------------------------------------------------------
+	//								GBuffer
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The geometry buffer for deferred shading, sized like the back-buffer.
+	// Stores the nearest surface of each pixel; its linear (camera space)
+	// depth, world space normal, albedo and material. Each attribute is kept
+	// in its own plane so the lighting pass can load 4 pixels of it at once.
+	// The world position is reconstructed from the depth in the lighting pass.
+	// ------------------------------------------------------------------------
+	class GBuffer
+	{
+	private:
+		U16 m_width;
+		U16 m_height;
+
+		// The pixels the planes have room for; the most any size has needed.
+		U32 m_capacity;
+
+		float* m_depth;
+		float* m_normalX;
+		float* m_normalY;
+		float* m_normalZ;
+		U32* m_albedo;
+		U8* m_material;
+	protected:
+	public:
+		GBuffer();
+		~GBuffer();
+
+		SWR_ERR Initilise(U16 width, U16 height);
+		void Release();
+
+		// Changes the size, and clears it. The planes are only reallocated when they are too small
+		// for it, so switching between render targets doesn't allocate once each size has been seen.
+		SWR_ERR Resize(U16 width, U16 height);
+
+		// Marks every pixel as empty.
+		void Clear();
+
+		U16 GetWidth() const;
+		U16 GetHeight() const;
+
+		// The attribute planes, width * height entries each.
+		inline float* GetDepth()		{ return m_depth; }
+		inline float* GetNormalX()		{ return m_normalX; }
+		inline float* GetNormalY()		{ return m_normalY; }
+		inline float* GetNormalZ()		{ return m_normalZ; }
+		inline U32* GetAlbedo()			{ return m_albedo; }
+		inline U8* GetMaterial()		{ return m_material; }
+
+		inline const float* GetDepth() const		{ return m_depth; }
+		inline const float* GetNormalX() const		{ return m_normalX; }
+		inline const float* GetNormalY() const		{ return m_normalY; }
+		inline const float* GetNormalZ() const		{ return m_normalZ; }
+		inline const U32* GetAlbedo() const			{ return m_albedo; }
+		inline const U8* GetMaterial() const		{ return m_material; }
+	};
+	
+}; // End namespace SWR.
+
+#endif // #ifndef GBUFFER_H
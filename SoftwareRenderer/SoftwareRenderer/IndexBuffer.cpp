@@ -9,7 +9,7 @@
 //**
 //****************************************************************************
 
-#include <Windows.h>
+#include <cstring>
 
 #include "IndexBuffer.h"
 
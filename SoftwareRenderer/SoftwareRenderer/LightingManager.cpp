@@ -9,6 +9,9 @@
 //**
 //****************************************************************************
 
+#include <assert.h>
+#include <cstring>
+
 #include "LightingManager.h"
 
 #include "Vertex.h"
@@ -22,8 +25,11 @@ namespace SWR
 
 	LightingManager::LightingManager(int totalSceneLights)
 		: m_totalSceneLights(totalSceneLights)
+		, m_revision(0)
 	{
 		m_sceneLights = new Light[m_totalSceneLights];
+		m_lightRevisions = new U32[m_totalSceneLights];
+		memset(m_lightRevisions, 0, sizeof(U32) * m_totalSceneLights);
 	}
 
 	LightingManager::~LightingManager()
@@ -32,6 +38,11 @@ namespace SWR
 		{
 			delete [] m_sceneLights;
 		}
+
+		if (m_lightRevisions != NULL)
+		{
+			delete [] m_lightRevisions;
+		}
 	}
 
 	// Applies the scenes lighting to the vertex.
@@ -142,6 +153,8 @@ namespace SWR
 			return;
 
 		m_sceneLights[ID] = light;
+		m_lightRevisions[ID]++;
+		m_revision++;
 	}
 
 	void LightingManager::EnableLight(int ID)
@@ -149,7 +162,12 @@ namespace SWR
 		if (ID >= this->m_totalSceneLights || ID < 0)
 			return;
 
-		m_sceneLights[ID].active = true;
+		if (m_sceneLights[ID].active == false)
+		{
+			m_sceneLights[ID].active = true;
+			m_lightRevisions[ID]++;
+			m_revision++;
+		}
 	}
 
 	void LightingManager::DisableLight(int ID)
@@ -157,7 +175,12 @@ namespace SWR
 		if (ID >= this->m_totalSceneLights || ID < 0)
 			return;
 
-		m_sceneLights[ID].active = false;
+		if (m_sceneLights[ID].active == true)
+		{
+			m_sceneLights[ID].active = false;
+			m_lightRevisions[ID]++;
+			m_revision++;
+		}
 	}
 
 	void LightingManager::EnableAll()
@@ -166,7 +189,7 @@ namespace SWR
 		{
 			if (m_sceneLights[i].type != LIGHT_Invalid)
 			{
-				m_sceneLights[i].active = true;
+				EnableLight(i);
 			}
 		}
 	}
@@ -177,7 +200,7 @@ namespace SWR
 		{
 			if (m_sceneLights[i].type != LIGHT_Invalid)
 			{
-				m_sceneLights[i].active = false;
+				DisableLight(i);
 			}
 		}
 	}
@@ -198,7 +221,78 @@ namespace SWR
 		if (handle < 0 || handle > this->m_totalSceneLights -1)
 			return;
 
-		m_sceneLights[handle].position = newPos;
+		Vector3 &pos = m_sceneLights[handle].position;
+		if (pos.x != newPos.x || pos.y != newPos.y || pos.z != newPos.z)
+		{
+			pos = newPos;
+			m_lightRevisions[handle]++;
+			m_revision++;
+		}
+	}
+
+	int LightingManager::BuildPixelLights(PixelLight* out, int maxLights) const
+	{
+		int total = 0;
+		for (int i = 0; i < m_totalSceneLights && total < maxLights; i++)
+		{
+			const Light &light = m_sceneLights[i];
+			if (light.active == false || light.type == LIGHT_Invalid)
+				continue;
+
+			PixelLight &pl = out[total++];
+			pl.sourceID = i;
+			pl.type = light.type;
+			pl.x = light.position.x;
+			pl.y = light.position.y;
+			pl.z = light.position.z;
+			pl.r = light.colour.R / 255.0f;
+			pl.g = light.colour.G / 255.0f;
+			pl.b = light.colour.B / 255.0f;
+			pl.falloff = light.falloff;
+			pl.atten[0] = light.atten[0];
+			pl.atten[1] = light.atten[1];
+			pl.atten[2] = light.atten[2];
+		}
+
+		return total;
+	}
+
+	int LightingManager::GetTotalSceneLights() const
+	{
+		return m_totalSceneLights;
+	}
+
+	const Light& LightingManager::GetLight(int ID) const
+	{
+		assert(ID >= 0 && ID < m_totalSceneLights);
+		return m_sceneLights[ID];
+	}
+
+	U32 LightingManager::GetLightRevision(int ID) const
+	{
+		assert(ID >= 0 && ID < m_totalSceneLights);
+		return m_lightRevisions[ID];
+	}
+
+	U32 LightingManager::GetRevision() const
+	{
+		return m_revision;
+	}
+
+	bool LightingManager::LightAffectsBounds(int ID, const Vector3 &centre, float radius) const
+	{
+		const Light &light = m_sceneLights[ID];
+		if (light.active == false || light.type == LIGHT_Invalid)
+			return false;
+
+		// Directional lights reach everything.
+		if (light.type == LIGHT_Directional)
+			return true;
+
+		// Point lights only reach vertices within their falloff distance.
+		Vector3 toCentre = light.position - centre;
+		float reach = light.falloff + radius;
+		return toCentre.SquaredMagnitude() <= reach * reach;
 	}
 	
 }; // End namespace SWR.
\ No newline at end of file
@@ -14,6 +14,7 @@
 //**
 //****************************************************************************
 
+#include "DataTypes.h"
 #include "Colour.h"
 #include "Vector3.h"
 
@@ -81,6 +82,23 @@ namespace SWR
 		{	}
 	};
 
+	// ------------------------------------------------------------------------
+	//								PixelLight
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A flattened copy of an active light, laid out for the per-pixel lit
+	// spans. The colour is pre-scaled into the 0-1 range.
+	// ------------------------------------------------------------------------
+	struct PixelLight
+	{
+		int sourceID;		// The ID of the light within the lighting manager.
+		LightType type;
+		float x, y, z;
+		float r, g, b;
+		float falloff;
+		float atten[3];
+	};
+
 	// ------------------------------------------------------------------------
 	//								LightingManager
 	// ------------------------------------------------------------------------
@@ -96,6 +114,13 @@ namespace SWR
 		Light* m_sceneLights;
 		const int m_totalSceneLights;
 
+		// A revision counter per light, bumped whenever a change to the light would alter the
+		// lighting it produces. Lets cached lighting results detect which lights have changed.
+		U32* m_lightRevisions;
+
+		// Bumped along with any light's revision, so a change to any of them can be found at once.
+		U32 m_revision;
+
 		bool ApplyPointLight(int index, Vertex* vertex, Colour128 &out, const Matrix4 &transform);
 		bool ApplyDirectionalLight(int index, Vertex* vertex, Colour128 &out, const Matrix4 &transform);
 	protected:
@@ -118,6 +143,18 @@ namespace SWR
 		int FindNextLightHandle();
 
 		void SetLightPosition(int handle, Vector3 newPos);
+
+		// Copies the active lights into the array for per-pixel lighting. Returns the amount copied.
+		int BuildPixelLights(PixelLight* out, int maxLights) const;
+
+		// Accessors used by the lighting cache to validate previously lit results.
+		int GetTotalSceneLights() const;
+		const Light& GetLight(int ID) const;
+		U32 GetLightRevision(int ID) const;
+		U32 GetRevision() const;
+
+		// Tests if the light can reach any point within the bounding sphere.
+		bool LightAffectsBounds(int ID, const Vector3 &centre, float radius) const;
 	};
 	
 }; // End namespace SWR.
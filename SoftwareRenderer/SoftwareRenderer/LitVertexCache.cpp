@@ -0,0 +1,242 @@
+//****************************************************************************
+//**
+//**    LitVertexCache.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 08/2010
+//**
+//****************************************************************************
+
+#include <cstring>
+#include <math.h>
+
+#include "LitVertexCache.h"
+
+#include "Vertex.h"
+#include "LightingManager.h"
+#include "RenderStats.h"
+#include "Profiler.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	LitVertexCache::LitVertexCache()
+		: m_frame(0)
+		, m_hits(0)
+		, m_relights(0)
+		, m_stats(NULL)
+	{
+	}
+
+	LitVertexCache::~LitVertexCache()
+	{
+		Clear();
+	}
+
+	U64 LitVertexCache::MakeKey(U32 bufferID, U32 instanceID)
+	{
+		return ((U64)bufferID << 32) | instanceID;
+	}
+
+	bool LitVertexCache::IsValid(LitCacheEntry* entry, const Matrix4 &world, const LightingManager* lights)
+	{
+		// A moved instance must always be relit.
+		if (memcmp(&entry->world, &world, sizeof(Matrix4)) != 0)
+			return false;
+
+		if ((int)entry->lightRevisions.size() != lights->GetTotalSceneLights())
+			return false;
+
+		for (int i = 0; i < lights->GetTotalSceneLights(); i++)
+		{
+			U32 revision = lights->GetLightRevision(i);
+			if (entry->lightRevisions[i] == revision)
+				continue;
+
+			// The light has changed; it only matters if it reached the instance before or reaches it now.
+			bool influences = lights->LightAffectsBounds(i, entry->boundsCentre, entry->boundsRadius);
+			if (influences || entry->lightInfluenced[i])
+				return false;
+
+			entry->lightRevisions[i] = revision;
+		}
+
+		return true;
+	}
+
+	void LitVertexCache::Relight(LitCacheEntry* entry, VertexBuffer* buffer, const Matrix4 &world, LightingManager* lights)
+	{
+		SWR_PROFILE_SCOPE("Lighting");
+
+		Vertex* verts = buffer->GetVertices();
+		U16 totalVerts = buffer->GetTotalVerts();
+
+		if (entry->totalVerts != totalVerts)
+		{
+			if (entry->colours != NULL)
+			{
+				delete [] entry->colours;
+			}
+
+			entry->colours = new Colour32[totalVerts];
+			entry->totalVerts = totalVerts;
+		}
+
+		// Light each vertex once in world space and find the bounds as we go.
+		Vector3 point;
+		Vector3 min, max;
+		for (U16 i = 0; i < totalVerts; i++)
+		{
+			Vertex vert = verts[i];
+			vert.ToVec3(point);
+			point = Transform(world, point);
+			vert.FromVec3(point);
+
+			lights->ProcessVertex(&vert, world, LRO_UseAll);
+			entry->colours[i] = vert.colour;
+
+			if (i == 0)
+			{
+				min = point;
+				max = point;
+			}
+			else
+			{
+				min.x = min.x < point.x ? min.x : point.x;
+				min.y = min.y < point.y ? min.y : point.y;
+				min.z = min.z < point.z ? min.z : point.z;
+				max.x = max.x > point.x ? max.x : point.x;
+				max.y = max.y > point.y ? max.y : point.y;
+				max.z = max.z > point.z ? max.z : point.z;
+			}
+		}
+
+		Vector3 extent = (max - min) * 0.5f;
+		entry->boundsCentre = min + extent;
+		entry->boundsRadius = sqrt(extent.SquaredMagnitude());
+		entry->world = world;
+
+		// Snapshot the lights we were lit with.
+		int totalLights = lights->GetTotalSceneLights();
+		entry->lightRevisions.resize(totalLights);
+		entry->lightInfluenced.resize(totalLights);
+		for (int i = 0; i < totalLights; i++)
+		{
+			entry->lightRevisions[i] = lights->GetLightRevision(i);
+			entry->lightInfluenced[i] = lights->LightAffectsBounds(i, entry->boundsCentre, entry->boundsRadius);
+		}
+	}
+
+	void LitVertexCache::DestroyEntry(LitCacheEntry* entry)
+	{
+		if (entry->colours != NULL)
+		{
+			delete [] entry->colours;
+			entry->colours = NULL;
+		}
+
+		delete entry;
+	}
+
+	const Colour32* LitVertexCache::Acquire(VertexBuffer* buffer, U32 instanceID, const Matrix4 &world, LightingManager* lights)
+	{
+		LitCacheEntry* &slot = m_entries[MakeKey(buffer->GetID(), instanceID)];
+		LitCacheEntry* entry = slot;
+		if (entry == NULL)
+		{
+			entry = new LitCacheEntry();
+			entry->bufferID = buffer->GetID();
+			entry->instanceID = instanceID;
+			slot = entry;
+		}
+		else if (entry->totalVerts == buffer->GetTotalVerts() && IsValid(entry, world, lights))
+		{
+			entry->lastUsedFrame = m_frame;
+
+			m_hits++;
+			if (m_stats != NULL)
+				m_stats->litCacheHits += entry->totalVerts;
+
+			return entry->colours;
+		}
+
+		m_relights++;
+		entry->lastUsedFrame = m_frame;
+		Relight(entry, buffer, world, lights);
+		if (m_stats != NULL)
+			m_stats->vertsLit += entry->totalVerts;
+
+		return entry->colours;
+	}
+
+	void LitVertexCache::Invalidate(const VertexBuffer* buffer)
+	{
+		// Every instance of the buffer, from instance 0 to the last.
+		EntryMap::iterator first = m_entries.lower_bound(MakeKey(buffer->GetID(), 0));
+		EntryMap::iterator last = m_entries.upper_bound(MakeKey(buffer->GetID(), 0xFFFFFFFF));
+		for (EntryMap::iterator i = first; i != last; ++i)
+		{
+			DestroyEntry(i->second);
+		}
+
+		m_entries.erase(first, last);
+	}
+
+	void LitVertexCache::Clear()
+	{
+		for (EntryMap::iterator i = m_entries.begin(); i != m_entries.end(); ++i)
+		{
+			DestroyEntry(i->second);
+		}
+
+		m_entries.clear();
+	}
+
+	void LitVertexCache::EndFrame()
+	{
+		m_frame++;
+		for (EntryMap::iterator i = m_entries.begin(); i != m_entries.end(); )
+		{
+			if (m_frame - i->second->lastUsedFrame > MAX_UNUSED_FRAMES)
+			{
+				DestroyEntry(i->second);
+				m_entries.erase(i++);
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	int LitVertexCache::GetTotalEntries() const
+	{
+		return (int)m_entries.size();
+	}
+
+	int LitVertexCache::GetHits() const
+	{
+		return m_hits;
+	}
+
+	int LitVertexCache::GetRelights() const
+	{
+		return m_relights;
+	}
+
+	void LitVertexCache::ResetStatsCounters()
+	{
+		m_hits = 0;
+		m_relights = 0;
+	}
+
+	void LitVertexCache::SetStats(RenderStats* stats)
+	{
+		m_stats = stats;
+	}
+
+}; // End namespace SWR.
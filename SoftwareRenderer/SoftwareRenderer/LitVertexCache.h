@@ -0,0 +1,141 @@
+#pragma once
+
+#ifndef LIT_VERTEX_CACHE_H
+#define LIT_VERTEX_CACHE_H
+
+//****************************************************************************
+//**
+//**    LitVertexCache.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 08/2010
+//**
+//****************************************************************************
+
+#include <map>
+#include <vector>
+
+#include "DataTypes.h"
+#include "Colour.h"
+#include "Matrix4.h"
+#include "Vector3.h"
+
+// Forward Declarations
+namespace SWR
+{
+	class VertexBuffer;
+	class LightingManager;
+	struct RenderStats;
+};
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								LitCacheEntry
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The lit vertex colours of a single mesh instance, along with the state
+	// they were lit with so we can tell when they have gone stale.
+	// ------------------------------------------------------------------------
+	struct LitCacheEntry
+	{
+		// The key of the entry; the ID of the buffer it was lit from and the instance. A buffer
+		// created at the address of a deleted one has another ID, so it gets an entry of its own.
+		U32 bufferID;
+		U32 instanceID;
+
+		// The last frame the entry was drawn in.
+		U32 lastUsedFrame;
+
+		// The lit colour of each vertex in the buffer.
+		Colour32* colours;
+		U16 totalVerts;
+
+		// The world transform the colours were lit with.
+		Matrix4 world;
+
+		// World space bounding sphere of the instance.
+		Vector3 boundsCentre;
+		float boundsRadius;
+
+		// Per light; the revision the colours were lit with and if the light reached the instance.
+		std::vector<U32> lightRevisions;
+		std::vector<bool> lightInfluenced;
+
+		LitCacheEntry()
+			: bufferID(0)
+			, instanceID(0)
+			, lastUsedFrame(0)
+			, colours(NULL)
+			, totalVerts(0)
+			, boundsRadius(0.0f)
+		{	}
+	};
+
+	// ------------------------------------------------------------------------
+	//								LitVertexCache
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Caches the gourad lit colours of a vertex buffer per mesh instance so
+	// static geometry under static lights is only lit once, rather than once
+	// per triangle that references a vertex every frame.
+	// An entry is relit only when its world transform changes, or when a light
+	// that reached (or now reaches) the instance is moved, toggled or replaced.
+	// Lights that change well away from the instance leave it untouched.
+	// Entries that go unused for MAX_UNUSED_FRAMES frames are dropped, which
+	// takes care of deleted buffers and instances that are no longer drawn.
+	// ------------------------------------------------------------------------
+	class LitVertexCache
+	{
+	private:
+		// Keyed by the buffer ID in the high half and the instance ID in the low one, so the
+		// entries of a buffer are next to each other.
+		typedef std::map<U64, LitCacheEntry*> EntryMap;
+		EntryMap m_entries;
+		U32 m_frame;
+
+		// Usage counters; reset by ResetStatsCounters.
+		int m_hits;
+		int m_relights;
+
+		// Counts the vertices lit and reused, if set.
+		RenderStats* m_stats;
+
+		static U64 MakeKey(U32 bufferID, U32 instanceID);
+		bool IsValid(LitCacheEntry* entry, const Matrix4 &world, const LightingManager* lights);
+		void Relight(LitCacheEntry* entry, VertexBuffer* buffer, const Matrix4 &world, LightingManager* lights);
+		void DestroyEntry(LitCacheEntry* entry);
+	protected:
+	public:
+		enum { MAX_UNUSED_FRAMES = 60 };
+
+		LitVertexCache();
+		~LitVertexCache();
+
+		// Returns the lit colours for the instance of the buffer, relighting them only if they are stale.
+		const Colour32* Acquire(VertexBuffer* buffer, U32 instanceID, const Matrix4 &world, LightingManager* lights);
+
+		// Flushes every entry lit from the buffer. Must be called when the buffer is modified; a
+		// deleted buffer's entries are dropped once they have gone unused for long enough.
+		void Invalidate(const VertexBuffer* buffer);
+
+		// Flushes the whole cache.
+		void Clear();
+
+		// Ends the frame, dropping the entries that haven't been used for MAX_UNUSED_FRAMES frames.
+		void EndFrame();
+
+		int GetTotalEntries() const;
+
+		int GetHits() const;
+		int GetRelights() const;
+		void ResetStatsCounters();
+
+		void SetStats(RenderStats* stats);
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef LIT_VERTEX_CACHE_H
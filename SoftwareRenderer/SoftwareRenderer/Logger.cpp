@@ -9,23 +9,44 @@
 //**
 //****************************************************************************
 
-#include <iostream>
-#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdarg>
+#include <chrono>
 
 #include "Logger.h"
 
 #include "MemoryLeak.h"
 
 namespace SWR
-{		
+{
+	// How long the flush thread sleeps when there is nothing to write.
+	static const int FLUSH_INTERVAL_MS = 5;
+
 	Logger::Logger()
-		: m_consoleDump(false)
+		: m_writePosition(0)
+		, m_totalDropped(0)
+		, m_readPosition(0)
+		, m_file(NULL)
+		, m_consoleDump(false)
+		, m_running(true)
 	{
-		m_log.clear();
+		for (U32 i = 0; i < CAPACITY; i++)
+		{
+			m_records[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		m_flushThread = std::thread(&Logger::FlushLoop, this);
 	}
 
 	Logger::~Logger()
 	{
+		m_running = false;
+		m_flushThread.join();
+
+		// Anything logged since the thread's last flush.
+		DumpLog();
+		SetLogFile(NULL);
 	}
 
 	Logger& Logger::Instance()
@@ -39,44 +60,155 @@ namespace SWR
 		m_consoleDump = enable;
 	}
 
-	void Logger::AddToLogDump(LogItem item)
+	SWR_ERR Logger::SetLogFile(const char* filename)
 	{
-		// Only do log dumping if we are in debug mode.
-//#if defined(_DEBUG)
-		m_log.push_back(item);
-		static char buffer[1024] = {0};
-		memset(buffer, 0, 1024);
+		std::lock_guard<std::mutex> lock(m_flushLock);
+
+		// Keep the old file's records with it.
+		Flush(true);
+		if (m_file != NULL)
+		{
+			fclose(m_file);
+			m_file = NULL;
+		}
+
+		if (filename == NULL)
+			return SWR_OK;
+
+		m_file = fopen(filename, "w");
+		return m_file != NULL ? SWR_OK : SWR_FAIL;
+	}
 
-		if (m_consoleDump)
+	LogRecord* Logger::Claim(U32 &position)
+	{
+		position = m_writePosition.load(std::memory_order_relaxed);
+		for (;;)
 		{
-			sprintf(buffer,"%s %s", ToLogType(item.type), item.info.c_str());
-			puts(buffer);
+			LogRecord* record = &m_records[position & (CAPACITY - 1)];
+			S32 turn = (S32)(record->sequence.load(std::memory_order_acquire) - position);
+			if (turn == 0)
+			{
+				// The slot is free; take it unless another thread got there first.
+				if (m_writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					return record;
+			}
+			else if (turn < 0)
+			{
+				// The slot still holds a record from the last lap; the ring is full.
+				m_totalDropped.fetch_add(1, std::memory_order_relaxed);
+				return NULL;
+			}
+			else
+			{
+				position = m_writePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void Logger::Publish(LogRecord* record, U32 position)
+	{
+		record->sequence.store(position + 1, std::memory_order_release);
+	}
+
+	void Logger::Log(LogType type, const char* text)
+	{
+		U32 position;
+		LogRecord* record = Claim(position);
+		if (record == NULL)
+			return;
+
+		record->type = type;
+		strncpy(record->text, text, LogRecord::TEXT_SIZE - 1);
+		record->text[LogRecord::TEXT_SIZE - 1] = '\0';
+		Publish(record, position);
+	}
+
+	void Logger::Log(LogType type, const std::string &text)
+	{
+		Log(type, text.c_str());
+	}
+
+	void Logger::LogFormat(LogType type, const char* format, ...)
+	{
+		U32 position;
+		LogRecord* record = Claim(position);
+		if (record == NULL)
+			return;
+
+		va_list args;
+		va_start(args, format);
+		vsnprintf(record->text, LogRecord::TEXT_SIZE, format, args);
+		va_end(args);
+
+		record->type = type;
+		Publish(record, position);
+	}
+
+	void Logger::Flush(bool write)
+	{
+		bool consoleDump = m_consoleDump;
+		for (;;)
+		{
+			LogRecord* record = &m_records[m_readPosition & (CAPACITY - 1)];
+			if (record->sequence.load(std::memory_order_acquire) != m_readPosition + 1)
+				break;
+
+			if (write && consoleDump)
+			{
+				printf("%s %s\n", ToLogType(record->type), record->text);
+			}
+
+			if (write && m_file != NULL)
+			{
+				fprintf(m_file, "%s%s\n", ToLogType(record->type), record->text);
+			}
+
+			// Free the slot for the next lap.
+			record->sequence.store(m_readPosition + CAPACITY, std::memory_order_release);
+			m_readPosition++;
+		}
+	}
+
+	void Logger::FlushLoop()
+	{
+		while (m_running)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_flushLock);
+				Flush(true);
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(FLUSH_INTERVAL_MS));
 		}
-//#endif // #if defined(_DEBUG)
 	}
 
 	void Logger::DumpLog()
 	{
-		std::ofstream file;
-		file.open("SWRDebugLog.txt");
+		std::lock_guard<std::mutex> lock(m_flushLock);
+		Flush(true);
 
-		// Dump the loggers contents to the file.
-		for (unsigned int i = 0; i < m_log.size(); i++)
+		if (m_file != NULL)
 		{
-			file << ToLogType(m_log[i].type) << m_log[i].info << std::endl;
+			fflush(m_file);
 		}
 
-		file.close();
+		fflush(stdout);
 	}
 
 	void Logger::EmptyLog()
 	{
-		m_log.clear();
+		std::lock_guard<std::mutex> lock(m_flushLock);
+		Flush(false);
 	}
 
-	char* Logger::ToLogType(LogType type)
+	U32 Logger::GetTotalDropped() const
 	{
-		if (type == LOG_Standard)	
+		return m_totalDropped.load(std::memory_order_relaxed);
+	}
+
+	const char* Logger::ToLogType(LogType type)
+	{
+		if (type == LOG_Standard)
 		{
 			return "Log     : ";
 		}
@@ -84,15 +216,15 @@ namespace SWR
 		{
 			return "Warning : ";
 		}
-		if (type == LOG_Error)	
+		if (type == LOG_Error)
 		{
 			return "Error   : ";
 		}
-		if (type == LOG_Init)	
+		if (type == LOG_Init)
 		{
 			return "Init    : ";
 		}
-		if (type == LOG_Shutdown)	
+		if (type == LOG_Shutdown)
 		{
 			return "Shutdown: ";
 		}
@@ -100,5 +232,5 @@ namespace SWR
 		return ""; // Shouldnt reach this.
 	}
 
-	
-}; // End namespace SWR
\ No newline at end of file
+
+}; // End namespace SWR
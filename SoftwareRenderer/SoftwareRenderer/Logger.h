@@ -14,8 +14,19 @@
 //**
 //****************************************************************************
 
-#include <vector>
+#include <cstdio>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "DataTypes.h"
+
+// The least severe level LOG and LOGF keep; calls below it compile to nothing. 0 keeps everything,
+// 1 drops LOG_Standard, 2 keeps warnings and errors and 3 only errors.
+#ifndef SWR_LOG_MIN_LEVEL
+#define SWR_LOG_MIN_LEVEL 0
+#endif
 
 namespace SWR
 {
@@ -23,62 +34,121 @@ namespace SWR
 	enum LogType
 	{						// What will be printed out...
 		LOG_Standard,		// Log      :
-		LOG_Warning,		// Warning  : 
+		LOG_Warning,		// Warning  :
 		LOG_Error,			// Error    :
 		LOG_Init,           // Init     :
 		LOG_Shutdown,		// Shutdown :
 	};
 
-	struct LogItem;
-	
+	// The severity of a type, for SWR_LOG_MIN_LEVEL. Folds away when the type is a constant.
+	inline int LogLevelOf(LogType type)
+	{
+		switch (type)
+		{
+		case LOG_Standard:	return 0;
+		case LOG_Init:
+		case LOG_Shutdown:	return 1;
+		case LOG_Warning:	return 2;
+		default:			return 3;
+		}
+	}
+
+	// ------------------------------------------------------------------------
+	//								LogRecord
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A slot of the logger's ring. The sequence says whose turn the slot is;
+	// equal to a position it's free for the writer claiming that position,
+	// one past it the record is written and waiting to be flushed.
+	// ------------------------------------------------------------------------
+	struct LogRecord
+	{
+		enum { TEXT_SIZE = 256 };
+
+		std::atomic<U32> sequence;
+		LogType type;
+		char text[TEXT_SIZE]; // Longer texts are cut short.
+	};
+
 	// ------------------------------------------------------------------------
 	//								Logger
 	// ------------------------------------------------------------------------
 	// Desc:
 	// The logger is designed to log events as they happen at certain stages of
-	// the applications lifetime to help provide an insight into how the 
+	// the applications lifetime to help provide an insight into how the
 	// application ran and its possible problems.
+	// Any thread can log. The text is formatted straight into a slot of a
+	// fixed ring, claimed without locks, and a background thread writes the
+	// records out to the console and log file. Logging never allocates or
+	// waits; when the ring is full the record is dropped and counted.
 	// ------------------------------------------------------------------------
 	class Logger
 	{
 	public:
+		enum { CAPACITY = 1024 }; // A power of 2.
+
 		static Logger& Instance();
 		~Logger();
 
 		// When a log item is submitted this will also dump an item that is inputed to the logger to the console.
 		void EnableConsoleDumping(bool enable);
 
-		void AddToLogDump(LogItem item);
+		// The file records are written to as they are flushed, replacing its contents. NULL stops
+		// writing to a file.
+		SWR_ERR SetLogFile(const char* filename);
+
+		void Log(LogType type, const char* text);
+		void Log(LogType type, const std::string &text);
+		void LogFormat(LogType type, const char* format, ...);
+
+		// Writes out everything logged so far, on the calling thread.
 		void DumpLog();
+
+		// Drops everything not yet written out.
 		void EmptyLog();
 
+		// Records dropped because the ring was full.
+		U32 GetTotalDropped() const;
+
 	protected:
 	private:
 		Logger();
-		bool m_consoleDump;
 
-		std::vector<LogItem> m_log;
+		LogRecord m_records[CAPACITY];
+		std::atomic<U32> m_writePosition;
+		std::atomic<U32> m_totalDropped;
 
-		char* ToLogType(LogType type);
+		// Flushing; only one thread reads the ring at a time.
+		std::mutex m_flushLock;
+		U32 m_readPosition;
+		FILE* m_file;
+		std::atomic<bool> m_consoleDump;
 
-	};
+		std::thread m_flushThread;
+		std::atomic<bool> m_running;
+
+		// Claims a slot, returning NULL when the ring is full. Publish hands it to the flush.
+		LogRecord* Claim(U32 &position);
+		void Publish(LogRecord* record, U32 position);
+
+		// Writes out the records ready; the flush lock must be held.
+		void Flush(bool write);
+		void FlushLoop();
+
+		const char* ToLogType(LogType type);
 
-	struct LogItem
-	{
-		std::string info;
-		LogType type;
-		LogItem(){}
-		LogItem(std::string infoIn, LogType typeIn)
-		{
-			info = infoIn;
-			type = typeIn;
-		}
 	};
-	
+
 }; // End namespace SWR
 
 // Macros to help logging
 #define gLogger SWR::Logger::Instance()
-#define LOG(text, type)  SWR::Logger::Instance().AddToLogDump(SWR::LogItem(std::string(text), type))
 
-#endif // #ifndef B3D_LOGGER_H
\ No newline at end of file
+#define LOG(text, type) \
+	do { if (SWR::LogLevelOf(type) >= SWR_LOG_MIN_LEVEL) SWR::Logger::Instance().Log(type, text); } while (0)
+
+// printf style; LOGF(LOG_Warning, "%s failed to load.", filename);
+#define LOGF(type, format, ...) \
+	do { if (SWR::LogLevelOf(type) >= SWR_LOG_MIN_LEVEL) SWR::Logger::Instance().LogFormat(type, format, __VA_ARGS__); } while (0)
+
+#endif // #ifndef B3D_LOGGER_H
@@ -24,6 +24,7 @@
 #include "Texture.h"
 #include "Logger.h"
 #include "LightingManager.h"
+#include "Timer.h"
 
 #include "Font.h"
 
@@ -444,6 +445,19 @@ namespace SWR
 				SetupRenderMode();
 			}
 
+			// Cycle through the debug views of where the frame's cost goes.
+			if (INPUT_HANDLER->IsKeyHit(KEY_F2))
+			{
+				int view = device->GetDebugView() + 1;
+				device->SetDebugView(view > DEBUGVIEW_TileCost ? DEBUGVIEW_None : (DebugView)view, 0.0f);
+			}
+
+			// Write the next frame out for swr_replay.
+			if (INPUT_HANDLER->IsKeyHit(KEY_F3))
+			{
+				device->BeginCapture("Frame.swrc");
+			}
+
 			// Setup the triangle transformation.
 			static float rotation = 0;
 
@@ -578,6 +592,12 @@ namespace SWR
 			memset(buffer, 0, 64);
 			sprintf(buffer, "Tris rendered:%i", trisDrawn);
 			arialFont->PrintText(buffer, Vector3(8, 56, 0));
+
+			// The hitches the FPS averages away.
+			const FrameTimeHistogram &frameTimes = ENGINE.GetTimer()->GetFrameTimes();
+			memset(buffer, 0, 64);
+			sprintf(buffer, "p50:%.1fms p99:%.1fms max:%.1fms", frameTimes.GetPercentile(50.0), frameTimes.GetPercentile(99.0), frameTimes.GetMax());
+			arialFont->PrintText(buffer, Vector3(8, 72, 0));
 		}
 
 		void UpdateRendererStats()
@@ -25,6 +25,11 @@
 // Comment this block out to disable memory leak checking.
 #define CHECK_MEMORY_LEAKS
 
+// The allocation tracker replaces new itself.
+#ifdef SWR_TRACK_ALLOCATIONS
+#undef CHECK_MEMORY_LEAKS
+#endif
+
 #ifdef CHECK_MEMORY_LEAKS
 
 #define _CRTDBG_MAP_ALLOC
@@ -0,0 +1,129 @@
+//****************************************************************************
+//**
+//**    PPMFile.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cctype>
+
+#include "PPMFile.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	SWR_ERR WritePPM(const char* filename, const U8* pixels, U32 width, U32 height, U32 pitch)
+	{
+		FILE* file = fopen(filename, "wb");
+		if (file == NULL)
+		{
+			LOG("Failed to create the PPM file.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		fprintf(file, "P6\n%u %u\n255\n", width, height);
+
+		std::vector<U8> row(width * 3);
+		for (U32 y = 0; y < height; y++)
+		{
+			// The pixels are blue, green, red; PPM wants red first.
+			const U8* source = pixels + y * pitch;
+			for (U32 x = 0; x < width; x++)
+			{
+				row[x * 3 + 0] = source[x * 4 + 2];
+				row[x * 3 + 1] = source[x * 4 + 1];
+				row[x * 3 + 2] = source[x * 4 + 0];
+			}
+
+			if (width > 0)
+			{
+				fwrite(&row[0], 1, row.size(), file);
+			}
+		}
+
+		fclose(file);
+		return SWR_OK;
+	}
+
+	// Reads the next number of the header, skipping whitespace and comments. Returns -1 on failure.
+	static int ReadHeaderValue(FILE* file)
+	{
+		int c = fgetc(file);
+		while (c != EOF && (isspace(c) || c == '#'))
+		{
+			if (c == '#')
+			{
+				while (c != EOF && c != '\n')
+				{
+					c = fgetc(file);
+				}
+			}
+
+			c = fgetc(file);
+		}
+
+		if (c == EOF || isdigit(c) == 0)
+			return -1;
+
+		int value = 0;
+		while (c != EOF && isdigit(c))
+		{
+			value = value * 10 + (c - '0');
+			c = fgetc(file);
+		}
+
+		// A single whitespace character ends the value; after the last one the pixels start.
+		return value;
+	}
+
+	SWR_ERR ReadPPM(const char* filename, std::vector<U8> &pixels, U32 &width, U32 &height)
+	{
+		FILE* file = fopen(filename, "rb");
+		if (file == NULL)
+			return SWR_FAIL;
+
+		bool valid = fgetc(file) == 'P' && fgetc(file) == '6';
+		int w = valid ? ReadHeaderValue(file) : -1;
+		int h = valid ? ReadHeaderValue(file) : -1;
+		int maxValue = valid ? ReadHeaderValue(file) : -1;
+
+		if (w < 1 || h < 1 || maxValue != 255)
+		{
+			LOG("The file is not an 8 bit binary PPM.", LOG_Error);
+			fclose(file);
+			return SWR_FAIL;
+		}
+
+		width = (U32)w;
+		height = (U32)h;
+
+		std::vector<U8> rgb(width * height * 3);
+		if (fread(&rgb[0], 1, rgb.size(), file) != rgb.size())
+		{
+			LOG("The PPM file is truncated.", LOG_Error);
+			fclose(file);
+			return SWR_FAIL;
+		}
+
+		fclose(file);
+
+		pixels.resize(width * height * 4);
+		for (U32 i = 0; i < width * height; i++)
+		{
+			pixels[i * 4 + 0] = rgb[i * 3 + 2];
+			pixels[i * 4 + 1] = rgb[i * 3 + 1];
+			pixels[i * 4 + 2] = rgb[i * 3 + 0];
+			pixels[i * 4 + 3] = 0;
+		}
+
+		return SWR_OK;
+	}
+
+}; // End namespace SWR.
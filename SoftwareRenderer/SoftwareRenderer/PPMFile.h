@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef PPM_FILE_H
+#define PPM_FILE_H
+
+//****************************************************************************
+//**
+//**    PPMFile.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace SWR
+{
+	// Saving and loading frames as binary (P6) PPM images, which any image viewer opens and which
+	// take no library to read back. The pixels are 32 bit and laid out like the back-buffer; the
+	// unused fourth byte is dropped when saving and zeroed when loading.
+
+	// Writes the pixels, pitch bytes per row.
+	SWR_ERR WritePPM(const char* filename, const U8* pixels, U32 width, U32 height, U32 pitch);
+
+	// Reads an image with 8 bit channels into the pixels, width * 4 bytes per row.
+	SWR_ERR ReadPPM(const char* filename, std::vector<U8> &pixels, U32 &width, U32 &height);
+
+}; // End namespace SWR.
+
+#endif // #ifndef PPM_FILE_H
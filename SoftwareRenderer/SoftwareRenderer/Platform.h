@@ -0,0 +1,69 @@
+#pragma once
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+//****************************************************************************
+//**
+//**    Platform.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+// Selects the platform layer the render device is built with.
+// Win32 presents the back-buffer to a window through GDI. Headless renders into heap memory with
+// no window or display, and the finished frame is read back by the application instead.
+// Headless is used everywhere but Windows, or on Windows when SWR_HEADLESS is defined.
+#if defined(_WIN32) && !defined(SWR_HEADLESS)
+#define SWR_PLATFORM_WIN32 1
+#include <windows.h>
+#else
+#define SWR_PLATFORM_HEADLESS 1
+#endif
+
+#include "DataTypes.h"
+#include "AllocationTracker.h"
+
+// The alignment of heap allocated surfaces, and of the start of each of their rows. A cache line,
+// which also suits the SSE spans.
+#define SWR_SURFACE_ALIGNMENT 64
+
+namespace SWR
+{
+	// Allocates memory aligned to alignment bytes, which must be a power of 2. Returns NULL on
+	// failure. Must be released with AlignedFree.
+	// Built on SWR_MALLOC rather than the platform's aligned malloc, so the allocation tracker
+	// sees the surfaces too; the pointer malloc returned is kept just in front of the block.
+	inline void* AlignedAlloc(size_t size, size_t alignment)
+	{
+		U8* block = (U8*)SWR_MALLOC(size + alignment + sizeof(void*));
+		if (block == NULL)
+			return NULL;
+
+		size_t mask = alignment - 1;
+		U8* aligned = (U8*)(((size_t)(block + sizeof(void*)) + mask) & ~mask);
+		((void**)aligned)[-1] = block;
+		return aligned;
+	}
+
+	inline void AlignedFree(void* memory)
+	{
+		if (memory != NULL)
+		{
+			SWR_FREE(((void**)memory)[-1]);
+		}
+	}
+
+	// Pads a row of rowBytes so the next row starts on the surface alignment.
+	inline U32 AlignPitch(U32 rowBytes)
+	{
+		return (rowBytes + SWR_SURFACE_ALIGNMENT - 1) & ~(U32)(SWR_SURFACE_ALIGNMENT - 1);
+	}
+
+}; // End namespace SWR.
+
+#endif // #ifndef PLATFORM_H
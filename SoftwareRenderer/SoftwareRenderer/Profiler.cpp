@@ -0,0 +1,166 @@
+//****************************************************************************
+//**
+//**    Profiler.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "Profiler.h"
+
+#ifdef SWR_PROFILE
+
+#include <cstdio>
+#include <chrono>
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	// The ring of the calling thread, created when it registers or on its first event.
+	static thread_local ProfileRing* t_ring = NULL;
+
+	static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+	Profiler::Profiler()
+		: m_frameStart(0)
+		, m_frameEnd(0)
+		, m_lastFrameMark(0)
+		, m_totalFrames(0)
+	{
+		RegisterThread();
+	}
+
+	Profiler::~Profiler()
+	{
+		for (size_t i = 0; i < m_rings.size(); i++)
+		{
+			delete m_rings[i];
+		}
+
+		m_rings.clear();
+	}
+
+	Profiler& Profiler::Instance()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+	U64 Profiler::Now()
+	{
+		return (U64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+	}
+
+	ProfileRing* Profiler::CreateRing()
+	{
+		ProfileRing* ring = new ProfileRing();
+		ring->written.store(0);
+
+		std::lock_guard<std::mutex> lock(m_ringsLock);
+		ring->threadIndex = (int)m_rings.size();
+		m_rings.push_back(ring);
+		return ring;
+	}
+
+	void Profiler::RegisterThread()
+	{
+		if (t_ring == NULL)
+		{
+			t_ring = CreateRing();
+		}
+	}
+
+	void Profiler::Record(const char* name, U64 start, U64 end)
+	{
+		ProfileRing* ring = t_ring;
+		if (ring == NULL)
+		{
+			ring = CreateRing();
+			t_ring = ring;
+		}
+
+		U32 written = ring->written.load(std::memory_order_relaxed);
+		ProfileEvent &e = ring->events[written & (ProfileRing::CAPACITY - 1)];
+		e.name = name;
+		e.start = start;
+		e.end = end;
+
+		// Publish the event to a reader on another thread.
+		ring->written.store(written + 1, std::memory_order_release);
+	}
+
+	void Profiler::EndFrame()
+	{
+		U64 now = Now();
+		m_frameStart = m_lastFrameMark;
+		m_frameEnd = now;
+		m_lastFrameMark = now;
+		m_totalFrames++;
+	}
+
+	U32 Profiler::GetTotalFrames() const
+	{
+		return m_totalFrames;
+	}
+
+	SWR_ERR Profiler::WriteFrameTrace(const char* filename)
+	{
+		if (m_totalFrames == 0)
+		{
+			LOG("There is no complete frame to write a trace of.", LOG_Warning);
+			return SWR_FAIL;
+		}
+
+		FILE* file = fopen(filename, "w");
+		if (file == NULL)
+		{
+			LOG("Failed to open the profiler trace file.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		std::lock_guard<std::mutex> lock(m_ringsLock);
+
+		fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+		fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"SoftwareRenderer frame %u\"}}", m_totalFrames);
+
+		for (size_t r = 0; r < m_rings.size(); r++)
+		{
+			const ProfileRing* ring = m_rings[r];
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}}", ring->threadIndex, ring->threadIndex);
+
+			U32 written = ring->written.load(std::memory_order_acquire);
+			U32 available = written < (U32)ProfileRing::CAPACITY ? written : (U32)ProfileRing::CAPACITY;
+			for (U32 i = written - available; i != written; i++)
+			{
+				const ProfileEvent &e = ring->events[i & (ProfileRing::CAPACITY - 1)];
+				if (e.start < m_frameStart || e.end > m_frameEnd)
+					continue;
+
+				// Chrome wants microseconds.
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					e.name, ring->threadIndex, (e.start - m_frameStart) / 1000.0, (e.end - e.start) / 1000.0);
+			}
+		}
+
+		fprintf(file, "\n]}\n");
+		fclose(file);
+		return SWR_OK;
+	}
+
+	void Profiler::Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_ringsLock);
+		for (size_t i = 0; i < m_rings.size(); i++)
+		{
+			m_rings[i]->written.store(0, std::memory_order_release);
+		}
+	}
+
+}; // End namespace SWR.
+
+#endif // #ifdef SWR_PROFILE
@@ -0,0 +1,151 @@
+#pragma once
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+//****************************************************************************
+//**
+//**    Profiler.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+// Timing of the render pipeline's stages. Only built when SWR_PROFILE is defined; otherwise the
+// macros below expand to nothing and none of the profiler is compiled.
+//
+//     SWR_PROFILE_SCOPE("Clip");   // Times the rest of the enclosing block.
+//     SWR_PROFILE_FRAME();         // Marks the end of a frame; the render device does this in Present.
+//     SWR_PROFILE_THREAD();        // Gives the calling thread its ring before it records anything.
+//
+// Each thread records into its own ring buffer, so recording takes no locks. Once a ring is full
+// the oldest events are overwritten. The last complete frame can be written out as Chrome trace
+// event JSON (load it in chrome://tracing or Perfetto) with Profiler::WriteFrameTrace.
+//
+// A stage scope is also an allocation scope (see AllocationTracker.h), with or without SWR_PROFILE.
+
+#include "AllocationTracker.h"
+
+#ifdef SWR_PROFILE
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include "DataTypes.h"
+
+namespace SWR
+{
+	// A timed scope. Times are in nanoseconds from when the profiler was created.
+	struct ProfileEvent
+	{
+		const char* name; // Must be a string literal, or otherwise outlive the profiler.
+		U64 start;
+		U64 end;
+	};
+
+	// ------------------------------------------------------------------------
+	//								ProfileRing
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The events recorded by one thread. Only the owning thread writes to it.
+	// ------------------------------------------------------------------------
+	struct ProfileRing
+	{
+		enum { CAPACITY = 1 << 16 };
+
+		ProfileEvent events[CAPACITY];
+		std::atomic<U32> written; // Total events ever recorded; wraps into events.
+		int threadIndex;
+	};
+
+	// ------------------------------------------------------------------------
+	//								Profiler
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Owns the per thread rings and the frame boundaries. The thread that
+	// creates the profiler and the render threads get their rings up front,
+	// so recording never allocates during a frame; any other thread gets one
+	// the first time it records. Rings are kept until the profiler is
+	// destroyed at exit.
+	// Writing a trace reads every ring, so it should be done between frames,
+	// while the render threads are idle.
+	// ------------------------------------------------------------------------
+	class Profiler
+	{
+	private:
+		std::mutex m_ringsLock;
+		std::vector<ProfileRing*> m_rings;
+
+		// The last complete frame.
+		U64 m_frameStart;
+		U64 m_frameEnd;
+		U64 m_lastFrameMark;
+		U32 m_totalFrames;
+
+		Profiler();
+
+		ProfileRing* CreateRing();
+	protected:
+	public:
+		~Profiler();
+
+		static Profiler& Instance();
+
+		// Nanoseconds since the profiler was created.
+		static U64 Now();
+
+		// Creates the calling thread's ring, if it doesn't have one yet.
+		void RegisterThread();
+
+		void Record(const char* name, U64 start, U64 end);
+
+		void EndFrame();
+		U32 GetTotalFrames() const;
+
+		// Writes the events of the last complete frame as Chrome trace event JSON.
+		SWR_ERR WriteFrameTrace(const char* filename);
+
+		// Drops every recorded event.
+		void Clear();
+	};
+
+	// Records the time between its construction and destruction.
+	class ProfileScope
+	{
+	private:
+		const char* m_name;
+		U64 m_start;
+	public:
+		inline ProfileScope(const char* name)
+			: m_name(name)
+			, m_start(Profiler::Now())
+		{
+		}
+
+		inline ~ProfileScope()
+		{
+			Profiler::Instance().Record(m_name, m_start, Profiler::Now());
+		}
+	};
+
+}; // End namespace SWR.
+
+#define SWR_PROFILE_CONCAT_INNER(a, b) a##b
+#define SWR_PROFILE_CONCAT(a, b) SWR_PROFILE_CONCAT_INNER(a, b)
+#define SWR_PROFILE_SCOPE(name) SWR::ProfileScope SWR_PROFILE_CONCAT(profileScope, __LINE__)(name); SWR_ALLOC_SCOPE(name)
+#define SWR_PROFILE_FRAME() SWR::Profiler::Instance().EndFrame()
+#define SWR_PROFILE_THREAD() SWR::Profiler::Instance().RegisterThread()
+
+#else
+
+#define SWR_PROFILE_SCOPE(name) SWR_ALLOC_SCOPE(name)
+#define SWR_PROFILE_FRAME()
+#define SWR_PROFILE_THREAD()
+
+#endif // #ifdef SWR_PROFILE
+
+#endif // #ifndef PROFILER_H
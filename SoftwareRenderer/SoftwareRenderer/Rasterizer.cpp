@@ -11,6 +11,8 @@
 
 #include <assert.h>
 #include <cmath>
+#include <cstring>
+#include <chrono>
 
 #include "Rasterizer.h"
 
@@ -18,20 +20,40 @@
 #include "ZDepthBuffer.h"
 #include "Colour.h"
 #include "Texture.h"
+#include "LightingManager.h"
+#include "TiledLightList.h"
+#include "GBuffer.h"
+#include "RenderTarget.h"
+#include "Profiler.h"
 
 #include "SWR_Math.h"
 #include "SWRUtil.h"
+#include "SWR_SIMD.h"
 
 #include "Logger.h"
 #include "MemoryLeak.h"
 
 #define FIXED_INTEGER_SHIFT 12
 
+// The bytes a G-buffer pixel takes across its planes; depth, normal, albedo and material.
+#define GBUFFER_PIXEL_BYTES (4 * sizeof(float) + sizeof(U32) + sizeof(U8))
+
 namespace SWR
 {
 
 	Rasterizer::Rasterizer()
 	{
+		m_scanLineBuffer = NULL;
+		m_scanLineBufferHeight = 0;
+		m_batchingSpans = false;
+		m_batchType = SPANBATCH_None;
+		m_batchBuffer = NULL;
+		m_batchColSpans = NULL;
+		m_batchTexSpans = NULL;
+		m_batchTexLevels = NULL;
+		m_batchOrder = NULL;
+		m_batchRowStarts = NULL;
+		m_batchTotalSpans = 0;
 		Reset();
 	}
 
@@ -47,27 +69,64 @@ namespace SWR
 		
 		if (m_scanLineBuffer != NULL)
 		{
-			delete [] m_scanLineBuffer;
+			delete [] (char*)m_scanLineBuffer;
 		}
 
+		if (m_batchBuffer != NULL)
+		{
+			delete [] m_batchBuffer;
+		}
 	}
 
-	void Rasterizer::SetTargetBuffers(U8* backBuffer, ZDepthBuffer* zBuffer, U32 width, U32 height)
+	void Rasterizer::SetTargetBuffers(U8* backBuffer, ZDepthBuffer* zBuffer, U32 width, U32 height, U32 pitch)
 	{
 		m_targetBackBuffer = backBuffer;
 		m_targetZBuffer = zBuffer;
 		m_bufferHeight = height;
 		m_bufferWidth = width;
+		m_bufferPitch = pitch >> 2;
+
+		// Split the buffer into tiles, rounding up to cover partial tiles at the edges.
+		m_tileGrid.tileSize = RASTER_TILE_SIZE;
+		m_tileGrid.tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+		m_tileGrid.tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
 
 		// Generate the edge list buffers.
-		//int scanLineCol = 
-		int size = sizeof(ScanlineDataCol) > sizeof(ScanlineDataTex) ? sizeof(ScanlineDataCol) : sizeof(ScanlineDataTex);
-		
-		this->m_scanLineBuffer = new char[(height * 2 * size)];
+		if (height > m_scanLineBufferHeight)
+		{
+			if (m_scanLineBuffer != NULL)
+			{
+				delete [] (char*)m_scanLineBuffer;
+			}
+
+			int size = sizeof(ScanlineDataCol) > sizeof(ScanlineDataTex) ? sizeof(ScanlineDataCol) : sizeof(ScanlineDataTex);
+			this->m_scanLineBuffer = new char[(height * 2 * size)];
+			m_scanLineBufferHeight = height;
+
+			// The span batch, its fill order and level per span, and the start of each row in the order.
+			if (m_batchBuffer != NULL)
+			{
+				delete [] m_batchBuffer;
+			}
+
+			U32 capacity = SPAN_BATCH_SIZE + height * 2;
+			m_batchBuffer = new char[capacity * (size + sizeof(U32) + sizeof(U8)) + (height + 1) * sizeof(U32)];
+			m_batchColSpans = (ScanlineDataCol*)m_batchBuffer;
+			m_batchTexSpans = (ScanlineDataTex*)m_batchBuffer;
+			m_batchOrder = (U32*)(m_batchBuffer + capacity * size);
+			m_batchRowStarts = m_batchOrder + capacity;
+			m_batchTexLevels = (U8*)(m_batchRowStarts + height + 1);
+		}
+
 		this->m_scanLineColBuffer = (ScanlineDataCol*)m_scanLineBuffer;
 		this->m_scanLineTexBuffer = (ScanlineDataTex*)m_scanLineBuffer;
 	}
 
+	void Rasterizer::SetRenderTarget(RenderTarget* target)
+	{
+		SetTargetBuffers(target->GetColour(), target->GetDepth(), target->GetWidth(), target->GetHeight(), target->GetPitch());
+	}
+
 	void Rasterizer::Reset()
 	{
 		EnableZTesting(false);
@@ -76,8 +135,25 @@ namespace SWR
 		m_targetBackBuffer = NULL;
 		m_targetZBuffer = NULL;
 		m_targetTexture = NULL;
+		m_perspectiveTextures = false;
+		m_near = 1.0f;
+		m_far = 1000.0f;
+		memset(&m_texLevel, 0, sizeof(TextureLevel));
+		memset(&m_texAddressing, 0, sizeof(TexelAddressing));
+		m_texLevelIndex = 0;
+		m_pixelLights = NULL;
+		m_totalPixelLights = 0;
+		m_lightTiles = NULL;
+		m_shadowMap = NULL;
+		m_targetGBuffer = NULL;
+		m_gbufferMaterial = GBUFFER_Lit;
+		m_stats = &m_ownStats;
+		m_overdrawCounts = NULL;
+		m_tileCosts = NULL;
+		memset(&m_tileGrid, 0, sizeof(TileGrid));
 		m_bufferWidth = 0;
 		m_bufferHeight = 0;
+		m_bufferPitch = 0;
 	}
 
 	void Rasterizer::EnableZTesting(bool enable)
@@ -89,6 +165,167 @@ namespace SWR
 	{
 		m_targetTexture = texture;
 	}
+
+	void Rasterizer::SetPerspectiveTexturing(bool enable, Real nearPlane, Real farPlane)
+	{
+		m_perspectiveTextures = enable;
+		m_near = nearPlane;
+		m_far = farPlane;
+	}
+
+	void Rasterizer::SelectTextureLevel(const Vertex* verts)
+	{
+		U32 totalLevels = m_targetTexture->GetTotalLevels();
+		if (totalLevels == 1)
+		{
+			SetTextureLevel(0);
+			return;
+		}
+
+		// The texels the triangle covers in level 0 over the pixels it covers, from twice their areas.
+		float texelArea = fabs((verts[1].u - verts[0].u) * (verts[2].v - verts[0].v) - (verts[2].u - verts[0].u) * (verts[1].v - verts[0].v))
+			* m_targetTexture->GetWidth() * m_targetTexture->GetHeight();
+		float pixelArea = fabs((verts[1].x - verts[0].x) * (verts[2].y - verts[0].y) - (verts[2].x - verts[0].x) * (verts[1].y - verts[0].y));
+
+		// Each level has a quarter of the texels of the last, so the level is half the log 2 of
+		// the ratio, rounded to the nearest.
+		U32 level = 0;
+		if (texelArea > pixelArea)
+		{
+			float lod = pixelArea > 0.0f ? 0.5f * log2f(texelArea / pixelArea) + 0.5f : (float)totalLevels;
+			level = lod < (float)totalLevels ? (U32)lod : totalLevels - 1;
+		}
+
+		SetTextureLevel(level);
+	}
+
+	// Returns log 2 of a power of 2.
+	static inline U32 Log2(U32 pow2)
+	{
+		U32 shift = 0;
+		while ((1u << shift) < pow2)
+		{
+			shift++;
+		}
+
+		return shift;
+	}
+
+	void Rasterizer::SetTextureLevel(U32 level)
+	{
+		m_texLevel = m_targetTexture->GetLevel(level);
+		m_texLevelIndex = level;
+
+		TexelAddressing &addressing = m_texAddressing;
+		addressing.mode = m_targetTexture->GetAddressMode();
+		addressing.filter = m_targetTexture->GetFilter();
+		addressing.width = m_texLevel.width;
+		addressing.height = m_texLevel.height;
+		addressing.widthMask = addressing.width - 1;
+		addressing.heightMask = addressing.height - 1;
+
+		// Both sizes a power of 2; the pitch then is as well, as it is padded to a power of 2.
+		U32 pitchTexels = m_texLevel.pitch >> 2;
+		addressing.pow2 = (addressing.width & addressing.widthMask) == 0 && (addressing.height & addressing.heightMask) == 0 && (pitchTexels & (pitchTexels - 1)) == 0;
+		addressing.widthShift = Log2(addressing.width);
+		addressing.heightShift = Log2(addressing.height);
+		addressing.pitchShift = Log2(pitchTexels);
+	}
+
+	void Rasterizer::SetStats(RenderStats* stats)
+	{
+		m_stats = stats != NULL ? stats : &m_ownStats;
+	}
+
+	void Rasterizer::SetDebugCounters(U16* overdrawCounts, U64* tileCosts)
+	{
+		m_overdrawCounts = overdrawCounts;
+		m_tileCosts = tileCosts;
+	}
+
+	U64 Rasterizer::DebugClock()
+	{
+		return (U64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void Rasterizer::AddDebugSpan(U32 y, int xStart, int xEnd, U64 startTime)
+	{
+		if (xStart < 0)
+			xStart = 0;
+		if (xEnd > (int)m_bufferWidth)
+			xEnd = (int)m_bufferWidth;
+		if (xStart >= xEnd)
+			return;
+
+		if (m_overdrawCounts != NULL)
+		{
+			U16* counts = m_overdrawCounts + y * m_bufferWidth;
+			for (int x = xStart; x < xEnd; x++)
+			{
+				if (counts[x] < 0xFFFF)
+					counts[x]++;
+			}
+		}
+
+		if (m_tileCosts != NULL)
+		{
+			// Split the span's time between the tiles it crosses by their share of its pixels.
+			U64 elapsed = DebugClock() - startTime;
+			U64 totalPixels = (U64)(xEnd - xStart);
+			U64* tileRow = m_tileCosts + (y / m_tileGrid.tileSize) * m_tileGrid.tilesX;
+			for (int x = xStart; x < xEnd; )
+			{
+				U32 tileX = x / m_tileGrid.tileSize;
+				int segmentEnd = (int)((tileX + 1) * m_tileGrid.tileSize);
+				if (segmentEnd > xEnd)
+					segmentEnd = xEnd;
+
+				tileRow[tileX] += elapsed * (U64)(segmentEnd - x) / totalPixels;
+				x = segmentEnd;
+			}
+		}
+	}
+
+	void Rasterizer::SetPixelLights(const PixelLight* lights, int totalLights)
+	{
+		m_pixelLights = lights;
+		m_totalPixelLights = totalLights;
+	}
+
+	void Rasterizer::SetLightTiles(const TiledLightList* tiles)
+	{
+		m_lightTiles = tiles;
+	}
+
+	const TileGrid& Rasterizer::GetTileGrid() const
+	{
+		return m_tileGrid;
+	}
+
+	void Rasterizer::SetShadowMap(const ShadowMapView* shadowMap)
+	{
+		m_shadowMap = shadowMap;
+	}
+
+	const ShadowMapView* Rasterizer::GetShadowMap() const
+	{
+		return m_shadowMap;
+	}
+
+	void Rasterizer::SetTargetGBuffer(GBuffer* gbuffer)
+	{
+		m_targetGBuffer = gbuffer;
+	}
+
+	void Rasterizer::SetGBufferMaterial(U8 material)
+	{
+		m_gbufferMaterial = material;
+	}
+
+	U8 Rasterizer::GetGBufferMaterial() const
+	{
+		return m_gbufferMaterial;
+	}
 	
 	void Rasterizer::ScanLineCol(ScanlineDataCol* scanline)
 	{
@@ -100,8 +337,14 @@ namespace SWR
 		U32 xStart = ceil(scanline->xStart);
 		U32 xEnd = ceil(scanline->xEnd);// - 1;
 
+		U32 totalPixels = xEnd > xStart ? xEnd - xStart : 0;
+		m_stats->pixelsShaded += totalPixels;
+		m_stats->bytesWritten += totalPixels * 4;
+
+		U64 spanStart = m_tileCosts != NULL ? DebugClock() : 0;
+
 		// Load the back buffer at the start point for our render.
-		U32* buffer = (U32*)(m_targetBackBuffer + ((xStart + (scanline->y * m_bufferWidth)) << 2));
+		U32* buffer = (U32*)(m_targetBackBuffer + ((xStart + (scanline->y * m_bufferPitch)) << 2));
 
 		static U32 colour;
 		static S32 rCol, rSlope, gCol, gSlope, bCol, bSlope;
@@ -122,45 +365,315 @@ namespace SWR
 			gCol += gSlope;
 			bCol += bSlope;
 		}
+
+		if (m_overdrawCounts != NULL || m_tileCosts != NULL)
+		{
+			AddDebugSpan(scanline->y, (int)xStart, (int)xEnd, spanStart);
+		}
 	}
 	
+	// The texel addressing for each TextureAddressMode. Apply maps a texel coordinate that may be
+	// outside of the texture into it, given the size, the size - 1 and, for powers of 2, log 2 of
+	// the size. The power of 2 versions are a mask or two and no branches.
+	template <bool Pow2>
+	struct TexelClamp
+	{
+		enum { POW2 = Pow2 };
+		static inline S32 Apply(S32 t, S32, S32 mask, U32)
+		{
+			t = t < 0 ? 0 : t;
+			return t > mask ? mask : t;
+		}
+	};
+
+	template <bool Pow2>
+	struct TexelWrap
+	{
+		enum { POW2 = Pow2 };
+		static inline S32 Apply(S32 t, S32 size, S32 mask, U32)
+		{
+			if (Pow2)
+				return t & mask;
+
+			t %= size;
+			return t < 0 ? t + size : t;
+		}
+	};
+
+	template <bool Pow2>
+	struct TexelMirror
+	{
+		enum { POW2 = Pow2 };
+		static inline S32 Apply(S32 t, S32 size, S32 mask, U32 shift)
+		{
+			// Every other repeat, flip the bits below the size to count back down.
+			if (Pow2)
+				return (t ^ -((t >> shift) & 1)) & mask;
+
+			S32 period = size * 2;
+			t %= period;
+			t = t < 0 ? t + period : t;
+			return t < size ? t : period - 1 - t;
+		}
+	};
+
+	// The index of an addressed texel in a level of the layout. Powers of 2 have a power of 2
+	// pitch, so their rows are found with shifts as well.
+	template <class Address, bool Tiled>
+	static inline U32 LevelTexelIndex(U32 u, U32 v, U32 texPitch, U32 rowShift)
+	{
+		if (Tiled)
+		{
+			if (Address::POW2)
+			{
+				return ((v >> TEXTURE_TILE_SHIFT) << (rowShift + TEXTURE_TILE_SHIFT)) + (u >> TEXTURE_TILE_SHIFT << (TEXTURE_TILE_SHIFT * 2))
+					+ ((v & (TEXTURE_TILE_SIZE - 1)) << TEXTURE_TILE_SHIFT) + (u & (TEXTURE_TILE_SIZE - 1));
+			}
+
+			return TiledTexelIndex(u, v, texPitch << TEXTURE_TILE_SHIFT);
+		}
+
+		return u + (Address::POW2 ? v << rowShift : v * texPitch);
+	}
+
+	// Fills an affine span from a texture level with the addressing and layout; one is compiled
+	// for each, so the loop has no branches on either. The UVs are fixed point.
+	template <class Address, bool Tiled>
+	static void TexSpanAffine(U32* buffer, const U32* texels, U32 texPitch, const TexelAddressing &addressing, S32 uVal, S32 vVal, S32 uSlope, S32 vSlope, U32 totalPixels)
+	{
+		for (U32 i = 0; i < totalPixels; i++)
+		{
+			U32 u = (U32)Address::Apply(uVal >> FIXED_INTEGER_SHIFT, addressing.width, addressing.widthMask, addressing.widthShift);
+			U32 v = (U32)Address::Apply(vVal >> FIXED_INTEGER_SHIFT, addressing.height, addressing.heightMask, addressing.heightShift);
+
+			*buffer++ = texels[LevelTexelIndex<Address, Tiled>(u, v, texPitch, addressing.pitchShift)];
+			uVal += uSlope;
+			vVal += vSlope;
+		}
+	}
+
+	// Gathers the 2x2 texels around a fixed point UV for bilinear filtering, returning the 8 bit
+	// fractions of the way across them. The texels' centres are half a texel in from their corners.
+	template <class Address, bool Tiled>
+	static inline void GatherBilinearQuad(const U32* texels, U32 texPitch, const TexelAddressing &addressing, S32 uVal, S32 vVal, U32* quad, U32 &fracU, U32 &fracV)
+	{
+		const S32 half = 1 << (FIXED_INTEGER_SHIFT - 1);
+		uVal -= half;
+		vVal -= half;
+
+		S32 u = uVal >> FIXED_INTEGER_SHIFT;
+		S32 v = vVal >> FIXED_INTEGER_SHIFT;
+		fracU = (uVal >> (FIXED_INTEGER_SHIFT - 8)) & 0xFF;
+		fracV = (vVal >> (FIXED_INTEGER_SHIFT - 8)) & 0xFF;
+
+		// The neighbours are addressed as well, so the blend wraps, mirrors or clamps at the edges.
+		U32 u0 = (U32)Address::Apply(u, addressing.width, addressing.widthMask, addressing.widthShift);
+		U32 u1 = (U32)Address::Apply(u + 1, addressing.width, addressing.widthMask, addressing.widthShift);
+		U32 v0 = (U32)Address::Apply(v, addressing.height, addressing.heightMask, addressing.heightShift);
+		U32 v1 = (U32)Address::Apply(v + 1, addressing.height, addressing.heightMask, addressing.heightShift);
+
+		quad[0] = texels[LevelTexelIndex<Address, Tiled>(u0, v0, texPitch, addressing.pitchShift)];
+		quad[1] = texels[LevelTexelIndex<Address, Tiled>(u1, v0, texPitch, addressing.pitchShift)];
+		quad[2] = texels[LevelTexelIndex<Address, Tiled>(u0, v1, texPitch, addressing.pitchShift)];
+		quad[3] = texels[LevelTexelIndex<Address, Tiled>(u1, v1, texPitch, addressing.pitchShift)];
+	}
+
+	// As TexSpanAffine, but bilinearly filtered; two pixels are blended at a time.
+	template <class Address, bool Tiled>
+	static void TexSpanAffineBilinear(U32* buffer, const U32* texels, U32 texPitch, const TexelAddressing &addressing, S32 uVal, S32 vVal, S32 uSlope, S32 vSlope, U32 totalPixels)
+	{
+		U32 quadA[4], quadB[4];
+		U32 fracUA, fracVA, fracUB, fracVB;
+
+		U32 i = 0;
+		for (; i + 2 <= totalPixels; i += 2)
+		{
+			GatherBilinearQuad<Address, Tiled>(texels, texPitch, addressing, uVal, vVal, quadA, fracUA, fracVA);
+			GatherBilinearQuad<Address, Tiled>(texels, texPitch, addressing, uVal + uSlope, vVal + vSlope, quadB, fracUB, fracVB);
+			BilinearTexels2(quadA, fracUA, fracVA, quadB, fracUB, fracVB, buffer);
+
+			buffer += 2;
+			uVal += uSlope * 2;
+			vVal += vSlope * 2;
+		}
+
+		if (i < totalPixels)
+		{
+			GatherBilinearQuad<Address, Tiled>(texels, texPitch, addressing, uVal, vVal, quadA, fracUA, fracVA);
+			*buffer = BilinearTexels(quadA, fracUA, fracVA);
+		}
+	}
+
+	typedef void (*TexSpanAffineFunc)(U32* buffer, const U32* texels, U32 texPitch, const TexelAddressing &addressing, S32 uVal, S32 vVal, S32 uSlope, S32 vSlope, U32 totalPixels);
+
+	// By filter, then address mode, then if the sizes are powers of 2, then if the texels are tiled.
+	#define SWR_TEX_SPANS_FOR_MODE(span, Mode) \
+		{ \
+			{ span<Mode<false>, false>, span<Mode<false>, true> }, \
+			{ span<Mode<true>, false>, span<Mode<true>, true> }, \
+		}
+
+	static const TexSpanAffineFunc TEX_SPANS_AFFINE[TEXFILTER_Invalid][TEXADDRESS_Invalid][2][2] =
+	{
+		{
+			SWR_TEX_SPANS_FOR_MODE(TexSpanAffine, TexelClamp),
+			SWR_TEX_SPANS_FOR_MODE(TexSpanAffine, TexelWrap),
+			SWR_TEX_SPANS_FOR_MODE(TexSpanAffine, TexelMirror),
+		},
+		{
+			SWR_TEX_SPANS_FOR_MODE(TexSpanAffineBilinear, TexelClamp),
+			SWR_TEX_SPANS_FOR_MODE(TexSpanAffineBilinear, TexelWrap),
+			SWR_TEX_SPANS_FOR_MODE(TexSpanAffineBilinear, TexelMirror),
+		},
+	};
+
+	#undef SWR_TEX_SPANS_FOR_MODE
+
 	void Rasterizer::ScanLineTexAffine(ScanlineDataTex* scanline)
 	{
 		// Scanline end will be < 0 and cause a wrap-around.
 		if (scanline->xEnd <= 1.0f - EPSILON)
 			return;
 
-		static U32 xStart, xEnd, texelIndex;
-		static S32 uVal, vVal, uSlope, vSlope, texWidth, texHeight;
+		U32 xStart = ceil(scanline->xStart);
+		U32 xEnd = ceil(scanline->xEnd);
+
+		U32 totalPixels = xEnd > xStart ? xEnd - xStart : 0;
+		m_stats->pixelsShaded += totalPixels;
+		m_stats->texelsFetched += m_texAddressing.filter == TEXFILTER_Bilinear ? totalPixels * 4 : totalPixels;
+		m_stats->bytesWritten += totalPixels * 4;
 
-		xStart = ceil(scanline->xStart);
-		xEnd = ceil(scanline->xEnd);
+		U64 spanStart = m_tileCosts != NULL ? DebugClock() : 0;
 		
 		// Load the back buffer at the start point for our render.
-		U32* buffer = (U32*)(m_targetBackBuffer + ((xStart + (scanline->y * m_bufferWidth)) << 2));
+		U32* buffer = (U32*)(m_targetBackBuffer + ((xStart + (scanline->y * m_bufferPitch)) << 2));
 
-		// Load the texels we are going to be referencing into a buffer.
-		U32* texels = (U32*)(m_targetTexture->GetBytes());
+		// Load the texels we are going to be referencing into a buffer; those of the triangle's mip level.
+		const U32* texels = (const U32*)(m_texLevel.bytes);
 
-		// Get the width and height for our texture so we can use this to get the appropriate texel
-		// in the texture by scaling our U / V.
-		texWidth = m_targetTexture->GetWidth();
-		texHeight = m_targetTexture->GetHeight();
+		// The rows are padded, so step between them by the pitch rather than the width.
+		U32 texPitch = m_texLevel.pitch >> 2;
 
-		texelIndex = 0;
+		S32 uVal = (S32)(scanline->uStart * (1 << FIXED_INTEGER_SHIFT));
+		S32 vVal = (S32)(scanline->vStart * (1 << FIXED_INTEGER_SHIFT));
+		S32 uSlope = (S32)(scanline->uSlope * (1 << FIXED_INTEGER_SHIFT));
+		S32 vSlope = (S32)(scanline->vSlope * (1 << FIXED_INTEGER_SHIFT));
 
-		uVal = (S32)(scanline->uStart * (1 << FIXED_INTEGER_SHIFT));
-		vVal = (S32)(scanline->vStart * (1 << FIXED_INTEGER_SHIFT));
-		uSlope = (S32)(scanline->uSlope * (1 << FIXED_INTEGER_SHIFT));
-		vSlope = (S32)(scanline->vSlope * (1 << FIXED_INTEGER_SHIFT));
+		// The addressing keeps every texel inside the level, whatever the UVs.
+		const TexelAddressing &addressing = m_texAddressing;
+		TEX_SPANS_AFFINE[addressing.filter][addressing.mode][addressing.pow2][m_texLevel.layout == TEXLAYOUT_Tiled](buffer, texels, texPitch, addressing, uVal, vVal, uSlope, vSlope, totalPixels);
 
-		for (int index = xStart; index < xEnd; index++)
+		if (m_overdrawCounts != NULL || m_tileCosts != NULL)
 		{
-			texelIndex = (uVal >> FIXED_INTEGER_SHIFT) + ((vVal >> FIXED_INTEGER_SHIFT) * texWidth);
-			// Calculate our texel index.
-			*buffer++ = texels[texelIndex];
-			uVal += uSlope;
-			vVal += vSlope;
+			AddDebugSpan(scanline->y, (int)xStart, (int)xEnd, spanStart);
+		}
+	}
+
+	// The lit textured spans are done in runs of this many pixels. Each run's texels are fetched
+	// into a buffer on the stack and modulated into the back buffer from there. Perspective
+	// correct spans find the UVs exactly at the ends of each run and step them affinely between.
+	static const U32 TEX_LIGHT_RUN = 16;
+
+	template <bool Lit>
+	void Rasterizer::ScanLineTexRuns(ScanlineDataTexLight* scanline)
+	{
+		// Scanline end will be < 0 and cause a wrap-around.
+		if (scanline->xEnd <= 1.0f - EPSILON)
+			return;
+
+		// Apply top-left fill convention.
+		int xStart = (int)ceil(scanline->xStart);
+		int xEnd = (int)ceil(scanline->xEnd);
+		if (xStart < 0)
+			xStart = 0;
+		if (xEnd > (int)m_bufferWidth)
+			xEnd = (int)m_bufferWidth;
+		if (xStart >= xEnd)
+			return;
+
+		U32 totalPixels = (U32)(xEnd - xStart);
+		m_stats->pixelsShaded += totalPixels;
+		m_stats->texelsFetched += m_texAddressing.filter == TEXFILTER_Bilinear ? totalPixels * 4 : totalPixels;
+		m_stats->bytesWritten += totalPixels * 4;
+
+		U64 spanStart = m_tileCosts != NULL ? DebugClock() : 0;
+
+		U32* buffer = (U32*)(m_targetBackBuffer + ((xStart + (scanline->y * m_bufferPitch)) << 2));
+		const U32* texels = (const U32*)(m_texLevel.bytes);
+		U32 texPitch = m_texLevel.pitch >> 2;
+		const TexelAddressing &addressing = m_texAddressing;
+		TexSpanAffineFunc texSpan = TEX_SPANS_AFFINE[addressing.filter][addressing.mode][addressing.pow2][m_texLevel.layout == TEXLAYOUT_Tiled];
+		bool perspective = !Lit || m_perspectiveTextures;
+
+		// The colour is clamped at both ends of the span, so no pixel between can carry into the
+		// next channel. The slopes are truncated towards 0, so they never step past the end.
+		S32 colour[3] = { 0 }, colourSlope[3] = { 0 };
+		for (int i = 0; Lit && i < 3; i++)
+		{
+			float first = scanline->start[TEXLIGHT_Red + i];
+			float last = first + scanline->slope[TEXLIGHT_Red + i] * (totalPixels - 1);
+			first = Clamp<float>(0.0f, 255.0f, first);
+			last = Clamp<float>(0.0f, 255.0f, last);
+
+			colour[i] = (S32)(first * (1 << FIXED_INTEGER_SHIFT));
+			colourSlope[i] = totalPixels > 1 ? (S32)((last - first) / (totalPixels - 1) * (1 << FIXED_INTEGER_SHIFT)) : 0;
+		}
+
+		float invW = scanline->start[TEXLIGHT_InvW];
+		float uw = scanline->start[TEXLIGHT_U];
+		float vw = scanline->start[TEXLIGHT_V];
+		float w = perspective ? 1.0f / invW : 1.0f;
+
+		S32 uVal = (S32)(uw * w * (1 << FIXED_INTEGER_SHIFT));
+		S32 vVal = (S32)(vw * w * (1 << FIXED_INTEGER_SHIFT));
+		S32 uSlope = (S32)(scanline->slope[TEXLIGHT_U] * (1 << FIXED_INTEGER_SHIFT));
+		S32 vSlope = (S32)(scanline->slope[TEXLIGHT_V] * (1 << FIXED_INTEGER_SHIFT));
+
+		U32 texelRun[TEX_LIGHT_RUN];
+		U32 colourRun[TEX_LIGHT_RUN];
+		for (U32 done = 0; done < totalPixels; )
+		{
+			U32 run = totalPixels - done < TEX_LIGHT_RUN ? totalPixels - done : TEX_LIGHT_RUN;
+
+			// Divide at the end of the run, and step there in a straight line.
+			S32 uNext = 0, vNext = 0;
+			if (perspective)
+			{
+				invW += scanline->slope[TEXLIGHT_InvW] * run;
+				uw += scanline->slope[TEXLIGHT_U] * run;
+				vw += scanline->slope[TEXLIGHT_V] * run;
+				w = 1.0f / invW;
+
+				uNext = (S32)(uw * w * (1 << FIXED_INTEGER_SHIFT));
+				vNext = (S32)(vw * w * (1 << FIXED_INTEGER_SHIFT));
+				uSlope = (uNext - uVal) / (S32)run;
+				vSlope = (vNext - vVal) / (S32)run;
+			}
+
+			// Unlit texels go straight to the back buffer.
+			texSpan(Lit ? texelRun : buffer + done, texels, texPitch, addressing, uVal, vVal, uSlope, vSlope, run);
+
+			if (Lit)
+			{
+				for (U32 i = 0; i < run; i++)
+				{
+					colourRun[i] = 0xFF000000 | ((colour[0] >> FIXED_INTEGER_SHIFT) << RED_BIT_SHIFT) | ((colour[1] >> FIXED_INTEGER_SHIFT) << GREEN_BIT_SHIFT) | (colour[2] >> FIXED_INTEGER_SHIFT);
+					colour[0] += colourSlope[0];
+					colour[1] += colourSlope[1];
+					colour[2] += colourSlope[2];
+				}
+
+				ModulateTexels(texelRun, colourRun, buffer + done, run);
+			}
+
+			uVal = perspective ? uNext : uVal + uSlope * (S32)run;
+			vVal = perspective ? vNext : vVal + vSlope * (S32)run;
+			done += run;
+		}
+
+		if (m_overdrawCounts != NULL || m_tileCosts != NULL)
+		{
+			AddDebugSpan(scanline->y, xStart, xEnd, spanStart);
 		}
 	}
 
@@ -273,6 +786,9 @@ namespace SWR
 		  numOfPixels = deltaY;         // The number of pixels is the total delta in the y direction
 		}
 		
+		m_stats->pixelsShaded += numOfPixels + 1;
+		m_stats->bytesWritten += (numOfPixels + 1) * 4;
+
 		float numOfPixelsInv = 1 / (float)numOfPixels;
 		// Calculate the colour slopes.
 		float rCol = c1.R;
@@ -298,7 +814,7 @@ namespace SWR
 			// Get rid of these casts. Find something on fast float conversions.
 			colour = 0 | (((U8)rCol) << RED_BIT_SHIFT) | (((U8)gCol) << GREEN_BIT_SHIFT) | (((U8)bCol) << BLUE_BIT_SHIFT);
 
-			byteIndex = (xPos + (yPos * m_bufferWidth));// Calculate the write index for the back buffer.
+			byteIndex = (xPos + (yPos * m_bufferPitch));// Calculate the write index for the back buffer.
 			backBuffer[byteIndex] = colour;
 			num += numInc;              // Increase the numerator by the top of the fraction
 					
@@ -354,13 +870,33 @@ namespace SWR
 		}
 	}
 
-	// THis function draws a filled gourad shaded triangle.
-	// THe code is pretty foul but there really isnt an easy way to make this clean without
-	// killing whatever perfomance I have with a software renderer.
-	// This is mostly to accomodate for each type of triangle that could occur and I have
-	// written code to switch / prepare values for these cases.
+	// Draws a filled gourad shaded triangle. It is stepped into the edge list like the batched one,
+	// and the scan-lines are filled straight away.
 	void Rasterizer::RasterizeTriSolid(Vertex* tri)
-	{		
+	{
+		int totalScanlines = GenerateEdgeListCol(tri);
+
+		SWR_PROFILE_SCOPE("SpanFill");
+		for (int i = 0; i < totalScanlines; i++)
+		{
+			ScanLineCol(&m_scanLineColBuffer[i]);
+		}
+	}
+
+	// The texture based triangle rasterization is the same as the Gourad shaded filled triangle procedure.
+	// We use the same steps and procedures of deducing the type of triangle (Major or minor) however here
+	// we are interpolating UV co-ordinates based on the slopes between each vertex.
+	// Each UV co-ordinate is also scaled up by the source texture width and height to avoid getting visaul artifacts.
+	void Rasterizer::RasterizeTriTex(Vertex* tri)
+	{
+		if (m_perspectiveTextures)
+		{
+			RasterizeTriTexPerspective(tri);
+			return;
+		}
+
+		SWR_PROFILE_SCOPE("TriangleSetup");
+
 		enum VertexLocation
 		{
 			TOP,
@@ -373,6 +909,7 @@ namespace SWR
 
 		// Sort vertices up to down.
 		Vertex verts[3];
+		
 		SortByY(verts, tri);
 
 		// Determine if the triangle is major/minor.
@@ -389,6 +926,14 @@ namespace SWR
 		float invDeltaYTB = 1.0f / (verts[BOTTOM].y - verts[TOP].y);
 		float invDeltaYTM = 1.0f / (verts[MIDDLE].y - verts[TOP].y);
 		float invDeltaYMB = 1.0f / (verts[BOTTOM].y - verts[MIDDLE].y);
+
+		// Scale out the vertices UV's based on the level of the current texture it samples.
+		SelectTextureLevel(verts);
+		for (int i = 0; i < 3; i++)
+		{
+			verts[i].u *= m_texLevel.width;
+			verts[i].v *= m_texLevel.height;
+		}
 	
 		// Slope values for screen pixels
 		float x1, x2;
@@ -399,18 +944,17 @@ namespace SWR
 		float zSlopeLeft, zSlopeRight;
 		float spanXInv = 0.0f;
 
-		// Slope values for colour values.
-		float r1, r2;
-		float g1, g2;
-		float b1, b2;
-		float rSlopeLeft, gSlopeLeft, bSlopeLeft;
-		float rSlopeRight, gSlopeRight, bSlopeRight;
+		// Slope values for texel values.
+		float u1, u2;
+		float v1, v2;
+		float uSlopeLeft, vSlopeLeft;
+		float uSlopeRight, vSlopeRight;
 
 		// To update the interpolants.
 		float sub = 0.0f;
 
-		ScanlineDataCol scanline;
-		memset(&scanline, 0, sizeof(ScanlineDataCol));
+		static ScanlineDataTex scanline;
+		memset(&scanline, 0, sizeof(ScanlineDataTex));
 		
 		// Decide on how to setup the scanline rendering.
 		if (triType == TRIANGLE_Minor)
@@ -427,33 +971,20 @@ namespace SWR
 			yEnd = ceil(verts[MIDDLE].y) - 1;
 
 			// Set up the colour interpolation values.
-			r1 = verts[TOP].colour.R;
-			r2 = verts[TOP].colour.R;
-			g1 = verts[TOP].colour.G;
-			g2 = verts[TOP].colour.G;
-			b1 = verts[TOP].colour.B;
-			b2 = verts[TOP].colour.B;
-
-			rSlopeLeft = (verts[MIDDLE].colour.R - verts[TOP].colour.R) * invDeltaYTM;
-			rSlopeRight = (verts[BOTTOM].colour.R - verts[TOP].colour.R) * invDeltaYTB;
-			gSlopeLeft = (verts[MIDDLE].colour.G - verts[TOP].colour.G) * invDeltaYTM;
-			gSlopeRight = (verts[BOTTOM].colour.G - verts[TOP].colour.G) * invDeltaYTB;
-			bSlopeLeft = (verts[MIDDLE].colour.B - verts[TOP].colour.B) * invDeltaYTM;
-			bSlopeRight = (verts[BOTTOM].colour.B - verts[TOP].colour.B) * invDeltaYTB;
+			u1 = verts[TOP].u;
+			u2 = verts[TOP].u;
+			v1 = verts[TOP].v;
+			v2 = verts[TOP].v;
+
+			uSlopeLeft = (verts[MIDDLE].u - verts[TOP].u) * invDeltaYTM;
+			uSlopeRight = (verts[BOTTOM].u - verts[TOP].u) * invDeltaYTB;
+			vSlopeLeft = (verts[MIDDLE].v - verts[TOP].v) * invDeltaYTM;
+			vSlopeRight = (verts[BOTTOM].v - verts[TOP].v) * invDeltaYTB;
 		
 			// The incidental offset that may be generated by using the ceil function.
 			// We may get 'graphical artifacts' / visaul errors if we dont correct starting values
 			// by this.
 			sub = (float)yStart - verts[TOP].y;
-			x1 += xSlopeLeft * sub;
-			x2 += xSlopeRight * sub;
-			r1 += rSlopeLeft * sub;
-			r2 += rSlopeRight * sub;
-			g1 += gSlopeLeft * sub;
-			g2 += gSlopeRight * sub;
-			b1 += bSlopeLeft * sub;
-			b2 += bSlopeRight * sub;
-
 			// If our right slope is less than our left slope then we are going to get an incomplete triangle.
 			// Swap the values to fix this.
 			bool hasSwaped = false;
@@ -463,15 +994,12 @@ namespace SWR
 				Swap<float>(x2,x1);
 				Swap<float>(xSlopeLeft,xSlopeRight);
 
-				// Swap colour interpolation.
-				Swap<float>(r1, r2);
-				Swap<float>(rSlopeLeft, rSlopeRight);
-
-				Swap<float>(g1, g2);
-				Swap<float>(gSlopeLeft, gSlopeRight);
+				// Swap texel interpolation.
+				Swap<float>(u1, u2);
+				Swap<float>(uSlopeLeft, uSlopeRight);
 
-				Swap<float>(b1, b2);
-				Swap<float>(bSlopeLeft, bSlopeRight);
+				Swap<float>(v1, v2);
+				Swap<float>(vSlopeLeft, vSlopeRight);
 
 				hasSwaped = true;
 			}
@@ -481,32 +1009,31 @@ namespace SWR
 			if (invDeltaYTM > EPSILON)
 			{
 				// Run down from the top to the middle of the triangle.
-				for (int y = yStart; y <= yEnd; y++)
 				{
-					scanline.y = y;
-					scanline.xStart = x1;
-					scanline.xEnd = x2;
-
-					spanXInv = 1.0f /  fabs(x1 - x2);
-
-					scanline.rStart = r1;
-					scanline.rSlope = (r2 - r1) * spanXInv;
-					scanline.gStart = g1;
-					scanline.gSlope = (g2 - g1) * spanXInv;
-					scanline.bStart = b1;
-					scanline.bSlope = (b2 - b1) * spanXInv;
-
-					ScanLineCol(&scanline);
-
-					// Update the slopes.
-					x1 += xSlopeLeft;
-					x2 += xSlopeRight;
-					r1 += rSlopeLeft;
-					r2 += rSlopeRight;
-					g1 += gSlopeLeft;
-					g2 += gSlopeRight;
-					b1 += bSlopeLeft;
-					b2 += bSlopeRight;
+					SWR_PROFILE_SCOPE("SpanFill");
+					for (int y = yStart; y <= yEnd; y++)
+					{
+						scanline.y = y;
+						scanline.xStart = x1;
+						scanline.xEnd = x2;
+
+						spanXInv = 1.0f /  fabs(x1 - x2);
+					
+						scanline.uStart = u1;
+						scanline.uSlope = (u2 - u1) * spanXInv;
+						scanline.vStart = v1;
+						scanline.vSlope = (v2 - v1) * spanXInv;
+
+						ScanLineTexAffine(&scanline);
+
+						// Update the slopes.
+						x1 += xSlopeLeft;
+						x2 += xSlopeRight;
+						u1 += uSlopeLeft;
+						u2 += uSlopeRight;
+						v1 += vSlopeLeft;
+						v2 += vSlopeRight;
+					}
 				}
 			}
 			
@@ -515,16 +1042,13 @@ namespace SWR
 			{
 				Swap<float>(x2,x1);
 				Swap<float>(xSlopeLeft,xSlopeRight);
+				
+				// Swap texel interpolation.
+				Swap<float>(u1, u2);
+				Swap<float>(uSlopeLeft, uSlopeRight);
 
-				// Swap colour interpolation.
-				Swap<float>(r1, r2);
-				Swap<float>(rSlopeLeft, rSlopeRight);
-
-				Swap<float>(g1, g2);
-				Swap<float>(gSlopeLeft, gSlopeRight);
-
-				Swap<float>(b1, b2);
-				Swap<float>(bSlopeLeft, bSlopeRight);
+				Swap<float>(v1, v2);
+				Swap<float>(vSlopeLeft, vSlopeRight);
 			}
 
 			// Setup the new slope values for the lower left edge.
@@ -533,29 +1057,24 @@ namespace SWR
 			yStart = ceil(verts[MIDDLE].y);
 			yEnd = ceil(verts[BOTTOM].y) - 1;
 
-			r1 = verts[MIDDLE].colour.R;
-			g1 = verts[MIDDLE].colour.G;
-			b1 = verts[MIDDLE].colour.B;
+			u1 = verts[MIDDLE].u;
+			v1 = verts[MIDDLE].v;
 
 			// Calculate the new colour interpolations.
-			rSlopeLeft = (verts[BOTTOM].colour.R - verts[MIDDLE].colour.R) * invDeltaYMB;
-			gSlopeLeft = (verts[BOTTOM].colour.G - verts[MIDDLE].colour.G) * invDeltaYMB;
-			bSlopeLeft = (verts[BOTTOM].colour.B - verts[MIDDLE].colour.B) * invDeltaYMB;
+			uSlopeLeft = (verts[BOTTOM].u - verts[MIDDLE].u) * invDeltaYMB;
+			vSlopeLeft = (verts[BOTTOM].v - verts[MIDDLE].v) * invDeltaYMB;
 		
 			if (x2 < x1)
 			{
 				Swap<float>(x2, x1);
 				Swap<float>(xSlopeLeft, xSlopeRight);
+				
+				// Swap texel interpolation.
+				Swap<float>(u1, u2);
+				Swap<float>(uSlopeLeft, uSlopeRight);
 
-				// Swap colour interpolation.
-				Swap<float>(r1, r2);
-				Swap<float>(rSlopeLeft, rSlopeRight);
-
-				Swap<float>(g1, g2);
-				Swap<float>(gSlopeLeft, gSlopeRight);
-
-				Swap<float>(b1, b2);
-				Swap<float>(bSlopeLeft, bSlopeRight);
+				Swap<float>(v1, v2);
+				Swap<float>(vSlopeLeft, vSlopeRight);
 			}
 
 			// The incidental offset that may be generated by using the ceil function.
@@ -567,34 +1086,32 @@ namespace SWR
 			if (invDeltaYMB > EPSILON)
 			{				
 				// Run down from the middle to the bottom of the triangle.
-				for (int y = yStart; y <= yEnd; y++)
 				{
-					scanline.y = y;
-					scanline.xStart = x1;
-					scanline.xEnd = x2;
-
-					// Calculate the inverse of the X delta.
-					spanXInv = 1.0f /  fabs(x1 - x2);
-
-					// Calculate the new colour values for the scan line.
-					scanline.rStart = r1;
-					scanline.rSlope = (r2 - r1) * spanXInv;
-					scanline.gStart = g1;
-					scanline.gSlope = (g2 - g1) * spanXInv;
-					scanline.bStart = b1;
-					scanline.bSlope = (b2 - b1) * spanXInv;
-
-					ScanLineCol(&scanline);
-
-					// Update the slopes.
-					x1 += xSlopeLeft;
-					x2 += xSlopeRight;
-					r1 += rSlopeLeft;
-					r2 += rSlopeRight;
-					g1 += gSlopeLeft;
-					g2 += gSlopeRight;
-					b1 += bSlopeLeft;
-					b2 += bSlopeRight;
+					SWR_PROFILE_SCOPE("SpanFill");
+					for (int y = yStart; y <= yEnd; y++)
+					{
+						scanline.y = y;
+						scanline.xStart = x1;
+						scanline.xEnd = x2;
+
+						spanXInv = 1.0f /  fabs(x1 - x2);
+					
+						scanline.uStart = u1;
+						scanline.uSlope = (u2 - u1) * spanXInv;
+						scanline.vStart = v1;
+						scanline.vSlope = (v2 - v1) * spanXInv;
+
+						ScanLineTexAffine(&scanline);
+
+						// Update the slopes.
+						x1 += xSlopeLeft;
+						x2 += xSlopeRight;
+						u1 += uSlopeLeft;
+						u2 += uSlopeRight;
+						v1 += vSlopeLeft;
+						v2 += vSlopeRight;
+
+					}
 				}
 			}
 		}
@@ -608,35 +1125,28 @@ namespace SWR
 			yStart = ceil(verts[TOP].y);
 			yEnd = ceil(verts[MIDDLE].y) - 1;
 
-			r1 = verts[TOP].colour.R;
-			r2 = verts[TOP].colour.R;
-			g1 = verts[TOP].colour.G;
-			g2 = verts[TOP].colour.G;
-			b1 = verts[TOP].colour.B;
-			b2 = verts[TOP].colour.B;
+			u1 = verts[TOP].u;
+			u2 = verts[TOP].u;
+			v1 = verts[TOP].v;
+			v2 = verts[TOP].v;
 
-			rSlopeLeft = (verts[BOTTOM].colour.R - verts[TOP].colour.R) * invDeltaYTB;
-			rSlopeRight = (verts[MIDDLE].colour.R - verts[TOP].colour.R) * invDeltaYTM;
-			gSlopeLeft = (verts[BOTTOM].colour.G - verts[TOP].colour.G) * invDeltaYTB;
-			gSlopeRight = (verts[MIDDLE].colour.G - verts[TOP].colour.G) * invDeltaYTM;
-			bSlopeLeft = (verts[BOTTOM].colour.B - verts[TOP].colour.B) * invDeltaYTB;
-			bSlopeRight = (verts[MIDDLE].colour.B - verts[TOP].colour.B) * invDeltaYTM;
+			uSlopeLeft = (verts[BOTTOM].u- verts[TOP].u) * invDeltaYTB;
+			uSlopeRight = (verts[MIDDLE].u - verts[TOP].u) * invDeltaYTM;
+			vSlopeLeft = (verts[BOTTOM].v - verts[TOP].v) * invDeltaYTB;
+			vSlopeRight = (verts[MIDDLE].v - verts[TOP].v) * invDeltaYTM;
 
 			bool hasSwaped = false;
 			if (xSlopeRight < xSlopeLeft)
 			{
 				Swap<float>(x2,x1);
 				Swap<float>(xSlopeLeft,xSlopeRight);
+				
+				// Swap texel interpolation.
+				Swap<float>(u1, u2);
+				Swap<float>(uSlopeLeft, uSlopeRight);
 
-				// Swap colour interpolation.
-				Swap<float>(r1, r2);
-				Swap<float>(rSlopeLeft, rSlopeRight);
-
-				Swap<float>(g1, g2);
-				Swap<float>(gSlopeLeft, gSlopeRight);
-
-				Swap<float>(b1, b2);
-				Swap<float>(bSlopeLeft, bSlopeRight);
+				Swap<float>(v1, v2);
+				Swap<float>(vSlopeLeft, vSlopeRight);
 
 				hasSwaped = true;
 			}
@@ -645,36 +1155,35 @@ namespace SWR
 			// We may get 'graphical artifacts' / visaul errors if we dont correct starting values
 			// by this.
 			sub = (float)yStart - verts[TOP].y;
-			
+
 			// Draw the upper triangle section.
 			if (invDeltaYTM > EPSILON)
 			{
-				for (int y = yStart; y <= yEnd; y++)
 				{
-					scanline.y = y;
-					scanline.xStart = x1;
-					scanline.xEnd = x2;
-
-					spanXInv = 1.0f /  fabs(x1 - x2);
-
-					scanline.rStart = r1;
-					scanline.rSlope = (r2 - r1) * spanXInv;
-					scanline.gStart = g1;
-					scanline.gSlope = (g2 - g1) * spanXInv;
-					scanline.bStart = b1;
-					scanline.bSlope = (b2 - b1) * spanXInv;
-
-					ScanLineCol(&scanline);
-
-					// Update the slopes.
-					x1 += xSlopeLeft;
-					x2 += xSlopeRight;
-					r1 += rSlopeLeft;
-					r2 += rSlopeRight;
-					g1 += gSlopeLeft;
-					g2 += gSlopeRight;
-					b1 += bSlopeLeft;
-					b2 += bSlopeRight;
+					SWR_PROFILE_SCOPE("SpanFill");
+					for (int y = yStart; y <= yEnd; y++)
+					{
+						scanline.y = y;
+						scanline.xStart = x1;
+						scanline.xEnd = x2;
+
+						spanXInv = 1.0f /  fabs(x1 - x2);
+					
+						scanline.uStart = u1;
+						scanline.uSlope = (u2 - u1) * spanXInv;
+						scanline.vStart = v1;
+						scanline.vSlope = (v2 - v1) * spanXInv;
+
+						ScanLineTexAffine(&scanline);
+
+						// Update the slopes.
+						x1 += xSlopeLeft;
+						x2 += xSlopeRight;
+						u1 += uSlopeLeft;
+						u2 += uSlopeRight;
+						v1 += vSlopeLeft;
+						v2 += vSlopeRight;
+					}
 				}
 			}
 
@@ -683,16 +1192,13 @@ namespace SWR
 			{
 				Swap<float>(x2,x1);
 				Swap<float>(xSlopeLeft,xSlopeRight);
+				
+				// Swap texel interpolation.
+				Swap<float>(u1, u2);
+				Swap<float>(uSlopeLeft, uSlopeRight);
 
-				// Swap colour interpolation.
-				Swap<float>(r1, r2);
-				Swap<float>(rSlopeLeft, rSlopeRight);
-
-				Swap<float>(g1, g2);
-				Swap<float>(gSlopeLeft, gSlopeRight);
-
-				Swap<float>(b1, b2);
-				Swap<float>(bSlopeLeft, bSlopeRight);
+				Swap<float>(v1, v2);
+				Swap<float>(vSlopeLeft, vSlopeRight);
 			}
 
 			// Setup the new slope values for the lower left edge.
@@ -701,30 +1207,25 @@ namespace SWR
 			yStart = ceil(verts[MIDDLE].y);
 			yEnd = ceil(verts[BOTTOM].y) - 1;
 			
-			r2 = verts[MIDDLE].colour.R;
-			g2 = verts[MIDDLE].colour.G;
-			b2 = verts[MIDDLE].colour.B;
+			u2 = verts[MIDDLE].u;
+			v2 = verts[MIDDLE].v;
 
 			// Calculate the new colour interpolations.
-			rSlopeRight = (verts[BOTTOM].colour.R - verts[MIDDLE].colour.R) * invDeltaYMB;
-			gSlopeRight = (verts[BOTTOM].colour.G - verts[MIDDLE].colour.G) * invDeltaYMB;
-			bSlopeRight = (verts[BOTTOM].colour.B - verts[MIDDLE].colour.B) * invDeltaYMB;
+			uSlopeRight = (verts[BOTTOM].u - verts[MIDDLE].u) * invDeltaYMB;
+			vSlopeRight = (verts[BOTTOM].v - verts[MIDDLE].v) * invDeltaYMB;
 
 			
 			if (x2 < x1)
 			{
 				Swap<float>(x2, x1);
 				Swap<float>(xSlopeLeft, xSlopeRight);
+				
+				// Swap texel interpolation.
+				Swap<float>(u1, u2);
+				Swap<float>(uSlopeLeft, uSlopeRight);
 
-				// Swap colour interpolation.
-				Swap<float>(r1, r2);
-				Swap<float>(rSlopeLeft, rSlopeRight);
-
-				Swap<float>(g1, g2);
-				Swap<float>(gSlopeLeft, gSlopeRight);
-
-				Swap<float>(b1, b2);
-				Swap<float>(bSlopeLeft, bSlopeRight);
+				Swap<float>(v1, v2);
+				Swap<float>(vSlopeLeft, vSlopeRight);
 			}
 			
 			// The incidental offset that may be generated by using the ceil function.
@@ -735,32 +1236,31 @@ namespace SWR
 			if (invDeltaYMB > EPSILON)
 			{				
 				// Run down from the middle to the bottom of the triangle.
-				for (int y = yStart; y <= yEnd; y++)
 				{
-					scanline.y = y;
-					scanline.xStart = x1;
-					scanline.xEnd = x2;
-
-					spanXInv = 1.0f /  fabs(x1 - x2);
-
-					scanline.rStart = r1;
-					scanline.rSlope = (r2 - r1) * spanXInv;
-					scanline.gStart = g1;
-					scanline.gSlope = (g2 - g1) * spanXInv;
-					scanline.bStart = b1;
-					scanline.bSlope = (b2 - b1) * spanXInv;
-
-					ScanLineCol(&scanline);
-
-					// Update the slopes.
-					x1 += xSlopeLeft;
-					x2 += xSlopeRight;
-					r1 += rSlopeLeft;
-					r2 += rSlopeRight;
-					g1 += gSlopeLeft;
-					g2 += gSlopeRight;
-					b1 += bSlopeLeft;
-					b2 += bSlopeRight;
+					SWR_PROFILE_SCOPE("SpanFill");
+					for (int y = yStart; y <= yEnd; y++)
+					{
+						scanline.y = y;
+						scanline.xStart = x1;
+						scanline.xEnd = x2;
+
+						spanXInv = 1.0f /  fabs(x1 - x2);
+					
+						scanline.uStart = u1;
+						scanline.uSlope = (u2 - u1) * spanXInv;
+						scanline.vStart = v1;
+						scanline.vSlope = (v2 - v1) * spanXInv;
+
+						ScanLineTexAffine(&scanline);
+
+						// Update the slopes.
+						x1 += xSlopeLeft;
+						x2 += xSlopeRight;
+						u1 += uSlopeLeft;
+						u2 += uSlopeRight;
+						v1 += vSlopeLeft;
+						v2 += vSlopeRight;
+					}
 				}
 			}
 		}
@@ -770,19 +1270,15 @@ namespace SWR
 			assert(false);
 		}
 	}
-
+	
 	// The texture based triangle rasterization is the same as the Gourad shaded filled triangle procedure.
 	// We use the same steps and procedures of deducing the type of triangle (Major or minor) however here
 	// we are interpolating UV co-ordinates based on the slopes between each vertex.
 	// Each UV co-ordinate is also scaled up by the source texture width and height to avoid getting visaul artifacts.
-	void Rasterizer::RasterizeTriTex(Vertex* tri)
+	void Rasterizer::RasterizeTriTex_EdgeList(Vertex* tri)
 	{
-		enum VertexLocation
-		{
-			TOP,
-			MIDDLE,
-			BOTTOM,
-		};
+		SWR_PROFILE_SCOPE("TriangleSetup");
+
 		// The type of triangle that is being drawn.
 		// Major means that edge with greatest Y delta is on left, minor means it is on right.
 		TriangleEdgeType triType;
@@ -794,438 +1290,1096 @@ namespace SWR
 
 		// Determine if the triangle is major/minor.
 		if (verts[BOTTOM].x > verts[MIDDLE].x)
-		{
 			triType = TRIANGLE_Minor;
-		}
 		else
-		{
 			triType = TRIANGLE_Major;
-		}
 
 		// Set up Y deltas and inverse multipliers for edge traversal.
 		float invDeltaYTB = 1.0f / (verts[BOTTOM].y - verts[TOP].y);
 		float invDeltaYTM = 1.0f / (verts[MIDDLE].y - verts[TOP].y);
 		float invDeltaYMB = 1.0f / (verts[BOTTOM].y - verts[MIDDLE].y);
 
-		// Scale out the vertices UV's based on the current texture.
+		// Scale out the vertices UV's based on the level of the current texture it samples.
+		SelectTextureLevel(verts);
 		for (int i = 0; i < 3; i++)
 		{
-			verts[i].u *= m_targetTexture->GetWidth();
-			verts[i].v *= m_targetTexture->GetHeight();
+			verts[i].u *= m_texLevel.width;
+			verts[i].v *= m_texLevel.height;
 		}
-	
-		// Slope values for screen pixels
-		float x1, x2;
-		float z1, z2;
-		int yStart;
-		int yEnd;
-		float xSlopeLeft, xSlopeRight;
-		float zSlopeLeft, zSlopeRight;
-		float spanXInv = 0.0f;
-
-		// Slope values for texel values.
-		float u1, u2;
-		float v1, v2;
-		float uSlopeLeft, vSlopeLeft;
-		float uSlopeRight, vSlopeRight;
 
-		// To update the interpolants.
-		float sub = 0.0f;
+		// Cast the scanline list pointer.
+		this->m_scanLineTexBuffer = (SWR::ScanlineDataTex*)GetEdgeListTarget(SPANBATCH_Tex);
 
-		static ScanlineDataTex scanline;
-		memset(&scanline, 0, sizeof(ScanlineDataTex));
-		
-		// Decide on how to setup the scanline rendering.
+		// Build the edge list, and render the scan-lines it wrote.
+		int totalScanlines;
 		if (triType == TRIANGLE_Minor)
-		{
-			// The two smaller triangle edges are to the left so we are basing our scan-line
-			// rendering from this.
+			totalScanlines = this->GenerateMinorEdgeListTex(verts, invDeltaYTB, invDeltaYTM, invDeltaYMB);
+		else
+			totalScanlines = this->GenerateMajorEdgeListTex(verts, invDeltaYTB, invDeltaYTM, invDeltaYMB);
 
-			// Calculate our values for the scan line interpolation.
-			xSlopeLeft = (verts[MIDDLE].x - verts[TOP].x) * invDeltaYTM;
-			xSlopeRight = (verts[BOTTOM].x - verts[TOP].x) * invDeltaYTB;
-			x1 = verts[TOP].x;
-			x2 = verts[TOP].x;
-			yStart = ceil(verts[TOP].y);
-			yEnd = ceil(verts[MIDDLE].y) - 1;
+		this->BatchRasterizeEdgeListTex(totalScanlines);
+	}
 
-			// Set up the colour interpolation values.
-			u1 = verts[TOP].u;
-			u2 = verts[TOP].u;
-			v1 = verts[TOP].v;
-			v2 = verts[TOP].v;
+	// The gourad shaded triangle built as an edge list, the same way as the textured one.
+	void Rasterizer::RasterizeTriSolid_EdgeList(Vertex* tri)
+	{
+		this->BatchRasterizeEdgeListCol(GenerateEdgeListCol(tri));
+	}
 
-			uSlopeLeft = (verts[MIDDLE].u - verts[TOP].u) * invDeltaYTM;
-			uSlopeRight = (verts[BOTTOM].u - verts[TOP].u) * invDeltaYTB;
-			vSlopeLeft = (verts[MIDDLE].v - verts[TOP].v) * invDeltaYTM;
-			vSlopeRight = (verts[BOTTOM].v - verts[TOP].v) * invDeltaYTB;
-		
-			// The incidental offset that may be generated by using the ceil function.
-			// We may get 'graphical artifacts' / visaul errors if we dont correct starting values
-			// by this.
-			sub = (float)yStart - verts[TOP].y;
-			// If our right slope is less than our left slope then we are going to get an incomplete triangle.
-			// Swap the values to fix this.
-			bool hasSwaped = false;
-			if (xSlopeRight < xSlopeLeft)
-			{
-				// Swap x axis interpolation.
-				Swap<float>(x2,x1);
-				Swap<float>(xSlopeLeft,xSlopeRight);
+	int Rasterizer::GenerateEdgeListCol(Vertex* tri)
+	{
+		SWR_PROFILE_SCOPE("TriangleSetup");
 
-				// Swap texel interpolation.
-				Swap<float>(u1, u2);
-				Swap<float>(uSlopeLeft, uSlopeRight);
+		// The type of triangle that is being drawn.
+		// Major means that edge with greatest Y delta is on left, minor means it is on right.
+		TriangleEdgeType triType;
 
-				Swap<float>(v1, v2);
-				Swap<float>(vSlopeLeft, vSlopeRight);
+		// Sort vertices up to down.
+		Vertex verts[3];
+		
+		SortByY(verts, tri);
 
-				hasSwaped = true;
-			}
+		// Determine if the triangle is major/minor.
+		if (verts[BOTTOM].x > verts[MIDDLE].x)
+			triType = TRIANGLE_Minor;
+		else
+			triType = TRIANGLE_Major;
 
+		// Set up Y deltas and inverse multipliers for edge traversal.
+		float invDeltaYTB = 1.0f / (verts[BOTTOM].y - verts[TOP].y);
+		float invDeltaYTM = 1.0f / (verts[MIDDLE].y - verts[TOP].y);
+		float invDeltaYMB = 1.0f / (verts[BOTTOM].y - verts[MIDDLE].y);
 
-			// Draw the upper triangle section.
-			if (invDeltaYTM > EPSILON)
-			{
-				// Run down from the top to the middle of the triangle.
-				for (int y = yStart; y <= yEnd; y++)
-				{
-					// Clamp the UVs
-					u1 = Clamp<double>(0.0, (double)m_targetTexture->GetWidth(), u1);
-					u2 = Clamp<double>(0.0, (double)m_targetTexture->GetWidth(), u2);
-					v1 = Clamp<double>(0.0, (double)m_targetTexture->GetHeight(), v1);
-					v2 = Clamp<double>(0.0, (double)m_targetTexture->GetHeight(), v2);
+		// Cast the scanline list pointer.
+		this->m_scanLineColBuffer = (SWR::ScanlineDataCol*)GetEdgeListTarget(SPANBATCH_Col);
 
-					scanline.y = y;
-					scanline.xStart = x1;
-					scanline.xEnd = x2;
+		// Build the edge list.
+		if (triType == TRIANGLE_Minor)
+			return this->GenerateMinorEdgeListCol(verts, invDeltaYTB, invDeltaYTM, invDeltaYMB);
 
-					spanXInv = 1.0f /  fabs(x1 - x2);
-					
-					scanline.uStart = u1;
-					scanline.uSlope = (u2 - u1) * spanXInv;
-					scanline.vStart = v1;
-					scanline.vSlope = (v2 - v1) * spanXInv;
-
-					ScanLineTexAffine(&scanline);
-
-					// Update the slopes.
-					x1 += xSlopeLeft;
-					x2 += xSlopeRight;
-					u1 += uSlopeLeft;
-					u2 += uSlopeRight;
-					v1 += vSlopeLeft;
-					v2 += vSlopeRight;
-				}
-			}
-			
-			// Swap back if we swapped.
-			if (hasSwaped)
-			{
-				Swap<float>(x2,x1);
-				Swap<float>(xSlopeLeft,xSlopeRight);
-				
-				// Swap texel interpolation.
-				Swap<float>(u1, u2);
-				Swap<float>(uSlopeLeft, uSlopeRight);
+		return this->GenerateMajorEdgeListCol(verts, invDeltaYTB, invDeltaYTM, invDeltaYMB);
+	}
 
-				Swap<float>(v1, v2);
-				Swap<float>(vSlopeLeft, vSlopeRight);
-			}
+	void Rasterizer::BeginSpanBatch()
+	{
+		// Anything left from a batch that wasn't ended is filled first.
+		FlushSpanBatch();
+		m_batchingSpans = true;
+	}
 
-			// Setup the new slope values for the lower left edge.
-			xSlopeLeft = (verts[BOTTOM].x - verts[MIDDLE].x) * invDeltaYMB;
-			x1 = verts[MIDDLE].x;
-			yStart = ceil(verts[MIDDLE].y);
-			yEnd = ceil(verts[BOTTOM].y) - 1;
+	void Rasterizer::EndSpanBatch()
+	{
+		FlushSpanBatch();
+		m_batchingSpans = false;
+	}
 
-			u1 = verts[MIDDLE].u;
-			v1 = verts[MIDDLE].v;
+	// The lit textured triangle is stepped with constant gradients like the per-pixel lit one, as it
+	// carries the UVs and the colour, and 1/w for perspective correction.
+	void Rasterizer::RasterizeTriTexLight(Vertex* vertices)
+	{
+		SelectTextureLevel(vertices);
 
-			// Calculate the new colour interpolations.
-			uSlopeLeft = (verts[BOTTOM].u - verts[MIDDLE].u) * invDeltaYMB;
-			vSlopeLeft = (verts[BOTTOM].v - verts[MIDDLE].v) * invDeltaYMB;
-		
-			if (x2 < x1)
-			{
-				Swap<float>(x2, x1);
-				Swap<float>(xSlopeLeft, xSlopeRight);
-				
-				// Swap texel interpolation.
-				Swap<float>(u1, u2);
-				Swap<float>(uSlopeLeft, uSlopeRight);
+		TexLightVertex verts[3];
+		SetupTexLightVertices(vertices, verts);
+		RasterizeTriGradient(verts, &Rasterizer::ScanLineTexRuns<true>);
+	}
 
-				Swap<float>(v1, v2);
-				Swap<float>(vSlopeLeft, vSlopeRight);
-			}
+	void Rasterizer::RasterizeTriTexPerspective(Vertex* vertices)
+	{
+		SelectTextureLevel(vertices);
 
-			// The incidental offset that may be generated by using the ceil function.
-			// We may get 'graphical artifacts' / visual errors if we dont correct starting values
-			// by this.
-			sub = (float)yStart - verts[MIDDLE].y;
-			
+		TexLightVertex verts[3];
+		SetupTexLightVertices(vertices, verts);
+		RasterizeTriGradient(verts, &Rasterizer::ScanLineTexRuns<false>);
+	}
 
-			if (invDeltaYMB > EPSILON)
-			{				
-				// Run down from the middle to the bottom of the triangle.
-				for (int y = yStart; y <= yEnd; y++)
-				{
-					// Clamp the UVs
-					u1 = Clamp<double>(0.0, (double)m_targetTexture->GetWidth(), u1);
-					u2 = Clamp<double>(0.0, (double)m_targetTexture->GetWidth(), u2);
-					v1 = Clamp<double>(0.0, (double)m_targetTexture->GetHeight(), v1);
-					v2 = Clamp<double>(0.0, (double)m_targetTexture->GetHeight(), v2);
+	void Rasterizer::SetupTexLightVertices(const Vertex* vertices, TexLightVertex* verts)
+	{
+		// The projected depth is q - q * near / z, so 1 / z can be found from it. It is linear
+		// in screen space, as are the UVs multiplied by it.
+		float q = m_far / (m_far - m_near);
+		float invQNear = 1.0f / (q * m_near);
 
-					scanline.y = y;
-					scanline.xStart = x1;
-					scanline.xEnd = x2;
+		for (int i = 0; i < 3; i++)
+		{
+			const Vertex &vert = vertices[i];
+			float invW = m_perspectiveTextures ? (q - vert.z) * invQNear : 1.0f;
+
+			verts[i].x = vert.x;
+			verts[i].y = vert.y;
+			verts[i].attr[TEXLIGHT_InvW] = invW;
+			verts[i].attr[TEXLIGHT_U] = vert.u * m_texLevel.width * invW;
+			verts[i].attr[TEXLIGHT_V] = vert.v * m_texLevel.height * invW;
+			verts[i].attr[TEXLIGHT_Red] = vert.colour.R;
+			verts[i].attr[TEXLIGHT_Green] = vert.colour.G;
+			verts[i].attr[TEXLIGHT_Blue] = vert.colour.B;
+		}
+	}
 
-					spanXInv = 1.0f /  fabs(x1 - x2);
-					
-					scanline.uStart = u1;
-					scanline.uSlope = (u2 - u1) * spanXInv;
-					scanline.vStart = v1;
-					scanline.vSlope = (v2 - v1) * spanXInv;
 
-					ScanLineTexAffine(&scanline);
+	// Finds which of 4 world positions are visible to the shadow map's light; 1 where lit, 0 where 
+	// shadowed. Positions outside of the map or behind its near plane are treated as lit. 
+	static inline Float4 ShadowTest4(const ShadowMapView* shadow, Float4 px, Float4 py, Float4 pz)
+	{
+		const Matrix4 &m = shadow->worldToLight;
+		const Float4 zero = Float4Zero();
+		const Float4 nearPlane = Float4Set1(shadow->nearPlane);
+		const Float4 width = Float4Set1((float)shadow->width);
+		const Float4 height = Float4Set1((float)shadow->height);
+
+		// Into the light's view.
+		Float4 lx = Float4MulAdd(px, Float4Set1(m.xX), Float4MulAdd(py, Float4Set1(m.yX), Float4MulAdd(pz, Float4Set1(m.zX), Float4Set1(m.wX))));
+		Float4 ly = Float4MulAdd(px, Float4Set1(m.xY), Float4MulAdd(py, Float4Set1(m.yY), Float4MulAdd(pz, Float4Set1(m.zY), Float4Set1(m.wY))));
+		Float4 lz = Float4MulAdd(px, Float4Set1(m.xZ), Float4MulAdd(py, Float4Set1(m.yZ), Float4MulAdd(pz, Float4Set1(m.zZ), Float4Set1(m.wZ))));
+		Float4 tested = Float4LessEqual(nearPlane, lz);
+
+		// Onto the map. Lanes behind the near plane are kept finite; they're masked out below.
+		Float4 invZ = Float4Rcp(Float4Max(lz, nearPlane));
+		Float4 sx = Float4MulAdd(Float4Mul(Float4Set1(shadow->focalX), lx), invZ, Float4Set1(shadow->halfWidth));
+		Float4 sy = Float4MulAdd(Float4Mul(Float4Set1(-shadow->focalY), ly), invZ, Float4Set1(shadow->halfHeight));
+		tested = Float4And(tested, Float4And(Float4LessEqual(zero, sx), Float4Greater(width, sx)));
+		tested = Float4And(tested, Float4And(Float4LessEqual(zero, sy), Float4Greater(height, sy)));
+
+		int mask = Float4MoveMask(tested);
+		if (mask == 0)
+			return Float4Set1(1.0f);
+
+		// Fetch the texels of the tested lanes; the others compare against the far plane.
+		S32 texelX[4], texelY[4];
+		Float4FloorToInt(Float4Clamp(sx, zero, width), texelX);
+		Float4FloorToInt(Float4Clamp(sy, zero, height), texelY);
+
+		float stored[4];
+		for (int i = 0; i < 4; i++)
+		{
+			stored[i] = (mask & (1 << i)) ? (float)shadow->depth[texelX[i] + texelY[i] * shadow->pitch] : 3.4e38f;
+		}
 
-					// Update the slopes.
-					x1 += xSlopeLeft;
-					x2 += xSlopeRight;
-					u1 += uSlopeLeft;
-					u2 += uSlopeRight;
-					v1 += vSlopeLeft;
-					v2 += vSlopeRight;
+		const Float4 q = Float4Set1(shadow->q * 32767.0f);
+		Float4 depth = Float4Sub(Float4Sub(q, Float4Mul(Float4Mul(q, nearPlane), invZ)), Float4Set1(shadow->bias));
+		return Float4And(Float4LessEqual(depth, Float4Load(stored)), Float4Set1(1.0f));
+	}
 
-				}
-			}
-		}
-		else if (triType == TRIANGLE_Major)
+	// Lights 4 pixels from their interpolated attributes. The lighting mirrors the LightingManager's 
+	// vertex lighting so the gourad and per-pixel paths match on finely tesselated meshes; each light
+	// that reaches a pixel contributes base * colour * max(dot, 0) [* attenuation], and the 
+	// contributions are averaged. Lights are taken from the index list if there is one. The light
+	// the shadow map belongs to only contributes to the pixels its map can see.
+	static inline void ShadePhong4(const Float4* attr, const PixelLight* lights, const U16* lightIndices, int totalLights, 
+								   const ShadowMapView* shadow, Float4 &outR, Float4 &outG, Float4 &outB)
+	{
+		const Float4 zero = Float4Zero();
+		const Float4 one = Float4Set1(1.0f);
+		const Float4 tiny = Float4Set1(1e-12f);
+		const Float4 maxChannel = Float4Set1(255.0f);
+
+		// Divide out the perspective to get the world position, normal and base colour.
+		Float4 w = Float4Rcp(attr[PHONG_InvW]);
+		Float4 px = Float4Mul(attr[PHONG_PosX], w);
+		Float4 py = Float4Mul(attr[PHONG_PosY], w);
+		Float4 pz = Float4Mul(attr[PHONG_PosZ], w);
+		Float4 nx = Float4Mul(attr[PHONG_NormalX], w);
+		Float4 ny = Float4Mul(attr[PHONG_NormalY], w);
+		Float4 nz = Float4Mul(attr[PHONG_NormalZ], w);
+		Float4 baseR = Float4Mul(attr[PHONG_Red], w);
+		Float4 baseG = Float4Mul(attr[PHONG_Green], w);
+		Float4 baseB = Float4Mul(attr[PHONG_Blue], w);
+
+		// Re-normalise the interpolated normal.
+		Float4 nInv = Float4RSqrt(Float4Max(Float4Dot3(nx, ny, nz, nx, ny, nz), tiny));
+		nx = Float4Mul(nx, nInv);
+		ny = Float4Mul(ny, nInv);
+		nz = Float4Mul(nz, nInv);
+
+		Float4 sumR = zero, sumG = zero, sumB = zero;
+		Float4 lightsApplied = zero;
+
+		for (int l = 0; l < totalLights; l++)
 		{
-			// Calculate our values for the scan line interpolation.
-			xSlopeLeft = (verts[BOTTOM].x - verts[TOP].x) * invDeltaYTB;
-			xSlopeRight = (verts[MIDDLE].x - verts[TOP].x) * invDeltaYTM;
-			x1 = verts[TOP].x;
-			x2 = verts[TOP].x;
-			yStart = ceil(verts[TOP].y);
-			yEnd = ceil(verts[MIDDLE].y) - 1;
+			const PixelLight &light = lights[lightIndices != NULL ? lightIndices[l] : l];
 
-			u1 = verts[TOP].u;
-			u2 = verts[TOP].u;
-			v1 = verts[TOP].v;
-			v2 = verts[TOP].v;
+			// Vector from the light to the pixel.
+			Float4 lx = Float4Sub(px, Float4Set1(light.x));
+			Float4 ly = Float4Sub(py, Float4Set1(light.y));
+			Float4 lz = Float4Sub(pz, Float4Set1(light.z));
+			Float4 distSq = Float4Max(Float4Dot3(lx, ly, lz, lx, ly, lz), tiny);
+			Float4 distInv = Float4RSqrt(distSq);
 
-			uSlopeLeft = (verts[BOTTOM].u- verts[TOP].u) * invDeltaYTB;
-			uSlopeRight = (verts[MIDDLE].u - verts[TOP].u) * invDeltaYTM;
-			vSlopeLeft = (verts[BOTTOM].v - verts[TOP].v) * invDeltaYTB;
-			vSlopeRight = (verts[MIDDLE].v - verts[TOP].v) * invDeltaYTM;
+			Float4 dot = Float4Max(Float4Mul(Float4Dot3(lx, ly, lz, nx, ny, nz), distInv), zero);
 
-			bool hasSwaped = false;
-			if (xSlopeRight < xSlopeLeft)
+			if (light.type == LIGHT_Point)
 			{
-				Swap<float>(x2,x1);
-				Swap<float>(xSlopeLeft,xSlopeRight);
-				
-				// Swap texel interpolation.
-				Swap<float>(u1, u2);
-				Swap<float>(uSlopeLeft, uSlopeRight);
-
-				Swap<float>(v1, v2);
-				Swap<float>(vSlopeLeft, vSlopeRight);
+				Float4 dist = Float4Mul(distSq, distInv);
+				Float4 inRange = Float4LessEqual(dist, Float4Set1(light.falloff));
+				Float4 attenDenom = Float4MulAdd(Float4MulAdd(dist, Float4Set1(light.atten[2]), Float4Set1(light.atten[1])), dist, Float4Set1(light.atten[0]));
+				dot = Float4And(inRange, Float4Mul(dot, Float4Rcp(attenDenom)));
+				lightsApplied = Float4Add(lightsApplied, Float4And(inRange, one));
+			}
+			else
+			{
+				lightsApplied = Float4Add(lightsApplied, one);
+			}
 
-				hasSwaped = true;
+			if (shadow != NULL && light.sourceID == shadow->lightID)
+			{
+				dot = Float4Mul(dot, ShadowTest4(shadow, px, py, pz));
 			}
-			
-			// The incidental offset that may be generated by using the ceil function.
-			// We may get 'graphical artifacts' / visaul errors if we dont correct starting values
-			// by this.
-			sub = (float)yStart - verts[TOP].y;
 
-			// Draw the upper triangle section.
-			if (invDeltaYTM > EPSILON)
+			sumR = Float4MulAdd(dot, Float4Set1(light.r), sumR);
+			sumG = Float4MulAdd(dot, Float4Set1(light.g), sumG);
+			sumB = Float4MulAdd(dot, Float4Set1(light.b), sumB);
+		}
+
+		// Average over the lights applied; pixels no light reached keep their base colour.
+		Float4 lit = Float4Greater(lightsApplied, zero);
+		Float4 avg = Float4Rcp(Float4Max(lightsApplied, one));
+		outR = Float4Select(lit, Float4Mul(Float4Mul(sumR, avg), baseR), baseR);
+		outG = Float4Select(lit, Float4Mul(Float4Mul(sumG, avg), baseG), baseG);
+		outB = Float4Select(lit, Float4Mul(Float4Mul(sumB, avg), baseB), baseB);
+
+		outR = Float4Clamp(outR, zero, maxChannel);
+		outG = Float4Clamp(outG, zero, maxChannel);
+		outB = Float4Clamp(outB, zero, maxChannel);
+	}
+
+	// Lights a span 4 pixels at a time. With light tiles set the span is split at the tile 
+	// boundaries, and each part only evaluates the lights listed for its tile.
+	void Rasterizer::ScanLinePhong(ScanlineDataPhong* scanline)
+	{
+		// Scanline end will be < 0 and cause a wrap-around.
+		if (scanline->xEnd <= 1.0f - EPSILON)
+			return;
+
+		// Apply top-left fill convention.
+		int xStart = (int)ceil(scanline->xStart);
+		int xEnd = (int)ceil(scanline->xEnd);
+		if (xStart < 0)
+			xStart = 0;
+		if (xEnd > (int)m_bufferWidth)
+			xEnd = (int)m_bufferWidth;
+		if (xStart >= xEnd)
+			return;
+
+		m_stats->pixelsShaded += xEnd - xStart;
+		m_stats->bytesWritten += (xEnd - xStart) * 4;
+
+		U64 spanStart = m_tileCosts != NULL ? DebugClock() : 0;
+
+		U32* buffer = (U32*)(m_targetBackBuffer + ((xStart + (scanline->y * m_bufferPitch)) << 2));
+
+		const Float4 laneOffsets = Float4Set(0.0f, 1.0f, 2.0f, 3.0f);
+		Float4 slope[PHONG_Total];
+		Float4 step[PHONG_Total];
+		for (int i = 0; i < PHONG_Total; i++)
+		{
+			slope[i] = Float4Set1(scanline->slope[i]);
+			step[i] = Float4Mul(slope[i], Float4Set1(4.0f));
+		}
+
+		U32 tileY = scanline->y / m_tileGrid.tileSize;
+
+		Float4 attr[PHONG_Total];
+		Float4 r, g, b;
+		U32 pixels[4];
+
+		int segmentStart = xStart;
+		while (segmentStart < xEnd)
+		{
+			// Without light tiles every light is evaluated for the whole span.
+			const U16* lightIndices = NULL;
+			int totalLights = m_totalPixelLights;
+			int segmentEnd = xEnd;
+			if (m_lightTiles != NULL)
 			{
-				for (int y = yStart; y <= yEnd; y++)
-				{
-					// Clamp the UVs
-					u1 = Clamp<double>(0.0, (double)m_targetTexture->GetWidth(), u1);
-					u2 = Clamp<double>(0.0, (double)m_targetTexture->GetWidth(), u2);
-					v1 = Clamp<double>(0.0, (double)m_targetTexture->GetHeight(), v1);
-					v2 = Clamp<double>(0.0, (double)m_targetTexture->GetHeight(), v2);
+				U32 tileX = segmentStart / m_tileGrid.tileSize;
+				lightIndices = m_lightTiles->GetTileLights(tileX, tileY, totalLights);
+				segmentEnd = (tileX + 1) * m_tileGrid.tileSize;
+				if (segmentEnd > xEnd)
+					segmentEnd = xEnd;
+			}
 
-					scanline.y = y;
-					scanline.xStart = x1;
-					scanline.xEnd = x2;
+			// Attribute values for the first 4 pixels of the segment.
+			Float4 offset = Float4Add(Float4Set1((float)(segmentStart - xStart)), laneOffsets);
+			for (int i = 0; i < PHONG_Total; i++)
+			{
+				attr[i] = Float4MulAdd(slope[i], offset, Float4Set1(scanline->start[i]));
+			}
 
-					spanXInv = 1.0f /  fabs(x1 - x2);
-					
-					scanline.uStart = u1;
-					scanline.uSlope = (u2 - u1) * spanXInv;
-					scanline.vStart = v1;
-					scanline.vSlope = (v2 - v1) * spanXInv;
-
-					ScanLineTexAffine(&scanline);
-
-					// Update the slopes.
-					x1 += xSlopeLeft;
-					x2 += xSlopeRight;
-					u1 += uSlopeLeft;
-					u2 += uSlopeRight;
-					v1 += vSlopeLeft;
-					v2 += vSlopeRight;
+			for (int x = segmentStart; x < segmentEnd; x += 4)
+			{
+				ShadePhong4(attr, m_pixelLights, lightIndices, totalLights, m_shadowMap, r, g, b);
+
+				if (segmentEnd - x >= 4)
+				{
+					Float4PackRGB(r, g, b, buffer);
+					buffer += 4;
+				}
+				else
+				{
+					// Partial block at the end of the segment.
+					Float4PackRGB(r, g, b, pixels);
+					for (int i = 0; i < segmentEnd - x; i++)
+					{
+						*buffer++ = pixels[i];
+					}
+				}
+
+				for (int i = 0; i < PHONG_Total; i++)
+				{
+					attr[i] = Float4Add(attr[i], step[i]);
 				}
 			}
 
-			// Swap back if we swapped.
-			if (hasSwaped)
+			segmentStart = segmentEnd;
+		}
+
+		if (m_overdrawCounts != NULL || m_tileCosts != NULL)
+		{
+			AddDebugSpan(scanline->y, xStart, xEnd, spanStart);
+		}
+	}
+
+	// Writes the nearest surface of each pixel in the span to the G-buffer. Only the depth test is
+	// done per pixel here; the lighting is left to the resolve so it only runs on visible pixels.
+	void Rasterizer::ScanLineGBuffer(ScanlineDataPhong* scanline)
+	{
+		// Scanline end will be < 0 and cause a wrap-around.
+		if (scanline->xEnd <= 1.0f - EPSILON)
+			return;
+
+		// Apply top-left fill convention.
+		int xStart = (int)ceil(scanline->xStart);
+		int xEnd = (int)ceil(scanline->xEnd);
+		if (xStart < 0)
+			xStart = 0;
+		if (xEnd > (int)m_bufferWidth)
+			xEnd = (int)m_bufferWidth;
+
+		U32 row = scanline->y * m_bufferWidth;
+		float* depth = m_targetGBuffer->GetDepth() + row;
+		float* normalX = m_targetGBuffer->GetNormalX() + row;
+		float* normalY = m_targetGBuffer->GetNormalY() + row;
+		float* normalZ = m_targetGBuffer->GetNormalZ() + row;
+		U32* albedo = m_targetGBuffer->GetAlbedo() + row;
+		U8* material = m_targetGBuffer->GetMaterial() + row;
+
+		float attr[PHONG_Total];
+		for (int i = 0; i < PHONG_Total; i++)
+		{
+			attr[i] = scanline->start[i];
+		}
+
+		U64 spanStart = m_tileCosts != NULL ? DebugClock() : 0;
+
+		int written = 0;
+		for (int x = xStart; x < xEnd; x++)
+		{
+			float w = 1.0f / attr[PHONG_InvW];
+			if (w < depth[x])
 			{
-				Swap<float>(x2,x1);
-				Swap<float>(xSlopeLeft,xSlopeRight);
-				
-				// Swap texel interpolation.
-				Swap<float>(u1, u2);
-				Swap<float>(uSlopeLeft, uSlopeRight);
+				written++;
+				depth[x] = w;
+				normalX[x] = attr[PHONG_NormalX] * w;
+				normalY[x] = attr[PHONG_NormalY] * w;
+				normalZ[x] = attr[PHONG_NormalZ] * w;
+				albedo[x] = ((U32)Clamp<float>(0.0f, 255.0f, attr[PHONG_Red] * w) << RED_BIT_SHIFT) |
+							((U32)Clamp<float>(0.0f, 255.0f, attr[PHONG_Green] * w) << GREEN_BIT_SHIFT) |
+							(U32)Clamp<float>(0.0f, 255.0f, attr[PHONG_Blue] * w);
+				material[x] = m_gbufferMaterial;
+			}
 
-				Swap<float>(v1, v2);
-				Swap<float>(vSlopeLeft, vSlopeRight);
+			for (int i = 0; i < PHONG_Total; i++)
+			{
+				attr[i] += scanline->slope[i];
 			}
+		}
 
-			// Setup the new slope values for the lower left edge.
-			xSlopeRight = (verts[BOTTOM].x - verts[MIDDLE].x) * invDeltaYMB;
-			x2 = verts[MIDDLE].x;
-			yStart = ceil(verts[MIDDLE].y);
-			yEnd = ceil(verts[BOTTOM].y) - 1;
-			
-			u2 = verts[MIDDLE].u;
-			v2 = verts[MIDDLE].v;
+		if (xEnd > xStart)
+		{
+			m_stats->pixelsShaded += written;
+			m_stats->pixelsDepthRejected += (xEnd - xStart) - written;
+			m_stats->bytesWritten += written * GBUFFER_PIXEL_BYTES;
+		}
 
-			// Calculate the new colour interpolations.
-			uSlopeRight = (verts[BOTTOM].u - verts[MIDDLE].u) * invDeltaYMB;
-			vSlopeRight = (verts[BOTTOM].v - verts[MIDDLE].v) * invDeltaYMB;
+		// Every pixel of the span is counted, as the depth test is most of the work here.
+		if (m_overdrawCounts != NULL || m_tileCosts != NULL)
+		{
+			AddDebugSpan(scanline->y, xStart, xEnd, spanStart);
+		}
+	}
 
-			
-			if (x2 < x1)
+	void Rasterizer::ResolveGBufferTile(U32 tileX, U32 tileY, const DeferredView &view, RenderStats &stats)
+	{
+		U32 xStart = tileX * m_tileGrid.tileSize;
+		U32 yStart = tileY * m_tileGrid.tileSize;
+		U32 xEnd = xStart + m_tileGrid.tileSize < m_bufferWidth ? xStart + m_tileGrid.tileSize : m_bufferWidth;
+		U32 yEnd = yStart + m_tileGrid.tileSize < m_bufferHeight ? yStart + m_tileGrid.tileSize : m_bufferHeight;
+
+		const U16* lightIndices = NULL;
+		int totalLights = m_totalPixelLights;
+		if (m_lightTiles != NULL)
+		{
+			lightIndices = m_lightTiles->GetTileLights(tileX, tileY, totalLights);
+		}
+
+		const Matrix4 &m = view.cameraToWorld;
+		const Float4 laneOffsets = Float4Set(0.0f, 1.0f, 2.0f, 3.0f);
+		const Float4 invFocalX = Float4Set1(1.0f / view.focalX);
+
+		const float* depthPlane = m_targetGBuffer->GetDepth();
+		const float* normalXPlane = m_targetGBuffer->GetNormalX();
+		const float* normalYPlane = m_targetGBuffer->GetNormalY();
+		const float* normalZPlane = m_targetGBuffer->GetNormalZ();
+		const U32* albedoPlane = m_targetGBuffer->GetAlbedo();
+		const U8* materialPlane = m_targetGBuffer->GetMaterial();
+
+		Float4 attr[PHONG_Total];
+		attr[PHONG_InvW] = Float4Set1(1.0f);
+
+		// The block being lit, gathered from the G-buffer planes. Lanes past the end of the tile
+		// or over empty pixels get harmless values and are not written out.
+		float depth[4];
+		float normal[3][4];
+		float colour[3][4];
+		U32 pixels[4];
+		Float4 r, g, b;
+		U32 resolved = 0;
+
+		for (U32 y = yStart; y < yEnd; y++)
+		{
+			U32 row = y * m_bufferWidth;
+			U32* buffer = (U32*)m_targetBackBuffer + y * m_bufferPitch;
+
+			// Camera space y over depth is constant along the row.
+			Float4 yOverZ = Float4Set1(-((float)y - view.halfHeight) / view.focalY);
+
+			for (U32 x = xStart; x < xEnd; x += 4)
 			{
-				Swap<float>(x2, x1);
-				Swap<float>(xSlopeLeft, xSlopeRight);
-				
-				// Swap texel interpolation.
-				Swap<float>(u1, u2);
-				Swap<float>(uSlopeLeft, uSlopeRight);
+				U32 count = xEnd - x < 4 ? xEnd - x : 4;
+				U32 index = row + x;
 
-				Swap<float>(v1, v2);
-				Swap<float>(vSlopeLeft, vSlopeRight);
-			}
-			
-			// The incidental offset that may be generated by using the ceil function.
-			// We may get 'graphical artifacts' / visaul errors if we dont correct starting values
-			// by this.
-			sub = (float)yStart - verts[MIDDLE].y;
+				bool anyCovered = false;
+				for (U32 i = 0; i < 4; i++)
+				{
+					bool covered = i < count && depthPlane[index + i] < GBUFFER_EMPTY_DEPTH;
+					anyCovered |= covered;
+
+					U32 src = covered ? index + i : index;
+					depth[i] = covered ? depthPlane[src] : 1.0f;
+					normal[0][i] = covered ? normalXPlane[src] : 0.0f;
+					normal[1][i] = covered ? normalYPlane[src] : 0.0f;
+					normal[2][i] = covered ? normalZPlane[src] : 1.0f;
+
+					U32 albedo = covered ? albedoPlane[src] : 0;
+					colour[0][i] = (float)((albedo & RED_MASK) >> RED_BIT_SHIFT);
+					colour[1][i] = (float)((albedo & GREEN_MASK) >> GREEN_BIT_SHIFT);
+					colour[2][i] = (float)(albedo & BLUE_MASK);
+				}
 
-			if (invDeltaYMB > EPSILON)
-			{				
-				// Run down from the middle to the bottom of the triangle.
-				for (int y = yStart; y <= yEnd; y++)
+				if (anyCovered == false)
+					continue;
+
+				// Rebuild the world position from the camera space position.
+				Float4 z = Float4Load(depth);
+				Float4 camX = Float4Mul(Float4Mul(Float4Sub(Float4Add(Float4Set1((float)x), laneOffsets), Float4Set1(view.halfWidth)), invFocalX), z);
+				Float4 camY = Float4Mul(yOverZ, z);
+				attr[PHONG_PosX] = Float4Add(Float4Dot3(camX, camY, z, Float4Set1(m.xX), Float4Set1(m.yX), Float4Set1(m.zX)), Float4Set1(m.wX));
+				attr[PHONG_PosY] = Float4Add(Float4Dot3(camX, camY, z, Float4Set1(m.xY), Float4Set1(m.yY), Float4Set1(m.zY)), Float4Set1(m.wY));
+				attr[PHONG_PosZ] = Float4Add(Float4Dot3(camX, camY, z, Float4Set1(m.xZ), Float4Set1(m.yZ), Float4Set1(m.zZ)), Float4Set1(m.wZ));
+				attr[PHONG_NormalX] = Float4Load(normal[0]);
+				attr[PHONG_NormalY] = Float4Load(normal[1]);
+				attr[PHONG_NormalZ] = Float4Load(normal[2]);
+				attr[PHONG_Red] = Float4Load(colour[0]);
+				attr[PHONG_Green] = Float4Load(colour[1]);
+				attr[PHONG_Blue] = Float4Load(colour[2]);
+
+				ShadePhong4(attr, m_pixelLights, lightIndices, totalLights, m_shadowMap, r, g, b);
+				Float4PackRGB(r, g, b, pixels);
+
+				for (U32 i = 0; i < count; i++)
 				{
-					// Clamp the UVs
-					u1 = Clamp<double>(0.0, (double)m_targetTexture->GetWidth(), u1);
-					u2 = Clamp<double>(0.0, (double)m_targetTexture->GetWidth(), u2);
-					v1 = Clamp<double>(0.0, (double)m_targetTexture->GetHeight(), v1);
-					v2 = Clamp<double>(0.0, (double)m_targetTexture->GetHeight(), v2);
+					if (depthPlane[index + i] >= GBUFFER_EMPTY_DEPTH)
+						continue;
 
-					scanline.y = y;
-					scanline.xStart = x1;
-					scanline.xEnd = x2;
+					if (materialPlane[index + i] == GBUFFER_Unlit)
+						buffer[x + i] = albedoPlane[index + i];
+					else
+						buffer[x + i] = pixels[i];
 
-					spanXInv = 1.0f /  fabs(x1 - x2);
-					
-					scanline.uStart = u1;
-					scanline.uSlope = (u2 - u1) * spanXInv;
-					scanline.vStart = v1;
-					scanline.vSlope = (v2 - v1) * spanXInv;
-
-					ScanLineTexAffine(&scanline);
-
-					// Update the slopes.
-					x1 += xSlopeLeft;
-					x2 += xSlopeRight;
-					u1 += uSlopeLeft;
-					u2 += uSlopeRight;
-					v1 += vSlopeLeft;
-					v2 += vSlopeRight;
+					resolved++;
 				}
 			}
 		}
-		else
+
+		stats.pixelsResolved += resolved;
+		stats.bytesWritten += resolved * 4;
+	}
+
+	// Depth only triangle for rendering shadow maps. The projected z is linear in screen space, so 
+	// it is stepped with constant gradients like the per-pixel lit path.
+	void Rasterizer::RasterizeTriDepth(const Vertex* tri, ZDepthBuffer* target)
+	{
+		SWR_PROFILE_SCOPE("TriangleSetup");
+
+		// Sort vertices up to down.
+		const Vertex* verts[3] = { &tri[0], &tri[1], &tri[2] };
+		if (verts[1]->y < verts[0]->y) Swap<const Vertex*>(verts[0], verts[1]);
+		if (verts[2]->y < verts[1]->y) Swap<const Vertex*>(verts[1], verts[2]);
+		if (verts[1]->y < verts[0]->y) Swap<const Vertex*>(verts[0], verts[1]);
+
+		const Vertex &top = *verts[TOP];
+		const Vertex &mid = *verts[MIDDLE];
+		const Vertex &bot = *verts[BOTTOM];
+
+		float dx1 = mid.x - top.x, dy1 = mid.y - top.y;
+		float dx2 = bot.x - top.x, dy2 = bot.y - top.y;
+		float area = dx1 * dy2 - dx2 * dy1;
+		if (fabs(area) < EPSILON)
+			return;
+
+		// Depth gradients, scaled up to the depth buffer's range.
+		float areaInv = 1.0f / area;
+		float dz1 = (mid.z - top.z) * 32767.0f;
+		float dz2 = (bot.z - top.z) * 32767.0f;
+		float ddx = (dz1 * dy2 - dz2 * dy1) * areaInv;
+		float ddy = (dz2 * dx1 - dz1 * dx2) * areaInv;
+
+		TriangleEdgeType triType = area > 0.0f ? TRIANGLE_Major : TRIANGLE_Minor;
+
+		float longSlope = dx2 / dy2;
+		float topSlope = dy1 > EPSILON ? dx1 / dy1 : 0.0f;
+		float botSlope = (bot.y - mid.y) > EPSILON ? (bot.x - mid.x) / (bot.y - mid.y) : 0.0f;
+
+		int width = (int)target->GetWidth();
+		int height = (int)target->GetHeight();
+		int pitch = (int)target->GetPitch();
+		S16* buffer = target->GetBuffer();
+
+		int yStart = (int)ceil(top.y);
+		int yEnd = (int)ceil(bot.y) - 1;
+		if (yStart < 0)
+			yStart = 0;
+		if (yEnd > height - 1)
+			yEnd = height - 1;
+
 		{
-			LOG("Triangle failed to be classified as a valid render type", LOG_Error);
-			assert(false);
+			SWR_PROFILE_SCOPE("SpanFill");
+			for (int y = yStart; y <= yEnd; y++)
+			{
+				float fy = (float)y;
+				float xLong = top.x + (fy - top.y) * longSlope;
+				float xShort = fy < mid.y ? top.x + (fy - top.y) * topSlope : mid.x + (fy - mid.y) * botSlope;
+				float xLeft = triType == TRIANGLE_Major ? xLong : xShort;
+				float xRight = triType == TRIANGLE_Major ? xShort : xLong;
+
+				// Apply top-left fill convention.
+				int xStart = (int)ceil(xLeft);
+				int xEnd = (int)ceil(xRight);
+				if (xStart < 0)
+					xStart = 0;
+				if (xEnd > width)
+					xEnd = width;
+
+				float z = top.z * 32767.0f + ddx * ((float)xStart - top.x) + ddy * (fy - top.y);
+				S16* row = buffer + y * pitch;
+				int written = 0;
+				for (int x = xStart; x < xEnd; x++)
+				{
+					S16 depth = (S16)Clamp<float>(0.0f, 32767.0f, z);
+					if (depth < row[x])
+					{
+						row[x] = depth;
+						written++;
+					}
+
+					z += ddx;
+				}
+
+				// Depth only pixels are not shaded, so only the depth test is counted.
+				if (xEnd > xStart)
+				{
+					m_stats->pixelsDepthRejected += (xEnd - xStart) - written;
+					m_stats->bytesWritten += written * sizeof(S16);
+				}
+			}
 		}
 	}
-	
-	// The texture based triangle rasterization is the same as the Gourad shaded filled triangle procedure.
-	// We use the same steps and procedures of deducing the type of triangle (Major or minor) however here
-	// we are interpolating UV co-ordinates based on the slopes between each vertex.
-	// Each UV co-ordinate is also scaled up by the source texture width and height to avoid getting visaul artifacts.
-	void Rasterizer::RasterizeTriTex_EdgeList(Vertex* tri)
+
+	// Per-pixel lit triangle. Unlike the gourad path, which steps each interpolant down both edges, 
+	// the attributes here are stepped with constant screen space gradients. There are too many of
+	// them to carry down two edges each, and the gradients are what the 4 wide spans need anyway.
+	void Rasterizer::RasterizeTriPhong(PhongVertex* tri)
 	{
-		// The type of triangle that is being drawn.
-		// Major means that edge with greatest Y delta is on left, minor means it is on right.
-		TriangleEdgeType triType;
+		RasterizeTriGradient(tri, &Rasterizer::ScanLinePhong);
+	}
+
+	void Rasterizer::RasterizeTriGBuffer(PhongVertex* tri)
+	{
+		RasterizeTriGradient(tri, &Rasterizer::ScanLineGBuffer);
+	}
+
+	template <class GradientVertex, class Scanline>
+	void Rasterizer::RasterizeTriGradient(const GradientVertex* tri, void (Rasterizer::*spanFunc)(Scanline* scanline))
+	{
+		SWR_PROFILE_SCOPE("TriangleSetup");
+
+		const int totalAttributes = sizeof(tri->attr) / sizeof(tri->attr[0]);
 
 		// Sort vertices up to down.
-		Vertex verts[3];
+		const GradientVertex* verts[3] = { &tri[0], &tri[1], &tri[2] };
+		if (verts[1]->y < verts[0]->y) Swap<const GradientVertex*>(verts[0], verts[1]);
+		if (verts[2]->y < verts[1]->y) Swap<const GradientVertex*>(verts[1], verts[2]);
+		if (verts[1]->y < verts[0]->y) Swap<const GradientVertex*>(verts[0], verts[1]);
+
+		const GradientVertex &top = *verts[TOP];
+		const GradientVertex &mid = *verts[MIDDLE];
+		const GradientVertex &bot = *verts[BOTTOM];
+
+		// Twice the signed area of the triangle. Discard degenerate triangles.
+		float dx1 = mid.x - top.x, dy1 = mid.y - top.y;
+		float dx2 = bot.x - top.x, dy2 = bot.y - top.y;
+		float area = dx1 * dy2 - dx2 * dy1;
+		if (fabs(area) < EPSILON)
+			return;
+
+		// Screen space gradients of each attribute.
+		float areaInv = 1.0f / area;
+		float ddx[totalAttributes];
+		float ddy[totalAttributes];
+		for (int i = 0; i < totalAttributes; i++)
+		{
+			float d1 = mid.attr[i] - top.attr[i];
+			float d2 = bot.attr[i] - top.attr[i];
+			ddx[i] = (d1 * dy2 - d2 * dy1) * areaInv;
+			ddy[i] = (d2 * dx1 - d1 * dx2) * areaInv;
+		}
+
+		// Major means that edge with greatest Y delta is on left, minor means it is on right.
+		// With y pointing down a positive area places the middle vertex to the right of the long edge.
+		TriangleEdgeType triType = area > 0.0f ? TRIANGLE_Major : TRIANGLE_Minor;
+
+		float longSlope = dx2 / dy2;
+		float topSlope = dy1 > EPSILON ? dx1 / dy1 : 0.0f;
+		float botSlope = (bot.y - mid.y) > EPSILON ? (bot.x - mid.x) / (bot.y - mid.y) : 0.0f;
+
+		int yStart = (int)ceil(top.y);
+		int yEnd = (int)ceil(bot.y) - 1;
+		if (yStart < 0)
+			yStart = 0;
+		if (yEnd > (int)m_bufferHeight - 1)
+			yEnd = (int)m_bufferHeight - 1;
+
+		Scanline scanline;
+		for (int i = 0; i < totalAttributes; i++)
+		{
+			scanline.slope[i] = ddx[i];
+		}
+
+		{
+			SWR_PROFILE_SCOPE("SpanFill");
+			for (int y = yStart; y <= yEnd; y++)
+			{
+				float fy = (float)y;
+				float xLong = top.x + (fy - top.y) * longSlope;
+				float xShort = fy < mid.y ? top.x + (fy - top.y) * topSlope : mid.x + (fy - mid.y) * botSlope;
+
+				scanline.y = y;
+				if (triType == TRIANGLE_Major)
+				{
+					scanline.xStart = xLong;
+					scanline.xEnd = xShort;
+				}
+				else
+				{
+					scanline.xStart = xShort;
+					scanline.xEnd = xLong;
+				}
+
+				// Evaluate the attributes at the first pixel centre the span will cover.
+				float xFirst = ceil(scanline.xStart);
+				if (xFirst < 0.0f)
+					xFirst = 0.0f;
+				float offX = xFirst - top.x;
+				float offY = fy - top.y;
+				for (int i = 0; i < totalAttributes; i++)
+				{
+					scanline.start[i] = top.attr[i] + ddx[i] * offX + ddy[i] * offY;
+				}
+
+				(this->*spanFunc)(&scanline);
+			}
+		}
+	}
+
+	
+	// Colour edge list generation.
+	int Rasterizer::GenerateMajorEdgeListCol(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB)
+	{
+		// Slope values for screen pixels
+		float x1, x2;
+		int yStart;
+		int yEnd;
+		float xSlopeLeft, xSlopeRight;
+		float spanXInv = 0.0f;
+
+		// Slope values for colours.
+		float r1, r2;
+		float g1, g2;
+		float b1, b2;
+		float rSlopeLeft, gSlopeLeft, bSlopeLeft;
+		float rSlopeRight, gSlopeRight, bSlopeRight;
+		bool hasSwaped = false;
+
+		// Calculate our values for the scan line interpolation.
+		xSlopeLeft = (verts[BOTTOM].x - verts[TOP].x) * invDeltaYTB;
+		xSlopeRight = (verts[MIDDLE].x - verts[TOP].x) * invDeltaYTM;
+		x1 = verts[TOP].x;
+		x2 = verts[TOP].x;
+		yStart = ceil(verts[TOP].y);
+		yEnd = ceil(verts[MIDDLE].y) - 1;
+
+		r1 = verts[TOP].colour.R;
+		r2 = verts[TOP].colour.R;
+		g1 = verts[TOP].colour.G;
+		g2 = verts[TOP].colour.G;
+		b1 = verts[TOP].colour.B;
+		b2 = verts[TOP].colour.B;
+
+		rSlopeLeft = (verts[BOTTOM].colour.R - verts[TOP].colour.R) * invDeltaYTB;
+		rSlopeRight = (verts[MIDDLE].colour.R - verts[TOP].colour.R) * invDeltaYTM;
+		gSlopeLeft = (verts[BOTTOM].colour.G - verts[TOP].colour.G) * invDeltaYTB;
+		gSlopeRight = (verts[MIDDLE].colour.G - verts[TOP].colour.G) * invDeltaYTM;
+		bSlopeLeft = (verts[BOTTOM].colour.B - verts[TOP].colour.B) * invDeltaYTB;
+		bSlopeRight = (verts[MIDDLE].colour.B - verts[TOP].colour.B) * invDeltaYTM;
+
+		if (xSlopeRight < xSlopeLeft)
+		{
+			Swap<float>(x2,x1);
+			Swap<float>(xSlopeLeft,xSlopeRight);
+				
+			// Swap colour interpolation.
+			Swap<float>(r1, r2);
+			Swap<float>(rSlopeLeft, rSlopeRight);
+
+			Swap<float>(g1, g2);
+			Swap<float>(gSlopeLeft, gSlopeRight);
+
+			Swap<float>(b1, b2);
+			Swap<float>(bSlopeLeft, bSlopeRight);
+
+			hasSwaped = true;
+		}
+
+		int index = 0;
+
+		// Draw the upper triangle section.
+		if (invDeltaYTM > EPSILON)
+		{
+			for (int y = yStart; y <= yEnd; y++)
+			{
+				this->m_scanLineColBuffer[index].y = y;
+				this->m_scanLineColBuffer[index].xStart = x1;
+				this->m_scanLineColBuffer[index].xEnd = x2;
+
+				spanXInv = 1.0f /  fabs(x1 - x2);
+					
+				this->m_scanLineColBuffer[index].rStart = r1;
+				this->m_scanLineColBuffer[index].rSlope = (r2 - r1) * spanXInv;
+				this->m_scanLineColBuffer[index].gStart = g1;
+				this->m_scanLineColBuffer[index].gSlope = (g2 - g1) * spanXInv;
+				this->m_scanLineColBuffer[index].bStart = b1;
+				this->m_scanLineColBuffer[index].bSlope = (b2 - b1) * spanXInv;
+
+				// Update the slopes.
+				x1 += xSlopeLeft;
+				x2 += xSlopeRight;
+				r1 += rSlopeLeft;
+				r2 += rSlopeRight;
+				g1 += gSlopeLeft;
+				g2 += gSlopeRight;
+				b1 += bSlopeLeft;
+				b2 += bSlopeRight;
+				index++;
+			}
+		}
+
+		// Swap back if we swapped.
+		if (hasSwaped)
+		{
+			Swap<float>(x2,x1);
+			Swap<float>(xSlopeLeft,xSlopeRight);
+				
+			// Swap colour interpolation.
+			Swap<float>(r1, r2);
+			Swap<float>(rSlopeLeft, rSlopeRight);
+
+			Swap<float>(g1, g2);
+			Swap<float>(gSlopeLeft, gSlopeRight);
+
+			Swap<float>(b1, b2);
+			Swap<float>(bSlopeLeft, bSlopeRight);
+		}
+
+		// Setup the new slope values for the lower left edge.
+		xSlopeRight = (verts[BOTTOM].x - verts[MIDDLE].x) * invDeltaYMB;
+		x2 = verts[MIDDLE].x;
+		yStart = ceil(verts[MIDDLE].y);
+		yEnd = ceil(verts[BOTTOM].y) - 1;
+			
+		r2 = verts[MIDDLE].colour.R;
+		g2 = verts[MIDDLE].colour.G;
+		b2 = verts[MIDDLE].colour.B;
+
+		// Calculate the new colour interpolations.
+		rSlopeRight = (verts[BOTTOM].colour.R - verts[MIDDLE].colour.R) * invDeltaYMB;
+		gSlopeRight = (verts[BOTTOM].colour.G - verts[MIDDLE].colour.G) * invDeltaYMB;
+		bSlopeRight = (verts[BOTTOM].colour.B - verts[MIDDLE].colour.B) * invDeltaYMB;
+
+		if (x2 < x1)
+		{
+			Swap<float>(x2, x1);
+			Swap<float>(xSlopeLeft, xSlopeRight);
+				
+			// Swap colour interpolation.
+			Swap<float>(r1, r2);
+			Swap<float>(rSlopeLeft, rSlopeRight);
+
+			Swap<float>(g1, g2);
+			Swap<float>(gSlopeLeft, gSlopeRight);
+
+			Swap<float>(b1, b2);
+			Swap<float>(bSlopeLeft, bSlopeRight);
+		}
+	
+		if (invDeltaYMB > EPSILON)
+		{				
+			// Run down from the middle to the bottom of the triangle.
+			for (int y = yStart; y <= yEnd; y++)
+			{
+				this->m_scanLineColBuffer[index].y = y;
+				this->m_scanLineColBuffer[index].xStart = x1;
+				this->m_scanLineColBuffer[index].xEnd = x2;
+
+				spanXInv = 1.0f /  fabs(x1 - x2);
+					
+				this->m_scanLineColBuffer[index].rStart = r1;
+				this->m_scanLineColBuffer[index].rSlope = (r2 - r1) * spanXInv;
+				this->m_scanLineColBuffer[index].gStart = g1;
+				this->m_scanLineColBuffer[index].gSlope = (g2 - g1) * spanXInv;
+				this->m_scanLineColBuffer[index].bStart = b1;
+				this->m_scanLineColBuffer[index].bSlope = (b2 - b1) * spanXInv;
+
+				// Update the slopes.
+				x1 += xSlopeLeft;
+				x2 += xSlopeRight;
+				r1 += rSlopeLeft;
+				r2 += rSlopeRight;
+				g1 += gSlopeLeft;
+				g2 += gSlopeRight;
+				b1 += bSlopeLeft;
+				b2 += bSlopeRight;
+				index++;
+			}
+		}
+
+		return index;
+	}
+
+	int Rasterizer::GenerateMinorEdgeListCol(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB)
+	{
+		// Slope values for screen pixels
+		float x1, x2;
+		int yStart;
+		int yEnd;
+		float xSlopeLeft, xSlopeRight;
+		float spanXInv = 0.0f;
+
+		// Slope values for colours.
+		float r1, r2;
+		float g1, g2;
+		float b1, b2;
+		float rSlopeLeft, gSlopeLeft, bSlopeLeft;
+		float rSlopeRight, gSlopeRight, bSlopeRight;
+
+		// Calculate our values for the scan line interpolation.
+		xSlopeLeft = (verts[MIDDLE].x - verts[TOP].x) * invDeltaYTM;
+		xSlopeRight = (verts[BOTTOM].x - verts[TOP].x) * invDeltaYTB;
+		x1 = verts[TOP].x;
+		x2 = verts[TOP].x;
+		yStart = ceil(verts[TOP].y);
+		yEnd = ceil(verts[MIDDLE].y) - 1;
+
+		// Set up the colour interpolation values.
+		r1 = verts[TOP].colour.R;
+		r2 = verts[TOP].colour.R;
+		g1 = verts[TOP].colour.G;
+		g2 = verts[TOP].colour.G;
+		b1 = verts[TOP].colour.B;
+		b2 = verts[TOP].colour.B;
+
+		rSlopeLeft = (verts[MIDDLE].colour.R - verts[TOP].colour.R) * invDeltaYTM;
+		rSlopeRight = (verts[BOTTOM].colour.R - verts[TOP].colour.R) * invDeltaYTB;
+		gSlopeLeft = (verts[MIDDLE].colour.G - verts[TOP].colour.G) * invDeltaYTM;
+		gSlopeRight = (verts[BOTTOM].colour.G - verts[TOP].colour.G) * invDeltaYTB;
+		bSlopeLeft = (verts[MIDDLE].colour.B - verts[TOP].colour.B) * invDeltaYTM;
+		bSlopeRight = (verts[BOTTOM].colour.B - verts[TOP].colour.B) * invDeltaYTB;
+
+		// The incidental offset that may be generated by using the ceil function.
+		// We may get 'graphical artifacts' / visaul errors if we dont correct starting values
+		// by this.
+		float sub = (float)yStart - verts[TOP].y;
+		x1 += xSlopeLeft * sub;
+		x2 += xSlopeRight * sub;
+		r1 += rSlopeLeft * sub;
+		r2 += rSlopeRight * sub;
+		g1 += gSlopeLeft * sub;
+		g2 += gSlopeRight * sub;
+		b1 += bSlopeLeft * sub;
+		b2 += bSlopeRight * sub;
 		
-		SortByY(verts, tri);
+		// If our right slope is less than our left slope then we are going to get an incomplete triangle.
+		// Swap the values to fix this.
+		bool hasSwaped = false;
+		if (xSlopeRight < xSlopeLeft)
+		{
+			// Swap x axis interpolation.
+			Swap<float>(x2,x1);
+			Swap<float>(xSlopeLeft,xSlopeRight);
 
-		// Determine if the triangle is major/minor.
-		if (verts[BOTTOM].x > verts[MIDDLE].x)
-			triType = TRIANGLE_Minor;
-		else
-			triType = TRIANGLE_Major;
+			// Swap colour interpolation.
+			Swap<float>(r1, r2);
+			Swap<float>(rSlopeLeft, rSlopeRight);
 
-		// Set up Y deltas and inverse multipliers for edge traversal.
-		float invDeltaYTB = 1.0f / (verts[BOTTOM].y - verts[TOP].y);
-		float invDeltaYTM = 1.0f / (verts[MIDDLE].y - verts[TOP].y);
-		float invDeltaYMB = 1.0f / (verts[BOTTOM].y - verts[MIDDLE].y);
+			Swap<float>(g1, g2);
+			Swap<float>(gSlopeLeft, gSlopeRight);
+
+			Swap<float>(b1, b2);
+			Swap<float>(bSlopeLeft, bSlopeRight);
+
+			hasSwaped = true;
+		}
+
+		int index = 0; 
+
+		// Draw the upper triangle section.
+		if (invDeltaYTM > EPSILON)
+		{
+			// Run down from the top to the middle of the triangle.
+			for (int y = yStart; y <= yEnd; y++)
+			{
+				m_scanLineColBuffer[index].y = y;
+				m_scanLineColBuffer[index].xStart = x1;
+				m_scanLineColBuffer[index].xEnd = x2;
+
+				spanXInv = 1.0f /  fabs(x1 - x2);
+					
+				m_scanLineColBuffer[index].rStart = r1;
+				m_scanLineColBuffer[index].rSlope = (r2 - r1) * spanXInv;
+				m_scanLineColBuffer[index].gStart = g1;
+				m_scanLineColBuffer[index].gSlope = (g2 - g1) * spanXInv;
+				m_scanLineColBuffer[index].bStart = b1;
+				m_scanLineColBuffer[index].bSlope = (b2 - b1) * spanXInv;
+
+				// Update the slopes.
+				x1 += xSlopeLeft;
+				x2 += xSlopeRight;
+				r1 += rSlopeLeft;
+				r2 += rSlopeRight;
+				g1 += gSlopeLeft;
+				g2 += gSlopeRight;
+				b1 += bSlopeLeft;
+				b2 += bSlopeRight;
+
+				index++;
+			}
+		}
+			
+		// Swap back if we swapped.
+		if (hasSwaped)
+		{
+			Swap<float>(x2,x1);
+			Swap<float>(xSlopeLeft,xSlopeRight);
+				
+			// Swap colour interpolation.
+			Swap<float>(r1, r2);
+			Swap<float>(rSlopeLeft, rSlopeRight);
+
+			Swap<float>(g1, g2);
+			Swap<float>(gSlopeLeft, gSlopeRight);
+
+			Swap<float>(b1, b2);
+			Swap<float>(bSlopeLeft, bSlopeRight);
+		}
+
+		// Setup the new slope values for the lower left edge.
+		xSlopeLeft = (verts[BOTTOM].x - verts[MIDDLE].x) * invDeltaYMB;
+		x1 = verts[MIDDLE].x;
+		yStart = ceil(verts[MIDDLE].y);
+		yEnd = ceil(verts[BOTTOM].y) - 1;
 
-		// Scale out the vertices UV's based on the current texture.
-		for (int i = 0; i < 3; i++)
+		r1 = verts[MIDDLE].colour.R;
+		g1 = verts[MIDDLE].colour.G;
+		b1 = verts[MIDDLE].colour.B;
+
+		// Calculate the new colour interpolations.
+		rSlopeLeft = (verts[BOTTOM].colour.R - verts[MIDDLE].colour.R) * invDeltaYMB;
+		gSlopeLeft = (verts[BOTTOM].colour.G - verts[MIDDLE].colour.G) * invDeltaYMB;
+		bSlopeLeft = (verts[BOTTOM].colour.B - verts[MIDDLE].colour.B) * invDeltaYMB;
+		
+		if (x2 < x1)
 		{
-			verts[i].u *= m_targetTexture->GetWidth();
-			verts[i].v *= m_targetTexture->GetHeight();
-		}
+			Swap<float>(x2, x1);
+			Swap<float>(xSlopeLeft, xSlopeRight);
+				
+			// Swap colour interpolation.
+			Swap<float>(r1, r2);
+			Swap<float>(rSlopeLeft, rSlopeRight);
 
-		// Cast the scanline list pointer.
-		this->m_scanLineTexBuffer = (SWR::ScanlineDataTex*)this->m_scanLineBuffer;
+			Swap<float>(g1, g2);
+			Swap<float>(gSlopeLeft, gSlopeRight);
 
-		// Build the edge list
-		if (triType == TRIANGLE_Minor)
-			this->GenerateMinorEdgeListTex(verts, invDeltaYTB, invDeltaYTM, invDeltaYMB);
-		else
-			this->GenerateMajorEdgeListTex(verts, invDeltaYTB, invDeltaYTM, invDeltaYMB);
+			Swap<float>(b1, b2);
+			Swap<float>(bSlopeLeft, bSlopeRight);
+		}
 
-		// Calculate the total number of scanlines that we are going to need to render.
-		int totalScanlines = (int)(verts[BOTTOM].y - verts[TOP].y);
+		if (invDeltaYMB > EPSILON)
+		{				
+			// Run down from the middle to the bottom of the triangle.
+			for (int y = yStart; y <= yEnd; y++)
+			{
+				m_scanLineColBuffer[index].y = y;
+				m_scanLineColBuffer[index].xStart = x1;
+				m_scanLineColBuffer[index].xEnd = x2;
 
-		this->BatchRasterizeEdgeListTex(totalScanlines + 1);
-	}
+				spanXInv = 1.0f /  fabs(x1 - x2);
+					
+				m_scanLineColBuffer[index].rStart = r1;
+				m_scanLineColBuffer[index].rSlope = (r2 - r1) * spanXInv;
+				m_scanLineColBuffer[index].gStart = g1;
+				m_scanLineColBuffer[index].gSlope = (g2 - g1) * spanXInv;
+				m_scanLineColBuffer[index].bStart = b1;
+				m_scanLineColBuffer[index].bSlope = (b2 - b1) * spanXInv;
 
-	void Rasterizer::RasterizeTriTexLight(Vertex* vertices)
-	{
-		// Unimplemented.
-	}
+				// Update the slopes.
+				x1 += xSlopeLeft;
+				x2 += xSlopeRight;
+				r1 += rSlopeLeft;
+				r2 += rSlopeRight;
+				g1 += gSlopeLeft;
+				g2 += gSlopeRight;
+				b1 += bSlopeLeft;
+				b2 += bSlopeRight;
 
-	
-	// Colour edge list generation.
-	void Rasterizer::GenerateMajorEdgeListCol(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB)
-	{
-	}
+				index++;
 
-	void Rasterizer::GenerateMinorEdgeListCol(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB)
-	{
+			}
+		}
+
+		return index;
 	}
 
-	void Rasterizer::GenerateMajorEdgeListTex(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB)
+	// Texture edge list generation.
+	int Rasterizer::GenerateMajorEdgeListTex(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB)
 	{
 		// Slope values for screen pixels
 		float x1, x2;
@@ -1241,35 +2395,31 @@ namespace SWR
 		float v1, v2;
 		float uSlopeLeft, vSlopeLeft;
 		float uSlopeRight, vSlopeRight;
+		bool hasSwaped = false;
 
 		// Calculate our values for the scan line interpolation.
-		xSlopeLeft = (verts[MIDDLE].x - verts[TOP].x) * invDeltaYTM;
-		xSlopeRight = (verts[BOTTOM].x - verts[TOP].x) * invDeltaYTB;
+		xSlopeLeft = (verts[BOTTOM].x - verts[TOP].x) * invDeltaYTB;
+		xSlopeRight = (verts[MIDDLE].x - verts[TOP].x) * invDeltaYTM;
 		x1 = verts[TOP].x;
 		x2 = verts[TOP].x;
 		yStart = ceil(verts[TOP].y);
 		yEnd = ceil(verts[MIDDLE].y) - 1;
 
-		// Set up the colour interpolation values.
 		u1 = verts[TOP].u;
 		u2 = verts[TOP].u;
 		v1 = verts[TOP].v;
 		v2 = verts[TOP].v;
 
-		uSlopeLeft = (verts[MIDDLE].u - verts[TOP].u) * invDeltaYTM;
-		uSlopeRight = (verts[BOTTOM].u - verts[TOP].u) * invDeltaYTB;
-		vSlopeLeft = (verts[MIDDLE].v - verts[TOP].v) * invDeltaYTM;
-		vSlopeRight = (verts[BOTTOM].v - verts[TOP].v) * invDeltaYTB;
-		
-		// If our right slope is less than our left slope then we are going to get an incomplete triangle.
-		// Swap the values to fix this.
-		bool hasSwaped = false;
+		uSlopeLeft = (verts[BOTTOM].u- verts[TOP].u) * invDeltaYTB;
+		uSlopeRight = (verts[MIDDLE].u - verts[TOP].u) * invDeltaYTM;
+		vSlopeLeft = (verts[BOTTOM].v - verts[TOP].v) * invDeltaYTB;
+		vSlopeRight = (verts[MIDDLE].v - verts[TOP].v) * invDeltaYTM;
+
 		if (xSlopeRight < xSlopeLeft)
 		{
-			// Swap x axis interpolation.
 			Swap<float>(x2,x1);
 			Swap<float>(xSlopeLeft,xSlopeRight);
-
+				
 			// Swap texel interpolation.
 			Swap<float>(u1, u2);
 			Swap<float>(uSlopeLeft, uSlopeRight);
@@ -1280,31 +2430,23 @@ namespace SWR
 			hasSwaped = true;
 		}
 
-		int index = 0; 
-
+		int index = 0;
 
 		// Draw the upper triangle section.
 		if (invDeltaYTM > EPSILON)
 		{
-			// Run down from the top to the middle of the triangle.
 			for (int y = yStart; y <= yEnd; y++)
 			{
-				// Clamp the UVs
-				u1 = Clamp<float>(0.0, (float)m_targetTexture->GetWidth(), u1);
-				u2 = Clamp<float>(0.0, (float)m_targetTexture->GetWidth(), u2);
-				v1 = Clamp<float>(0.0, (float)m_targetTexture->GetHeight(), v1);
-				v2 = Clamp<float>(0.0, (float)m_targetTexture->GetHeight(), v2);
-
-				m_scanLineTexBuffer[index].y = y;
-				m_scanLineTexBuffer[index].xStart = x1;
-				m_scanLineTexBuffer[index].xEnd = x2;
+				this->m_scanLineTexBuffer[index].y = y;
+				this->m_scanLineTexBuffer[index].xStart = x1;
+				this->m_scanLineTexBuffer[index].xEnd = x2;
 
 				spanXInv = 1.0f /  fabs(x1 - x2);
 					
-				m_scanLineTexBuffer[index].uStart = u1;
-				m_scanLineTexBuffer[index].uSlope = (u2 - u1) * spanXInv;
-				m_scanLineTexBuffer[index].vStart = v1;
-				m_scanLineTexBuffer[index].vSlope = (v2 - v1) * spanXInv;
+				this->m_scanLineTexBuffer[index].uStart = u1;
+				this->m_scanLineTexBuffer[index].uSlope = (u2 - u1) * spanXInv;
+				this->m_scanLineTexBuffer[index].vStart = v1;
+				this->m_scanLineTexBuffer[index].vSlope = (v2 - v1) * spanXInv;
 
 				// Update the slopes.
 				x1 += xSlopeLeft;
@@ -1313,11 +2455,10 @@ namespace SWR
 				u2 += uSlopeRight;
 				v1 += vSlopeLeft;
 				v2 += vSlopeRight;
-
 				index++;
 			}
 		}
-			
+
 		// Swap back if we swapped.
 		if (hasSwaped)
 		{
@@ -1333,18 +2474,19 @@ namespace SWR
 		}
 
 		// Setup the new slope values for the lower left edge.
-		xSlopeLeft = (verts[BOTTOM].x - verts[MIDDLE].x) * invDeltaYMB;
-		x1 = verts[MIDDLE].x;
+		xSlopeRight = (verts[BOTTOM].x - verts[MIDDLE].x) * invDeltaYMB;
+		x2 = verts[MIDDLE].x;
 		yStart = ceil(verts[MIDDLE].y);
 		yEnd = ceil(verts[BOTTOM].y) - 1;
-
-		u1 = verts[MIDDLE].u;
-		v1 = verts[MIDDLE].v;
+			
+		u2 = verts[MIDDLE].u;
+		v2 = verts[MIDDLE].v;
 
 		// Calculate the new colour interpolations.
-		uSlopeLeft = (verts[BOTTOM].u - verts[MIDDLE].u) * invDeltaYMB;
-		vSlopeLeft = (verts[BOTTOM].v - verts[MIDDLE].v) * invDeltaYMB;
-		
+		uSlopeRight = (verts[BOTTOM].u - verts[MIDDLE].u) * invDeltaYMB;
+		vSlopeRight = (verts[BOTTOM].v - verts[MIDDLE].v) * invDeltaYMB;
+
+			
 		if (x2 < x1)
 		{
 			Swap<float>(x2, x1);
@@ -1357,29 +2499,23 @@ namespace SWR
 			Swap<float>(v1, v2);
 			Swap<float>(vSlopeLeft, vSlopeRight);
 		}
-
-
+	
 		if (invDeltaYMB > EPSILON)
 		{				
 			// Run down from the middle to the bottom of the triangle.
 			for (int y = yStart; y <= yEnd; y++)
 			{
-				// Clamp the UVs
-				u1 = Clamp<float>(0.0, (float)m_targetTexture->GetWidth(), u1);
-				u2 = Clamp<float>(0.0, (float)m_targetTexture->GetWidth(), u2);
-				v1 = Clamp<float>(0.0, (float)m_targetTexture->GetHeight(), v1);
-				v2 = Clamp<float>(0.0, (float)m_targetTexture->GetHeight(), v2);
-
-				m_scanLineTexBuffer[index].y = y;
-				m_scanLineTexBuffer[index].xStart = x1;
-				m_scanLineTexBuffer[index].xEnd = x2;
+				this->m_scanLineTexBuffer[index].y = y;
+				this->m_scanLineTexBuffer[index].xStart = x1;
+				this->m_scanLineTexBuffer[index].xEnd = x2;
 
 				spanXInv = 1.0f /  fabs(x1 - x2);
 					
-				m_scanLineTexBuffer[index].uStart = u1;
-				m_scanLineTexBuffer[index].uSlope = (u2 - u1) * spanXInv;
-				m_scanLineTexBuffer[index].vStart = v1;
-				m_scanLineTexBuffer[index].vSlope = (v2 - v1) * spanXInv;
+				this->m_scanLineTexBuffer[index].uStart = u1;
+				this->m_scanLineTexBuffer[index].uSlope = (u2 - u1) * spanXInv;
+				this->m_scanLineTexBuffer[index].vStart = v1;
+				this->m_scanLineTexBuffer[index].vSlope = (v2 - v1) * spanXInv;
+
 
 				// Update the slopes.
 				x1 += xSlopeLeft;
@@ -1388,14 +2524,14 @@ namespace SWR
 				u2 += uSlopeRight;
 				v1 += vSlopeLeft;
 				v2 += vSlopeRight;
-
 				index++;
-
 			}
 		}
+
+		return index;
 	}
 
-	void Rasterizer::GenerateMinorEdgeListTex(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB)
+	int Rasterizer::GenerateMinorEdgeListTex(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB)
 	{
 		// Slope values for screen pixels
 		float x1, x2;
@@ -1411,31 +2547,35 @@ namespace SWR
 		float v1, v2;
 		float uSlopeLeft, vSlopeLeft;
 		float uSlopeRight, vSlopeRight;
-		bool hasSwaped = false;
 
 		// Calculate our values for the scan line interpolation.
-		xSlopeLeft = (verts[BOTTOM].x - verts[TOP].x) * invDeltaYTB;
-		xSlopeRight = (verts[MIDDLE].x - verts[TOP].x) * invDeltaYTM;
+		xSlopeLeft = (verts[MIDDLE].x - verts[TOP].x) * invDeltaYTM;
+		xSlopeRight = (verts[BOTTOM].x - verts[TOP].x) * invDeltaYTB;
 		x1 = verts[TOP].x;
 		x2 = verts[TOP].x;
 		yStart = ceil(verts[TOP].y);
 		yEnd = ceil(verts[MIDDLE].y) - 1;
 
+		// Set up the colour interpolation values.
 		u1 = verts[TOP].u;
 		u2 = verts[TOP].u;
 		v1 = verts[TOP].v;
 		v2 = verts[TOP].v;
 
-		uSlopeLeft = (verts[BOTTOM].u- verts[TOP].u) * invDeltaYTB;
-		uSlopeRight = (verts[MIDDLE].u - verts[TOP].u) * invDeltaYTM;
-		vSlopeLeft = (verts[BOTTOM].v - verts[TOP].v) * invDeltaYTB;
-		vSlopeRight = (verts[MIDDLE].v - verts[TOP].v) * invDeltaYTM;
-
+		uSlopeLeft = (verts[MIDDLE].u - verts[TOP].u) * invDeltaYTM;
+		uSlopeRight = (verts[BOTTOM].u - verts[TOP].u) * invDeltaYTB;
+		vSlopeLeft = (verts[MIDDLE].v - verts[TOP].v) * invDeltaYTM;
+		vSlopeRight = (verts[BOTTOM].v - verts[TOP].v) * invDeltaYTB;
+		
+		// If our right slope is less than our left slope then we are going to get an incomplete triangle.
+		// Swap the values to fix this.
+		bool hasSwaped = false;
 		if (xSlopeRight < xSlopeLeft)
 		{
+			// Swap x axis interpolation.
 			Swap<float>(x2,x1);
 			Swap<float>(xSlopeLeft,xSlopeRight);
-				
+
 			// Swap texel interpolation.
 			Swap<float>(u1, u2);
 			Swap<float>(uSlopeLeft, uSlopeRight);
@@ -1446,29 +2586,25 @@ namespace SWR
 			hasSwaped = true;
 		}
 
-		int index = 0;
+		int index = 0; 
+
 
 		// Draw the upper triangle section.
 		if (invDeltaYTM > EPSILON)
 		{
+			// Run down from the top to the middle of the triangle.
 			for (int y = yStart; y <= yEnd; y++)
 			{
-				// Clamp the UVs
-				u1 = Clamp<float>(0.0, (float)m_targetTexture->GetWidth(), u1);
-				u2 = Clamp<float>(0.0, (float)m_targetTexture->GetWidth(), u2);
-				v1 = Clamp<float>(0.0, (float)m_targetTexture->GetHeight(), v1);
-				v2 = Clamp<float>(0.0, (float)m_targetTexture->GetHeight(), v2);
-
-				this->m_scanLineTexBuffer[index].y = y;
-				this->m_scanLineTexBuffer[index].xStart = x1;
-				this->m_scanLineTexBuffer[index].xEnd = x2;
+				m_scanLineTexBuffer[index].y = y;
+				m_scanLineTexBuffer[index].xStart = x1;
+				m_scanLineTexBuffer[index].xEnd = x2;
 
 				spanXInv = 1.0f /  fabs(x1 - x2);
 					
-				this->m_scanLineTexBuffer[index].uStart = u1;
-				this->m_scanLineTexBuffer[index].uSlope = (u2 - u1) * spanXInv;
-				this->m_scanLineTexBuffer[index].vStart = v1;
-				this->m_scanLineTexBuffer[index].vSlope = (v2 - v1) * spanXInv;
+				m_scanLineTexBuffer[index].uStart = u1;
+				m_scanLineTexBuffer[index].uSlope = (u2 - u1) * spanXInv;
+				m_scanLineTexBuffer[index].vStart = v1;
+				m_scanLineTexBuffer[index].vSlope = (v2 - v1) * spanXInv;
 
 				// Update the slopes.
 				x1 += xSlopeLeft;
@@ -1477,10 +2613,11 @@ namespace SWR
 				u2 += uSlopeRight;
 				v1 += vSlopeLeft;
 				v2 += vSlopeRight;
+
 				index++;
 			}
 		}
-
+			
 		// Swap back if we swapped.
 		if (hasSwaped)
 		{
@@ -1496,19 +2633,18 @@ namespace SWR
 		}
 
 		// Setup the new slope values for the lower left edge.
-		xSlopeRight = (verts[BOTTOM].x - verts[MIDDLE].x) * invDeltaYMB;
-		x2 = verts[MIDDLE].x;
+		xSlopeLeft = (verts[BOTTOM].x - verts[MIDDLE].x) * invDeltaYMB;
+		x1 = verts[MIDDLE].x;
 		yStart = ceil(verts[MIDDLE].y);
 		yEnd = ceil(verts[BOTTOM].y) - 1;
-			
-		u2 = verts[MIDDLE].u;
-		v2 = verts[MIDDLE].v;
 
-		// Calculate the new colour interpolations.
-		uSlopeRight = (verts[BOTTOM].u - verts[MIDDLE].u) * invDeltaYMB;
-		vSlopeRight = (verts[BOTTOM].v - verts[MIDDLE].v) * invDeltaYMB;
+		u1 = verts[MIDDLE].u;
+		v1 = verts[MIDDLE].v;
 
-			
+		// Calculate the new colour interpolations.
+		uSlopeLeft = (verts[BOTTOM].u - verts[MIDDLE].u) * invDeltaYMB;
+		vSlopeLeft = (verts[BOTTOM].v - verts[MIDDLE].v) * invDeltaYMB;
+		
 		if (x2 < x1)
 		{
 			Swap<float>(x2, x1);
@@ -1521,29 +2657,23 @@ namespace SWR
 			Swap<float>(v1, v2);
 			Swap<float>(vSlopeLeft, vSlopeRight);
 		}
-	
+
+
 		if (invDeltaYMB > EPSILON)
 		{				
 			// Run down from the middle to the bottom of the triangle.
 			for (int y = yStart; y <= yEnd; y++)
 			{
-				// Clamp the UVs
-				u1 = Clamp<float>(0.0, (float)m_targetTexture->GetWidth(), u1);
-				u2 = Clamp<float>(0.0, (float)m_targetTexture->GetWidth(), u2);
-				v1 = Clamp<float>(0.0, (float)m_targetTexture->GetHeight(), v1);
-				v2 = Clamp<float>(0.0, (float)m_targetTexture->GetHeight(), v2);
-
-				this->m_scanLineTexBuffer[index].y = y;
-				this->m_scanLineTexBuffer[index].xStart = x1;
-				this->m_scanLineTexBuffer[index].xEnd = x2;
+				m_scanLineTexBuffer[index].y = y;
+				m_scanLineTexBuffer[index].xStart = x1;
+				m_scanLineTexBuffer[index].xEnd = x2;
 
 				spanXInv = 1.0f /  fabs(x1 - x2);
 					
-				this->m_scanLineTexBuffer[index].uStart = u1;
-				this->m_scanLineTexBuffer[index].uSlope = (u2 - u1) * spanXInv;
-				this->m_scanLineTexBuffer[index].vStart = v1;
-				this->m_scanLineTexBuffer[index].vSlope = (v2 - v1) * spanXInv;
-
+				m_scanLineTexBuffer[index].uStart = u1;
+				m_scanLineTexBuffer[index].uSlope = (u2 - u1) * spanXInv;
+				m_scanLineTexBuffer[index].vStart = v1;
+				m_scanLineTexBuffer[index].vSlope = (v2 - v1) * spanXInv;
 
 				// Update the slopes.
 				x1 += xSlopeLeft;
@@ -1552,9 +2682,13 @@ namespace SWR
 				u2 += uSlopeRight;
 				v1 += vSlopeLeft;
 				v2 += vSlopeRight;
+
 				index++;
+
 			}
 		}
+
+		return index;
 	}
 
 	
@@ -1563,18 +2697,130 @@ namespace SWR
 
 	void Rasterizer::BatchRasterizeEdgeListCol(int edges)
 	{
-		for (int i = 0; i < edges; i++)
+		if (!m_batchingSpans)
 		{
-			ScanLineCol(&m_scanLineColBuffer[i]);
+			SWR_PROFILE_SCOPE("SpanFill");
+			for (int i = 0; i < edges; i++)
+			{
+				ScanLineCol(&m_scanLineColBuffer[i]);
+			}
+			return;
 		}
+
+		// The edge list was generated at the end of the batch.
+		m_batchTotalSpans += edges;
 	}
 
 	void Rasterizer::BatchRasterizeEdgeListTex(int edges)
 	{
-		for (int i = 0; i < edges; i++)
+		if (!m_batchingSpans)
+		{
+			SWR_PROFILE_SCOPE("SpanFill");
+			for (int i = 0; i < edges; i++)
+			{
+				ScanLineTexAffine(&m_scanLineTexBuffer[i]);
+			}
+			return;
+		}
+
+		// The level is kept with each scan-line, as the triangles in the batch can pick different ones.
+		memset(m_batchTexLevels + m_batchTotalSpans, (U8)m_texLevelIndex, edges);
+		m_batchTotalSpans += edges;
+	}
+
+	void* Rasterizer::GetEdgeListTarget(SpanBatchType type)
+	{
+		if (!m_batchingSpans)
+			return m_scanLineBuffer;
+
+		// Past SPAN_BATCH_SIZE there is only room left for one more edge list.
+		if (m_batchType != type || m_batchTotalSpans >= SPAN_BATCH_SIZE)
+		{
+			FlushSpanBatch();
+			m_batchType = type;
+		}
+
+		if (type == SPANBATCH_Col)
+			return m_batchColSpans + m_batchTotalSpans;
+
+		return m_batchTexSpans + m_batchTotalSpans;
+	}
+
+	void Rasterizer::FlushSpanBatch()
+	{
+		U32 totalSpans = m_batchTotalSpans;
+		if (m_batchType == SPANBATCH_None || totalSpans == 0)
 		{
-			ScanLineTexAffine(&m_scanLineTexBuffer[i]);
+			m_batchType = SPANBATCH_None;
+			return;
+		}
+
+		SWR_PROFILE_SCOPE("SpanFill");
+
+		// Bucket the spans by row with a counting sort. It is stable, so the spans of each row
+		// keep the order they were drawn in, and overlapping ones cover each other as before.
+		// rowStarts holds where each row's spans start in the order they are filled in. Spans
+		// below the buffer are left out.
+		U32* rowStarts = m_batchRowStarts;
+		memset(rowStarts, 0, (m_bufferHeight + 1) * sizeof(U32));
+		for (U32 i = 0; i < totalSpans; i++)
+		{
+			U32 y = m_batchType == SPANBATCH_Col ? m_batchColSpans[i].y : m_batchTexSpans[i].y;
+			if (y < m_bufferHeight)
+			{
+				rowStarts[y + 1]++;
+			}
+		}
+
+		for (U32 y = 0; y < m_bufferHeight; y++)
+		{
+			rowStarts[y + 1] += rowStarts[y];
+		}
+
+		U32 totalFilled = rowStarts[m_bufferHeight];
+		U32* order = m_batchOrder;
+		for (U32 i = 0; i < totalSpans; i++)
+		{
+			U32 y = m_batchType == SPANBATCH_Col ? m_batchColSpans[i].y : m_batchTexSpans[i].y;
+			if (y < m_bufferHeight)
+			{
+				order[rowStarts[y]++] = i;
+			}
+		}
+
+		if (m_batchType == SPANBATCH_Col)
+		{
+			for (U32 i = 0; i < totalFilled; i++)
+			{
+				ScanLineCol(&m_batchColSpans[order[i]]);
+			}
+		}
+		else
+		{
+			// Only set the level up again when it changes between spans, and put back the one
+			// the triangle being drawn picked afterwards.
+			U32 triangleLevel = m_texLevelIndex;
+			U32 level = triangleLevel;
+			for (U32 i = 0; i < totalFilled; i++)
+			{
+				U32 span = order[i];
+				if (m_batchTexLevels[span] != level)
+				{
+					level = m_batchTexLevels[span];
+					SetTextureLevel(level);
+				}
+
+				ScanLineTexAffine(&m_batchTexSpans[span]);
+			}
+
+			if (level != triangleLevel)
+			{
+				SetTextureLevel(triangleLevel);
+			}
 		}
+
+		m_batchTotalSpans = 0;
+		m_batchType = SPANBATCH_None;
 	}
 
 	// -------------------------------------------------------------------------------------
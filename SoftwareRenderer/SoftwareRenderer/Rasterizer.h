@@ -18,18 +18,44 @@
 
 #include "Vertex.h"
 #include "Colour.h"
+#include "Matrix4.h"
+#include "RenderStats.h"
+#include "Texture.h"
 
 // Forward Declarations
 namespace SWR
 {
 	class BackBuffer;
 	class ZDepthBuffer;
+	class RenderTarget;
 	class Colour32;
-	class Texture;
+	struct PixelLight;
+	class TiledLightList;
+	class GBuffer;
 };
 
+// The width and height in pixels of the screen tiles the rasterizer splits the back-buffer into.
+// Lit spans are split at tile boundaries, so a multiple of 4 keeps their 4 pixel blocks whole.
+#ifndef RASTER_TILE_SIZE
+#define RASTER_TILE_SIZE 32
+#endif
+
 namespace SWR
 {
+	// ------------------------------------------------------------------------
+	//								TileGrid
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Describes how the back-buffer is split into screen tiles. Per tile data
+	// such as light lists is stored row major, tilesX * tilesY entries.
+	// ------------------------------------------------------------------------
+	struct TileGrid
+	{
+		U32 tileSize;
+		U32 tilesX;
+		U32 tilesY;
+	};
+
 	struct ScanlineDataCol
 	{
 		U32 y;					   // The Y position for the scan line in the back buffer.
@@ -55,6 +81,141 @@ namespace SWR
 		ScanlineDataTex(){}
 	};
 
+	// ------------------------------------------------------------------------
+	//								TexLightAttribute
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The attributes interpolated across a lit textured triangle. The UVs
+	// are in texels of the sampled level. For perspective correct texturing
+	// they are multiplied by InvW, otherwise InvW is 1. The colour is the lit
+	// vertex colour, 0 to 255, and always interpolates affinely.
+	// ------------------------------------------------------------------------
+	enum TexLightAttribute
+	{
+		TEXLIGHT_InvW,			   // 1 / camera space z.
+		TEXLIGHT_U,
+		TEXLIGHT_V,
+		TEXLIGHT_Red,
+		TEXLIGHT_Green,
+		TEXLIGHT_Blue,
+
+		TEXLIGHT_Total,
+	};
+
+	struct TexLightVertex
+	{
+		Real x, y;				   // The screen position.
+		Real attr[TEXLIGHT_Total];
+	};
+
+	struct ScanlineDataTexLight
+	{
+		U32 y;					   // The Y position for the scan line in the back buffer.
+		Real xStart, xEnd;		   // The start and end x positions for the scan-line.
+		Real start[TEXLIGHT_Total]; // The attribute values at the first pixel of the scan-line.
+		Real slope[TEXLIGHT_Total]; // The per pixel step of each attribute.
+	};
+
+	// How the textured spans find the texels of a level, for its TextureAddressMode, and how
+	// they filter them. Set up once a triangle.
+	struct TexelAddressing
+	{
+		TextureAddressMode mode;
+		TextureFilter filter;
+		bool pow2;							// Both sizes, and so the pitch, are powers of 2.
+		S32 width, height;
+		S32 widthMask, heightMask;			// The sizes - 1.
+		U32 widthShift, heightShift;		// Log 2 of the sizes, when they are powers of 2.
+		U32 pitchShift;						// Log 2 of the pitch in texels, when it is a power of 2.
+	};
+
+	// ------------------------------------------------------------------------
+	//								PhongAttribute
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The attributes interpolated across a triangle for per-pixel lighting.
+	// ------------------------------------------------------------------------
+	enum PhongAttribute
+	{
+		PHONG_InvW,				   // 1 / camera space z.
+		PHONG_PosX,				   // World space position.
+		PHONG_PosY,
+		PHONG_PosZ,
+		PHONG_NormalX,			   // World space normal.
+		PHONG_NormalY,
+		PHONG_NormalZ,
+		PHONG_Red,				   // Base colour.
+		PHONG_Green,
+		PHONG_Blue,
+
+		PHONG_Total,
+	};
+
+	// ------------------------------------------------------------------------
+	//								PhongVertex
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A screen space vertex for the per-pixel lit path. Every attribute other
+	// than InvW has been multiplied by InvW so that all of them interpolate
+	// linearly in screen space; the spans divide back out per pixel to get
+	// perspective correct positions and normals.
+	// ------------------------------------------------------------------------
+	struct PhongVertex
+	{
+		Real x, y;				   // The screen position.
+		Real attr[PHONG_Total];
+	};
+
+	struct ScanlineDataPhong
+	{
+		U32 y;					   // The Y position for the scan line in the back buffer.
+		Real xStart, xEnd;		   // The start and end x positions for the scan-line.
+		Real start[PHONG_Total];   // The attribute values at the first pixel of the scan-line.
+		Real slope[PHONG_Total];   // The per pixel step of each attribute.
+	};
+
+	// ------------------------------------------------------------------------
+	//								DeferredView
+	// ------------------------------------------------------------------------
+	// Desc:
+	// What the deferred lighting pass needs to rebuild a pixel's world 
+	// position from its linear depth; the projection and the camera's 
+	// camera to world transform.
+	// ------------------------------------------------------------------------
+	struct DeferredView
+	{
+		Real focalX, focalY;
+		Real halfWidth, halfHeight;
+		Matrix4 cameraToWorld;
+	};
+
+	// ------------------------------------------------------------------------
+	//								ShadowMapView
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A shadow map rendered from a light's point of view, and the projection
+	// it was rendered with so the lighting can find a pixel's depth in it.
+	// Depths are stored like the ZDepthBuffer; the projected z * 32767.
+	// ------------------------------------------------------------------------
+	struct ShadowMapView
+	{
+		const S16* depth;
+		U32 width, height;
+		U32 pitch; // In entries.
+
+		// The ID of the light in the lighting manager the map was rendered for.
+		int lightID;
+
+		Matrix4 worldToLight;
+		Real focalX, focalY;
+		Real halfWidth, halfHeight;
+		Real nearPlane, q;
+
+		// Subtracted from the depth of the pixel being lit, in depth buffer units, to stop
+		// surfaces from shadowing themselves.
+		Real bias;
+	};
+
 	// ------------------------------------------------------------------------
 	//								TriangleEdgeType
 	// ------------------------------------------------------------------------
@@ -89,14 +250,45 @@ namespace SWR
 		U8* m_targetBackBuffer;
 		U32 m_bufferWidth;
 		U32 m_bufferHeight;
+		U32 m_bufferPitch; // In pixels.
 		ZDepthBuffer* m_targetZBuffer;
+		TileGrid m_tileGrid;
 
 		Real m_near, m_far;
 		Texture* m_targetTexture;
 		bool m_useZTest;
 
+		// If the lit textured triangles are perspective corrected; their 1/w is found from the
+		// projected depth, which is why the clip planes are kept.
+		bool m_perspectiveTextures;
+
+		// The level of the target texture the current triangle samples, its index in the mip chain,
+		// and how it is addressed.
+		TextureLevel m_texLevel;
+		TexelAddressing m_texAddressing;
+		U32 m_texLevelIndex;
+
+		void SetTextureLevel(U32 level);
+
+		// Picks the mip level whose texels are closest to a pixel each across the triangle, from
+		// its screen positions and its UVs before they are scaled to the texture.
+		void SelectTextureLevel(const Vertex* verts);
+
+		// The counters the spans add to. Counts into m_ownStats when none have been set.
+		RenderStats* m_stats;
+		RenderStats m_ownStats;
+
+		// The debug view's per pixel draw counts and per tile nanoseconds; NULL when not gathered.
+		U16* m_overdrawCounts;
+		U64* m_tileCosts;
+
+		// Adds a drawn span to the debug view counters. The start time is only used for tile costs.
+		void AddDebugSpan(U32 y, int xStart, int xEnd, U64 startTime);
+
 		// THe base scan line buffer. This will always be the size of the largest scanline type * screen height.
+		// Only grows, so targets no taller than the largest seen so far reuse it.
 		void* m_scanLineBuffer;
+		U32 m_scanLineBufferHeight;
 
 		// The cast pointer of m_scanLineBuffer. Used to share with the texture buffer.
 		ScanlineDataCol* m_scanLineColBuffer;
@@ -119,21 +311,90 @@ namespace SWR
 		// Textured line plotting and scan-line plotting
 		// *********************************************************************************
 		void ScanLineTexAffine(ScanlineDataTex* scanline);
-		void ScanLineTexPerspective(ScanlineDataTex* scanline);
+
+		// Textures the span in runs of pixels, with the UVs divided by 1/w at the ends of each run
+		// when they are perspective correct. Lit spans modulate the texels by the interpolated
+		// colour and follow the texture mapping type; unlit ones are always perspective correct.
+		template <bool Lit>
+		void ScanLineTexRuns(ScanlineDataTexLight* scanline);
+
+		// Sets up the gradient vertices of a textured triangle; UVs in texels of the selected level,
+		// multiplied by 1/w when perspective texturing is on.
+		void SetupTexLightVertices(const Vertex* vertices, TexLightVertex* verts);
+
+		// *********************************************************************************
+		// Per-pixel lit scan-line plotting
+		// *********************************************************************************
+		const PixelLight* m_pixelLights;
+		int m_totalPixelLights;
+		const TiledLightList* m_lightTiles;
+
+		void ScanLinePhong(ScanlineDataPhong* scanline);
+
+		// The shadow map sampled by the per-pixel lighting, NULL when there is none.
+		const ShadowMapView* m_shadowMap;
+
+		// The G-buffer the deferred geometry pass writes to, and the material it writes.
+		GBuffer* m_targetGBuffer;
+		U8 m_gbufferMaterial;
+
+		void ScanLineGBuffer(ScanlineDataPhong* scanline);
+
+		// Steps the attributes of the screen space vertices across the triangle with constant
+		// gradients, handing each scan-line to the span function. For the Phong and the lit
+		// textured vertices and their scan-lines.
+		template <class GradientVertex, class Scanline>
+		void RasterizeTriGradient(const GradientVertex* tri, void (Rasterizer::*spanFunc)(Scanline* scanline));
 
 		// Helper function to sort the triangle by Y.
 		void SortByY(Vertex* target, Vertex* source);
 
-		// Helper functions for building the edge lists for major and minor triangles.
-		void GenerateMajorEdgeListCol(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB);
-		void GenerateMinorEdgeListCol(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB);
-		void GenerateMajorEdgeListTex(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB);
-		void GenerateMinorEdgeListTex(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB);
-
-		// Batch render functionality.
+		// Helper functions for building the edge lists for major and minor triangles. Each returns
+		// the scan-lines it wrote.
+		// GenerateEdgeListCol sorts the triangle and builds the colour one for its type.
+		int GenerateEdgeListCol(Vertex* tri);
+		int GenerateMajorEdgeListCol(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB);
+		int GenerateMinorEdgeListCol(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB);
+		int GenerateMajorEdgeListTex(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB);
+		int GenerateMinorEdgeListTex(Vertex* verts, float invDeltaYTB, float invDeltaYTM, float invDeltaYMB);
+
+		// Batch render functionality. Fills the edge list's scan-lines, or adds them to the span
+		// batch if one is open.
 		void BatchRasterizeEdgeListCol(int edges);
 		void BatchRasterizeEdgeListTex(int edges);
 
+		enum SpanBatchType
+		{
+			SPANBATCH_None,
+			SPANBATCH_Col,
+			SPANBATCH_Tex,
+		};
+
+		// The span batch; the scan-lines of the edge list triangles since the batch was last
+		// filled, in the order they were drawn. The edge lists are generated straight into its end.
+		// Once it holds SPAN_BATCH_SIZE spans it is filled before the next triangle, so a batch
+		// stays small enough for the cache. A batch only holds one type of scan-line, and the
+		// textured ones keep the mip level their triangle picked. It grows with the scan-line
+		// buffer, with room past SPAN_BATCH_SIZE for the largest edge list, along with the row
+		// buckets it is filled from.
+		enum { SPAN_BATCH_SIZE = 1024 };
+		bool m_batchingSpans;
+		SpanBatchType m_batchType;
+		char* m_batchBuffer;
+		ScanlineDataCol* m_batchColSpans;
+		ScanlineDataTex* m_batchTexSpans;
+		U8* m_batchTexLevels;
+		U32* m_batchOrder;
+		U32* m_batchRowStarts;
+		U32 m_batchTotalSpans;
+
+		// Where the next edge list of the type is generated. Batching, that is the end of the batch,
+		// which is filled first if it is full or holds the other type; otherwise the scan-line buffer.
+		void* GetEdgeListTarget(SpanBatchType type);
+
+		// Fills the batched spans a row at a time, and empties the batch.
+		void FlushSpanBatch();
+
 		enum VertexLocation
 		{
 			TOP,
@@ -146,7 +407,9 @@ namespace SWR
 		Rasterizer();
 		~Rasterizer();
 
-		void SetTargetBuffers(U8* backBuffer, ZDepthBuffer* zBuffer, U32 width, U32 height);
+		// Sets the buffers drawn to. The pitch is the bytes between the start of each row.
+		void SetTargetBuffers(U8* backBuffer, ZDepthBuffer* zBuffer, U32 width, U32 height, U32 pitch);
+		void SetRenderTarget(RenderTarget* target);
 		void Release();
 		void Reset();
 
@@ -155,6 +418,37 @@ namespace SWR
 
 		void SetTargetTexture(Texture* texture);
 
+		// Sets if the lit textured triangles are perspective corrected, and the clip planes their
+		// vertices were projected with.
+		void SetPerspectiveTexturing(bool enable, Real nearPlane, Real farPlane);
+
+		// Sets the counters the triangles drawn from the calling thread add to; NULL counts into
+		// the rasterizer's own. The deferred resolve is handed the counters of its worker instead.
+		void SetStats(RenderStats* stats);
+
+		// Sets the buffers the spans count their cost into for the debug views; one counter per
+		// pixel of the target, and the nanoseconds spent per tile of the tile grid. Either may be
+		// NULL, which is the default, to not gather it.
+		void SetDebugCounters(U16* overdrawCounts, U64* tileCosts);
+
+		// Nanoseconds on a steady clock, for timing the debug views.
+		static U64 DebugClock();
+
+		// Sets the lights evaluated by the per-pixel lit triangles. The array must outlive the draw.
+		// When light tiles are set only the lights listed for a pixel's tile are evaluated.
+		void SetPixelLights(const PixelLight* lights, int totalLights);
+		void SetLightTiles(const TiledLightList* tiles);
+
+		const TileGrid& GetTileGrid() const;
+
+		// Sets the shadow map used by the per-pixel lighting; NULL disables shadows.
+		void SetShadowMap(const ShadowMapView* shadowMap);
+		const ShadowMapView* GetShadowMap() const;
+
+		void SetTargetGBuffer(GBuffer* gbuffer);
+		void SetGBufferMaterial(U8 material);
+		U8 GetGBufferMaterial() const;
+
 		// Renders a single line.
 		void PlotLineCol(U32 x1, U32 x2, U32 y1, U32 y2, S16 z1, S16 z2, const Colour32 &c1, const Colour32 &c2);
 
@@ -164,15 +458,49 @@ namespace SWR
 		// Renders the triangle with only colours and applies gourad shading.
 		void RasterizeTriSolid(Vertex* tri);
 
-		// Renders the triangle with texture mapping.
+		// Renders the gourad shaded triangle through the edge list buffer.
+		void RasterizeTriSolid_EdgeList(Vertex* tri);
+
+		// Renders the triangle with texture mapping. With perspective texturing on, it goes through
+		// RasterizeTriTexPerspective.
 		void RasterizeTriTex(Vertex* tri);
 
+		// Renders the triangle with perspective correct texture mapping; stepped with gradients like
+		// the lit textured triangle, without the colour.
+		void RasterizeTriTexPerspective(Vertex* vertices);
+
 		// Renders the textured triangle through the edge list buffer. This is cleaner, but slower than the
 		// straight rasterize function.
 		void RasterizeTriTex_EdgeList(Vertex* tri);
 
-		// Renders the triangle with texture mapping and applies lighting through the gourad shading.
+		// Between these the edge list triangles only generate their spans, and each batch of them
+		// is filled a row at a time, so each row of the back buffer, and the texture rows it
+		// samples, stay in the cache across many small triangles. Within a row the spans are
+		// filled in the order they were drawn, so the result is the same as without.
+		// The target texture and buffers must not change until the batch ends.
+		void BeginSpanBatch();
+		void EndSpanBatch();
+
+		// Renders the triangle with texture mapping and applies lighting through the gourad shading;
+		// each texel is modulated by the interpolated vertex colour.
 		void RasterizeTriTexLight(Vertex* vertices);
+
+		// Renders the triangle with per-pixel lighting, interpolating the world position and normal 
+		// and evaluating the lights 4 pixels at a time.
+		void RasterizeTriPhong(PhongVertex* tri);
+
+		// Renders only the depth of the screen space triangle into the depth buffer, keeping the
+		// closest. The triangle may be larger than the buffer; it is clamped to it.
+		void RasterizeTriDepth(const Vertex* tri, ZDepthBuffer* target);
+
+		// Renders the triangle's depth, normal, albedo and material into the G-buffer, keeping 
+		// the nearest surface per pixel.
+		void RasterizeTriGBuffer(PhongVertex* tri);
+
+		// Runs the deferred lighting over one screen tile, writing the lit G-buffer pixels to the
+		// back-buffer. Tiles do not share any state so may be resolved in parallel, each thread
+		// counting into its own stats.
+		void ResolveGBufferTile(U32 tileX, U32 tileY, const DeferredView &view, RenderStats &stats);
 	};
 	
 }; // End namespace SWR.
@@ -9,7 +9,8 @@
 //**
 //****************************************************************************
 
-#include <Windows.h>
+#include <cstdio>
+#include <cstring>
 #include <assert.h>
 #include <iostream>
 
@@ -18,6 +19,12 @@
 #include "Rasterizer.h"
 #include "TriangleClipper2D.h"
 #include "LightingManager.h"
+#include "LitVertexCache.h"
+#include "TiledLightList.h"
+#include "RenderThreadManager.h"
+#include "GBuffer.h"
+#include "RenderTarget.h"
+#include "FrameCapture.h"
 
 #include "BackBuffer.h"
 #include "ZDepthBuffer.h"
@@ -31,59 +38,109 @@
 #include "Vector3.h"
 #include "SWR_Math.h"
 #include "Rectangle.h"
+#include "Profiler.h"
+#include "FrameArena.h"
 
 #include "Logger.h"
 #include "MemoryLeak.h"
 
 namespace SWR
 {
+	// The starting size of the frame arena. It grows to fit the frame if it has to.
+	static const U32 FRAME_ARENA_SIZE = 64 * 1024;
+
 	RenderDevice::RenderDevice()
-		: winDevContext(NULL)
-		, m_backBuffer(NULL)
+		: m_backBuffer(NULL)
 		, m_zBuffer(NULL)
+		, m_backBufferTarget(NULL)
+		, m_renderTarget(NULL)
 		, m_rasterizer(NULL)
+		, m_lightManager(NULL)
+		, m_litCache(NULL)
+		, m_instanceID(0)
+		, m_pixelLights(NULL)
+		, m_lightBounds(NULL)
+		, m_totalPixelLights(0)
+		, m_lightTiles(NULL)
+		, m_lightTilesDirty(true)
+		, m_lightTilesRevision(0)
+		, m_threadManager(NULL)
+		, m_pipeline(PIPELINE_Forward)
+		, m_gBuffer(NULL)
+		, m_gBufferPending(false)
+		, m_shadowBuffer(NULL)
+		, m_shadowView(NULL)
+		, m_shadowMapSize(512)
+		, m_shadowBias(16.0f)
+		, m_inShadowPass(false)
+		, m_triClipper(NULL)
 		, m_texMapType(TEX_MAP_Affine)
-		, m_fov(45.0f)
+		, m_sourceTexture(NULL)
 		, m_vertexSource(NULL)
 		, m_indexSource(NULL)
+		, m_frameArena(NULL)
 		, m_triangle(NULL)
+		, m_clippedVerts(NULL)
+		, m_phongVerts(NULL)
+		, m_cullingEnabled(false)
+		, m_spanBatchingEnabled(false)
 		, m_nearPlane(1.0f)
 		, m_farPlane(1000.0f)
-		, m_cullingEnabled(false)
-		, m_clippedVerts(NULL)
-		, m_triClipper(NULL)
-		, m_lightManager(NULL)
+		, m_fov(45.0f)
+		, m_threadStats(NULL)
+		, m_totalStatsSlots(0)
+		, m_stats(NULL)
+		, m_debugView(DEBUGVIEW_None)
+		, m_debugViewScale(0.0f)
+		, m_overdrawCounts(NULL)
+		, m_tileCosts(NULL)
+		, m_capture(NULL)
 	{
 		// Default initilises the renderer.
 		// All construction should be done through initilise method.
+#ifdef SWR_PLATFORM_WIN32
+		winDevContext = NULL;
+#endif
 	}
 
 	RenderDevice::~RenderDevice()
 	{
 		// All destruction should be done through the release method.
-		if (m_triangle != NULL)
-		{
-			delete [] m_triangle;
-			m_triangle = NULL;
+	}
+	
+	static bool ValidateBufferDimensions(const SWRInitParams &params)
+	{
+		if (params.bufferHeight < 1 || params.bufferWidth < 1)
+		{	
+			LOGF(LOG_Error, "Invalid back-buffer dimensions for render-device. W=%i H=%i", params.bufferWidth, params.bufferHeight);
+			return false;
 		}
 
-		if (m_clippedVerts != NULL)
+		return true;
+	}
+
+	SWR_ERR RenderDevice::Initilise(const SWRInitParams &params)
+	{
+		if (ValidateBufferDimensions(params) == false)
+			return SWR_FAIL;
+
+		// Create the back buffer we are drawing to, in memory rather than in a window.
+		this->m_backBuffer = new BackBuffer();
+		SWR_ERR result = m_backBuffer->CreateBuffer(params.bufferWidth, params.bufferHeight);
+		if (result != SWR_OK)
 		{
-			delete [] m_clippedVerts;
-			m_clippedVerts = NULL;
+			LOG("Back-buffer creation has failed.", LOG_Error);
+			return SWR_FAIL;
 		}
+
+		return CreateDevice(params);
 	}
-	
+
+#ifdef SWR_PLATFORM_WIN32
 	SWR_ERR RenderDevice::Initilise(const SWRInitParams &params, HWND hWnd)
 	{
-		// Validate back-buffer dimensions.
-		if (params.bufferHeight < 1 || params.bufferWidth < 1)
-		{	
-			char buffer[256] = {0};
-			sprintf(buffer, "Invalid back-buffer dimensions for render-device. W=%i H=%i", params.bufferWidth, params.bufferHeight);
-			LOG(buffer, LOG_Error);
+		if (ValidateBufferDimensions(params) == false)
 			return SWR_FAIL;
-		}
 
 		// Create the device context for the window.
 		winDevContext = GetDC(hWnd);
@@ -102,20 +159,55 @@ namespace SWR
 			return SWR_FAIL;
 		}
 
+		return CreateDevice(params);
+	}
+#endif
+
+	SWR_ERR RenderDevice::CreateDevice(const SWRInitParams &params)
+	{
 		this->m_zBuffer = new ZDepthBuffer();
 		m_zBuffer->Initilise(params.bufferWidth, params.bufferHeight);
 
-		m_lightManager = new LightingManager(5);
+		this->m_backBufferTarget = new RenderTarget();
+		m_backBufferTarget->Initilise(m_backBuffer->GetByteBuffer(), params.bufferWidth, params.bufferHeight, m_backBuffer->GetPitch(), m_zBuffer);
+		m_renderTarget = m_backBufferTarget;
+
+		int maxSceneLights = params.maxSceneLights > 0 ? params.maxSceneLights : 5;
+		m_lightManager = new LightingManager(maxSceneLights);
+		m_litCache = new LitVertexCache();
+
+		// The calling thread's profiler ring; the workers make theirs as they start.
+		SWR_PROFILE_THREAD();
+		m_threadManager = new RenderThreadManager();
+		m_threadManager->Initilise(params.totalRenderThreads);
+
+		m_totalStatsSlots = m_threadManager->GetTotalThreads();
+		m_threadStats = new RenderStatsSlot[m_totalStatsSlots];
+		m_stats = &m_threadStats[0].stats;
+		m_litCache->SetStats(m_stats);
+
+		m_frameArena = new FrameArena();
+		m_frameArena->Initilise(FRAME_ARENA_SIZE);
 
 		m_triangle = new Vertex[3];
-		m_clippedVerts  = new Vertex[9];
+		m_clippedVerts = new Vertex[9];
+		m_phongVerts = new PhongVertex[9];
+
+		m_shadowMapSize = params.shadowMapSize > 0 ? params.shadowMapSize : 512;
 
 		m_rasterizer = new Rasterizer();
-		m_rasterizer->SetTargetBuffers(m_backBuffer->GetByteBuffer(), m_zBuffer, params.bufferWidth, params.bufferHeight);
+		m_rasterizer->SetRenderTarget(m_renderTarget);
+		m_rasterizer->SetStats(m_stats);
+		m_rasterizer->SetPerspectiveTexturing(m_texMapType == TEX_MAP_Perspective, m_nearPlane, m_farPlane);
+
+		m_lightTiles = new TiledLightList();
+		m_lightTiles->Initilise(m_rasterizer->GetTileGrid(), maxSceneLights);
+		ResetFrameArena();
 		LOG("Render Device startup sucessful.", LOG_Init);
 
 		m_triClipper = new TriangleClipper2D();
 		m_triClipper->SetViewDimensions(params.bufferWidth, params.bufferHeight);
+		m_triClipper->SetStats(m_stats);
 
 		ResetStatsCounters();
 
@@ -127,7 +219,7 @@ namespace SWR
 		return SWR_OK;
 	}
 
-	SWR_ERR RenderDevice::Release(HWND hWnd)
+	SWR_ERR RenderDevice::Release()
 	{
 		if (m_backBuffer != NULL)
 		{
@@ -136,6 +228,14 @@ namespace SWR
 			m_backBuffer = NULL;
 		}
 
+		if (m_backBufferTarget != NULL)
+		{
+			delete m_backBufferTarget;
+			m_backBufferTarget = NULL;
+		}
+
+		m_renderTarget = NULL;
+
 		if (m_zBuffer != NULL)
 		{
 			m_zBuffer->Release();
@@ -149,12 +249,6 @@ namespace SWR
 			m_rasterizer = NULL;
 		}
 
-		if (m_triangle != NULL)
-		{
-			delete [] m_triangle;
-			m_triangle = NULL;
-		}
-
 		if (m_triClipper != NULL)
 		{
 			delete m_triClipper;
@@ -167,6 +261,106 @@ namespace SWR
 			m_lightManager = NULL;
 		}
 
+		if (m_litCache != NULL)
+		{
+			delete m_litCache;
+			m_litCache = NULL;
+		}
+
+		if (m_lightTiles != NULL)
+		{
+			delete m_lightTiles;
+			m_lightTiles = NULL;
+		}
+
+		if (m_gBuffer != NULL)
+		{
+			delete m_gBuffer;
+			m_gBuffer = NULL;
+		}
+
+		if (m_shadowBuffer != NULL)
+		{
+			delete m_shadowBuffer;
+			m_shadowBuffer = NULL;
+		}
+
+		if (m_shadowView != NULL)
+		{
+			delete m_shadowView;
+			m_shadowView = NULL;
+		}
+
+		if (m_threadManager != NULL)
+		{
+			m_threadManager->Release();
+			delete m_threadManager;
+			m_threadManager = NULL;
+		}
+
+		if (m_triangle != NULL)
+		{
+			delete [] m_triangle;
+			m_triangle = NULL;
+		}
+
+		if (m_clippedVerts != NULL)
+		{
+			delete [] m_clippedVerts;
+			m_clippedVerts = NULL;
+		}
+
+		if (m_phongVerts != NULL)
+		{
+			delete [] m_phongVerts;
+			m_phongVerts = NULL;
+		}
+
+		if (m_frameArena != NULL)
+		{
+			delete m_frameArena;
+			m_frameArena = NULL;
+			m_pixelLights = NULL;
+			m_lightBounds = NULL;
+		}
+
+		if (m_threadStats != NULL)
+		{
+			delete [] m_threadStats;
+			m_threadStats = NULL;
+			m_totalStatsSlots = 0;
+			m_stats = NULL;
+		}
+
+		if (m_overdrawCounts != NULL)
+		{
+			delete [] m_overdrawCounts;
+			m_overdrawCounts = NULL;
+		}
+
+		if (m_tileCosts != NULL)
+		{
+			delete [] m_tileCosts;
+			m_tileCosts = NULL;
+		}
+
+		m_debugView = DEBUGVIEW_None;
+
+		if (m_capture != NULL)
+		{
+			delete m_capture;
+			m_capture = NULL;
+		}
+
+		LOG("Render Device shutdown sucessful.", LOG_Shutdown);
+		return SWR_OK;
+	}
+
+#ifdef SWR_PLATFORM_WIN32
+	SWR_ERR RenderDevice::Release(HWND hWnd)
+	{
+		Release();
+
 		// Destroy the device context.
 		if(winDevContext)
 		{
@@ -174,59 +368,205 @@ namespace SWR
 			winDevContext = NULL;
 		}
 
-		LOG("Render Device shutdown sucessful.", LOG_Shutdown);
 		return SWR_OK;
 	}
+#endif
 
-	void RenderDevice::ClearBackBuffer(UINT32 value)
+	void RenderDevice::ClearBackBuffer(U32 value)
 	{
-		m_backBuffer->Clear(value);
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_ClearBackBuffer);
+			m_capture->WriteU32(value);
+		}
+
+		SWR_PROFILE_SCOPE("Clear");
+		m_renderTarget->Clear(value);
+
+		// A new frame; the lights may have changed since the last.
+		m_lightTilesDirty = true;
+
+		if (m_pipeline == PIPELINE_Deferred)
+		{
+			m_gBuffer->Clear();
+			m_gBufferPending = false;
+		}
 	}
 
 	void RenderDevice::ClearZBuffer()
 	{
-		m_zBuffer->Clear(ZDepthBuffer::MAX_Z_DEPTH);
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_ClearZBuffer);
+		}
+
+		SWR_PROFILE_SCOPE("Clear");
+		m_renderTarget->ClearDepth();
+	}
+
+	void RenderDevice::FinishFrame()
+	{
+		// The capture ends with the frame; the replay's Present does the rest of the work here.
+		if (IsCapturing())
+		{
+			m_capture->SyncLights(m_lightManager);
+			m_capture->WriteCommand(CAPTURE_Present);
+			m_capture->Close();
+			LOG("Frame capture written.", LOG_Standard);
+		}
+
+		if (m_gBufferPending)
+		{
+			ResolveGBuffer();
+		}
+
+		if (m_debugView != DEBUGVIEW_None)
+		{
+			ResolveDebugView();
+		}
+
+		m_litCache->EndFrame();
+		MergeStats();
+		ResetFrameArena();
+	}
+
+	void RenderDevice::MergeStats()
+	{
+		m_frameStats.Clear();
+		for (int i = 0; i < m_totalStatsSlots; i++)
+		{
+			m_frameStats.Add(m_threadStats[i].stats);
+			m_threadStats[i].stats.Clear();
+		}
+
+		m_frameStats.transientBytes = m_frameArena->GetUsed();
+
+		m_frameStats.targetPixels = (U64)m_backBuffer->GetWidth() * m_backBuffer->GetHeight();
+		m_totalStats.Add(m_frameStats);
+	}
+
+	void RenderDevice::ResetFrameArena()
+	{
+		m_frameArena->Reset();
+
+		// The lights and their tile lists went with the arena; the next per-pixel lit draw rebuilds them.
+		m_pixelLights = NULL;
+		m_lightBounds = NULL;
+		m_totalPixelLights = 0;
+		m_lightTiles->SetStorage(NULL);
+		m_lightTilesDirty = true;
+	}
+
+	const FrameArena& RenderDevice::GetFrameArena() const
+	{
+		return *m_frameArena;
+	}
+
+	U32 RenderDevice::GetBackBufferPitch() const
+	{
+		return m_backBuffer->GetPitch();
+	}
+
+	const U8* RenderDevice::Present()
+	{
+		FinishFrame();
+		SWR_PROFILE_FRAME();
+		SWR_ALLOC_FRAME();
+		return m_backBuffer->GetByteBuffer();
+	}
+
+	void RenderDevice::Present(U8* destination, U32 pitch)
+	{
+		FinishFrame();
+
+		{
+			SWR_PROFILE_SCOPE("Present");
+			const U8* source = m_backBuffer->GetByteBuffer();
+			U32 sourcePitch = m_backBuffer->GetPitch();
+			U32 rowBytes = m_backBuffer->GetWidth() * 4;
+			for (U32 y = 0; y < m_backBuffer->GetHeight(); y++)
+			{
+				memcpy(destination + y * pitch, source + y * sourcePitch, rowBytes);
+			}
+		}
+
+		SWR_PROFILE_FRAME();
+		SWR_ALLOC_FRAME();
 	}
 
+#ifdef SWR_PLATFORM_WIN32
 	void RenderDevice::Present(HWND hWnd)
 	{
+		FinishFrame();
+
 		// Blit the back-buffer onto the screen.	
 		assert(winDevContext != NULL);
 		assert(m_backBuffer->GetDeviceContext() != NULL);
 
-		RECT clRect;
-		GetClientRect(hWnd,&clRect);
-
-		// Blit to buffer to the window
-		if(BitBlt(winDevContext,
-				  clRect.left,
-				  clRect.top,
-				  (clRect.right - clRect.left) + 1, 
-				  (clRect.bottom - clRect.top) + 1,
-				  m_backBuffer->GetDeviceContext(),
-				  0,
-				  0,
-				  SRCCOPY) == FALSE)
-		{
-			LOG("BackBuffer presentation failed.", LOG_Warning);
-			return;
+		{
+			SWR_PROFILE_SCOPE("Present");
+
+			RECT clRect;
+			GetClientRect(hWnd,&clRect);
+
+			// Blit to buffer to the window
+			if(BitBlt(winDevContext,
+					  clRect.left,
+					  clRect.top,
+					  (clRect.right - clRect.left) + 1, 
+					  (clRect.bottom - clRect.top) + 1,
+					  m_backBuffer->GetDeviceContext(),
+					  0,
+					  0,
+					  SRCCOPY) == FALSE)
+			{
+				LOG("BackBuffer presentation failed.", LOG_Warning);
+			}
 		}
-	
-		return;
+
+		SWR_PROFILE_FRAME();
+		SWR_ALLOC_FRAME();
 	}
+#endif
 	
 	void RenderDevice::SetClipPlanes(float nearPlane, float farPlane)
 	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetClipPlanes);
+			m_capture->WriteReal(nearPlane);
+			m_capture->WriteReal(farPlane);
+		}
+
 		m_nearPlane = nearPlane;
 		m_farPlane = farPlane;
 		m_triClipper->SetViewPlanes(nearPlane, farPlane);
+		m_lightTilesDirty = true;
+		m_rasterizer->SetPerspectiveTexturing(m_texMapType == TEX_MAP_Perspective, m_nearPlane, m_farPlane);
 	}
 
 	void RenderDevice::SetFOV(Real FOV)
 	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetFOV);
+			m_capture->WriteReal(FOV);
+		}
+
 		m_fov = FOV;
 
-		CalculateFocal(m_backBuffer->GetWidth(), m_backBuffer->GetHeight(), FOV);
+		CalculateFocal(m_renderTarget->GetWidth(), m_renderTarget->GetHeight(), FOV);
+		m_lightTilesDirty = true;
+	}
+
+	Real RenderDevice::GetFocalX() const
+	{
+		return m_focalX;
+	}
+
+	Real RenderDevice::GetFocalY() const
+	{
+		return m_focalY;
 	}
 
 	void RenderDevice::CalculateFocal(float width, float height, float FOV)
@@ -244,9 +584,19 @@ namespace SWR
 
 	void RenderDevice::SetTextureMappingType(TextureMappingTypeSet type)
 	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetTextureMappingType);
+			m_capture->WriteU8((U8)type);
+		}
+
 		m_texMapType = type;
 
 		// Reconfigure the function pointers so that the correct drawing function will be called.
+		if (m_rasterizer != NULL)
+		{
+			m_rasterizer->SetPerspectiveTexturing(m_texMapType == TEX_MAP_Perspective, m_nearPlane, m_farPlane);
+		}
 	}
 	
 	LightingManager* RenderDevice::GetLightingManager()
@@ -256,6 +606,8 @@ namespace SWR
 
 	bool RenderDevice::IsBackfacingCC(Vertex* verts)
 	{
+		SWR_PROFILE_SCOPE("BackfaceCull");
+
 		if (m_cullingEnabled == false)
 			return false;
 
@@ -272,7 +624,7 @@ namespace SWR
 		normal.Normalise();
 		if (Vector3::DOT(normal, viewNormal) >= 0)
 		{
-			trisCulled++;
+			m_stats->trisCulled++;
 			return true;
 		}
 
@@ -281,6 +633,8 @@ namespace SWR
 
 	bool RenderDevice::IsBackfacingAC(Vertex* verts)
 	{
+		SWR_PROFILE_SCOPE("BackfaceCull");
+
 		if (m_cullingEnabled == false)
 			return false;
 
@@ -297,7 +651,7 @@ namespace SWR
 		normal.Normalise();
 		if (Vector3::DOT(normal, viewNormal) >= 0)
 		{
-			trisCulled++;
+			m_stats->trisCulled++;
 			return true;
 		}
 
@@ -306,22 +660,40 @@ namespace SWR
 
 	void RenderDevice::SetWorldTransform(const Matrix4& m)
 	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetWorldTransform);
+			m_capture->WriteMatrix(m);
+		}
+
 		m_world = m;
 		Inverse(m_world, m_worldInv);
 	}
 
 	void RenderDevice::SetCameraTransform(const Matrix4& m)
 	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetCameraTransform);
+			m_capture->WriteMatrix(m);
+		}
+
 		m_cameraMat = m;
 		// Extract the camera location.
 		m_camLocation.x = m.wX;
 		m_camLocation.y = m.wY;
 		m_camLocation.z = m.wZ;
 		Inverse(m_cameraMat, m_cameraMatInv);
+		m_lightTilesDirty = true;
 	}
 
 	void RenderDevice::CommitMatrixChanges()
 	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_CommitMatrixChanges);
+		}
+
 		// Build the transformation matrix that takes a point from world space into camera space.
 		m_transform = m_world * m_cameraMatInv;
 	}
@@ -329,6 +701,7 @@ namespace SWR
 	void RenderDevice::ToWorldCameraSpace(Vertex* vert)
 	{
 		static Vector3 point;
+		m_stats->vertsTransformed++;
 		
 		// Convert vertices to vectors.
 		vert->ToVec3(point);
@@ -337,6 +710,22 @@ namespace SWR
 		vert->FromVec3(Transform(m_transform, point));
 	}
 
+	void RenderDevice::TransformTri(Vertex* tri)
+	{
+		SWR_PROFILE_SCOPE("Transform");
+		ToWorldCameraSpace(&tri[0]);
+		ToWorldCameraSpace(&tri[1]);
+		ToWorldCameraSpace(&tri[2]);
+	}
+
+	void RenderDevice::ProjectTri(Vertex* tri)
+	{
+		SWR_PROFILE_SCOPE("Project");
+		Project(&tri[0]);
+		Project(&tri[1]);
+		Project(&tri[2]);
+	}
+
 	void RenderDevice::ToWorldSpace(Vertex* vert)
 	{
 		static Vector3 point;
@@ -357,6 +746,7 @@ namespace SWR
 	void RenderDevice::ToCameraSpace(Vertex* vert)
 	{
 		static Vector3 point;
+		m_stats->vertsTransformed++;
 		
 		// Convert vertices to vectors.
 		vert->ToVec3(point);
@@ -367,11 +757,26 @@ namespace SWR
 
 	void RenderDevice::SetPixelColour(U16 x, U16 y, U32 colour)
 	{
-		m_backBuffer->PlotPixel(x,y, colour);
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetPixelColour);
+			m_capture->WriteU16(x);
+			m_capture->WriteU16(y);
+			m_capture->WriteU32(colour);
+		}
+
+		U32* row = (U32*)(m_renderTarget->GetColour() + y * m_renderTarget->GetPitch());
+		row[x] = colour;
 	}
 
 	void RenderDevice::EnableBackfaceCulling(bool enable)
 	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_EnableBackfaceCulling);
+			m_capture->WriteBool(enable);
+		}
+
 		this->m_cullingEnabled = enable;
 	}
 
@@ -379,19 +784,424 @@ namespace SWR
 	{
 		return m_cullingEnabled;
 	}
+
+	void RenderDevice::EnableSpanBatching(bool enable)
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_EnableSpanBatching);
+			m_capture->WriteBool(enable);
+		}
+
+		this->m_spanBatchingEnabled = enable;
+	}
+
+	bool RenderDevice::IsSpanBatchingEnabled() const
+	{
+		return m_spanBatchingEnabled;
+	}
 	
 	void RenderDevice::SetVertexBuffer(VertexBuffer* buffer)
 	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineVertexBuffer(buffer);
+			m_capture->WriteCommand(CAPTURE_SetVertexBuffer);
+			m_capture->WriteU32(ID);
+		}
+
 		m_vertexSource = buffer;
 	}
 
 	void RenderDevice::SetIndexBuffer(IndexBuffer* buffer)
 	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineIndexBuffer(buffer);
+			m_capture->WriteCommand(CAPTURE_SetIndexBuffer);
+			m_capture->WriteU32(ID);
+		}
+
 		m_indexSource = buffer;
 	}
 
+	void RenderDevice::SetRenderTarget(RenderTarget* target)
+	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineRenderTarget(target == m_backBufferTarget ? NULL : target);
+			m_capture->WriteCommand(CAPTURE_SetRenderTarget);
+			m_capture->WriteU32(ID);
+		}
+
+		if (target == NULL)
+		{
+			target = m_backBufferTarget;
+		}
+
+		if (target == m_renderTarget)
+			return;
+
+		// Surfaces waiting in the G-buffer belong to the old target.
+		if (m_gBufferPending)
+		{
+			ResolveGBuffer();
+		}
+
+		m_renderTarget = target;
+		m_rasterizer->SetRenderTarget(target);
+		BindDebugCounters();
+
+		U32 width = target->GetWidth();
+		U32 height = target->GetHeight();
+		CalculateFocal(width, height, m_fov);
+		m_triClipper->SetViewDimensions(width, height);
+
+		// The screen space structures are sized to the target.
+		const TileGrid &grid = m_rasterizer->GetTileGrid();
+		const TileGrid &lightGrid = m_lightTiles->GetGrid();
+		if (grid.tilesX != lightGrid.tilesX || grid.tilesY != lightGrid.tilesY)
+		{
+			m_lightTiles->Initilise(grid, m_lightManager->GetTotalSceneLights());
+		}
+		m_lightTilesDirty = true;
+
+		if (m_gBuffer != NULL && (m_gBuffer->GetWidth() != width || m_gBuffer->GetHeight() != height))
+		{
+			if (m_gBuffer->Resize(width, height) != SWR_OK)
+			{
+				LOG("G-buffer resize has failed; falling back to the forward pipeline.", LOG_Error);
+				delete m_gBuffer;
+				m_gBuffer = NULL;
+				m_rasterizer->SetTargetGBuffer(NULL);
+				m_pipeline = PIPELINE_Forward;
+			}
+		}
+	}
+
+	RenderTarget* RenderDevice::GetRenderTarget()
+	{
+		return m_renderTarget;
+	}
+
+	void RenderDevice::SetRenderPipeline(RenderPipeline pipeline)
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetRenderPipeline);
+			m_capture->WriteU8((U8)pipeline);
+		}
+
+		if (pipeline == PIPELINE_Deferred && m_gBuffer == NULL)
+		{
+			m_gBuffer = new GBuffer();
+			if (m_gBuffer->Initilise(m_renderTarget->GetWidth(), m_renderTarget->GetHeight()) != SWR_OK)
+			{
+				LOG("G-buffer creation has failed; staying with the forward pipeline.", LOG_Error);
+				delete m_gBuffer;
+				m_gBuffer = NULL;
+				return;
+			}
+
+			m_rasterizer->SetTargetGBuffer(m_gBuffer);
+		}
+
+		// Light anything already drawn with the old pipeline before switching.
+		if (m_gBufferPending)
+		{
+			ResolveGBuffer();
+		}
+
+		m_pipeline = pipeline;
+		if (m_pipeline == PIPELINE_Deferred)
+		{
+			m_gBuffer->Clear();
+		}
+	}
+
+	RenderPipeline RenderDevice::GetRenderPipeline() const
+	{
+		return m_pipeline;
+	}
+
+	void RenderDevice::SetMaterialID(U8 material)
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetMaterialID);
+			m_capture->WriteU8(material);
+		}
+
+		m_rasterizer->SetGBufferMaterial(material);
+	}
+
+	struct DeferredResolveJob
+	{
+		Rasterizer* rasterizer;
+		DeferredView view;
+		U32 tilesX;
+		RenderStatsSlot* threadStats;
+		U64* tileCosts; // Each tile's resolve time is added to it when set.
+	};
+
+	static void ResolveGBufferTileJob(void* data, int tile, int threadIndex)
+	{
+		SWR_PROFILE_SCOPE("ResolveTile");
+		DeferredResolveJob* job = (DeferredResolveJob*)data;
+		U64 start = job->tileCosts != NULL ? Rasterizer::DebugClock() : 0;
+
+		job->rasterizer->ResolveGBufferTile(tile % job->tilesX, tile / job->tilesX, job->view, job->threadStats[threadIndex].stats);
+
+		// Each tile is resolved by a single worker, so its cost can be added to without locking.
+		if (job->tileCosts != NULL)
+		{
+			job->tileCosts[tile] += Rasterizer::DebugClock() - start;
+		}
+	}
+
+	void RenderDevice::ResolveGBuffer()
+	{
+		if (IsCapturing())
+		{
+			// Lit with the lights as they are now.
+			m_capture->SyncLights(m_lightManager);
+			m_capture->WriteCommand(CAPTURE_ResolveGBuffer);
+		}
+
+		SWR_PROFILE_SCOPE("ResolveGBuffer");
+
+		if (m_gBuffer == NULL)
+			return;
+
+		if (LightTilesStale())
+		{
+			BuildLightTiles();
+		}
+
+		m_rasterizer->SetPixelLights(m_pixelLights, m_totalPixelLights);
+		m_rasterizer->SetLightTiles(m_lightTiles);
+
+		DeferredResolveJob job;
+		job.rasterizer = m_rasterizer;
+		job.view.focalX = m_focalX;
+		job.view.focalY = m_focalY;
+		job.view.halfWidth = m_halfVPW;
+		job.view.halfHeight = m_halfVPH;
+		job.view.cameraToWorld = m_cameraMat;
+		job.threadStats = m_threadStats;
+		job.tileCosts = m_debugView == DEBUGVIEW_TileCost && m_renderTarget == m_backBufferTarget ? m_tileCosts : NULL;
+
+		const TileGrid &grid = m_rasterizer->GetTileGrid();
+		job.tilesX = grid.tilesX;
+		m_threadManager->ParallelFor(grid.tilesX * grid.tilesY, &ResolveGBufferTileJob, &job);
+
+		// Everything drawn so far is lit; start over so it is not lit twice.
+		m_gBuffer->Clear();
+		m_gBufferPending = false;
+	}
+
+	SWR_ERR RenderDevice::BeginShadowPass(int lightID, const Matrix4 &lightTransform, Real FOV, Real nearPlane, Real farPlane)
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_BeginShadowPass);
+			m_capture->WriteS32(lightID);
+			m_capture->WriteMatrix(lightTransform);
+			m_capture->WriteReal(FOV);
+			m_capture->WriteReal(nearPlane);
+			m_capture->WriteReal(farPlane);
+		}
+
+		if (m_shadowBuffer == NULL)
+		{
+			m_shadowBuffer = new ZDepthBuffer();
+			if (m_shadowBuffer->Initilise(m_shadowMapSize, m_shadowMapSize) != SWR_OK)
+			{
+				LOG("Shadow map creation has failed.", LOG_Error);
+				delete m_shadowBuffer;
+				m_shadowBuffer = NULL;
+				return SWR_FAIL;
+			}
+
+			m_shadowView = new ShadowMapView();
+		}
+
+		// Surfaces waiting in the G-buffer must be lit with the map they were drawn with.
+		if (m_gBufferPending)
+		{
+			ResolveGBuffer();
+		}
+
+		// Project like the camera does, with the light's own view.
+		float size = (float)m_shadowMapSize;
+		ShadowMapView &view = *m_shadowView;
+		view.depth = m_shadowBuffer->GetBuffer();
+		view.width = m_shadowMapSize;
+		view.height = m_shadowMapSize;
+		view.pitch = m_shadowBuffer->GetPitch();
+		view.lightID = lightID;
+		// The light's transform is rigid; Inverse's shortcut for those drops the translation, so undo
+		// the rotation by transposing and take the position off in the light's axes.
+		Matrix4 rotation = lightTransform;
+		rotation.wX = rotation.wY = rotation.wZ = 0.0f;
+		Transpose(rotation, view.worldToLight);
+		Vector3 position = TransformNoTranslate(view.worldToLight, Vector3(lightTransform.wX, lightTransform.wY, lightTransform.wZ));
+		view.worldToLight.wX = -position.x;
+		view.worldToLight.wY = -position.y;
+		view.worldToLight.wZ = -position.z;
+		view.focalX = (size * 0.5f) * cotan((FOV * 0.5f) * RADIANS_PER_DEGREE);
+		view.focalY = view.focalX;
+		view.halfWidth = size * 0.5f;
+		view.halfHeight = size * 0.5f;
+		view.nearPlane = nearPlane;
+		view.q = farPlane / (farPlane - nearPlane);
+		view.bias = m_shadowBias;
+
+		m_shadowBuffer->Clear(ZDepthBuffer::MAX_Z_DEPTH);
+		m_inShadowPass = true;
+
+		return SWR_OK;
+	}
+
+	void RenderDevice::DrawTrisShadowList(bool useIndexBuffer, int totalTris, int start)
+	{
+		CaptureDraw(CAPTURE_DrawTrisShadowList, useIndexBuffer, totalTris, start);
+
+		if (m_inShadowPass == false)
+		{
+			LOG("Shadow casters must be drawn between BeginShadowPass and EndShadowPass.", LOG_Warning);
+			return;
+		}
+
+		const ShadowMapView &view = *m_shadowView;
+		Matrix4 worldToLight = m_world * view.worldToLight;
+
+		Vertex* tri = m_triangle;
+		Vertex* buffer  = m_vertexSource->GetVertices();
+		U16* indices = useIndexBuffer ? m_indexSource->GetBuffer() : NULL;
+		for (int i = 0; i < totalTris; i++)
+		{
+			m_stats->trisSubmitted++;
+
+			int first = start + i * 3;
+			bool visible = true;
+			{
+				SWR_PROFILE_SCOPE("Transform");
+				for (int k = 0; k < 3; k++)
+				{
+					const Vertex &source = useIndexBuffer ? buffer[indices[first + k]] : buffer[first + k];
+					Vector3 v = Transform(worldToLight, Vector3(source.x, source.y, source.z));
+					m_stats->vertsTransformed++;
+
+					// Without clipping against the near plane, casters crossing it are skipped. Back faces
+					// are kept; they cast the same shadow and are less prone to acne.
+					if (v.z < view.nearPlane)
+					{
+						visible = false;
+						break;
+					}
+
+					float invZ = 1.0f / v.z;
+					tri[k].x = view.focalX * v.x * invZ + view.halfWidth;
+					tri[k].y = view.focalY * -v.y * invZ + view.halfHeight;
+					tri[k].z = view.q - view.q * view.nearPlane * invZ;
+				}
+			}
+
+			if (visible)
+			{
+				m_stats->trisDrawn++;
+				m_rasterizer->RasterizeTriDepth(tri, m_shadowBuffer);
+			}
+		}
+	}
+
+	void RenderDevice::EndShadowPass()
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_EndShadowPass);
+		}
+
+		if (m_inShadowPass == false)
+			return;
+
+		m_inShadowPass = false;
+		m_rasterizer->SetShadowMap(m_shadowView);
+	}
+
+	void RenderDevice::DisableShadows()
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_DisableShadows);
+		}
+
+		if (m_gBufferPending)
+		{
+			ResolveGBuffer();
+		}
+
+		m_rasterizer->SetShadowMap(NULL);
+	}
+
+	void RenderDevice::SetShadowBias(Real bias)
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetShadowBias);
+			m_capture->WriteReal(bias);
+		}
+
+		m_shadowBias = bias;
+		if (m_shadowView != NULL)
+		{
+			m_shadowView->bias = bias;
+		}
+	}
+
+	void RenderDevice::SetInstanceID(U32 instanceID)
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_SetInstanceID);
+			m_capture->WriteU32(instanceID);
+		}
+
+		m_instanceID = instanceID;
+	}
+
+	void RenderDevice::InvalidateLightingCache(VertexBuffer* buffer)
+	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineVertexBuffer(buffer);
+			m_capture->WriteCommand(CAPTURE_InvalidateLightingCache);
+			m_capture->WriteU32(ID);
+		}
+
+		m_litCache->Invalidate(buffer);
+	}
+
+	void RenderDevice::ClearLightingCache()
+	{
+		if (IsCapturing())
+		{
+			m_capture->WriteCommand(CAPTURE_ClearLightingCache);
+		}
+
+		m_litCache->Clear();
+	}
+
 	void RenderDevice::SetSourceTexture(Texture* texture)
 	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineTexture(texture);
+			m_capture->WriteCommand(CAPTURE_SetSourceTexture);
+			m_capture->WriteU32(ID);
+		}
+
 		m_sourceTexture = texture;
 		m_rasterizer->SetTargetTexture(texture);
 	}
@@ -406,6 +1216,16 @@ namespace SWR
 
 	void RenderDevice::DrawTrisColList(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisColList, useIndexBuffer, totalTris, start);
+
+		// Batched, the triangles go through the edge list so their spans can be held until the end.
+		void (Rasterizer::*rasterizeTri)(Vertex*) = &Rasterizer::RasterizeTriSolid;
+		if (m_spanBatchingEnabled)
+		{
+			rasterizeTri = &Rasterizer::RasterizeTriSolid_EdgeList;
+			m_rasterizer->BeginSpanBatch();
+		}
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
@@ -422,19 +1242,15 @@ namespace SWR
 			for (unsigned int i = start; i < end; i+=3)
 			{
 
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 				// Transform.
-				ToWorldCameraSpace(&tri[0]);
-				ToWorldCameraSpace(&tri[1]);
-				ToWorldCameraSpace(&tri[2]);
+				TransformTri(tri);
 
 				if (IsBackfacingCC(tri) == false)
 				{
 
 					// Project.
-					Project(&tri[0]);
-					Project(&tri[1]);
-					Project(&tri[2]);
+					ProjectTri(tri);
 
 					// Clip the triangle.
 					int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -443,8 +1259,8 @@ namespace SWR
 					{
 						for (int j = 0; j < resultingTris; j++)
 						{
-							trisDrawn++;
-							m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
+							m_stats->trisDrawn++;
+							(m_rasterizer->*rasterizeTri)(&m_clippedVerts[j * 3]);
 						}
 					}
 				}
@@ -454,7 +1270,7 @@ namespace SWR
 				tri[2] = buffer[indices[i + 2]];
 			}
 			
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 				// Transform.
 				ToCameraSpace(&tri[0]);
 				ToCameraSpace(&tri[1]);
@@ -464,9 +1280,7 @@ namespace SWR
 			{
 
 				// Project.
-				Project(&tri[0]);
-				Project(&tri[1]);
-				Project(&tri[2]);
+				ProjectTri(tri);
 				
 				// Clip the triangle.
 				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -475,8 +1289,8 @@ namespace SWR
 				{
 					for (int j = 0; j < resultingTris; j++)
 					{
-							trisDrawn++;
-						m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
+							m_stats->trisDrawn++;
+						(m_rasterizer->*rasterizeTri)(&m_clippedVerts[j * 3]);
 					}
 				}
 			}
@@ -489,19 +1303,15 @@ namespace SWR
 			tri[2] = buffer[start + 2];
 			for (unsigned int i = start; i < end; i+=3)
 			{
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 
 				// Transform.
-				ToWorldCameraSpace(&tri[0]);
-				ToWorldCameraSpace(&tri[1]);
-				ToWorldCameraSpace(&tri[2]);
+				TransformTri(tri);
 				
 				if (IsBackfacingCC(tri) == false)
 				{
 					// Project.
-					Project(&tri[0]);
-					Project(&tri[1]);
-					Project(&tri[2]);
+					ProjectTri(tri);
 					
 					// Clip the triangle.
 					int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -510,8 +1320,8 @@ namespace SWR
 					{
 						for (int j = 0; j < resultingTris; j++)
 						{
-							trisDrawn++;
-							m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
+							m_stats->trisDrawn++;
+							(m_rasterizer->*rasterizeTri)(&m_clippedVerts[j * 3]);
 						}
 					}
 				}
@@ -521,18 +1331,14 @@ namespace SWR
 				tri[2] = buffer[i + 2];
 			}
 			
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 			// Transform.
-			ToWorldCameraSpace(&tri[0]);
-			ToWorldCameraSpace(&tri[1]);
-			ToWorldCameraSpace(&tri[2]);
+			TransformTri(tri);
 				
 			if (IsBackfacingCC(tri) == false)
 			{
 				// Project.
-				Project(&tri[0]);
-				Project(&tri[1]);
-				Project(&tri[2]);
+				ProjectTri(tri);
 				
 				// Clip the triangle.
 				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -541,16 +1347,23 @@ namespace SWR
 				{
 					for (int j = 0; j < resultingTris; j++)
 					{
-							trisDrawn++;
-						m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
+							m_stats->trisDrawn++;
+						(m_rasterizer->*rasterizeTri)(&m_clippedVerts[j * 3]);
 					}
 				}
 			}
 		}
+
+		if (m_spanBatchingEnabled)
+		{
+			m_rasterizer->EndSpanBatch();
+		}
 	}
 
 	void RenderDevice::DrawTrisColStrip(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisColStrip, useIndexBuffer, totalTris, start);
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
@@ -564,14 +1377,10 @@ namespace SWR
 			tri[2] = buffer[indices[start + 2]];
 			
 			// Transform.
-			ToWorldCameraSpace(&tri[0]);
-			ToWorldCameraSpace(&tri[1]);
-			ToWorldCameraSpace(&tri[2]);
+			TransformTri(tri);
 
 			// Project.
-			Project(&tri[0]);
-			Project(&tri[1]);
-			Project(&tri[2]);
+			ProjectTri(tri);
 
 			// The next index to be changed in the triangle.
 			int nextIndexToSwap = 0;
@@ -581,8 +1390,8 @@ namespace SWR
 			unsigned int i = start;
 			for (i; i < end; i++)
 			{
-				trisSubmittedForDrawing++;
-							trisDrawn++;
+				m_stats->trisSubmitted++;
+							m_stats->trisDrawn++;
 				nextIndex = nextIndexToSwap % 3;
 				// Draw triangle.
 				m_rasterizer->RasterizeTriSolid(tri);
@@ -606,14 +1415,10 @@ namespace SWR
 			tri[2] = buffer[start + 2];
 			
 			// Transform.
-			ToWorldCameraSpace(&tri[0]);
-			ToWorldCameraSpace(&tri[1]);
-			ToWorldCameraSpace(&tri[2]);
+			TransformTri(tri);
 
 			// Project.
-			Project(&tri[0]);
-			Project(&tri[1]);
-			Project(&tri[2]);
+			ProjectTri(tri);
 
 			// The next index to be changed in the triangle.
 			int nextIndexToSwap = 0;
@@ -623,8 +1428,8 @@ namespace SWR
 			unsigned int i = start;
 			for (i; i < end; i++)
 			{
-				trisSubmittedForDrawing++;
-							trisDrawn++;
+				m_stats->trisSubmitted++;
+							m_stats->trisDrawn++;
 				nextIndex = nextIndexToSwap % 3;
 				// Draw triangle.
 				m_rasterizer->RasterizeTriSolid(tri);
@@ -645,9 +1450,14 @@ namespace SWR
 		
 	void RenderDevice::DrawTrisColLitList(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisColLitList, useIndexBuffer, totalTris, start);
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
+
+		// The vertices are lit once per instance and cached, so we only need to fetch their colour here.
+		const Colour32* litColours = m_litCache->Acquire(m_vertexSource, m_instanceID, m_world, m_lightManager);
 		if (useIndexBuffer)
 		{
 			U16* indices = m_indexSource->GetBuffer();
@@ -655,26 +1465,18 @@ namespace SWR
 			unsigned int end = (start + totalTris * 3)- 1;
 
 			tri[0] = buffer[indices[start]];
+			tri[0].colour = litColours[indices[start]];
 			tri[1] = buffer[indices[start + 1]];
+			tri[1].colour = litColours[indices[start + 1]];
 			tri[2] = buffer[indices[start + 2]];
+			tri[2].colour = litColours[indices[start + 2]];
 
 			for (unsigned int i = start; i < end; i+=3)
 			{
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 
 				// Transform.
-				ToWorldSpace(&tri[0]);
-				ToWorldSpace(&tri[1]);
-				ToWorldSpace(&tri[2]);
-
-				// Apply gourad lighting
-				m_lightManager->ProcessVertex(&tri[0], this->m_world,  LRO_UseAll);
-				m_lightManager->ProcessVertex(&tri[1], this->m_world,  LRO_UseAll);
-				m_lightManager->ProcessVertex(&tri[2], this->m_world,  LRO_UseAll);
-				
-				ToCameraSpace(&tri[0]);
-				ToCameraSpace(&tri[1]);
-				ToCameraSpace(&tri[2]);
+				TransformTri(tri);
 
 
 
@@ -682,9 +1484,7 @@ namespace SWR
 				{
 
 					// Project.
-					Project(&tri[0]);
-					Project(&tri[1]);
-					Project(&tri[2]);
+					ProjectTri(tri);
 
 					// Clip the triangle.
 					int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -693,39 +1493,29 @@ namespace SWR
 					{
 						for (int j = 0; j < resultingTris; j++)
 						{
-							trisDrawn++;
+							m_stats->trisDrawn++;
 							m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
 						}
 					}
 				}
 
 				tri[0] = buffer[indices[i]];
+				tri[0].colour = litColours[indices[i]];
 				tri[1] = buffer[indices[i + 1]];
+				tri[1].colour = litColours[indices[i + 1]];
 				tri[2] = buffer[indices[i + 2]];
+				tri[2].colour = litColours[indices[i + 2]];
 			}
 			
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 				// Transform.
-			ToWorldSpace(&tri[0]);
-			ToWorldSpace(&tri[1]);
-			ToWorldSpace(&tri[2]);
-			
-			// Apply gourad lighting
-			m_lightManager->ProcessVertex(&tri[0], this->m_world,  LRO_UseAll);
-			m_lightManager->ProcessVertex(&tri[1], this->m_world,  LRO_UseAll);
-			m_lightManager->ProcessVertex(&tri[2], this->m_world,  LRO_UseAll);
-				
-			ToCameraSpace(&tri[0]);
-			ToCameraSpace(&tri[1]);
-			ToCameraSpace(&tri[2]);
+			TransformTri(tri);
 
 			if (IsBackfacingCC(tri) == false)
 			{
 
 				// Project.
-				Project(&tri[0]);
-				Project(&tri[1]);
-				Project(&tri[2]);
+				ProjectTri(tri);
 				
 				// Clip the triangle.
 				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -734,7 +1524,7 @@ namespace SWR
 				{
 					for (int j = 0; j < resultingTris; j++)
 					{
-							trisDrawn++;
+							m_stats->trisDrawn++;
 						m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
 					}
 				}
@@ -744,32 +1534,22 @@ namespace SWR
 		{
 			unsigned int end = (start + totalTris * 3) - 3;
 			tri[0] = buffer[start];
+			tri[0].colour = litColours[start];
 			tri[1] = buffer[start + 1];
+			tri[1].colour = litColours[start + 1];
 			tri[2] = buffer[start + 2];
+			tri[2].colour = litColours[start + 2];
 			for (unsigned int i = start; i < end; i+=3)
 			{
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 
 				// Transform.
-				ToWorldSpace(&tri[0]);
-				ToWorldSpace(&tri[1]);
-				ToWorldSpace(&tri[2]);
-				
-				// Apply gourad lighting
-				m_lightManager->ProcessVertex(&tri[0], this->m_world,  LRO_UseAll);
-				m_lightManager->ProcessVertex(&tri[1], this->m_world,  LRO_UseAll);
-				m_lightManager->ProcessVertex(&tri[2], this->m_world,  LRO_UseAll);
-				
-				ToCameraSpace(&tri[0]);
-				ToCameraSpace(&tri[1]);
-				ToCameraSpace(&tri[2]);
+				TransformTri(tri);
 				
 				if (IsBackfacingCC(tri) == false)
 				{
 					// Project.
-					Project(&tri[0]);
-					Project(&tri[1]);
-					Project(&tri[2]);
+					ProjectTri(tri);
 					
 					// Clip the triangle.
 					int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -778,56 +1558,261 @@ namespace SWR
 					{
 						for (int j = 0; j < resultingTris; j++)
 						{
-							trisDrawn++;
+							m_stats->trisDrawn++;
 							m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
 						}
 					}
 				}
 
 				tri[0] = buffer[i];
+				tri[0].colour = litColours[i];
 				tri[1] = buffer[i + 1];
+				tri[1].colour = litColours[i + 1];
 				tri[2] = buffer[i + 2];
+				tri[2].colour = litColours[i + 2];
 			}
 			
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 			// Transform.
-			ToWorldSpace(&tri[0]);
-			ToWorldSpace(&tri[1]);
-			ToWorldSpace(&tri[2]);
-			
-			// Apply gourad lighting
-			m_lightManager->ProcessVertex(&tri[0], this->m_world,  LRO_UseAll);
-			m_lightManager->ProcessVertex(&tri[1], this->m_world,  LRO_UseAll);
-			m_lightManager->ProcessVertex(&tri[2], this->m_world,  LRO_UseAll);
-				
-			ToCameraSpace(&tri[0]);
-			ToCameraSpace(&tri[1]);
-			ToCameraSpace(&tri[2]);
+			TransformTri(tri);
 				
 			if (IsBackfacingCC(tri) == false)
 			{
 				// Project.
-				Project(&tri[0]);
-				Project(&tri[1]);
-				Project(&tri[2]);
+				ProjectTri(tri);
 				
 				// Clip the triangle.
 				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
 
-				if (resultingTris >= 1)
-				{
-					for (int j = 0; j < resultingTris; j++)
-					{
-							trisDrawn++;
-						m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
-					}
-				}
+				if (resultingTris >= 1)
+				{
+					for (int j = 0; j < resultingTris; j++)
+					{
+							m_stats->trisDrawn++;
+						m_rasterizer->RasterizeTriSolid(&m_clippedVerts[j * 3]);
+					}
+				}
+			}
+		}
+	}
+
+	void RenderDevice::DrawTrisColPhongList(bool useIndexBuffer, int totalTris, int start)
+	{
+		CaptureDraw(CAPTURE_DrawTrisColPhongList, useIndexBuffer, totalTris, start);
+
+		Vertex* tri = m_triangle;
+		Vertex* buffer  = m_vertexSource->GetVertices();
+
+		if (LightTilesStale())
+		{
+			BuildLightTiles();
+		}
+
+		m_rasterizer->SetPixelLights(m_pixelLights, m_totalPixelLights);
+		m_rasterizer->SetLightTiles(m_lightTiles);
+		m_gBufferPending |= m_pipeline == PIPELINE_Deferred;
+
+		U16* indices = useIndexBuffer ? m_indexSource->GetBuffer() : NULL;
+		for (int i = 0; i < totalTris; i++)
+		{
+			int first = start + i * 3;
+			if (useIndexBuffer)
+			{
+				tri[0] = buffer[indices[first]];
+				tri[1] = buffer[indices[first + 1]];
+				tri[2] = buffer[indices[first + 2]];
+			}
+			else
+			{
+				tri[0] = buffer[first];
+				tri[1] = buffer[first + 1];
+				tri[2] = buffer[first + 2];
+			}
+
+			DrawTriPhong(tri);
+		}
+	}
+
+	void RenderDevice::BuildLightTiles()
+	{
+		SWR_PROFILE_SCOPE("LightTiles");
+
+		// The first build of the frame takes the lights and tile lists from the arena; later builds
+		// reuse them, unless the target changed the tile grid in between.
+		FrameArena &arena = *m_frameArena;
+		if (m_pixelLights == NULL)
+		{
+			int maxLights = m_lightManager->GetTotalSceneLights();
+			m_pixelLights = arena.AllocateArray<PixelLight>(maxLights);
+			m_lightBounds = arena.AllocateArray<LightScreenBounds>(maxLights);
+		}
+
+		if (m_lightTiles->HasStorage() == false)
+		{
+			m_lightTiles->SetStorage(arena.Allocate(m_lightTiles->GetStorageSize()));
+		}
+
+		// Snapshot the lights and find the screen area each of them can reach.
+		m_totalPixelLights = m_lightManager->BuildPixelLights(m_pixelLights, m_lightManager->GetTotalSceneLights());
+		for (int i = 0; i < m_totalPixelLights; i++)
+		{
+			CalculateLightScreenBounds(m_pixelLights[i], m_lightBounds[i]);
+		}
+
+		m_lightTiles->Build(m_lightBounds, m_totalPixelLights, m_threadManager);
+		m_lightTilesDirty = false;
+		m_lightTilesRevision = m_lightManager->GetRevision();
+	}
+
+	bool RenderDevice::LightTilesStale() const
+	{
+		return m_lightTilesDirty || m_lightTilesRevision != m_lightManager->GetRevision();
+	}
+
+	void RenderDevice::CalculateLightScreenBounds(const PixelLight &light, LightScreenBounds &out)
+	{
+		S32 width = (S32)m_renderTarget->GetWidth();
+		S32 height = (S32)m_renderTarget->GetHeight();
+
+		// Directional lights reach everything.
+		out.minX = 0;
+		out.minY = 0;
+		out.maxX = width - 1;
+		out.maxY = height - 1;
+		if (light.type != LIGHT_Point)
+			return;
+
+		Vector3 centre = Transform(m_cameraMatInv, Vector3(light.x, light.y, light.z));
+		float radius = light.falloff;
+
+		// Entirely behind the near plane.
+		if (centre.z + radius < m_nearPlane)
+		{
+			out.minX = out.minY = 1;
+			out.maxX = out.maxY = 0;
+			return;
+		}
+
+		// Straddling the near plane; treat it as covering the screen.
+		if (centre.z - radius <= m_nearPlane)
+			return;
+
+		// Project the corners of the box bounding the sphere. The box contains the sphere, so the
+		// area covered by its corners conservatively covers the sphere.
+		float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+		for (int i = 0; i < 8; i++)
+		{
+			Vector3 corner(centre.x + ((i & 1) ? radius : -radius),
+						   centre.y + ((i & 2) ? radius : -radius),
+						   centre.z + ((i & 4) ? radius : -radius));
+			Project(corner);
+			minX = corner.x < minX ? corner.x : minX;
+			minY = corner.y < minY ? corner.y : minY;
+			maxX = corner.x > maxX ? corner.x : maxX;
+			maxY = corner.y > maxY ? corner.y : maxY;
+		}
+
+		out.minX = (S32)floor(Clamp<float>(0.0f, (float)width, minX));
+		out.minY = (S32)floor(Clamp<float>(0.0f, (float)height, minY));
+		out.maxX = (S32)ceil(Clamp<float>(-1.0f, (float)(width - 1), maxX));
+		out.maxY = (S32)ceil(Clamp<float>(-1.0f, (float)(height - 1), maxY));
+	}
+
+	void RenderDevice::DrawTriPhong(Vertex* tri)
+	{
+		m_stats->trisSubmitted++;
+
+		// The lighting needs the world position and normal, which are lost once we go to camera space.
+		Vector3 worldPos[3];
+		Vector3 worldNormal[3];
+		{
+			SWR_PROFILE_SCOPE("Transform");
+			for (int i = 0; i < 3; i++)
+			{
+				tri[i].ToVec3(worldPos[i]);
+				worldPos[i] = Transform(m_world, worldPos[i]);
+				worldNormal[i] = TransformNoTranslate(m_world, tri[i].GetNormal());
+				ToWorldCameraSpace(&tri[i]);
+			}
+		}
+
+		if (IsBackfacingCC(tri) == true)
+			return;
+
+		// The clipper only works in screen space, so reject anything crossing the near plane rather
+		// than dividing by a zero or negative depth.
+		float invW[3];
+		{
+			SWR_PROFILE_SCOPE("Project");
+			for (int i = 0; i < 3; i++)
+			{
+				if (tri[i].z < m_nearPlane)
+					return;
+
+				invW[i] = 1.0f / tri[i].z;
+				Project(&tri[i]);
+			}
+		}
+
+		// Clipped vertices only carry screen space data. We recover their attributes through their
+		// barycentric co-ordinates within the projected triangle.
+		float dx1 = tri[1].x - tri[0].x, dy1 = tri[1].y - tri[0].y;
+		float dx2 = tri[2].x - tri[0].x, dy2 = tri[2].y - tri[0].y;
+		float area = dx1 * dy2 - dx2 * dy1;
+		if (fabs(area) < EPSILON)
+			return;
+		float areaInv = 1.0f / area;
+
+		// Pre-multiply the attributes by 1/w for perspective correct interpolation.
+		float attr[3][PHONG_Total];
+		for (int i = 0; i < 3; i++)
+		{
+			attr[i][PHONG_InvW] = invW[i];
+			attr[i][PHONG_PosX] = worldPos[i].x * invW[i];
+			attr[i][PHONG_PosY] = worldPos[i].y * invW[i];
+			attr[i][PHONG_PosZ] = worldPos[i].z * invW[i];
+			attr[i][PHONG_NormalX] = worldNormal[i].x * invW[i];
+			attr[i][PHONG_NormalY] = worldNormal[i].y * invW[i];
+			attr[i][PHONG_NormalZ] = worldNormal[i].z * invW[i];
+			attr[i][PHONG_Red] = tri[i].colour.R * invW[i];
+			attr[i][PHONG_Green] = tri[i].colour.G * invW[i];
+			attr[i][PHONG_Blue] = tri[i].colour.B * invW[i];
+		}
+
+		int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
+		for (int j = 0; j < resultingTris * 3; j++)
+		{
+			const Vertex &clipped = m_clippedVerts[j];
+			PhongVertex &out = m_phongVerts[j];
+
+			float px = clipped.x - tri[0].x;
+			float py = clipped.y - tri[0].y;
+			float b1 = (px * dy2 - dx2 * py) * areaInv;
+			float b2 = (dx1 * py - px * dy1) * areaInv;
+			float b0 = 1.0f - b1 - b2;
+
+			out.x = clipped.x;
+			out.y = clipped.y;
+			for (int k = 0; k < PHONG_Total; k++)
+			{
+				out.attr[k] = attr[0][k] * b0 + attr[1][k] * b1 + attr[2][k] * b2;
 			}
 		}
+
+		for (int j = 0; j < resultingTris; j++)
+		{
+			m_stats->trisDrawn++;
+			if (m_pipeline == PIPELINE_Deferred)
+				m_rasterizer->RasterizeTriGBuffer(&m_phongVerts[j * 3]);
+			else
+				m_rasterizer->RasterizeTriPhong(&m_phongVerts[j * 3]);
+		}
 	}
 
 	void RenderDevice::DrawTrisColLitStrip(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisColLitStrip, useIndexBuffer, totalTris, start);
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
@@ -835,6 +1820,18 @@ namespace SWR
 		
 	void RenderDevice::DrawTrisTexList(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisTexList, useIndexBuffer, totalTris, start);
+
+		// Batched, the triangles go through the edge list so their spans can be held until the end.
+		// The edge list is affine, so perspective correct triangles are never batched.
+		void (Rasterizer::*rasterizeTri)(Vertex*) = &Rasterizer::RasterizeTriTex;
+		bool batchSpans = m_spanBatchingEnabled && m_texMapType != TEX_MAP_Perspective;
+		if (batchSpans)
+		{
+			rasterizeTri = &Rasterizer::RasterizeTriTex_EdgeList;
+			m_rasterizer->BeginSpanBatch();
+		}
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
@@ -850,20 +1847,16 @@ namespace SWR
 
 			for (unsigned int i = start; i < end; i+=3)
 			{
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 
 				// Transform.
-				ToWorldCameraSpace(&tri[0]);
-				ToWorldCameraSpace(&tri[1]);
-				ToWorldCameraSpace(&tri[2]);
+				TransformTri(tri);
 
 				if (IsBackfacingCC(tri) == false)
 				{
 
 					// Project.
-					Project(&tri[0]);
-					Project(&tri[1]);
-					Project(&tri[2]);
+					ProjectTri(tri);
 					
 					// Clip the triangle.
 					int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -872,8 +1865,8 @@ namespace SWR
 					{
 						for (int j = 0; j < resultingTris; j++)
 						{
-							trisDrawn++;
-							m_rasterizer->RasterizeTriTex(&m_clippedVerts[j * 3]);
+							m_stats->trisDrawn++;
+							(m_rasterizer->*rasterizeTri)(&m_clippedVerts[j * 3]);
 						}
 					}
 				}
@@ -883,19 +1876,15 @@ namespace SWR
 				tri[2] = buffer[indices[i + 2]];
 			}
 			
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 				// Transform.
-				ToWorldCameraSpace(&tri[0]);
-				ToWorldCameraSpace(&tri[1]);
-				ToWorldCameraSpace(&tri[2]);
+				TransformTri(tri);
 
 			if (IsBackfacingCC(tri) == false)
 			{
 
 				// Project.
-				Project(&tri[0]);
-				Project(&tri[1]);
-				Project(&tri[2]);
+				ProjectTri(tri);
 				
 				// Clip the triangle.
 				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -904,8 +1893,8 @@ namespace SWR
 				{
 					for (int j = 0; j < resultingTris; j++)
 					{
-							trisDrawn++;
-						m_rasterizer->RasterizeTriTex(&m_clippedVerts[j * 3]);
+							m_stats->trisDrawn++;
+						(m_rasterizer->*rasterizeTri)(&m_clippedVerts[j * 3]);
 					}
 				}
 			}
@@ -918,19 +1907,15 @@ namespace SWR
 			tri[2] = buffer[start + 2];
 			for (unsigned int i = start; i < end; i+=3)
 			{
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 
 				// Transform.
-				ToWorldCameraSpace(&tri[0]);
-				ToWorldCameraSpace(&tri[1]);
-				ToWorldCameraSpace(&tri[2]);
+				TransformTri(tri);
 				
 				if (IsBackfacingCC(tri) == false)
 				{
 					// Project.
-					Project(&tri[0]);
-					Project(&tri[1]);
-					Project(&tri[2]);
+					ProjectTri(tri);
 					
 					// Clip the triangle.
 					int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -939,8 +1924,8 @@ namespace SWR
 					{
 						for (int j = 0; j < resultingTris; j++)
 						{
-							trisDrawn++;
-							m_rasterizer->RasterizeTriTex(&m_clippedVerts[j * 3]);
+							m_stats->trisDrawn++;
+							(m_rasterizer->*rasterizeTri)(&m_clippedVerts[j * 3]);
 						}
 					}
 				}
@@ -950,18 +1935,14 @@ namespace SWR
 				tri[2] = buffer[i + 2];
 			}
 			
-				trisSubmittedForDrawing++;
+				m_stats->trisSubmitted++;
 			// Transform.
-			ToWorldCameraSpace(&tri[0]);
-			ToWorldCameraSpace(&tri[1]);
-			ToWorldCameraSpace(&tri[2]);
+			TransformTri(tri);
 				
 			if (IsBackfacingCC(tri) == false)
 			{
 				// Project.
-				Project(&tri[0]);
-				Project(&tri[1]);
-				Project(&tri[2]);
+				ProjectTri(tri);
 				
 				// Clip the triangle.
 				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -970,16 +1951,23 @@ namespace SWR
 				{
 					for (int j = 0; j < resultingTris; j++)
 					{
-							trisDrawn++;
-						m_rasterizer->RasterizeTriTex(&m_clippedVerts[j * 3]);
+							m_stats->trisDrawn++;
+						(m_rasterizer->*rasterizeTri)(&m_clippedVerts[j * 3]);
 					}
 				}
 			}
 		}
+
+		if (batchSpans)
+		{
+			m_rasterizer->EndSpanBatch();
+		}
 	}
 
 	void RenderDevice::DrawTrisTexStrip(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisTexStrip, useIndexBuffer, totalTris, start);
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();	
@@ -993,14 +1981,10 @@ namespace SWR
 			tri[2] = buffer[indices[start + 2]];
 			
 			// Transform.
-			ToWorldCameraSpace(&tri[0]);
-			ToWorldCameraSpace(&tri[1]);
-			ToWorldCameraSpace(&tri[2]);
+			TransformTri(tri);
 
 			// Project.
-			Project(&tri[0]);
-			Project(&tri[1]);
-			Project(&tri[2]);
+			ProjectTri(tri);
 
 			// The next index to be changed in the triangle.
 			int nextIndexToSwap = 0;
@@ -1010,8 +1994,8 @@ namespace SWR
 			unsigned int i = start;
 			for (i; i < end; i++)
 			{
-							trisDrawn++;
-				trisSubmittedForDrawing++;
+							m_stats->trisDrawn++;
+				m_stats->trisSubmitted++;
 				nextIndex = nextIndexToSwap % 3;
 				// Draw triangle.
 				m_rasterizer->RasterizeTriTex(tri);
@@ -1035,14 +2019,10 @@ namespace SWR
 			tri[2] = buffer[start + 2];
 			
 			// Transform.
-			ToWorldCameraSpace(&tri[0]);
-			ToWorldCameraSpace(&tri[1]);
-			ToWorldCameraSpace(&tri[2]);
+			TransformTri(tri);
 
 			// Project.
-			Project(&tri[0]);
-			Project(&tri[1]);
-			Project(&tri[2]);
+			ProjectTri(tri);
 
 			// The next index to be changed in the triangle.
 			int nextIndexToSwap = 0;
@@ -1052,8 +2032,8 @@ namespace SWR
 			unsigned int i = start;
 			for (i; i < end; i++)
 			{
-							trisDrawn++;
-				trisSubmittedForDrawing++;
+							m_stats->trisDrawn++;
+				m_stats->trisSubmitted++;
 				nextIndex = nextIndexToSwap % 3;
 				// Draw triangle.
 				m_rasterizer->RasterizeTriTex(tri);
@@ -1075,6 +2055,8 @@ namespace SWR
 	// Renders a 2D triangle.
 	void RenderDevice::DrawTrisTex2D(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisTex2D, useIndexBuffer, totalTris, start);
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
@@ -1108,21 +2090,156 @@ namespace SWR
 		
 	void RenderDevice::DrawTrisTexLitList(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisTexLitList, useIndexBuffer, totalTris, start);
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
+
+		// The vertices are lit once per instance and cached, so we only need to fetch their colour here.
+		const Colour32* litColours = m_litCache->Acquire(m_vertexSource, m_instanceID, m_world, m_lightManager);
 		if (useIndexBuffer)
 		{
 			U16* indices = m_indexSource->GetBuffer();
 			U16 numOfIndices = m_indexSource->GetTotalIndices();
+			unsigned int end = (start + totalTris * 3)- 1;
+
+			tri[0] = buffer[indices[start]];
+			tri[0].colour = litColours[indices[start]];
+			tri[1] = buffer[indices[start + 1]];
+			tri[1].colour = litColours[indices[start + 1]];
+			tri[2] = buffer[indices[start + 2]];
+			tri[2].colour = litColours[indices[start + 2]];
+
+			for (unsigned int i = start; i < end; i+=3)
+			{
+				m_stats->trisSubmitted++;
+
+				// Transform.
+				TransformTri(tri);
+
+
+
+				if (IsBackfacingCC(tri) == false)
+				{
+
+					// Project.
+					ProjectTri(tri);
+
+					// Clip the triangle.
+					int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
+
+					if (resultingTris >= 1)
+					{
+						for (int j = 0; j < resultingTris; j++)
+						{
+							m_stats->trisDrawn++;
+							m_rasterizer->RasterizeTriTexLight(&m_clippedVerts[j * 3]);
+						}
+					}
+				}
+
+				tri[0] = buffer[indices[i]];
+				tri[0].colour = litColours[indices[i]];
+				tri[1] = buffer[indices[i + 1]];
+				tri[1].colour = litColours[indices[i + 1]];
+				tri[2] = buffer[indices[i + 2]];
+				tri[2].colour = litColours[indices[i + 2]];
+			}
+			
+				m_stats->trisSubmitted++;
+				// Transform.
+			TransformTri(tri);
+
+			if (IsBackfacingCC(tri) == false)
+			{
+
+				// Project.
+				ProjectTri(tri);
+				
+				// Clip the triangle.
+				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
+
+				if (resultingTris >= 1)
+				{
+					for (int j = 0; j < resultingTris; j++)
+					{
+							m_stats->trisDrawn++;
+						m_rasterizer->RasterizeTriTexLight(&m_clippedVerts[j * 3]);
+					}
+				}
+			}
 		}
 		else
 		{
+			unsigned int end = (start + totalTris * 3) - 3;
+			tri[0] = buffer[start];
+			tri[0].colour = litColours[start];
+			tri[1] = buffer[start + 1];
+			tri[1].colour = litColours[start + 1];
+			tri[2] = buffer[start + 2];
+			tri[2].colour = litColours[start + 2];
+			for (unsigned int i = start; i < end; i+=3)
+			{
+				m_stats->trisSubmitted++;
+
+				// Transform.
+				TransformTri(tri);
+				
+				if (IsBackfacingCC(tri) == false)
+				{
+					// Project.
+					ProjectTri(tri);
+					
+					// Clip the triangle.
+					int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
+
+					if (resultingTris >= 1)
+					{
+						for (int j = 0; j < resultingTris; j++)
+						{
+							m_stats->trisDrawn++;
+							m_rasterizer->RasterizeTriTexLight(&m_clippedVerts[j * 3]);
+						}
+					}
+				}
+
+				tri[0] = buffer[i];
+				tri[0].colour = litColours[i];
+				tri[1] = buffer[i + 1];
+				tri[1].colour = litColours[i + 1];
+				tri[2] = buffer[i + 2];
+				tri[2].colour = litColours[i + 2];
+			}
+			
+				m_stats->trisSubmitted++;
+			// Transform.
+			TransformTri(tri);
+				
+			if (IsBackfacingCC(tri) == false)
+			{
+				// Project.
+				ProjectTri(tri);
+				
+				// Clip the triangle.
+				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
+
+				if (resultingTris >= 1)
+				{
+					for (int j = 0; j < resultingTris; j++)
+					{
+							m_stats->trisDrawn++;
+						m_rasterizer->RasterizeTriTexLight(&m_clippedVerts[j * 3]);
+					}
+				}
+			}
 		}
 	}
 
 	void RenderDevice::DrawTrisTexLitStrip(bool useIndexBuffer, int totalTris, int start)
 	{
+		CaptureDraw(CAPTURE_DrawTrisTexLitStrip, useIndexBuffer, totalTris, start);
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
@@ -1138,14 +2255,25 @@ namespace SWR
 
 	void RenderDevice::DrawTexture2D(U16 x, U16 y, Texture* texture)
 	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineTexture(texture);
+			m_capture->WriteCommand(CAPTURE_DrawTexture2D);
+			m_capture->WriteU16(x);
+			m_capture->WriteU16(y);
+			m_capture->WriteU32(ID);
+			m_capture->WriteU8(0);
+		}
+
 		// Firstly get the byte buffers.
 		U8* texels = texture->GetBytes();
-		U8* backbuffer = m_backBuffer->GetByteBuffer();
+		U8* backbuffer = m_renderTarget->GetColour();
 		U8* bytes = NULL;
 
 		// Get the textures width and height.
 		U16 texWidth = texture->GetWidth();
 		U16 texHeight = texture->GetHeight();
+		U32 texPitch = texture->GetPitch();
 
 		// Calculate the scanline size in bytes.
 		size_t lineSpan = texWidth << 2;
@@ -1155,24 +2283,51 @@ namespace SWR
 
 		for (U32 row = 0; row < texHeight; row++)
 		{
-			byteIndex = (x + (y * this->m_backBuffer->GetWidth())) << 2;
-			texelIndex = (row * texWidth) << 2;
+			byteIndex = (x << 2) + (y * m_renderTarget->GetPitch());
+			texelIndex = row * texPitch;
 
-			memcpy(&(backbuffer[byteIndex]), &(texels[texelIndex]), lineSpan);
+			// A tiled texture's rows are not whole, so gather them a texel at a time.
+			if (texture->GetLayout() == TEXLAYOUT_Tiled)
+			{
+				U32* target = (U32*)&(backbuffer[byteIndex]);
+				for (U32 col = 0; col < texWidth; col++)
+				{
+					target[col] = ((U32*)texels)[texture->GetTexelIndex(col, row)];
+				}
+			}
+			else
+			{
+				memcpy(&(backbuffer[byteIndex]), &(texels[texelIndex]), lineSpan);
+			}
 			y++;
 		}
 	}
 
 	void RenderDevice::DrawTexture2D(U16 x, U16 y, Texture* texture, Rectangle* srcRect)
 	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineTexture(texture);
+			m_capture->WriteCommand(CAPTURE_DrawTexture2D);
+			m_capture->WriteU16(x);
+			m_capture->WriteU16(y);
+			m_capture->WriteU32(ID);
+			m_capture->WriteU8(1);
+			m_capture->WriteS32(srcRect->left);
+			m_capture->WriteS32(srcRect->right);
+			m_capture->WriteS32(srcRect->top);
+			m_capture->WriteS32(srcRect->bottom);
+		}
+
 		// Firstly get the byte buffers.
 		U8* texels = texture->GetBytes();
-		U8* backbuffer = m_backBuffer->GetByteBuffer();
+		U8* backbuffer = m_renderTarget->GetColour();
 		U8* bytes = NULL;
 
 		// Get the textures width and height.
 		U16 texWidth = texture->GetWidth();
 		U16 texHeight = texture->GetHeight();
+		U32 texPitch = texture->GetPitch();
 
 		// Calculate the scanline size in bytes.
 		size_t lineSpan = (srcRect->right - srcRect->left) << 2;
@@ -1182,23 +2337,52 @@ namespace SWR
 
 		for (U32 row = srcRect->top; row < srcRect->bottom; row++)
 		{
-			byteIndex = (x + (y * this->m_backBuffer->GetWidth())) << 2;
-			texelIndex = ((row * texWidth) + srcRect->left) << 2;
+			byteIndex = (x << 2) + (y * m_renderTarget->GetPitch());
+			texelIndex = (row * texPitch) + (srcRect->left << 2);
 
-			memcpy(&(backbuffer[byteIndex]), &(texels[texelIndex]), lineSpan);
+			if (texture->GetLayout() == TEXLAYOUT_Tiled)
+			{
+				U32* target = (U32*)&(backbuffer[byteIndex]);
+				for (U32 col = srcRect->left; col < (U32)srcRect->right; col++)
+				{
+					target[col - srcRect->left] = ((U32*)texels)[texture->GetTexelIndex(col, row)];
+				}
+			}
+			else
+			{
+				memcpy(&(backbuffer[byteIndex]), &(texels[texelIndex]), lineSpan);
+			}
 			y++;
 		}
 	}
 
 	void RenderDevice::DrawTexture2D(U16 x, U16 y, Texture* texture, Rectangle* srcRect, U32 alphaFilter)
 	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineTexture(texture);
+			m_capture->WriteCommand(CAPTURE_DrawTexture2D);
+			m_capture->WriteU16(x);
+			m_capture->WriteU16(y);
+			m_capture->WriteU32(ID);
+			m_capture->WriteU8(2);
+			m_capture->WriteS32(srcRect->left);
+			m_capture->WriteS32(srcRect->right);
+			m_capture->WriteS32(srcRect->top);
+			m_capture->WriteS32(srcRect->bottom);
+			m_capture->WriteU32(alphaFilter);
+		}
+
 		// Firstly get the byte buffers.
 		U32* texels = (U32*)texture->GetBytes();
-		U32* backbuffer = (U32*)m_backBuffer->GetByteBuffer();
+		U32* backbuffer = (U32*)m_renderTarget->GetColour();
+		U32 pitch = m_renderTarget->GetPitch() >> 2;
 
-		// Get the textures width and height.
+		// Get the textures width and height, and the texels between its rows.
 		U16 texWidth = texture->GetWidth();
 		U16 texHeight = texture->GetHeight();
+		U32 texPitch = texture->GetPitch() >> 2;
+		bool tiled = texture->GetLayout() == TEXLAYOUT_Tiled;
 
 		U32 texColour =  0;
 
@@ -1209,8 +2393,8 @@ namespace SWR
 		{
 			for (U32 col = srcRect->left; col < srcRect->right; col++)
 			{
-				texelIndex = ((row * texWidth) + col);
-				bufferIndex = (x + (col - srcRect->left) + (y * this->m_backBuffer->GetWidth()));
+				texelIndex = tiled ? texture->GetTexelIndex(col, row) : ((row * texPitch) + col);
+				bufferIndex = (x + (col - srcRect->left) + (y * pitch));
 				texColour = (U32)texels[texelIndex];
 
 				if (texColour != alphaFilter)
@@ -1227,6 +2411,15 @@ namespace SWR
 
 	void RenderDevice::DrawNormals(VertexBuffer* buffer, Colour32 colour, float normalLength)
 	{
+		if (IsCapturing())
+		{
+			U32 ID = m_capture->DefineVertexBuffer(buffer);
+			m_capture->WriteCommand(CAPTURE_DrawNormals);
+			m_capture->WriteU32(ID);
+			m_capture->WriteBytes(&colour, sizeof(colour));
+			m_capture->WriteReal(normalLength);
+		}
+
 		Vector3 start;
 		Vector3 end;
 		Vertex* verts = buffer->GetVertices();
@@ -1247,6 +2440,12 @@ namespace SWR
 
 	void RenderDevice::DrawWireFrame(bool useIndexBuffer, int totalTris, int start, Colour32 colour)
 	{
+		CaptureDraw(CAPTURE_DrawWireFrame, useIndexBuffer, totalTris, start);
+		if (IsCapturing())
+		{
+			m_capture->WriteBytes(&colour, sizeof(colour));
+		}
+
 		Vertex* tri = m_triangle;
 		Vertex* buffer  = m_vertexSource->GetVertices();
 		U16 numOfVerts = m_vertexSource->GetTotalVerts();
@@ -1267,15 +2466,11 @@ namespace SWR
 			{
 
 				// Transform.
-				ToWorldCameraSpace(&tri[0]);
-				ToWorldCameraSpace(&tri[1]);
-				ToWorldCameraSpace(&tri[2]);
+				TransformTri(tri);
 
 
 				// Project.
-				Project(&tri[0]);
-				Project(&tri[1]);
-				Project(&tri[2]);
+				ProjectTri(tri);
 
 				// Clip the triangle.
 				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -1301,9 +2496,7 @@ namespace SWR
 			ToCameraSpace(&tri[1]);
 			ToCameraSpace(&tri[2]);
 			// Project.
-			Project(&tri[0]);
-			Project(&tri[1]);
-			Project(&tri[2]);
+			ProjectTri(tri);
 				
 			// Clip the triangle.
 			int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -1329,14 +2522,10 @@ namespace SWR
 			{
 
 				// Transform.
-				ToWorldCameraSpace(&tri[0]);
-				ToWorldCameraSpace(&tri[1]);
-				ToWorldCameraSpace(&tri[2]);
+				TransformTri(tri);
 				
 				// Project.
-				Project(&tri[0]);
-				Project(&tri[1]);
-				Project(&tri[2]);
+				ProjectTri(tri);
 					
 				// Clip the triangle.
 				int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -1358,14 +2547,10 @@ namespace SWR
 			}
 
 			// Transform.
-			ToWorldCameraSpace(&tri[0]);
-			ToWorldCameraSpace(&tri[1]);
-			ToWorldCameraSpace(&tri[2]);
+			TransformTri(tri);
 				
 			// Project.
-			Project(&tri[0]);
-			Project(&tri[1]);
-			Project(&tri[2]);
+			ProjectTri(tri);
 				
 			// Clip the triangle.
 			int resultingTris = m_triClipper->ClipTriangle(tri, this->m_clippedVerts);
@@ -1380,26 +2565,286 @@ namespace SWR
 		}
 	}
 
+	SWR_ERR RenderDevice::BeginCapture(const char* filename)
+	{
+		if (m_capture == NULL)
+		{
+			m_capture = new FrameCapture();
+		}
+
+		if (m_capture->Open(filename, m_backBuffer->GetWidth(), m_backBuffer->GetHeight(), m_lightManager->GetTotalSceneLights(), m_shadowMapSize) != SWR_OK)
+			return SWR_FAIL;
+
+		CaptureState();
+		return SWR_OK;
+	}
+
+	bool RenderDevice::IsCapturing() const
+	{
+		return m_capture != NULL && m_capture->IsOpen();
+	}
+
+	void RenderDevice::CaptureState()
+	{
+		FrameCapture &capture = *m_capture;
+
+		U32 targetID = capture.DefineRenderTarget(m_renderTarget == m_backBufferTarget ? NULL : m_renderTarget);
+		capture.WriteCommand(CAPTURE_SetRenderTarget);
+		capture.WriteU32(targetID);
+
+		capture.WriteCommand(CAPTURE_SetFOV);
+		capture.WriteReal(m_fov);
+		capture.WriteCommand(CAPTURE_SetClipPlanes);
+		capture.WriteReal(m_nearPlane);
+		capture.WriteReal(m_farPlane);
+		capture.WriteCommand(CAPTURE_SetTextureMappingType);
+		capture.WriteU8((U8)m_texMapType);
+		capture.WriteCommand(CAPTURE_EnableBackfaceCulling);
+		capture.WriteBool(m_cullingEnabled);
+		capture.WriteCommand(CAPTURE_EnableSpanBatching);
+		capture.WriteBool(m_spanBatchingEnabled);
+
+		capture.WriteCommand(CAPTURE_SetRenderPipeline);
+		capture.WriteU8((U8)m_pipeline);
+		capture.WriteCommand(CAPTURE_SetMaterialID);
+		capture.WriteU8(m_rasterizer->GetGBufferMaterial());
+		capture.WriteCommand(CAPTURE_SetShadowBias);
+		capture.WriteReal(m_shadowBias);
+		capture.WriteCommand(CAPTURE_SetInstanceID);
+		capture.WriteU32(m_instanceID);
+
+		// The transform is rebuilt from the matrices, as if they had been committed.
+		capture.WriteCommand(CAPTURE_SetCameraTransform);
+		capture.WriteMatrix(m_cameraMat);
+		capture.WriteCommand(CAPTURE_SetWorldTransform);
+		capture.WriteMatrix(m_world);
+		capture.WriteCommand(CAPTURE_CommitMatrixChanges);
+
+		U32 ID = capture.DefineVertexBuffer(m_vertexSource);
+		capture.WriteCommand(CAPTURE_SetVertexBuffer);
+		capture.WriteU32(ID);
+		ID = capture.DefineIndexBuffer(m_indexSource);
+		capture.WriteCommand(CAPTURE_SetIndexBuffer);
+		capture.WriteU32(ID);
+		ID = capture.DefineTexture(m_sourceTexture);
+		capture.WriteCommand(CAPTURE_SetSourceTexture);
+		capture.WriteU32(ID);
+
+		// The shadow map's depths aren't captured, only the passes that render them.
+		if (m_rasterizer->GetShadowMap() != NULL)
+		{
+			LOG("The shadow map was rendered before the frame capture began; it is left out of the capture.", LOG_Warning);
+		}
+		capture.WriteCommand(CAPTURE_DisableShadows);
+
+		capture.SyncLights(m_lightManager);
+	}
+
+	void RenderDevice::CaptureDraw(int command, bool useIndexBuffer, int totalTris, int start)
+	{
+		if (IsCapturing() == false)
+			return;
+
+		// The lights can be changed without going through the device, so check them with each draw.
+		m_capture->SyncLights(m_lightManager);
+		m_capture->WriteDraw((CaptureCommand)command, useIndexBuffer, totalTris, start);
+	}
+
+	void RenderDevice::SetDebugView(DebugView view, Real scale)
+	{
+		m_debugView = view;
+		m_debugViewScale = scale;
+
+		U32 totalPixels = m_backBuffer->GetWidth() * m_backBuffer->GetHeight();
+		U32 totalTiles = ((m_backBuffer->GetWidth() + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE) *
+						 ((m_backBuffer->GetHeight() + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE);
+
+		if (m_debugView == DEBUGVIEW_Overdraw)
+		{
+			if (m_overdrawCounts == NULL)
+			{
+				m_overdrawCounts = new U16[totalPixels];
+			}
+
+			memset(m_overdrawCounts, 0, totalPixels * sizeof(U16));
+		}
+		else if (m_debugView == DEBUGVIEW_TileCost)
+		{
+			if (m_tileCosts == NULL)
+			{
+				m_tileCosts = new U64[totalTiles];
+			}
+
+			memset(m_tileCosts, 0, totalTiles * sizeof(U64));
+		}
+
+		BindDebugCounters();
+	}
+
+	DebugView RenderDevice::GetDebugView() const
+	{
+		return m_debugView;
+	}
+
+	void RenderDevice::BindDebugCounters()
+	{
+		bool backBuffer = m_renderTarget == m_backBufferTarget;
+		m_rasterizer->SetDebugCounters(backBuffer && m_debugView == DEBUGVIEW_Overdraw ? m_overdrawCounts : NULL,
+									   backBuffer && m_debugView == DEBUGVIEW_TileCost ? m_tileCosts : NULL);
+	}
+
+	// Maps heat from 0 to 1 onto black, blue, green, yellow and then red. Anything hotter is white.
+	static U32 HeatColour(Real heat)
+	{
+		static const Real ramp[5][3] =
+		{
+			{ 0.0f, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, 255.0f },
+			{ 0.0f, 255.0f, 0.0f },
+			{ 255.0f, 255.0f, 0.0f },
+			{ 255.0f, 0.0f, 0.0f },
+		};
+
+		if (heat <= 0.0f)
+			return 0;
+
+		if (heat > 1.0f)
+			return 0x00FFFFFF;
+
+		Real position = heat * 4.0f;
+		int stop = (int)position < 3 ? (int)position : 3;
+		Real t = position - stop;
+
+		U32 r = (U32)(ramp[stop][0] + (ramp[stop + 1][0] - ramp[stop][0]) * t);
+		U32 g = (U32)(ramp[stop][1] + (ramp[stop + 1][1] - ramp[stop][1]) * t);
+		U32 b = (U32)(ramp[stop][2] + (ramp[stop + 1][2] - ramp[stop][2]) * t);
+		return (r << RED_BIT_SHIFT) | (g << GREEN_BIT_SHIFT) | b;
+	}
+
+	void RenderDevice::ResolveDebugView()
+	{
+		U32 width = m_backBuffer->GetWidth();
+		U32 height = m_backBuffer->GetHeight();
+		U32 pitch = m_backBuffer->GetPitch() >> 2;
+		U32* pixels = (U32*)m_backBuffer->GetByteBuffer();
+
+		if (m_debugView == DEBUGVIEW_Overdraw)
+		{
+			Real scale = m_debugViewScale;
+			if (scale <= 0.0f)
+			{
+				U16 largest = 1;
+				for (U32 i = 0; i < width * height; i++)
+				{
+					largest = m_overdrawCounts[i] > largest ? m_overdrawCounts[i] : largest;
+				}
+
+				scale = (Real)largest;
+			}
+
+			Real invScale = 1.0f / scale;
+			for (U32 y = 0; y < height; y++)
+			{
+				const U16* countRow = m_overdrawCounts + y * width;
+				U32* row = pixels + y * pitch;
+				for (U32 x = 0; x < width; x++)
+				{
+					row[x] = HeatColour(countRow[x] * invScale);
+				}
+			}
+
+			memset(m_overdrawCounts, 0, width * height * sizeof(U16));
+		}
+		else if (m_debugView == DEBUGVIEW_TileCost)
+		{
+			U32 tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+			U32 tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+
+			Real scale = m_debugViewScale;
+			if (scale <= 0.0f)
+			{
+				U64 largest = 1;
+				for (U32 i = 0; i < tilesX * tilesY; i++)
+				{
+					largest = m_tileCosts[i] > largest ? m_tileCosts[i] : largest;
+				}
+
+				scale = (Real)largest;
+			}
+
+			Real invScale = 1.0f / scale;
+			for (U32 y = 0; y < height; y++)
+			{
+				const U64* tileRow = m_tileCosts + (y / RASTER_TILE_SIZE) * tilesX;
+				U32* row = pixels + y * pitch;
+				for (U32 x = 0; x < width; x++)
+				{
+					row[x] = HeatColour(tileRow[x / RASTER_TILE_SIZE] * invScale);
+				}
+			}
+
+			memset(m_tileCosts, 0, tilesX * tilesY * sizeof(U64));
+		}
+	}
+
+	const RenderStats& RenderDevice::GetFrameStats() const
+	{
+		return m_frameStats;
+	}
+
+	RenderStats RenderDevice::GetStats() const
+	{
+		RenderStats stats = m_totalStats;
+		for (int i = 0; i < m_totalStatsSlots; i++)
+		{
+			stats.Add(m_threadStats[i].stats);
+		}
+
+		return stats;
+	}
+
 	int RenderDevice::GetTrisCulled() const
 	{
-		return trisCulled;
+		return (int)GetStats().trisCulled;
 	}
 
 	int RenderDevice::GetTrisRendered() const
 	{
-		return this->trisDrawn;
+		return (int)GetStats().trisDrawn;
 	}
 
 	int RenderDevice::GetTrisSubmittedForRender() const
 	{
-		return this->trisSubmittedForDrawing;
+		return (int)GetStats().trisSubmitted;
+	}
+
+	int RenderDevice::GetLitCacheHits() const
+	{
+		return m_litCache->GetHits();
+	}
+
+	int RenderDevice::GetLitCacheRelights() const
+	{
+		return m_litCache->GetRelights();
+	}
+
+	int RenderDevice::GetTotalLitCacheEntries() const
+	{
+		return m_litCache->GetTotalEntries();
 	}
 
 	void RenderDevice::ResetStatsCounters()
 	{
-		trisDrawn = 0;
-		trisCulled = 0;
-		trisSubmittedForDrawing = 0;
+		m_totalStats.Clear();
+		for (int i = 0; i < m_totalStatsSlots; i++)
+		{
+			m_threadStats[i].stats.Clear();
+		}
+
+		if (m_litCache != NULL)
+		{
+			m_litCache->ResetStatsCounters();
+		}
 	}
 
 
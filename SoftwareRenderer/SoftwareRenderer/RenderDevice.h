@@ -14,17 +14,20 @@
 //**
 //****************************************************************************
 
+#include "Platform.h"
 #include "DataTypes.h"
 
 #include "Vertex.h"
 #include "Matrix4.h"
 #include "Vector3.h"
+#include "RenderStats.h"
 
 // Forward Declarations
 namespace SWR
 {
 	class BackBuffer;
 	class ZDepthBuffer;
+	class RenderTarget;
 	class Rasterizer;
 	class VertexBuffer;
 	class IndexBuffer;
@@ -32,6 +35,16 @@ namespace SWR
 	class TriangleClipper2D;
 	class Rectangle;
 	class LightingManager;
+	class LitVertexCache;
+	struct PixelLight;
+	struct PhongVertex;
+	struct LightScreenBounds;
+	class TiledLightList;
+	class RenderThreadManager;
+	class GBuffer;
+	struct ShadowMapView;
+	class FrameCapture;
+	class FrameArena;
 };
 
 namespace SWR
@@ -106,6 +119,42 @@ namespace SWR
 	};
 
 
+	// ------------------------------------------------------------------------
+	//								RenderPipeline
+	// ------------------------------------------------------------------------
+	// Desc:
+	// How the per-pixel lit draws are shaded.
+	// Forward lights each pixel as its triangle is rasterized, so pixels that
+	// are later drawn over have been lit for nothing.
+	// Deferred rasterizes the surfaces into a G-buffer and lights only the
+	// visible pixels in a single screen pass when the frame is presented, so
+	// the lighting cost depends on the resolution rather than the overdraw.
+	// ------------------------------------------------------------------------
+	enum RenderPipeline
+	{
+		PIPELINE_Forward,
+		PIPELINE_Deferred,
+	};
+
+	// ------------------------------------------------------------------------
+	//								DebugView
+	// ------------------------------------------------------------------------
+	// Desc:
+	// What the back-buffer shows when a frame is finished, for finding where
+	// the cost of a frame concentrates.
+	// Overdraw counts the times each pixel is drawn by triangles, and shows
+	// the counts as heat colours in place of the frame.
+	// TileCost times the spans drawn in each screen tile, along with the
+	// tile's deferred resolve, and shows each tile's time as a heat colour.
+	// Only draws to the back-buffer are counted.
+	// ------------------------------------------------------------------------
+	enum DebugView
+	{
+		DEBUGVIEW_None,
+		DEBUGVIEW_Overdraw,
+		DEBUGVIEW_TileCost,
+	};
+
 	// ------------------------------------------------------------------------
 	//								 SWRInitParams
 	// ------------------------------------------------------------------------
@@ -113,6 +162,7 @@ namespace SWR
 	// A struct used to initilise the render device when it is created.
 	// This includes back buffer dimensions, texture mapping techinique,
 	// lights to apply to scene etc.
+	// The sizes and counts start at 0, so any left unset take their defaults.
 	// ------------------------------------------------------------------------
 	struct SWRInitParams
 	{
@@ -136,7 +186,26 @@ namespace SWR
 		// See TextureMappingTypeSet enum for description.
 		TextureMappingTypeSet texMapType;
 
-		SWRInitParams(){}
+		// The maximum amount of lights in the scene. 0 uses the default of 5.
+		U16 maxSceneLights;
+
+		// The amount of threads used for the parallel render passes, including the calling thread.
+		// 0 uses one per hardware core.
+		U16 totalRenderThreads;
+
+		// The width and height of the shadow map. 0 uses the default of 512.
+		U16 shadowMapSize;
+
+		SWRInitParams()
+		:	bufferWidth(0)
+		,	bufferHeight(0)
+		,	useZBuffer(true)
+		,	bitDepth(DBD_Bit32)
+		,	texMapType(TEX_MAP_Affine)
+		,	maxSceneLights(0)
+		,	totalRenderThreads(0)
+		,	shadowMapSize(0)
+		{}
 		~SWRInitParams(){}
 	};
 
@@ -155,19 +224,64 @@ namespace SWR
 	class RenderDevice
 	{
 	private:
+#ifdef SWR_PLATFORM_WIN32
 		// The windows device context.
 		HDC winDevContext;
+#endif
 
 		// The buffers for the render-device.
 		BackBuffer* m_backBuffer;
 		ZDepthBuffer* m_zBuffer;
 
+		// The back-buffer and z-buffer as a render target, and the target currently drawn to.
+		RenderTarget* m_backBufferTarget;
+		RenderTarget* m_renderTarget;
+
 		// The rasterizer.
 		Rasterizer* m_rasterizer;
 
 		// Lighter.
 		LightingManager* m_lightManager;
 
+		// Lit vertex colours cached per mesh instance, and the instance the next lit draws belong to.
+		LitVertexCache* m_litCache;
+		U32 m_instanceID;
+
+		// The active lights flattened for the per-pixel lit path, and the per tile lists of them.
+		// Rebuilt by the first per-pixel lit draw of each frame, and of any draw after a light
+		// changed, into the frame arena.
+		PixelLight* m_pixelLights;
+		LightScreenBounds* m_lightBounds;
+		int m_totalPixelLights;
+		TiledLightList* m_lightTiles;
+		bool m_lightTilesDirty;
+
+		// The lighting manager's revision the tiles were built with; the lights can be changed
+		// through it between draws.
+		U32 m_lightTilesRevision;
+
+		// If the tiles must be rebuilt before the next per-pixel lit draw.
+		bool LightTilesStale() const;
+
+		void BuildLightTiles();
+		void CalculateLightScreenBounds(const PixelLight &light, LightScreenBounds &out);
+
+		// The worker threads for the parallel passes.
+		RenderThreadManager* m_threadManager;
+
+		// Deferred shading; the G-buffer and if it has surfaces waiting to be lit.
+		RenderPipeline m_pipeline;
+		GBuffer* m_gBuffer;
+		bool m_gBufferPending;
+
+		// Shadow mapping; the depth buffer rendered from the light and how it was projected.
+		// Created by the first shadow pass.
+		ZDepthBuffer* m_shadowBuffer;
+		ShadowMapView* m_shadowView;
+		U16 m_shadowMapSize;
+		Real m_shadowBias;
+		bool m_inShadowPass;
+
 		// The triangle clipper.
 		TriangleClipper2D* m_triClipper;
 
@@ -181,13 +295,29 @@ namespace SWR
 		// Render device initilisation functions.
 		SWR_ERR SetDisplaySettings(U16 width, U16 height, DisplayBitDepth bitDepth);
 
+		// Creates everything but the back-buffer, which depends on the platform.
+		SWR_ERR CreateDevice(const SWRInitParams &params);
+
+		// Lights anything waiting in the G-buffer so the back-buffer holds the finished frame.
+		void FinishFrame();
+
 		// Current vertex and index buffer pointers.
 		VertexBuffer* m_vertexSource;
 		IndexBuffer* m_indexSource;
 
+		// The frame's transient data, freed at the end of every frame.
+		FrameArena* m_frameArena;
+
+		// Frees the frame's transient data.
+		void ResetFrameArena();
+
 		// Our vertex triplet that represents a triangle. When rendering we assign into this buffer.
 		Vertex* m_triangle;
 		Vertex* m_clippedVerts; // Up to 9 vertices.
+		PhongVertex* m_phongVerts; // The per-pixel lit versions of the clipped vertices.
+
+		// Transforms, clips and rasterizes a single triangle with per-pixel lighting.
+		void DrawTriPhong(Vertex* tri);
 		
 		// *****************************************************************************************
 		// Function pointers that configure the renderer.
@@ -198,6 +328,7 @@ namespace SWR
 		// *****************************************************************************************
 
 		bool m_cullingEnabled;
+		bool m_spanBatchingEnabled;
 		bool IsBackfacingCC(Vertex* verts);
 		bool IsBackfacingAC(Vertex* verts);
 		
@@ -301,43 +432,142 @@ namespace SWR
 		void ToWorldSpace(Vertex* vert);
 		void ToWorldCameraSpace(Vertex* vert);
 
-		// Stats gathering.
-		int trisDrawn;
-		int trisCulled;
-		int trisSubmittedForDrawing;
+		// ToWorldCameraSpace and Project for each vertex of a triangle.
+		void TransformTri(Vertex* tri);
+		void ProjectTri(Vertex* tri);
+
+		// Stats gathering. Each render thread counts into its own slot, and the slots are merged
+		// into the frame's stats when it is finished. m_stats is the calling thread's slot.
+		RenderStatsSlot* m_threadStats;
+		int m_totalStatsSlots;
+		RenderStats* m_stats;
+		RenderStats m_frameStats;
+		RenderStats m_totalStats; // Every frame finished since ResetStatsCounters.
+
+		void MergeStats();
+
+		// The debug view, and the per pixel draw counts or per tile nanoseconds it is built from.
+		DebugView m_debugView;
+		Real m_debugViewScale;
+		U16* m_overdrawCounts;
+		U64* m_tileCosts;
+
+		// Hands the debug counters to the rasterizer while the back-buffer is the target.
+		void BindDebugCounters();
+
+		// Replaces the back-buffer with the debug view's heat map and restarts its counters.
+		void ResolveDebugView();
+
+		// The capture of the frame being drawn, while BeginCapture is in effect.
+		FrameCapture* m_capture;
+
+		// Writes the state the device is in, so a capture can be played from it.
+		void CaptureState();
+
+		// Writes a draw of a triangle range, along with any lights changed since the last draw.
+		void CaptureDraw(int command, bool useIndexBuffer, int totalTris, int start);
 		
 	protected:
 	public:
 		RenderDevice();
 		~RenderDevice();
 
+		// Creates a device without a window. The frame is read back through Present.
+		SWR_ERR Initilise(const SWRInitParams &params);
+		SWR_ERR Release();
+
+#ifdef SWR_PLATFORM_WIN32
 		SWR_ERR Initilise(const SWRInitParams &params, HWND hWnd);
 		SWR_ERR Release(HWND hWnd);
+#endif
 
 		//SWR_ERR Reset(
 
-		void ClearBackBuffer(UINT32 value);
+		void ClearBackBuffer(U32 value);
 		void ClearZBuffer();
 
 		LightingManager* GetLightingManager();
 
+		// Finishes the frame and returns the back-buffer's pixels; 32 bit, GetBackBufferPitch() bytes
+		// per row. The pointer stays valid until the device is released.
+		const U8* Present();
+
+		// The bytes between the start of each row of the back-buffer; the rows are padded to a
+		// cache line, so this can be more than width * 4.
+		U32 GetBackBufferPitch() const;
+
+		// Finishes the frame and copies it into the destination, pitch bytes per row.
+		void Present(U8* destination, U32 pitch);
+
+#ifdef SWR_PLATFORM_WIN32
 		void Present(HWND hWnd);
+#endif
 
 		// Functions that configure the set-up of the renderer
 		void SetFOV(Real FOV);
 		void SetTextureMappingType(TextureMappingTypeSet type);
 		void SetClipPlanes(float nearPlane, float farPlane);
 
+		// The focal lengths, in pixels, used to project onto the current render target.
+		Real GetFocalX() const;
+		Real GetFocalY() const;
+
 		void SetPixelColour(U16 x, U16 y, U32 colour);
 
 		void EnableBackfaceCulling(bool enable);
 		bool IsBackfaceCullingEnabled() const;
 
+		// With span batching the colour and textured list draws generate their triangles' spans in
+		// batches of up to about a thousand, and fill each batch a row at a time, which keeps the
+		// rows in the cache when there are many small triangles. The result is the same either way.
+		void EnableSpanBatching(bool enable);
+		bool IsSpanBatchingEnabled() const;
+
 		void SetVertexBuffer(VertexBuffer* buffer);
 		void SetIndexBuffer(IndexBuffer* buffer);
 
 		void SetSourceTexture(Texture* texture);
 
+		// Binds the target the following draws and clears go to; NULL binds the back-buffer.
+		// The projection is fitted to the target's dimensions, with the same field of view.
+		// Present always shows the back-buffer.
+		void SetRenderTarget(RenderTarget* target);
+		RenderTarget* GetRenderTarget();
+
+		// Selects how the per-pixel lit draws are shaded. See RenderPipeline for a description.
+		void SetRenderPipeline(RenderPipeline pipeline);
+		RenderPipeline GetRenderPipeline() const;
+
+		// The material written to the G-buffer by the following deferred draws. See GBufferMaterial.
+		void SetMaterialID(U8 material);
+
+		// Lights the surfaces drawn to the G-buffer so far into the back-buffer. Done automatically
+		// by Present; call it directly to draw over the lit scene, such as with 2D overlays.
+		void ResolveGBuffer();
+
+		// Starts rendering the shadow map of a light. The light looks down its transform's z axis like
+		// the camera, with the given field of view and clip planes. Until EndShadowPass only the
+		// depth of the DrawTrisShadowList draws is rendered, into the shadow map.
+		SWR_ERR BeginShadowPass(int lightID, const Matrix4 &lightTransform, Real FOV, Real nearPlane, Real farPlane);
+		void DrawTrisShadowList(bool useIndexBuffer, int totalTris, int start);
+
+		// Finishes the shadow map; the per-pixel lit draws that follow are shadowed from its light.
+		// There is a single shadow map, so only one light can cast shadows at a time.
+		void EndShadowPass();
+		void DisableShadows();
+
+		// Stops surfaces shadowing themselves, in depth buffer units. See ZDepthBuffer.
+		void SetShadowBias(Real bias);
+
+		// Identifies the mesh instance the following lit draws belong to. Instances that share a
+		// vertex buffer must use different IDs for their cached lighting to survive between frames.
+		void SetInstanceID(U32 instanceID);
+
+		// Flushes the cached lighting of a vertex buffer. Call when a buffer is modified; a deleted
+		// one's is dropped after it goes unused for LitVertexCache::MAX_UNUSED_FRAMES frames.
+		void InvalidateLightingCache(VertexBuffer* buffer);
+		void ClearLightingCache();
+
 		void SetWorldTransform(const Matrix4& m);
 		void SetCameraTransform(const Matrix4& m);
 		void CommitMatrixChanges(); // Recalculates the matrix inverses and concatenates camera / world into a transformation matrix.
@@ -358,6 +588,10 @@ namespace SWR
 
 		// Draws from the current vertex buffer as a triangle strip. Draws colour component and applies lighting.
 		void DrawTrisColLitStrip(bool useIndexBuffer, int totalTris, int start);
+
+		// Draws from the current vertex buffer as a triangle list. Draws colour component and applies
+		// lighting per pixel rather than per vertex.
+		void DrawTrisColPhongList(bool useIndexBuffer, int totalTris, int start);
 		
 		// Draws from the current vertex buffer as a triangle list. Draws only texture component.
 		void DrawTrisTexList(bool useIndexBuffer, int totalTris, int start);
@@ -382,13 +616,36 @@ namespace SWR
 		// Renders a 2D triangle.
 		void DrawTrisTex2D(bool useIndexBuffer, int totalTris, int start);
 
+		// Shows the cost of each frame in place of it. See DebugView for a description.
+		// The scale is the draw count, or the tile nanoseconds, shown at full heat; 0 scales each
+		// frame to its largest.
+		void SetDebugView(DebugView view, Real scale);
+		DebugView GetDebugView() const;
+
+		// Writes every call made to the device from now until the frame is presented to a file
+		// FrameReplay can play back, starting with the state the device is in. Call it between frames;
+		// a shadow map rendered before the capture is not part of it.
+		SWR_ERR BeginCapture(const char* filename);
+		bool IsCapturing() const;
+
+		// The statistics of the last finished (presented) frame.
+		const RenderStats& GetFrameStats() const;
+
+		// The statistics since ResetStatsCounters, including the frame being drawn.
+		RenderStats GetStats() const;
+
 		// Method for accessing statistics on the renderer.
 		int GetTrisCulled() const;
 		int GetTrisRendered() const;
 		int GetTrisSubmittedForRender() const;
+		int GetLitCacheHits() const;
+		int GetLitCacheRelights() const;
+		int GetTotalLitCacheEntries() const;
 
 		void ResetStatsCounters();
 
+		// The frame arena, for its usage and high water mark.
+		const FrameArena& GetFrameArena() const;
 
 	};
 	
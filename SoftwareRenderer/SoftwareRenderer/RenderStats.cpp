@@ -0,0 +1,75 @@
+//****************************************************************************
+//**
+//**    RenderStats.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "RenderStats.h"
+
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	RenderStats::RenderStats()
+	{
+		Clear();
+	}
+
+	void RenderStats::Clear()
+	{
+		vertsTransformed = 0;
+		vertsLit = 0;
+		litCacheHits = 0;
+		trisSubmitted = 0;
+		trisCulled = 0;
+		trisClipped = 0;
+		trisSplit = 0;
+		trisDrawn = 0;
+
+		pixelsShaded = 0;
+		pixelsDepthRejected = 0;
+		pixelsResolved = 0;
+		texelsFetched = 0;
+		bytesWritten = 0;
+
+		targetPixels = 0;
+
+		transientBytes = 0;
+	}
+
+	void RenderStats::Add(const RenderStats &other)
+	{
+		vertsTransformed += other.vertsTransformed;
+		vertsLit += other.vertsLit;
+		litCacheHits += other.litCacheHits;
+		trisSubmitted += other.trisSubmitted;
+		trisCulled += other.trisCulled;
+		trisClipped += other.trisClipped;
+		trisSplit += other.trisSplit;
+		trisDrawn += other.trisDrawn;
+
+		pixelsShaded += other.pixelsShaded;
+		pixelsDepthRejected += other.pixelsDepthRejected;
+		pixelsResolved += other.pixelsResolved;
+		texelsFetched += other.texelsFetched;
+		bytesWritten += other.bytesWritten;
+
+		targetPixels += other.targetPixels;
+
+		transientBytes += other.transientBytes;
+	}
+
+	Real RenderStats::GetCoverageRatio() const
+	{
+		if (targetPixels == 0)
+			return 0.0f;
+
+		return (Real)((double)pixelsShaded / (double)targetPixels);
+	}
+
+}; // End namespace SWR.
@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+//****************************************************************************
+//**
+//**    RenderStats.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "DataTypes.h"
+
+// The size of a cache line on the targeted processors, in bytes.
+#ifndef SWR_CACHE_LINE_SIZE
+#define SWR_CACHE_LINE_SIZE 64
+#endif
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								RenderStats
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Counters of the work done by the render device, used to tune scenes to
+	// a pixel budget. Pixel counts are gathered per span rather than per
+	// pixel so keeping them costs next to nothing.
+	// ------------------------------------------------------------------------
+	struct RenderStats
+	{
+		// Geometry.
+		U64 vertsTransformed;		// Into camera space; each corner of each triangle is transformed on its own.
+		U64 vertsLit;				// Lit per vertex when a lit vertex cache entry was (re)built.
+		U64 litCacheHits;			// Vertices whose lit colour was reused from the lit vertex cache.
+		U64 trisSubmitted;
+		U64 trisCulled;				// Back facing.
+		U64 trisClipped;			// Crossing the screen edges, including those clipped away entirely.
+		U64 trisSplit;				// The extra triangles that clipping produced.
+		U64 trisDrawn;				// Handed to the rasterizer, after culling and clipping.
+
+		// Pixels.
+		U64 pixelsShaded;			// Written by triangles and lines, to the target or the G-buffer.
+		U64 pixelsDepthRejected;	// Failed the depth test.
+		U64 pixelsResolved;			// Lit by the deferred resolve.
+		U64 texelsFetched;
+		U64 bytesWritten;			// To the render target, G-buffer and depth buffers.
+
+		// The pixels in the frames counted, to relate the pixel counts to.
+		U64 targetPixels;
+
+		// Memory.
+		U64 transientBytes;			// Taken from the frame arena.
+
+		RenderStats();
+
+		void Clear();
+		void Add(const RenderStats &other);
+
+		// Pixels shaded per target pixel. 1 when as many pixels are shaded as the target has; that
+		// can be every pixel drawn once or half of them drawn twice, so it is not the overdraw.
+		// Divide pixelsShaded by the distinct pixels covered for that.
+		Real GetCoverageRatio() const;
+	};
+
+	// ------------------------------------------------------------------------
+	//								RenderStatsSlot
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The counters of one render thread. The padding keeps the counters of
+	// neighbouring slots off each other's cache lines, so the threads can
+	// count without contending.
+	// ------------------------------------------------------------------------
+	struct RenderStatsSlot
+	{
+		RenderStats stats;
+		U8 padding[SWR_CACHE_LINE_SIZE];
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef RENDER_STATS_H
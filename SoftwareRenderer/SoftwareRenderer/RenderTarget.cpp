@@ -0,0 +1,189 @@
+//****************************************************************************
+//**
+//**    RenderTarget.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstring>
+
+#include "RenderTarget.h"
+
+#include "ZDepthBuffer.h"
+#include "Texture.h"
+#include "Platform.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	RenderTarget::RenderTarget()
+		: m_colour(NULL)
+		, m_width(0)
+		, m_height(0)
+		, m_pitch(0)
+		, m_format(RTFORMAT_Invalid)
+		, m_depth(NULL)
+		, m_texture(NULL)
+		, m_ownsColour(false)
+		, m_ownsDepth(false)
+	{
+	}
+
+	RenderTarget::~RenderTarget()
+	{
+		Release();
+	}
+
+	SWR_ERR RenderTarget::Initilise(U32 width, U32 height, bool useDepth)
+	{
+		Release();
+
+		if (width < 1 || height < 1)
+		{
+			LOG("Invalid render target dimensions.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		// Cache line aligned, with each row padded to start on one.
+		m_pitch = AlignPitch(width * 4);
+		m_colour = (U8*)AlignedAlloc((size_t)m_pitch * height, SWR_SURFACE_ALIGNMENT);
+		if (m_colour == NULL)
+		{
+			LOG("Render target allocation has failed.", LOG_Error);
+			m_pitch = 0;
+			return SWR_FAIL;
+		}
+
+		m_ownsColour = true;
+		m_width = width;
+		m_height = height;
+		m_format = RTFORMAT_X8R8G8B8;
+
+		if (useDepth)
+		{
+			m_depth = new ZDepthBuffer();
+			m_ownsDepth = true;
+			if (m_depth->Initilise(width, height) != SWR_OK)
+			{
+				LOG("Render target depth buffer creation has failed.", LOG_Error);
+				Release();
+				return SWR_FAIL;
+			}
+		}
+
+		return SWR_OK;
+	}
+
+	SWR_ERR RenderTarget::Initilise(U8* colour, U32 width, U32 height, U32 pitch, ZDepthBuffer* depth)
+	{
+		Release();
+
+		if (colour == NULL || width < 1 || height < 1 || pitch < width * 4)
+		{
+			LOG("Invalid surface for the render target.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		m_colour = colour;
+		m_width = width;
+		m_height = height;
+		m_pitch = pitch;
+		m_format = RTFORMAT_X8R8G8B8;
+		m_depth = depth;
+
+		return SWR_OK;
+	}
+
+	SWR_ERR RenderTarget::Initilise(Texture* texture, bool useDepth)
+	{
+		if (texture == NULL || texture->GetBytes() == NULL)
+		{
+			LOG("Render target texture has no texels.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		// Spans are written a row at a time, which a tiled texture doesn't have.
+		if (texture->GetLayout() != TEXLAYOUT_Linear)
+		{
+			LOG("Render target texture must have a linear layout.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		U32 width = texture->GetWidth();
+		U32 height = texture->GetHeight();
+		if (Initilise(texture->GetBytes(), width, height, texture->GetPitch(), NULL) != SWR_OK)
+			return SWR_FAIL;
+
+		m_texture = texture;
+
+		if (useDepth)
+		{
+			m_depth = new ZDepthBuffer();
+			m_ownsDepth = true;
+			if (m_depth->Initilise(width, height) != SWR_OK)
+			{
+				LOG("Render target depth buffer creation has failed.", LOG_Error);
+				Release();
+				return SWR_FAIL;
+			}
+		}
+
+		return SWR_OK;
+	}
+
+	void RenderTarget::Release()
+	{
+		if (m_ownsColour && m_colour != NULL)
+		{
+			AlignedFree(m_colour);
+		}
+
+		if (m_ownsDepth && m_depth != NULL)
+		{
+			delete m_depth;
+		}
+
+		m_colour = NULL;
+		m_depth = NULL;
+		m_texture = NULL;
+		m_ownsColour = false;
+		m_ownsDepth = false;
+		m_width = 0;
+		m_height = 0;
+		m_pitch = 0;
+		m_format = RTFORMAT_Invalid;
+	}
+
+	void RenderTarget::Clear(U32 colour)
+	{
+		if (m_colour == NULL)
+			return;
+
+		// Fill the first row, then copy it down the rest.
+		U32* firstRow = (U32*)m_colour;
+		for (U32 x = 0; x < m_width; x++)
+		{
+			firstRow[x] = colour;
+		}
+
+		for (U32 y = 1; y < m_height; y++)
+		{
+			memcpy(m_colour + y * m_pitch, firstRow, m_width * 4);
+		}
+	}
+
+	void RenderTarget::ClearDepth()
+	{
+		if (m_depth != NULL)
+		{
+			m_depth->Clear(ZDepthBuffer::MAX_Z_DEPTH);
+		}
+	}
+
+}; // End namespace SWR.
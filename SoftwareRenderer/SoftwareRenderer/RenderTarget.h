@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+//****************************************************************************
+//**
+//**    RenderTarget.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "DataTypes.h"
+
+// Forward Declarations
+namespace SWR
+{
+	class ZDepthBuffer;
+	class Texture;
+};
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//							  RenderTargetFormat
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The pixel format of a render target's colour surface.
+	// The rasterizer writes 32 bit pixels laid out like the back-buffer, so
+	// this is the only format that can be drawn to.
+	// ------------------------------------------------------------------------
+	enum RenderTargetFormat
+	{
+		RTFORMAT_X8R8G8B8,
+
+		RTFORMAT_Invalid,
+	};
+
+	// ------------------------------------------------------------------------
+	//								RenderTarget
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A surface the render device draws into; a colour buffer and an optional
+	// depth buffer. The colour memory is either owned by the target or
+	// borrowed from something else, such as the back-buffer or a texture.
+	// Rows may be padded, so the pitch (bytes between the start of each row)
+	// is kept separately from the width.
+	// ------------------------------------------------------------------------
+	class RenderTarget
+	{
+	private:
+		U8* m_colour;
+		U32 m_width;
+		U32 m_height;
+		U32 m_pitch;
+		RenderTargetFormat m_format;
+
+		ZDepthBuffer* m_depth;
+
+		// The texture rendered into, if the target was created from one.
+		Texture* m_texture;
+
+		// If the colour and depth buffers are released with the target.
+		bool m_ownsColour;
+		bool m_ownsDepth;
+
+	protected:
+	public:
+		RenderTarget();
+		~RenderTarget();
+
+		// Creates a target with its own colour memory and, if requested, a depth buffer.
+		SWR_ERR Initilise(U32 width, U32 height, bool useDepth);
+
+		// Wraps existing colour memory of pitch bytes per row. The depth buffer may be NULL.
+		// Neither is released by the target.
+		SWR_ERR Initilise(U8* colour, U32 width, U32 height, U32 pitch, ZDepthBuffer* depth);
+
+		// Renders into the texture's texels so they can be drawn with like any other texture.
+		// The texture must outlive the target.
+		SWR_ERR Initilise(Texture* texture, bool useDepth);
+
+		void Release();
+
+		void Clear(U32 colour);
+		void ClearDepth();
+
+		inline U8* GetColour()					{ return m_colour; }
+		inline ZDepthBuffer* GetDepth()			{ return m_depth; }
+		inline U32 GetWidth() const				{ return m_width; }
+		inline U32 GetHeight() const			{ return m_height; }
+		inline U32 GetPitch() const				{ return m_pitch; }
+		inline RenderTargetFormat GetFormat() const	{ return m_format; }
+		inline Texture* GetTexture()			{ return m_texture; }
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef RENDER_TARGET_H
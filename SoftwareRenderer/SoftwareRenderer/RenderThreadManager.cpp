@@ -0,0 +1,197 @@
+//****************************************************************************
+//**
+//**    RenderThreadManager.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+
+#include "RenderThreadManager.h"
+#include "Profiler.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	RenderThreadManager::RenderThreadManager()
+		: m_totalThreads(1)
+		, m_jobFunc(NULL)
+		, m_jobData(NULL)
+		, m_jobCount(0)
+		, m_nextIndex(0)
+		, m_itemsRemaining(0)
+		, m_jobGeneration(0)
+		, m_activeWorkers(0)
+		, m_startedWorkers(0)
+		, m_shutdown(false)
+	{
+	}
+
+	RenderThreadManager::~RenderThreadManager()
+	{
+		Release();
+	}
+
+	SWR_ERR RenderThreadManager::Initilise(int totalThreads)
+	{
+		if (totalThreads <= 0)
+		{
+			totalThreads = (int)std::thread::hardware_concurrency();
+			if (totalThreads <= 0)
+				totalThreads = 1;
+		}
+
+		m_totalThreads = totalThreads;
+		m_shutdown = false;
+		m_startedWorkers = 0;
+
+		// The calling thread is thread 0, so we only spawn the extra workers.
+		for (int i = 1; i < m_totalThreads; i++)
+		{
+			m_workers.push_back(std::thread(&RenderThreadManager::WorkerLoop, this, i));
+		}
+
+		// Once the workers have started, their first job doesn't allocate their profiler rings.
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (m_startedWorkers < m_totalThreads - 1)
+			{
+				m_jobDone.wait(lock);
+			}
+		}
+
+		LOGF(LOG_Init, "Render thread manager started with %i thread(s).", m_totalThreads);
+
+		return SWR_OK;
+	}
+
+	void RenderThreadManager::Release()
+	{
+		if (m_workers.empty())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_shutdown = true;
+		}
+		m_jobReady.notify_all();
+
+		for (unsigned int i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i].join();
+		}
+
+		m_workers.clear();
+		m_totalThreads = 1;
+	}
+
+	void RenderThreadManager::ProcessItems(int threadIndex)
+	{
+		int index;
+		while ((index = m_nextIndex.fetch_add(1)) < m_jobCount)
+		{
+			m_jobFunc(m_jobData, index, threadIndex);
+
+			if (m_itemsRemaining.fetch_sub(1) == 1)
+			{
+				// Last item done; wake the issuing thread.
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_jobDone.notify_all();
+			}
+		}
+	}
+
+	void RenderThreadManager::WorkerLoop(int threadIndex)
+	{
+		SWR_PROFILE_THREAD();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_startedWorkers++;
+			m_jobDone.notify_all();
+		}
+
+		U32 lastGeneration = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (m_shutdown == false && m_jobGeneration == lastGeneration)
+				{
+					m_jobReady.wait(lock);
+				}
+
+				if (m_shutdown)
+					return;
+
+				lastGeneration = m_jobGeneration;
+				m_activeWorkers++;
+			}
+
+			ProcessItems(threadIndex);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_activeWorkers--;
+				if (m_activeWorkers == 0)
+				{
+					m_jobDone.notify_all();
+				}
+			}
+		}
+	}
+
+	void RenderThreadManager::ParallelFor(int count, ParallelJobFunc func, void* data)
+	{
+		if (count <= 0)
+			return;
+
+		// Not worth waking anyone for.
+		if (m_workers.empty() || count == 1)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				func(data, i, 0);
+			}
+			return;
+		}
+
+		{
+			// Workers that woke late for the previous job may still be on their way out of it.
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (m_activeWorkers > 0)
+			{
+				m_jobDone.wait(lock);
+			}
+
+			m_jobFunc = func;
+			m_jobData = data;
+			m_jobCount = count;
+			m_nextIndex = 0;
+			m_itemsRemaining = count;
+			m_jobGeneration++;
+		}
+		m_jobReady.notify_all();
+
+		ProcessItems(0);
+
+		// Wait for the items still being processed by the workers, and for the workers to leave the
+		// job so none of them can pick up items of the next one with stale state.
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_itemsRemaining.load() > 0 || m_activeWorkers > 0)
+		{
+			m_jobDone.wait(lock);
+		}
+	}
+
+	int RenderThreadManager::GetTotalThreads() const
+	{
+		return m_totalThreads;
+	}
+
+}; // End namespace SWR.
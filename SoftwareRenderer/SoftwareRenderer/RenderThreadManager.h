@@ -1,2 +1,84 @@
+#pragma once
 
-// WORK IN PROGRESS!!!
\ No newline at end of file
+#ifndef RENDER_THREAD_MANAGER_H
+#define RENDER_THREAD_MANAGER_H
+
+//****************************************************************************
+//**
+//**    RenderThreadManager.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "DataTypes.h"
+
+namespace SWR
+{
+	// A job run by the thread manager. Index is the item being processed, threadIndex is the
+	// worker running it (0 is the calling thread) and can be used to index per thread storage.
+	typedef void (*ParallelJobFunc)(void* data, int index, int threadIndex);
+
+	// ------------------------------------------------------------------------
+	//							RenderThreadManager
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A small pool of worker threads used to split the render device's per
+	// frame work, such as per tile passes, across the available cores.
+	// Work is issued through ParallelFor which blocks until every item has
+	// been processed. The calling thread works through items as well, so a
+	// manager with a single thread runs everything inline.
+	// ------------------------------------------------------------------------
+	class RenderThreadManager
+	{
+	private:
+		std::vector<std::thread> m_workers;
+		int m_totalThreads;
+
+		// The current job.
+		ParallelJobFunc m_jobFunc;
+		void* m_jobData;
+		int m_jobCount;
+		std::atomic<int> m_nextIndex;
+		std::atomic<int> m_itemsRemaining;
+
+		// Job hand-off between the issuing thread and the workers.
+		std::mutex m_mutex;
+		std::condition_variable m_jobReady;
+		std::condition_variable m_jobDone;
+		U32 m_jobGeneration;
+		int m_activeWorkers; // Workers inside the current job; a new job waits for them to leave.
+		int m_startedWorkers;
+		bool m_shutdown;
+
+		void WorkerLoop(int threadIndex);
+		void ProcessItems(int threadIndex);
+	protected:
+	public:
+		RenderThreadManager();
+		~RenderThreadManager();
+
+		// Creates the workers, and waits for them to set up their per thread state. A count of 0
+		// uses one thread per hardware core.
+		SWR_ERR Initilise(int totalThreads);
+		void Release();
+
+		// Runs func over [0, count) across the pool and waits for completion.
+		void ParallelFor(int count, ParallelJobFunc func, void* data);
+
+		// The total threads work is split across, including the calling thread.
+		int GetTotalThreads() const;
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef RENDER_THREAD_MANAGER_H
@@ -0,0 +1,327 @@
+#pragma once
+
+#ifndef SWR_SIMD_H
+#define SWR_SIMD_H
+
+//****************************************************************************
+//**
+//**    SWR_SIMD.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 08/2010
+//**
+//****************************************************************************
+
+#include <cmath>
+
+#include "DataTypes.h"
+#include "Colour.h"
+
+// Use SSE when the compiler targets it (always true for x64), otherwise fall back to plain floats.
+// Define SWR_NO_SIMD to force the scalar fallback.
+#if !defined(SWR_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SWR_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								Float4
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Four floats processed together. Used by the span functions to work on 4
+	// pixels at once. All operations are free functions so the scalar fallback
+	// compiles to the same code paths as the SSE version.
+	// Masks are all bits set in a lane for true and zero for false.
+	// ------------------------------------------------------------------------
+#ifdef SWR_SIMD_SSE
+
+	typedef __m128 Float4;
+
+	inline Float4 Float4Set1(float f)				{ return _mm_set1_ps(f); }
+	inline Float4 Float4Set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+	inline Float4 Float4Zero()						{ return _mm_setzero_ps(); }
+	inline Float4 Float4Load(const float* p)		{ return _mm_loadu_ps(p); }
+	inline void Float4Store(float* p, Float4 a)		{ _mm_storeu_ps(p, a); }
+
+	inline Float4 Float4Add(Float4 a, Float4 b)		{ return _mm_add_ps(a, b); }
+	inline Float4 Float4Sub(Float4 a, Float4 b)		{ return _mm_sub_ps(a, b); }
+	inline Float4 Float4Mul(Float4 a, Float4 b)		{ return _mm_mul_ps(a, b); }
+	inline Float4 Float4Min(Float4 a, Float4 b)		{ return _mm_min_ps(a, b); }
+	inline Float4 Float4Max(Float4 a, Float4 b)		{ return _mm_max_ps(a, b); }
+
+	inline Float4 Float4LessEqual(Float4 a, Float4 b)	{ return _mm_cmple_ps(a, b); }
+	inline Float4 Float4Greater(Float4 a, Float4 b)	{ return _mm_cmpgt_ps(a, b); }
+	inline Float4 Float4And(Float4 a, Float4 b)		{ return _mm_and_ps(a, b); }
+
+	// Picks a where the mask is set, otherwise b.
+	inline Float4 Float4Select(Float4 mask, Float4 a, Float4 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// Estimated reciprocal refined with a single Newton-Raphson step (~22 bits).
+	inline Float4 Float4Rcp(Float4 a)
+	{
+		Float4 r = _mm_rcp_ps(a);
+		return _mm_sub_ps(_mm_add_ps(r, r), _mm_mul_ps(_mm_mul_ps(r, r), a));
+	}
+
+	// Estimated reciprocal square root refined with a single Newton-Raphson step.
+	inline Float4 Float4RSqrt(Float4 a)
+	{
+		Float4 r = _mm_rsqrt_ps(a);
+		Float4 muls = _mm_mul_ps(_mm_mul_ps(a, r), r);
+		return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), r), _mm_sub_ps(_mm_set1_ps(3.0f), muls));
+	}
+
+	// Converts the lanes to ints (rounding to nearest) and packs the low bytes of each as 0RGB pixels.
+	inline void Float4PackRGB(Float4 r, Float4 g, Float4 b, U32* out)
+	{
+		__m128i ri = _mm_cvtps_epi32(r);
+		__m128i gi = _mm_cvtps_epi32(g);
+		__m128i bi = _mm_cvtps_epi32(b);
+		__m128i px = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(ri, RED_BIT_SHIFT), _mm_slli_epi32(gi, GREEN_BIT_SHIFT)), bi);
+		_mm_storeu_si128((__m128i*)out, px);
+	}
+
+	// Rounds the lanes down to ints. The lanes must be in the range of an int.
+	inline void Float4FloorToInt(Float4 a, S32* out)
+	{
+		// Truncation rounds negative fractions up; the all bits set mask of those lanes takes one off.
+		__m128i t = _mm_cvttps_epi32(a);
+		__m128i roundedUp = _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(t), a));
+		_mm_storeu_si128((__m128i*)out, _mm_add_epi32(t, roundedUp));
+	}
+
+	// A bit a lane, lane 0 in the lowest, set where the mask is.
+	inline int Float4MoveMask(Float4 mask)			{ return _mm_movemask_ps(mask); }
+
+#else
+
+	struct Float4
+	{
+		float v[4];
+	};
+
+	inline Float4 Float4Set(float a, float b, float c, float d)
+	{
+		Float4 r;
+		r.v[0] = a; r.v[1] = b; r.v[2] = c; r.v[3] = d;
+		return r;
+	}
+
+	inline Float4 Float4Set1(float f)				{ return Float4Set(f, f, f, f); }
+	inline Float4 Float4Zero()						{ return Float4Set1(0.0f); }
+	inline Float4 Float4Load(const float* p)		{ return Float4Set(p[0], p[1], p[2], p[3]); }
+	inline void Float4Store(float* p, Float4 a)		{ for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+
+#define SWR_FLOAT4_OP(name, expr) \
+	inline Float4 name(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) { float x = a.v[i], y = b.v[i]; r.v[i] = (expr); } return r; }
+
+	SWR_FLOAT4_OP(Float4Add, x + y)
+	SWR_FLOAT4_OP(Float4Sub, x - y)
+	SWR_FLOAT4_OP(Float4Mul, x * y)
+	SWR_FLOAT4_OP(Float4Min, x < y ? x : y)
+	SWR_FLOAT4_OP(Float4Max, x > y ? x : y)
+
+#undef SWR_FLOAT4_OP
+
+	// Masks in the scalar version are stored as 1.0f / 0.0f.
+	inline Float4 Float4LessEqual(Float4 a, Float4 b)	{ Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] <= b.v[i] ? 1.0f : 0.0f; return r; }
+	inline Float4 Float4Greater(Float4 a, Float4 b)	{ Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? 1.0f : 0.0f; return r; }
+	inline Float4 Float4And(Float4 mask, Float4 b)	{ Float4 r; for (int i = 0; i < 4; i++) r.v[i] = mask.v[i] != 0.0f ? b.v[i] : 0.0f; return r; }
+
+	inline Float4 Float4Select(Float4 mask, Float4 a, Float4 b)
+	{
+		Float4 r;
+		for (int i = 0; i < 4; i++)
+			r.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i];
+		return r;
+	}
+
+	inline Float4 Float4Rcp(Float4 a)		{ Float4 r; for (int i = 0; i < 4; i++) r.v[i] = 1.0f / a.v[i]; return r; }
+	inline Float4 Float4RSqrt(Float4 a)		{ Float4 r; for (int i = 0; i < 4; i++) r.v[i] = 1.0f / sqrt(a.v[i]); return r; }
+
+	inline void Float4PackRGB(Float4 r, Float4 g, Float4 b, U32* out)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			out[i] = ((U32)(r.v[i] + 0.5f) << RED_BIT_SHIFT) | ((U32)(g.v[i] + 0.5f) << GREEN_BIT_SHIFT) | (U32)(b.v[i] + 0.5f);
+		}
+	}
+
+	inline void Float4FloorToInt(Float4 a, S32* out)	{ for (int i = 0; i < 4; i++) out[i] = (S32)floor(a.v[i]); }
+
+	inline int Float4MoveMask(Float4 mask)
+	{
+		int bits = 0;
+		for (int i = 0; i < 4; i++)
+			bits |= mask.v[i] != 0.0f ? 1 << i : 0;
+		return bits;
+	}
+
+#endif
+
+	// Helpers built on the primitives.
+	inline Float4 Float4MulAdd(Float4 a, Float4 b, Float4 c)
+	{
+		return Float4Add(Float4Mul(a, b), c);
+	}
+
+	inline Float4 Float4Dot3(Float4 ax, Float4 ay, Float4 az, Float4 bx, Float4 by, Float4 bz)
+	{
+		return Float4MulAdd(ax, bx, Float4MulAdd(ay, by, Float4Mul(az, bz)));
+	}
+
+	inline Float4 Float4Clamp(Float4 a, Float4 minVal, Float4 maxVal)
+	{
+		return Float4Min(Float4Max(a, minVal), maxVal);
+	}
+
+	// The rounded average of four 32 bit texels, per byte. Two channels at a time in 16 bit
+	// halves of a U32, which have room for the sum of four bytes.
+	inline U32 AverageTexels(U32 a, U32 b, U32 c, U32 d)
+	{
+		const U32 mask = 0x00FF00FF;
+		U32 lowChannels = (a & mask) + (b & mask) + (c & mask) + (d & mask) + 0x00020002;
+		U32 highChannels = ((a >> 8) & mask) + ((b >> 8) & mask) + ((c >> 8) & mask) + ((d >> 8) & mask) + 0x00020002;
+		return ((lowChannels >> 2) & mask) | (((highChannels >> 2) & mask) << 8);
+	}
+
+	// Averages each 2x2 block of texels in the two rows into a texel of the row out, which is
+	// width texels long; the rows in must be at least twice that. Builds the mip levels.
+	inline void AverageTexelRows(const U32* top, const U32* bottom, U32* out, U32 width)
+	{
+		U32 x = 0;
+
+#ifdef SWR_SIMD_SSE
+		// Four texels out at a time; the channels are widened to 16 bits to sum them.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi16(2);
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128i top0 = _mm_loadu_si128((const __m128i*)(top + x * 2));
+			__m128i top1 = _mm_loadu_si128((const __m128i*)(top + x * 2 + 4));
+			__m128i bottom0 = _mm_loadu_si128((const __m128i*)(bottom + x * 2));
+			__m128i bottom1 = _mm_loadu_si128((const __m128i*)(bottom + x * 2 + 4));
+
+			// Column sums of the texel pairs 0 and 1, 2 and 3, 4 and 5, 6 and 7.
+			__m128i columns01 = _mm_add_epi16(_mm_unpacklo_epi8(top0, zero), _mm_unpacklo_epi8(bottom0, zero));
+			__m128i columns23 = _mm_add_epi16(_mm_unpackhi_epi8(top0, zero), _mm_unpackhi_epi8(bottom0, zero));
+			__m128i columns45 = _mm_add_epi16(_mm_unpacklo_epi8(top1, zero), _mm_unpacklo_epi8(bottom1, zero));
+			__m128i columns67 = _mm_add_epi16(_mm_unpackhi_epi8(top1, zero), _mm_unpackhi_epi8(bottom1, zero));
+
+			// Add the even columns to the odd ones for texels 0 and 1 out, then 2 and 3.
+			__m128i out01 = _mm_add_epi16(_mm_unpacklo_epi64(columns01, columns23), _mm_unpackhi_epi64(columns01, columns23));
+			__m128i out23 = _mm_add_epi16(_mm_unpacklo_epi64(columns45, columns67), _mm_unpackhi_epi64(columns45, columns67));
+			out01 = _mm_srli_epi16(_mm_add_epi16(out01, round), 2);
+			out23 = _mm_srli_epi16(_mm_add_epi16(out23, round), 2);
+
+			_mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(out01, out23));
+		}
+#endif
+
+		for (; x < width; x++)
+		{
+			out[x] = AverageTexels(top[x * 2], top[x * 2 + 1], bottom[x * 2], bottom[x * 2 + 1]);
+		}
+	}
+
+	// Bilinearly filters a 2x2 block of texels; top left, top right, bottom left, bottom right.
+	// The fractions are 8 bit, 0 to 255, from the left and top texels towards the others. Two
+	// channels at a time as in AverageTexels; a channel times a weight fits in 16 bits.
+	inline U32 BilinearTexels(const U32* quad, U32 fracU, U32 fracV)
+	{
+		const U32 mask = 0x00FF00FF;
+		U32 invU = 256 - fracU, invV = 256 - fracV;
+
+		U32 leftLow = (((quad[0] & mask) * invV + (quad[2] & mask) * fracV) >> 8) & mask;
+		U32 rightLow = (((quad[1] & mask) * invV + (quad[3] & mask) * fracV) >> 8) & mask;
+		U32 leftHigh = ((((quad[0] >> 8) & mask) * invV + ((quad[2] >> 8) & mask) * fracV) >> 8) & mask;
+		U32 rightHigh = ((((quad[1] >> 8) & mask) * invV + ((quad[3] >> 8) & mask) * fracV) >> 8) & mask;
+
+		U32 low = ((leftLow * invU + rightLow * fracU) >> 8) & mask;
+		U32 high = ((leftHigh * invU + rightHigh * fracU) >> 8) & mask;
+		return low | (high << 8);
+	}
+
+	// Two pixels of BilinearTexels at once, with the same results.
+	inline void BilinearTexels2(const U32* quadA, U32 fracUA, U32 fracVA, const U32* quadB, U32 fracUB, U32 fracVB, U32* out)
+	{
+#ifdef SWR_SIMD_SSE
+		// Each pixel's texels are widened to 16 bits a channel, the top pair in one register and
+		// the bottom pair in another; lerped down, then across.
+		const __m128i zero = _mm_setzero_si128();
+		__m128i topA = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)quadA), zero);
+		__m128i bottomA = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(quadA + 2)), zero);
+		__m128i topB = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)quadB), zero);
+		__m128i bottomB = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(quadB + 2)), zero);
+
+		__m128i columnsA = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(topA, _mm_set1_epi16((short)(256 - fracVA))),
+			_mm_mullo_epi16(bottomA, _mm_set1_epi16((short)fracVA))), 8);
+		__m128i columnsB = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(topB, _mm_set1_epi16((short)(256 - fracVB))),
+			_mm_mullo_epi16(bottomB, _mm_set1_epi16((short)fracVB))), 8);
+
+		// The left column is weighted in the low four lanes, the right in the high four; adding the
+		// halves sums them.
+		short invUA = (short)(256 - fracUA), uA = (short)fracUA;
+		short invUB = (short)(256 - fracUB), uB = (short)fracUB;
+		__m128i weightedA = _mm_mullo_epi16(columnsA, _mm_setr_epi16(invUA, invUA, invUA, invUA, uA, uA, uA, uA));
+		__m128i weightedB = _mm_mullo_epi16(columnsB, _mm_setr_epi16(invUB, invUB, invUB, invUB, uB, uB, uB, uB));
+		__m128i pixelA = _mm_srli_epi16(_mm_add_epi16(weightedA, _mm_srli_si128(weightedA, 8)), 8);
+		__m128i pixelB = _mm_srli_epi16(_mm_add_epi16(weightedB, _mm_srli_si128(weightedB, 8)), 8);
+
+		_mm_storel_epi64((__m128i*)out, _mm_packus_epi16(_mm_unpacklo_epi64(pixelA, pixelB), zero));
+#else
+		out[0] = BilinearTexels(quadA, fracUA, fracVA);
+		out[1] = BilinearTexels(quadB, fracUB, fracVB);
+#endif
+	}
+
+	// Multiplies each channel of a texel by the colour's, as if both were 0 to 1; t * (c + 1) / 256,
+	// so a channel of 255 in the colour keeps the texel's.
+	inline U32 ModulateTexel(U32 texel, U32 colour)
+	{
+		U32 result = 0;
+		for (U32 shift = 0; shift < 32; shift += 8)
+		{
+			U32 channel = (((texel >> shift) & 0xFF) * (((colour >> shift) & 0xFF) + 1)) >> 8;
+			result |= channel << shift;
+		}
+
+		return result;
+	}
+
+	// ModulateTexel over count texels and colours, four at a time in 16 bit lanes.
+	inline void ModulateTexels(const U32* texels, const U32* colours, U32* out, U32 count)
+	{
+		U32 i = 0;
+
+#ifdef SWR_SIMD_SSE
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi16(1);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i texel = _mm_loadu_si128((const __m128i*)(texels + i));
+			__m128i colour = _mm_loadu_si128((const __m128i*)(colours + i));
+
+			// 255 * 256 still fits in an unsigned 16 bit lane.
+			__m128i low = _mm_mullo_epi16(_mm_unpacklo_epi8(texel, zero), _mm_add_epi16(_mm_unpacklo_epi8(colour, zero), one));
+			__m128i high = _mm_mullo_epi16(_mm_unpackhi_epi8(texel, zero), _mm_add_epi16(_mm_unpackhi_epi8(colour, zero), one));
+			_mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			out[i] = ModulateTexel(texels[i], colours[i]);
+		}
+	}
+
+}; // End namespace SWR.
+
+#endif // #ifndef SWR_SIMD_H
@@ -10,23 +10,93 @@
 //****************************************************************************
 
 #include "Texture.h"
+#include "Platform.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
 
 namespace SWR
 {
 	Texture::Texture()
 	{
 		m_bytes = NULL;
+		m_width = 0;
+		m_height = 0;
+		m_pitch = 0;
+		m_layout = TEXLAYOUT_Linear;
+		m_addressMode = TEXADDRESS_Clamp;
+		m_filter = TEXFILTER_Nearest;
+		m_totalLevels = 1;
 	}
 
 	Texture::~Texture()
 	{
+		ReleaseMips();
+
 		if (m_bytes != NULL)
 		{
-			delete [] m_bytes;
+			AlignedFree(m_bytes);
 			m_bytes = NULL;
 		}
 	}
 
+	SWR_ERR Texture::AllocateTexels(U16 width, U16 height, TextureLayout layout)
+	{
+		ReleaseMips();
+
+		if (m_bytes != NULL)
+		{
+			AlignedFree(m_bytes);
+		}
+
+		TextureLevel level;
+		SWR_ERR result = AllocateLevel(level, width, height, layout);
+
+		m_bytes = level.bytes;
+		m_width = level.width;
+		m_height = level.height;
+		m_pitch = level.pitch;
+		m_layout = layout;
+		return result;
+	}
+
+	SWR_ERR Texture::AllocateLevel(TextureLevel &level, U16 width, U16 height, TextureLayout layout)
+	{
+		// A tiled texture's last row of blocks is whole, whatever the height.
+		U32 rows = height;
+		if (layout == TEXLAYOUT_Tiled)
+		{
+			rows = (rows + TEXTURE_TILE_SIZE - 1) & ~(TEXTURE_TILE_SIZE - 1);
+		}
+
+		// Each row of a tiled texture is a row of blocks, a cache line each.
+		level.pitch = AlignPitch((U32)width * 4);
+		level.layout = layout;
+		level.bytes = (U8*)AlignedAlloc((size_t)level.pitch * rows, SWR_SURFACE_ALIGNMENT);
+		if (level.bytes == NULL)
+		{
+			LOG("Texture allocation has failed.", LOG_Error);
+			level.width = 0;
+			level.height = 0;
+			level.pitch = 0;
+			return SWR_FAIL;
+		}
+
+		level.width = width;
+		level.height = height;
+		return SWR_OK;
+	}
+
+	void Texture::ReleaseMips()
+	{
+		for (U32 i = 1; i < m_totalLevels; i++)
+		{
+			AlignedFree(m_mips[i - 1].bytes);
+		}
+
+		m_totalLevels = 1;
+	}
+
 	std::string Texture::GetFileName() const
 	{
 		return m_file;
@@ -42,8 +112,69 @@ namespace SWR
 		return m_height;
 	}
 
+	U32 Texture::GetPitch() const
+	{
+		return m_pitch;
+	}
+
+	TextureLayout Texture::GetLayout() const
+	{
+		return m_layout;
+	}
+
 	U8* Texture::GetBytes()
 	{
 		return m_bytes;
 	}
+
+	TextureAddressMode Texture::GetAddressMode() const
+	{
+		return m_addressMode;
+	}
+
+	void Texture::SetAddressMode(TextureAddressMode mode)
+	{
+		if (mode >= TEXADDRESS_Invalid)
+		{
+			LOG("Invalid texture address mode.", LOG_Warning);
+			return;
+		}
+
+		m_addressMode = mode;
+	}
+
+	TextureFilter Texture::GetFilter() const
+	{
+		return m_filter;
+	}
+
+	void Texture::SetFilter(TextureFilter filter)
+	{
+		if (filter >= TEXFILTER_Invalid)
+		{
+			LOG("Invalid texture filter.", LOG_Warning);
+			return;
+		}
+
+		m_filter = filter;
+	}
+
+	U32 Texture::GetTotalLevels() const
+	{
+		return m_totalLevels;
+	}
+
+	TextureLevel Texture::GetLevel(U32 level) const
+	{
+		if (level >= m_totalLevels)
+		{
+			level = m_totalLevels - 1;
+		}
+
+		if (level > 0)
+			return m_mips[level - 1];
+
+		TextureLevel base = { m_bytes, m_width, m_height, m_pitch, m_layout };
+		return base;
+	}
 }; // End namespace SWR.
\ No newline at end of file
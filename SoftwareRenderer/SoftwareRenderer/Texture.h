@@ -20,20 +20,138 @@
 
 namespace SWR
 {
+	// ------------------------------------------------------------------------
+	//								TextureLayout
+	// ------------------------------------------------------------------------
+	// Desc:
+	// How the texels of a texture are ordered in memory.
+	// Linear is row after row, which suits copying and rendering into.
+	// Tiled is 4x4 blocks of texels, each block a single cache line, in rows
+	// of blocks. Texels that are close in both U and V share a line, so a
+	// span that walks across the texture at an angle touches far fewer lines
+	// than it does in rows.
+	// ------------------------------------------------------------------------
+	enum TextureLayout
+	{
+		TEXLAYOUT_Linear,
+		TEXLAYOUT_Tiled,
+
+		TEXLAYOUT_Invalid,
+	};
+
+	// ------------------------------------------------------------------------
+	//								TextureAddressMode
+	// ------------------------------------------------------------------------
+	// Desc:
+	// What a texture gives for UVs outside of [0, 1].
+	// Wrap repeats it, so a small texture can tile across a large surface.
+	// Mirror repeats it flipped every other time, so the tiles' edges meet.
+	// Clamp stretches the edge texels out, and is the default.
+	// Textures with power of 2 sizes are addressed with shifts and masks.
+	// ------------------------------------------------------------------------
+	enum TextureAddressMode
+	{
+		TEXADDRESS_Clamp,
+		TEXADDRESS_Wrap,
+		TEXADDRESS_Mirror,
+
+		TEXADDRESS_Invalid,
+	};
+
+	// ------------------------------------------------------------------------
+	//								TextureFilter
+	// ------------------------------------------------------------------------
+	// Desc:
+	// How a texture is sampled between its texels.
+	// Nearest takes the texel the UV falls in, and is the default.
+	// Bilinear blends the four texels around it, which smooths magnified
+	// textures for roughly twice the cost of a nearest span.
+	// ------------------------------------------------------------------------
+	enum TextureFilter
+	{
+		TEXFILTER_Nearest,
+		TEXFILTER_Bilinear,
+
+		TEXFILTER_Invalid,
+	};
+
+	// The size of a tiled texture's blocks along a side, and its log 2.
+	const U32 TEXTURE_TILE_SIZE = 4;
+	const U32 TEXTURE_TILE_SHIFT = 2;
+
+	// The index of texel (u, v) in tiled texels whose rows of blocks are blockRowTexels apart.
+	inline U32 TiledTexelIndex(U32 u, U32 v, U32 blockRowTexels)
+	{
+		return (v >> TEXTURE_TILE_SHIFT) * blockRowTexels + ((u >> TEXTURE_TILE_SHIFT) << (TEXTURE_TILE_SHIFT * 2))
+			+ ((v & (TEXTURE_TILE_SIZE - 1)) << TEXTURE_TILE_SHIFT) + (u & (TEXTURE_TILE_SIZE - 1));
+	}
+
+	// The index of texel (u, v) in texels of the layout whose rows are pitch bytes apart.
+	inline U32 TexelIndex(U32 u, U32 v, U32 pitch, TextureLayout layout)
+	{
+		U32 pitchTexels = pitch >> 2;
+		return layout == TEXLAYOUT_Tiled ? TiledTexelIndex(u, v, pitchTexels << TEXTURE_TILE_SHIFT) : u + v * pitchTexels;
+	}
+
+	// Enough levels for a chain from the largest texture down to 1x1.
+	const U32 TEXTURE_MAX_LEVELS = 17;
+
+	// ------------------------------------------------------------------------
+	//								TextureLevel
+	// ------------------------------------------------------------------------
+	// Desc:
+	// A single mip level of a texture; level 0 is the texture itself and each
+	// level after it is half the size of the last, down to 1x1. Levels are
+	// in the texture's layout and padded in the same way.
+	// ------------------------------------------------------------------------
+	struct TextureLevel
+	{
+		U8* bytes;
+		U16 width, height;
+		U32 pitch;
+		TextureLayout layout;
+
+		inline U32 GetTexelIndex(U32 u, U32 v) const
+		{
+			return TexelIndex(u, v, pitch, layout);
+		}
+	};
+
 	// ------------------------------------------------------------------------
 	//								Texture
 	// ------------------------------------------------------------------------
 	// Desc:
-	// 
+	// 32 bit texels in cache line aligned memory. Each row is padded to start
+	// on a cache line, so rows are GetPitch() bytes apart, not width * 4.
+	// A tiled texture keeps the same pitch, and its rows of blocks are four
+	// times it apart; the height is padded to a whole row of blocks.
+	// A texture may also carry a chain of mip levels, built by the texture
+	// manager, for the rasterizer to sample when the texture is minified.
 	// ------------------------------------------------------------------------
 	class Texture
 	{
 	private:
 		std::string m_file;
 		U16 m_width, m_height;
+		U32 m_pitch;
+		TextureLayout m_layout;
+		TextureAddressMode m_addressMode;
+		TextureFilter m_filter;
 
 		U8* m_bytes;
 
+		// Levels 1 and on; level 0 is the members above.
+		TextureLevel m_mips[TEXTURE_MAX_LEVELS - 1];
+		U32 m_totalLevels;
+
+		// Allocates uninitialised texels for the size and layout, releasing any held already along with the mips.
+		SWR_ERR AllocateTexels(U16 width, U16 height, TextureLayout layout = TEXLAYOUT_Linear);
+
+		// Allocates uninitialised texels for a level of the size and layout.
+		static SWR_ERR AllocateLevel(TextureLevel &level, U16 width, U16 height, TextureLayout layout);
+
+		void ReleaseMips();
+
 		friend class TextureManager;
 	protected:
 	public:
@@ -43,7 +161,25 @@ namespace SWR
 		std::string GetFileName() const;
 		U16 GetWidth() const;
 		U16 GetHeight() const;
+		U32 GetPitch() const;
+		TextureLayout GetLayout() const;
 		U8* GetBytes();
+
+		TextureAddressMode GetAddressMode() const;
+		void SetAddressMode(TextureAddressMode mode);
+
+		TextureFilter GetFilter() const;
+		void SetFilter(TextureFilter filter);
+
+		// 1 unless the texture has mip levels. Levels past the last give the last.
+		U32 GetTotalLevels() const;
+		TextureLevel GetLevel(U32 level) const;
+
+		// The index of texel (u, v) in the texels of either layout.
+		inline U32 GetTexelIndex(U32 u, U32 v) const
+		{
+			return TexelIndex(u, v, m_pitch, m_layout);
+		}
 	};
 	
 }; // End namespace SWR.
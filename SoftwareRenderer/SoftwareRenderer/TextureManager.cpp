@@ -9,12 +9,15 @@
 //**
 //****************************************************************************
 
-#include <Windows.h>
+#include <cstdio>
+#include <cstring>
 
 #include "TextureManager.h"
 #include "Texture.h"
 
 #include "Colour.h"
+#include "Platform.h"
+#include "SWR_SIMD.h"
 
 #include "BMPLoader.h"
 
@@ -26,26 +29,26 @@ namespace SWR
 	// Bitmap loading structs.
 	typedef struct 
 	{
-		WORD bfType;
-		DWORD bfSize;
-		DWORD bfReserved;
-		DWORD bfOffBits;
+		U16 bfType;
+		U32 bfSize;
+		U32 bfReserved;
+		U32 bfOffBits;
 	} BITMAPFILEHEADER;
 
 	//BITMAPINFOHEADER
 	typedef struct 
 	{
-		DWORD biSize;
-		LONG biWidth;
-		LONG biHeight;
-		WORD biPlanes;
-		WORD biBitCount;
-		DWORD biCompression;
-		DWORD biSizeImage;
-		LONG biXPelsPerMeter;
-		LONG biYPelsPerMeter;
-		DWORD biClrUsed;
-		DWORD biClrImportant;
+		U32 biSize;
+		S32 biWidth;
+		S32 biHeight;
+		U16 biPlanes;
+		U16 biBitCount;
+		U32 biCompression;
+		U32 biSizeImage;
+		S32 biXPelsPerMeter;
+		S32 biYPelsPerMeter;
+		U32 biClrUsed;
+		U32 biClrImportant;
 	} BITMAPINFOHEADER;
 
 	TextureManager::TextureManager()
@@ -65,20 +68,24 @@ namespace SWR
 	Texture* TextureManager::CreateDirtyTexture(int width, int height)
 	{
 		Texture* tex = new Texture();
-		size_t size = width * height * 4;
-		tex->m_bytes = (U8*)malloc(size);
-		U8* bytes = tex->m_bytes;
+		if (tex->AllocateTexels(width, height) != SWR_OK)
+		{
+			delete tex;
+			return NULL;
+		}
 
 		U32 dirtyCol = Colour32::DIRTY.ToUINT32();
 
-		// Copy the 
-		for (int i = 0; i < size; i+=4)
+		// Copy the dirty colour into every texel, row by row to skip the padding.
+		for (int y = 0; y < height; y++)
 		{
-			memcpy(&(bytes[i]), &dirtyCol, 4);
+			U32* row = (U32*)(tex->m_bytes + y * tex->m_pitch);
+			for (int x = 0; x < width; x++)
+			{
+				row[x] = dirtyCol;
+			}
 		}
 
-		tex->m_height = height;
-		tex->m_width = width;
 		tex->m_file = "INVALID FILE";
 
 		return tex;
@@ -87,63 +94,64 @@ namespace SWR
 	Texture* TextureManager::AlignTo32BitTexture(U8* bytes, const char* filename, int width, int height, bool flip)
 	{
 		Texture* tex = new Texture();
-		size_t sizeSource = width * height * 3; // 3 bytes as it is 24 bit.
-		size_t sizeTarget = width * height * 4; // 4 bytes as our target is 32 bit.
 
 		// Allocate our new texture buffer.
-		tex->m_bytes = (U8*)malloc(sizeTarget);
-		U8* targetBuffer = tex->m_bytes;
+		if (tex->AllocateTexels(width, height) != SWR_OK)
+		{
+			delete tex;
+			return NULL;
+		}
 
-		// The current byte index for our
-		U32 byteIndex = 0;
+		// The current byte index into the 24 bit source; its rows are not padded.
+		U32 sourceIndex = 0;
 
-		// Iterate over our input byte buffer and copy over the pixels.
-		for (unsigned int i = 0; i < sizeSource; i+=3)
+		// Iterate over our input byte buffer and copy over the pixels a row at a time.
+		for (int y = 0; y < height; y++)
 		{
-			targetBuffer[byteIndex] = bytes[i + 2];      // Red channel.
-			targetBuffer[byteIndex + 1] = bytes[i + 1];  // Green channel.
-			targetBuffer[byteIndex + 2] = bytes[i];      // Blue channel.
-			targetBuffer[byteIndex + 3] = 0;             // Alpha channel.
-
-			byteIndex += 4;
+			U8* targetBuffer = tex->m_bytes + y * tex->m_pitch;
+			for (int x = 0; x < width; x++)
+			{
+				targetBuffer[0] = bytes[sourceIndex + 2];  // Red channel.
+				targetBuffer[1] = bytes[sourceIndex + 1];  // Green channel.
+				targetBuffer[2] = bytes[sourceIndex];      // Blue channel.
+				targetBuffer[3] = 0;                       // Alpha channel.
+
+				targetBuffer += 4;
+				sourceIndex += 3;
+			}
 		}
 
 		// Flip the textures Y axis.
 		if (flip)
 		{
-			U8* flippedTex = FlipTextureYAxis(tex->m_bytes, width, height);
-
-			// Release the old buffer.
-			delete [] tex->m_bytes;
-			tex->m_bytes = flippedTex;
+			FlipTextureYAxis(tex);
 		}
 
-
 		tex->m_file = filename;
-		tex->m_height = height;
-		tex->m_width = width;
 
 		return tex;
 	}
 
-	U8* TextureManager::FlipTextureYAxis(U8* texture, int width, int height)
+	void TextureManager::FlipTextureYAxis(Texture* texture)
 	{
-		// Allocate a new buffer.
-		U8* buffer = (U8*)malloc(width * height * 4);
-
-		U16 targetRow = 0;
-		U16 lineSpan = width << 2;
+		U16 width = texture->m_width;
+		U16 height = texture->m_height;
 
-		for (U16 sourceRow = height - 1; sourceRow > 0; sourceRow--)
+		// Swap the rows from the top and bottom towards the middle.
+		for (U16 topRow = 0; topRow < height / 2; topRow++)
 		{
-			memcpy(&(buffer[width * targetRow * 4]), &(texture[width * sourceRow * 4]), lineSpan);
-			targetRow++;
+			U32* top = (U32*)(texture->m_bytes + topRow * texture->m_pitch);
+			U32* bottom = (U32*)(texture->m_bytes + (height - 1 - topRow) * texture->m_pitch);
+			for (U16 x = 0; x < width; x++)
+			{
+				U32 texel = top[x];
+				top[x] = bottom[x];
+				bottom[x] = texel;
+			}
 		}
-
-		return buffer;
 	}
 
-	SWR_ERR TextureManager::LoadTexture(const char* filename, Texture* &target, int width, int height, bool flip)
+	SWR_ERR TextureManager::LoadTexture(const char* filename, Texture* &target, int width, int height, bool flip, bool mipmaps, TextureLayout layout)
 	{
 		BMPLoader::BMPClass* bitmap = new BMPLoader::BMPClass();
 		char result = BMPLoader::BMPLoad(std::string(filename), *bitmap);
@@ -182,9 +190,170 @@ namespace SWR
 
 			// Clean up after our selves.
 			delete bitmap;
+
+			if (target != NULL && mipmaps)
+			{
+				GenerateMipmaps(target);
+			}
+
+			if (target != NULL && layout != TEXLAYOUT_Linear)
+			{
+				return SetTextureLayout(target, layout);
+			}
+		}
+
+		return SWR_OK;
+	}
+
+	SWR_ERR TextureManager::CreateTexture(int width, int height, Texture* &target)
+	{
+		if (width < 1 || height < 1)
+		{
+			LOG("Invalid texture dimensions.", LOG_Warning);
+			target = NULL;
+			return SWR_FAIL;
 		}
 
+		Texture* tex = new Texture();
+		if (tex->AllocateTexels(width, height) != SWR_OK)
+		{
+			delete tex;
+			target = NULL;
+			return SWR_FAIL;
+		}
+
+		memset(tex->m_bytes, 0, (size_t)tex->m_pitch * height);
+		tex->m_file = "RENDER TEXTURE";
+
+		target = tex;
 		return SWR_OK;
 	}
+
+	SWR_ERR TextureManager::RelayTextureLevel(TextureLevel &level, TextureLayout layout)
+	{
+		TextureLevel relaid;
+		if (Texture::AllocateLevel(relaid, level.width, level.height, layout) != SWR_OK)
+			return SWR_FAIL;
+
+		// Padding texels in the last row of blocks are left black.
+		if (layout == TEXLAYOUT_Tiled)
+		{
+			U32 rows = (level.height + TEXTURE_TILE_SIZE - 1) & ~(TEXTURE_TILE_SIZE - 1);
+			memset(relaid.bytes, 0, (size_t)relaid.pitch * rows);
+		}
+
+		const U32* from = (const U32*)level.bytes;
+		U32* to = (U32*)relaid.bytes;
+		for (U32 v = 0; v < level.height; v++)
+		{
+			for (U32 u = 0; u < level.width; u++)
+			{
+				to[relaid.GetTexelIndex(u, v)] = from[level.GetTexelIndex(u, v)];
+			}
+		}
+
+		AlignedFree(level.bytes);
+		level = relaid;
+		return SWR_OK;
+	}
+
+	SWR_ERR TextureManager::SetTextureLayout(Texture* texture, TextureLayout layout)
+	{
+		if (texture == NULL || texture->m_bytes == NULL || layout >= TEXLAYOUT_Invalid)
+		{
+			LOG("Invalid texture or layout.", LOG_Warning);
+			return SWR_FAIL;
+		}
+
+		if (texture->m_layout == layout)
+			return SWR_OK;
+
+		// Level 0 is kept in the texture's own members; relay it like the mips and put it back.
+		TextureLevel base = texture->GetLevel(0);
+		if (RelayTextureLevel(base, layout) != SWR_OK)
+			return SWR_FAIL;
+
+		texture->m_bytes = base.bytes;
+		texture->m_pitch = base.pitch;
+		texture->m_layout = layout;
+
+		for (U32 i = 1; i < texture->m_totalLevels; i++)
+		{
+			if (RelayTextureLevel(texture->m_mips[i - 1], layout) != SWR_OK)
+			{
+				// Levels in a mix of layouts can't be sampled; drop them all.
+				texture->ReleaseMips();
+				return SWR_FAIL;
+			}
+		}
+
+		return SWR_OK;
+	}
+
+	// Averages each 2x2 block of the source into a texel of the level half its size. A source
+	// a single texel high or wide repeats its last row or column.
+	static void DownsampleLevel(const TextureLevel &source, const TextureLevel &level)
+	{
+		for (U32 y = 0; y < level.height; y++)
+		{
+			U32 bottomRow = y * 2 + 1 < source.height ? y * 2 + 1 : source.height - 1;
+			const U32* top = (const U32*)(source.bytes + y * 2 * source.pitch);
+			const U32* bottom = (const U32*)(source.bytes + bottomRow * source.pitch);
+			U32* out = (U32*)(level.bytes + y * level.pitch);
+
+			if (source.width > 1)
+			{
+				AverageTexelRows(top, bottom, out, level.width);
+			}
+			else
+			{
+				out[0] = AverageTexels(top[0], top[0], bottom[0], bottom[0]);
+			}
+		}
+	}
+
+	SWR_ERR TextureManager::GenerateMipmaps(Texture* texture)
+	{
+		if (texture == NULL || texture->m_bytes == NULL)
+		{
+			LOG("Invalid texture to build mip levels for.", LOG_Warning);
+			return SWR_FAIL;
+		}
+
+		// The levels are averaged a row at a time, so they are built linear and relaid after.
+		TextureLayout layout = texture->m_layout;
+		if (SetTextureLayout(texture, TEXLAYOUT_Linear) != SWR_OK)
+			return SWR_FAIL;
+
+		texture->ReleaseMips();
+
+		TextureLevel source = texture->GetLevel(0);
+		while ((source.width > 1 || source.height > 1) && texture->m_totalLevels < TEXTURE_MAX_LEVELS)
+		{
+			U16 width = source.width > 1 ? source.width >> 1 : 1;
+			U16 height = source.height > 1 ? source.height >> 1 : 1;
+
+			TextureLevel &level = texture->m_mips[texture->m_totalLevels - 1];
+			if (Texture::AllocateLevel(level, width, height, TEXLAYOUT_Linear) != SWR_OK)
+			{
+				texture->ReleaseMips();
+				return SWR_FAIL;
+			}
+
+			DownsampleLevel(source, level);
+			texture->m_totalLevels++;
+			source = level;
+		}
+
+		return SetTextureLayout(texture, layout);
+	}
+
+	void TextureManager::ReleaseMipmaps(Texture* texture)
+	{
+		if (texture != NULL)
+		{
+			texture->ReleaseMips();
+		}
+	}
 	
 }; // End namespace SWR.
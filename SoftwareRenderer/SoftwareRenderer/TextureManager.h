@@ -15,11 +15,7 @@
 //****************************************************************************
 
 #include "DataTypes.h"
-
-namespace SWR
-{
-	class Texture;
-};
+#include "Texture.h"
 
 namespace SWR
 {
@@ -45,8 +41,11 @@ namespace SWR
 		// Takes a 24bit bitmap and re-creates it so that it fits into a standard texture used for 
 		Texture* AlignTo32BitTexture(U8* bytes, const char* filename, int width, int height, bool flip);
 
-		// Flips the texture so that the Y axis will run from top to bottom.
-		U8* FlipTextureYAxis(U8* texture, int width, int height);
+		// Flips the texture in place so that the Y axis will run from top to bottom.
+		void FlipTextureYAxis(Texture* texture);
+
+		// Reorders a level's texels into the layout in a new allocation, freeing the old one.
+		SWR_ERR RelayTextureLevel(TextureLevel &level, TextureLayout layout);
 
 	protected:
 	public:
@@ -56,7 +55,20 @@ namespace SWR
 		// Loads a bitmap from disk. If the bitmap is 24 bit, Will add 8 bytes of padding so that
 		// when they are used for rendering we have a pow2 for clean pixel copying and
 		// it will also align into memory better.
-		SWR_ERR LoadTexture(const char* filename, Texture* &target, int width, int height, bool flip);
+		// Textures that are only sampled can be loaded with mip levels, and tiled, see TextureLayout.
+		SWR_ERR LoadTexture(const char* filename, Texture* &target, int width, int height, bool flip, bool mipmaps = false, TextureLayout layout = TEXLAYOUT_Linear);
+
+		// Creates a black texture, such as one to render into through a RenderTarget.
+		// Always linear, as render targets need their rows whole.
+		SWR_ERR CreateTexture(int width, int height, Texture* &target);
+
+		// Reorders the texture's texels, and its mip levels, into the layout; does nothing if it is in it already.
+		SWR_ERR SetTextureLayout(Texture* texture, TextureLayout layout);
+
+		// Builds the texture's chain of mip levels down to 1x1 with a box filter, replacing any
+		// it had. The levels have to be rebuilt if the texels change.
+		SWR_ERR GenerateMipmaps(Texture* texture);
+		void ReleaseMipmaps(Texture* texture);
 
 	};
 	
@@ -0,0 +1,149 @@
+//****************************************************************************
+//**
+//**    TiledLightList.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstring>
+
+#include "TiledLightList.h"
+
+#include "RenderThreadManager.h"
+#include "Profiler.h"
+
+#include "Logger.h"
+#include "MemoryLeak.h"
+
+namespace SWR
+{
+	TiledLightList::TiledLightList()
+		: m_maxLights(0)
+		, m_indices(NULL)
+		, m_counts(NULL)
+		, m_bounds(NULL)
+		, m_totalLights(0)
+	{
+		memset(&m_grid, 0, sizeof(TileGrid));
+	}
+
+	TiledLightList::~TiledLightList()
+	{
+		Release();
+	}
+
+	SWR_ERR TiledLightList::Initilise(const TileGrid &grid, int maxLights)
+	{
+		Release();
+
+		if (grid.tilesX == 0 || grid.tilesY == 0 || maxLights <= 0)
+		{
+			LOG("Invalid tile grid or light count for the tiled light list.", LOG_Error);
+			return SWR_FAIL;
+		}
+
+		m_grid = grid;
+		m_maxLights = maxLights;
+
+		return SWR_OK;
+	}
+
+	void TiledLightList::Release()
+	{
+		SetStorage(NULL);
+	}
+
+	U32 TiledLightList::GetStorageSize() const
+	{
+		U32 totalTiles = m_grid.tilesX * m_grid.tilesY;
+		return sizeof(U16) * totalTiles * (m_maxLights + 1);
+	}
+
+	void TiledLightList::SetStorage(void* memory)
+	{
+		if (memory == NULL)
+		{
+			m_indices = NULL;
+			m_counts = NULL;
+			return;
+		}
+
+		// The counts follow the indices.
+		U32 totalTiles = m_grid.tilesX * m_grid.tilesY;
+		m_indices = (U16*)memory;
+		m_counts = m_indices + totalTiles * m_maxLights;
+		memset(m_counts, 0, sizeof(U16) * totalTiles);
+	}
+
+	bool TiledLightList::HasStorage() const
+	{
+		return m_indices != NULL;
+	}
+
+	void TiledLightList::BuildRowJob(void* data, int row, int)
+	{
+		SWR_PROFILE_SCOPE("LightTileRow");
+		((TiledLightList*)data)->BuildRow((U32)row);
+	}
+
+	void TiledLightList::BuildRow(U32 row)
+	{
+		S32 tileMinY = row * m_grid.tileSize;
+		S32 tileMaxY = tileMinY + m_grid.tileSize - 1;
+
+		for (U32 column = 0; column < m_grid.tilesX; column++)
+		{
+			S32 tileMinX = column * m_grid.tileSize;
+			S32 tileMaxX = tileMinX + m_grid.tileSize - 1;
+
+			U32 tile = column + row * m_grid.tilesX;
+			U16* indices = &m_indices[tile * m_maxLights];
+			U16 count = 0;
+
+			for (int i = 0; i < m_totalLights; i++)
+			{
+				// An empty rectangle can still straddle the edges of a tile, so is tested for first.
+				const LightScreenBounds &b = m_bounds[i];
+				if (b.minX > b.maxX || b.minY > b.maxY)
+					continue;
+
+				if (b.maxX < tileMinX || b.minX > tileMaxX || b.maxY < tileMinY || b.minY > tileMaxY)
+					continue;
+
+				indices[count++] = (U16)i;
+			}
+
+			m_counts[tile] = count;
+		}
+	}
+
+	void TiledLightList::Build(const LightScreenBounds* bounds, int totalLights, RenderThreadManager* threads)
+	{
+		m_bounds = bounds;
+		m_totalLights = totalLights < m_maxLights ? totalLights : m_maxLights;
+
+		if (threads != NULL)
+		{
+			threads->ParallelFor(m_grid.tilesY, &TiledLightList::BuildRowJob, this);
+		}
+		else
+		{
+			for (U32 row = 0; row < m_grid.tilesY; row++)
+			{
+				BuildRow(row);
+			}
+		}
+
+		m_bounds = NULL;
+	}
+
+	const TileGrid& TiledLightList::GetGrid() const
+	{
+		return m_grid;
+	}
+
+}; // End namespace SWR.
@@ -0,0 +1,99 @@
+#pragma once
+
+#ifndef TILED_LIGHT_LIST_H
+#define TILED_LIGHT_LIST_H
+
+//****************************************************************************
+//**
+//**    TiledLightList.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "DataTypes.h"
+#include "Rasterizer.h"
+
+// Forward Declarations
+namespace SWR
+{
+	class RenderThreadManager;
+};
+
+namespace SWR
+{
+	// ------------------------------------------------------------------------
+	//								LightScreenBounds
+	// ------------------------------------------------------------------------
+	// Desc:
+	// The inclusive screen rectangle a light can affect. A rectangle with 
+	// minX > maxX affects nothing.
+	// ------------------------------------------------------------------------
+	struct LightScreenBounds
+	{
+		S32 minX, minY;
+		S32 maxX, maxY;
+	};
+
+	// ------------------------------------------------------------------------
+	//								TiledLightList
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Per screen tile lists of the lights that can affect the tile, so per
+	// pixel lighting only evaluates the handful of lights near a pixel rather
+	// than every light in the scene.
+	// Built once per frame from the screen bounds of each light's falloff
+	// sphere, one tile row per job across the render threads.
+	// The lists are kept in memory handed to it, from the frame arena, so
+	// they must be given storage before each frame's first build.
+	// ------------------------------------------------------------------------
+	class TiledLightList
+	{
+	private:
+		TileGrid m_grid;
+		int m_maxLights;
+
+		// m_maxLights light indices per tile, and the amount used by each tile. Not owned.
+		U16* m_indices;
+		U16* m_counts;
+
+		// The input of the build in progress.
+		const LightScreenBounds* m_bounds;
+		int m_totalLights;
+
+		static void BuildRowJob(void* data, int row, int threadIndex);
+		void BuildRow(U32 row);
+	protected:
+	public:
+		TiledLightList();
+		~TiledLightList();
+
+		// Sizes the lists to the grid. Any storage is dropped, as it may no longer fit.
+		SWR_ERR Initilise(const TileGrid &grid, int maxLights);
+		void Release();
+
+		// The bytes of storage the lists need, and the storage to keep them in; NULL to drop it.
+		U32 GetStorageSize() const;
+		void SetStorage(void* memory);
+		bool HasStorage() const;
+
+		// Rebuilds the tile lists. The bounds are indexed the same as the lights given to the rasterizer.
+		void Build(const LightScreenBounds* bounds, int totalLights, RenderThreadManager* threads);
+
+		// Returns the light indices for the tile and their count.
+		inline const U16* GetTileLights(U32 tileX, U32 tileY, int &count) const
+		{
+			U32 tile = tileX + tileY * m_grid.tilesX;
+			count = m_counts[tile];
+			return &m_indices[tile * m_maxLights];
+		}
+
+		const TileGrid& GetGrid() const;
+	};
+
+}; // End namespace SWR.
+
+#endif // #ifndef TILED_LIGHT_LIST_H
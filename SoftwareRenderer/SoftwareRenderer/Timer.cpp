@@ -9,36 +9,48 @@
 //**
 //****************************************************************************
 
-#include <windows.h>
-#include <iostream>
+#include <chrono>
 
 #include "Timer.h"
 
+#include "Logger.h"
 #include "MemoryLeak.h"
 
 namespace SWR
 {
+	// The high resolution counter; the steady clock, in its own ticks.
+	typedef std::chrono::steady_clock TimerClock;
+
+	static S64 CountsPerSecond()
+	{
+		return (S64)TimerClock::period::den / TimerClock::period::num;
+	}
+
+	static S64 ReadCounter()
+	{
+		return (S64)TimerClock::now().time_since_epoch().count();
+	}
 
 	Timer::Timer()
-	:	mSecondsPerCount (0.0f)
+	:	m_ticked(false)
+	,	mSecondsPerCount (0.0f)
 	,	mDeltaTime(-1.0f)
-	,	mBaseTime(0)
-	,	mPrevTime(0)
-	,	mCurrTime(0)
 	,   mAvSecsPerFrame(0)
+	,   FPS(0)
 	,   numFrames(0)
 	,   timeElapsed(0.0f)
+	,	mBaseTime(0)
+	,	mPrevTime(0)
+	,	mCurrTime(0)
 	{
-		__int64 countsPerSec = 0;
-		QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+		S64 countsPerSec = CountsPerSecond();
 		mSecondsPerCount=1.0f/(double)countsPerSec;
 	}
 
 	void Timer::Tick()
 	{
 		//Get the current time for this frame
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		S64 currTime = ReadCounter();
 		mCurrTime=currTime;
 
 		//calculate the delta between current frame and last frame in seconds
@@ -55,6 +67,14 @@ namespace SWR
 			mDeltaTime=0;
 		}
 
+		// The first tick has no frame before it.
+		if (m_ticked)
+		{
+			m_frameTimes.AddSample(mDeltaTime * 1000.0);
+		}
+
+		m_ticked = true;
+
 		timeElapsed += this->getDeltaTime();
 		numFrames++;
 
@@ -91,4 +111,75 @@ namespace SWR
 		return FPS;
 	}
 
+	const FrameTimeHistogram& Timer::GetFrameTimes() const
+	{
+		return m_frameTimes;
+	}
+
+	void Timer::SetFrameBudget(float seconds)
+	{
+		m_frameTimes.SetBudget(seconds * 1000.0);
+	}
+
+	int Timer::AddStage(const char* name, float budgetSeconds)
+	{
+		Stage stage;
+		stage.name = name;
+		stage.times.SetBudget(budgetSeconds * 1000.0);
+		stage.start = 0;
+		m_stages.push_back(stage);
+		return (int)m_stages.size() - 1;
+	}
+
+	int Timer::FindStage(const char* name) const
+	{
+		for (size_t i = 0; i < m_stages.size(); i++)
+		{
+			if (m_stages[i].name == name)
+				return (int)i;
+		}
+
+		return -1;
+	}
+
+	int Timer::GetTotalStages() const
+	{
+		return (int)m_stages.size();
+	}
+
+	const char* Timer::GetStageName(int stage) const
+	{
+		return m_stages[stage].name.c_str();
+	}
+
+	const FrameTimeHistogram& Timer::GetStageTimes(int stage) const
+	{
+		return m_stages[stage].times;
+	}
+
+	void Timer::BeginStage(int stage)
+	{
+		m_stages[stage].start = ReadCounter();
+	}
+
+	void Timer::EndStage(int stage)
+	{
+		Stage &s = m_stages[stage];
+		s.times.AddSample((ReadCounter() - s.start) * mSecondsPerCount * 1000.0);
+	}
+
+	void Timer::LogReport() const
+	{
+		m_frameTimes.LogReport("Frame");
+		for (size_t i = 0; i < m_stages.size(); i++)
+		{
+			m_stages[i].times.LogReport(m_stages[i].name.c_str());
+		}
+	}
+
+	double Timer::Now()
+	{
+		return ReadCounter() / (double)CountsPerSecond();
+	}
+
 }; // End namespace SWR
\ No newline at end of file
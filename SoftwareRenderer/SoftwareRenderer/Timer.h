@@ -14,9 +14,23 @@
 //**
 //****************************************************************************
 
+#include <vector>
+#include <string>
+
+#include "DataTypes.h"
+#include "FrameTimeHistogram.h"
 
 namespace SWR
 {
+	// ------------------------------------------------------------------------
+	//								Timer
+	// ------------------------------------------------------------------------
+	// Desc:
+	// Times frames from one Tick to the next with the steady clock. Besides
+	// the FPS, each frame's time goes into a histogram for the percentiles,
+	// and stages of the frame can be timed into histograms of their own,
+	// each with a budget. LogReport logs them all, for dumping at exit.
+	// ------------------------------------------------------------------------
 	class Timer
 	{
 	public:
@@ -30,7 +44,39 @@ namespace SWR
 		int GetFPS() const;
 		float GetSecsPerFrame() const;
 
+		// The time of each frame, from one tick to the next, in milliseconds.
+		const FrameTimeHistogram& GetFrameTimes() const;
+		void SetFrameBudget(float seconds);
+
+		// Stages of the frame, timed between Begin and EndStage. Returns the stage's index; a
+		// budget of 0 is none.
+		int AddStage(const char* name, float budgetSeconds);
+		int FindStage(const char* name) const;
+		int GetTotalStages() const;
+		const char* GetStageName(int stage) const;
+		const FrameTimeHistogram& GetStageTimes(int stage) const;
+
+		void BeginStage(int stage);
+		void EndStage(int stage);
+
+		// Logs the frame times and those of each stage.
+		void LogReport() const;
+
+		// Seconds on the steady clock, from an arbitrary start.
+		static double Now();
+
 	private:
+		struct Stage
+		{
+			std::string name;
+			FrameTimeHistogram times;
+			S64 start;
+		};
+
+		FrameTimeHistogram m_frameTimes;
+		std::vector<Stage> m_stages;
+		bool m_ticked;
+
 		double mSecondsPerCount;
 		double mDeltaTime;
 		double mAvSecsPerFrame;
@@ -40,9 +86,9 @@ namespace SWR
 		int numFrames;
 		float timeElapsed;
 
-		__int64 mBaseTime;
-		__int64 mPrevTime;
-		__int64 mCurrTime;
+		S64 mBaseTime;
+		S64 mPrevTime;
+		S64 mCurrTime;
 	};
 	
 }; // End namespace SWR.
@@ -17,6 +17,8 @@
 #include "Vector2.h"
 
 #include "Colour.h"
+#include "RenderStats.h"
+#include "Profiler.h"
 
 #include "Logger.h"
 #include "MemoryLeak.h"
@@ -59,6 +61,7 @@ namespace SWR
 		, m_screenHeight(0.0f)
 		, m_nearPlane(0.0f)
 		, m_farPlane(0.0f)
+		, m_stats(NULL)
 	{
 		// Create the screen edges.
 		m_screenEdges = new Line[4];
@@ -251,9 +254,16 @@ namespace SWR
 		m_nearPlane = nearPlane;
 		m_farPlane = farPlane;
 	}
+
+	void TriangleClipper2D::SetStats(RenderStats* stats)
+	{
+		m_stats = stats;
+	}
 		
 	int TriangleClipper2D::ClipTriangle(Vertex* tri, Vertex* result)
 	{
+		SWR_PROFILE_SCOPE("Clip");
+
 		Edge triEdges[3];
 
 		// Build the triangle edges.
@@ -279,6 +289,9 @@ namespace SWR
 
 		int edgeIndex = -1;
 
+		// If any edge crossed the screen edges.
+		bool clipped = false;
+
 		Line line;
 
 		// Clip the edges.
@@ -307,10 +320,13 @@ namespace SWR
 			else if ((startRegion & endRegion) > 0)
 			{
 				// Both points are not within the view-space.
+				clipped = true;
 				continue;
 			}
 			else
 			{
+				clipped = true;
+
 				// Try add the start vertex to the output.
 				if (startRegion == INNER_VIEW_REGION)
 				{
@@ -360,6 +376,13 @@ namespace SWR
 			}
 		}
 
+		if (clipped && m_stats != NULL)
+		{
+			m_stats->trisClipped++;
+			if (totalOutputVerts > 3)
+				m_stats->trisSplit += totalOutputVerts - 3;
+		}
+
 		// No points were added to the output, therefore triangle is completely outside of the view-space.
 		if (totalOutputVerts < 2)
 			return 0;
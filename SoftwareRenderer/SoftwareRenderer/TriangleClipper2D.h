@@ -16,6 +16,12 @@
 
 #include "Vertex.h"
 
+// Forward Declarations
+namespace SWR
+{
+	struct RenderStats;
+};
+
 namespace SWR
 {
 	struct Line
@@ -70,6 +76,9 @@ namespace SWR
 		float m_nearPlane;
 		float m_farPlane;
 
+		// Counts the triangles clipped and split, if set.
+		RenderStats* m_stats;
+
 		Line* m_screenEdges;
 
 		void BuildScreenEdges();
@@ -102,6 +111,7 @@ namespace SWR
 
 		void SetViewDimensions(float width, float height);
 		void SetViewPlanes(float nearPlane, float farPlane);
+		void SetStats(RenderStats* stats);
 
 		// Clips the triangle, returning the amount of resultant triangles.
 		// Triangle will always be carried across to result 1, even if no clipping was performed.
@@ -9,7 +9,7 @@
 //**
 //****************************************************************************
 
-#include <Windows.h>
+#include <cstring>
 #include <iostream>
 
 #include "Vertex.h"
@@ -19,6 +19,16 @@
 
 namespace SWR
 {
+	// The ID the next vertex buffer is given; 0 is never used.
+	static U32 s_nextVertexBufferID = 1;
+
+	VertexBuffer::VertexBuffer()
+		: m_vertices(NULL)
+		, m_numOfVerts(0)
+		, m_ID(s_nextVertexBufferID++)
+	{
+	}
+
 	Vertex* VertexBuffer::GetVertices()
 	{
 		return (Vertex*)m_vertices;
@@ -29,6 +39,11 @@ namespace SWR
 		return m_numOfVerts;
 	}
 
+	U32 VertexBuffer::GetID() const
+	{
+		return m_ID;
+	}
+
 	size_t VertexBuffer::Size()
 	{
 		return m_numOfVerts * sizeof(Vertex);
@@ -14,7 +14,7 @@
 //**
 //****************************************************************************
 
-#include <Windows.h>
+#include <cstddef>
 
 #include "DataTypes.h"
 #include "Colour.h"
@@ -109,16 +109,15 @@ namespace SWR
 
 		Vertex* m_vertices; // A byte buffer.
 		U16 m_numOfVerts;
+
+		// Unique to each buffer created, unlike its address which a later buffer can reuse.
+		U32 m_ID;
 		
 		friend SWR_ERR CreateVertexBuffer(void* verts, U16 totalVerts, VertexBuffer* &out_buffer);
 	protected:
 	public:
 
-		VertexBuffer()
-			: m_vertices(NULL)
-			, m_numOfVerts(0)
-		{
-		}
+		VertexBuffer();
 
 		~VertexBuffer()
 		{
@@ -133,6 +132,8 @@ namespace SWR
 
 		U16 GetTotalVerts() const;
 
+		U32 GetID() const;
+
 		// Returns the size in BYTES of the total vertices stored by the buffer.
 		size_t Size();
 	};
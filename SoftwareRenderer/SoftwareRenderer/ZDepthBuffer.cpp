@@ -9,7 +9,11 @@
 //**
 //****************************************************************************
 
+#include <cstdlib>
+#include <cstring>
+
 #include "ZDepthBuffer.h"
+#include "Platform.h"
 
 #include "Logger.h"
 #include "MemoryLeak.h"
@@ -21,10 +25,15 @@ namespace SWR
 	ZDepthBuffer::ZDepthBuffer()
 	{
 		m_buffer = NULL;
+		m_width = 0;
+		m_height = 0;
+		m_pitch = 0;
+		m_buffSize = 0;
 	}
 
 	ZDepthBuffer::~ZDepthBuffer()
 	{
+		Release();
 	}
 
 	SWR_ERR ZDepthBuffer::Initilise(U16 width, U16 height)
@@ -34,16 +43,18 @@ namespace SWR
 			Release();
 		}
 
-		m_buffer = (U8*) malloc(sizeof(S16) * width * height);//[width * height];
+		U32 pitch = AlignPitch(sizeof(S16) * width) / sizeof(S16);
+		m_buffer = (S16*) AlignedAlloc(sizeof(S16) * pitch * height, SWR_SURFACE_ALIGNMENT);
+		if (m_buffer == NULL)
+		{
+			LOG("Z-depth buffer allocation has failed.", LOG_Error);
+			return SWR_FAIL;
+		}
 		
 		m_width	= width;
 		m_height = height;
-		//pitch	= width;
-
-		m_buffSize = (U32)m_width * (U32)m_height;
-		m_buffChunks = m_buffSize / (PIXELS_TO_CLEAR * 2); // Calculate how many byte chunks we have that are within the buffer size.
-		m_buffSizeRemainder = m_buffSize % m_buffChunks;
-		m_buffChunkSize = m_buffSize - m_buffSizeRemainder;
+		m_pitch = pitch;
+		m_buffSize = m_pitch * (U32)m_height;
 
 		return SWR_OK;
 	}
@@ -52,50 +63,60 @@ namespace SWR
 	{
 		if (m_buffer != NULL)
 		{
-			free(m_buffer);
+			AlignedFree(m_buffer);
 			m_buffer = NULL;
 		}
 	}
 
 	void ZDepthBuffer::SetZDepth(U16 x, U16 y, S16 depth)
 	{
+		m_buffer[x + (y * m_pitch)] = depth;
 	}
 
+	// Returns true if the depth is closer than the depth stored at the pixel.
 	bool ZDepthBuffer::ZDepthTest(U16 x, U16 y, S16 z)
 	{
-		S16 value = m_buffer[x + (y * m_width)];
-		if (value > z && value < 0)
-		{
-			return false;
-		}
-		return true;
+		return z < m_buffer[x + (y * m_pitch)];
 	}
 
 	void ZDepthBuffer::Clear(S16 value)
 	{
 		U32 index = 0;
-		U32 byteIndex = 0;
 		const U32 pixelsToCopy = PIXELS_TO_CLEAR;
-		unsigned char buffer[pixelsToCopy * 2];
+		S16 buffer[pixelsToCopy];
 
-		// Copy the clear colour into the byte buffer.
-		for (U16 pixelByte = 0; pixelByte < pixelsToCopy * 2; pixelByte += 2)
+		// Fill a chunk with the clear value.
+		for (index = 0; index < pixelsToCopy; index++)
 		{
-			memcpy(&buffer[pixelByte], &value, 2);
+			buffer[index] = value;
 		}
 
-		// Cycle over the pixel buffer up to the closest power of 2 to the the buffer size and copy large
-		// byte chunks into the buffer to help minimise individual write calls.
-		for (index = 0; index < m_buffChunkSize; index += pixelsToCopy)
+		// Copy whole chunks into the buffer to help minimise individual write calls.
+		for (index = 0; index + pixelsToCopy <= m_buffSize; index += pixelsToCopy)
 		{
-			memcpy(&(m_buffer[index]), &buffer, pixelsToCopy * 2);
+			memcpy(&m_buffer[index], buffer, pixelsToCopy * sizeof(S16));
 		}
 
-		// Do a standard / sloooow copy into the buffer for the remainder.
-		for (index = m_buffChunkSize; index < m_buffSize; index++)
+		// Fill the remainder.
+		for (; index < m_buffSize; index++)
 		{
-			memcpy(&(m_buffer[index]), &value, 2); // Copy the 4 bytes of the clear colour into our buffer.
+			m_buffer[index] = value;
 		}
 	}
+
+	U16 ZDepthBuffer::GetWidth() const
+	{
+		return m_width;
+	}
+
+	U16 ZDepthBuffer::GetHeight() const
+	{
+		return m_height;
+	}
+
+	U32 ZDepthBuffer::GetPitch() const
+	{
+		return m_pitch;
+	}
 	
 }; // End namespace SWR.
@@ -30,20 +30,21 @@ namespace SWR
 	// Desc:
 	// A buffer of signed shorts where -32767 = -1, 0 = 0 and 32767 = 1.
 	// Used to represent the Z-Depth of pixels as they are plotted to a back-
-	// buffer. 
+	// buffer, or as a depth-only target such as a shadow map. Smaller values
+	// are closer.
+	// The buffer is cache line aligned and its rows are padded to start on
+	// one, so rows are GetPitch() entries apart rather than the width.
 	// ------------------------------------------------------------------------
 	class ZDepthBuffer
 	{
 	private:
-		U8* m_buffer;
+		S16* m_buffer;
 		U16 m_width;
 		U16 m_height;
+		U32 m_pitch; // In entries.
 
-		// These are precalculated buffer/chunk sizes to help optimise buffer clearing.
+		// The total entries in the buffer, including the row padding.
 		U32 m_buffSize;
-		U32 m_buffChunks; // The number of 2048 byte chunks in the buffer.
-		U32 m_buffChunkSize;
-		U32 m_buffSizeRemainder;
 	protected:
 	public:
 		ZDepthBuffer();
@@ -57,6 +58,14 @@ namespace SWR
 
 		void Clear(S16 value);
 
+		U16 GetWidth() const;
+		U16 GetHeight() const;
+		U32 GetPitch() const;
+
+		// Direct access to the depth values for the raster kernels, pitch * height entries.
+		inline S16* GetBuffer()				{ return m_buffer; }
+		inline const S16* GetBuffer() const	{ return m_buffer; }
+
 		static const S16 MAX_Z_DEPTH = 32767;
 	};
 	
@@ -0,0 +1,46 @@
+#pragma once
+
+#ifndef SWR_TEST_H
+#define SWR_TEST_H
+
+//****************************************************************************
+//**
+//**    SWRTest.h
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+namespace SWR
+{
+	typedef void (*TestFunc)();
+
+	// Adds a test to the list run by swr_tests. Used through SWR_TEST.
+	struct TestRegistrar
+	{
+		TestRegistrar(const char* name, TestFunc func);
+	};
+
+	// Records a failed check against the running test.
+	void ReportTestFailure(const char* file, int line, const char* expression);
+
+}; // End namespace SWR.
+
+// Defines and registers a test:
+//     SWR_TEST(MyTest)
+//     {
+//         SWR_CHECK(1 + 1 == 2);
+//     }
+#define SWR_TEST(name) \
+	static void name(); \
+	static SWR::TestRegistrar name##Registrar(#name, &name); \
+	static void name()
+
+// Fails the running test and leaves it if the expression is false.
+#define SWR_CHECK(expression) \
+	do { if (!(expression)) { SWR::ReportTestFailure(__FILE__, __LINE__, #expression); return; } } while (0)
+
+#endif // #ifndef SWR_TEST_H
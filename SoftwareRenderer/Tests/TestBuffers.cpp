@@ -0,0 +1,314 @@
+//****************************************************************************
+//**
+//**    TestBuffers.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstring>
+
+#include "SWRTest.h"
+
+#include "BackBuffer.h"
+#include "ZDepthBuffer.h"
+#include "RenderTarget.h"
+#include "FrameArena.h"
+#include "TiledLightList.h"
+#include "TextureManager.h"
+#include "Texture.h"
+#include "Platform.h"
+#include "SWR_SIMD.h"
+
+using namespace SWR;
+
+SWR_TEST(BackBufferClearCoversEveryPixel)
+{
+	// Sizes smaller than, between and larger than the clear chunks.
+	const U16 sizes[][2] = { { 1, 1 }, { 33, 7 }, { 97, 55 }, { 800, 600 } };
+	for (int s = 0; s < 4; s++)
+	{
+		BackBuffer buffer;
+		SWR_CHECK(buffer.CreateBuffer(sizes[s][0], sizes[s][1]) == SWR_OK);
+
+		buffer.Clear(0x00ABCDEF);
+		for (U32 y = 0; y < buffer.GetHeight(); y++)
+		{
+			const U32* row = (const U32*)(buffer.GetByteBuffer() + y * buffer.GetPitch());
+			for (U32 x = 0; x < buffer.GetWidth(); x++)
+			{
+				SWR_CHECK(row[x] == 0x00ABCDEF);
+			}
+		}
+
+		buffer.ReleaseBuffer();
+	}
+}
+
+SWR_TEST(ZDepthBufferKeepsCloserDepths)
+{
+	ZDepthBuffer depth;
+	SWR_CHECK(depth.Initilise(13, 9) == SWR_OK);
+	depth.Clear(ZDepthBuffer::MAX_Z_DEPTH);
+
+	SWR_CHECK(depth.ZDepthTest(12, 8, 100));
+	depth.SetZDepth(12, 8, 100);
+	SWR_CHECK(depth.ZDepthTest(12, 8, 99));
+	SWR_CHECK(depth.ZDepthTest(12, 8, 101) == false);
+	SWR_CHECK(depth.ZDepthTest(0, 0, 32766));
+}
+
+SWR_TEST(SurfaceRowsStartOnCacheLines)
+{
+	// Widths whose rows don't fill a whole number of cache lines.
+	BackBuffer buffer;
+	SWR_CHECK(buffer.CreateBuffer(33, 7) == SWR_OK);
+	SWR_CHECK(((size_t)buffer.GetByteBuffer() % SWR_SURFACE_ALIGNMENT) == 0);
+	SWR_CHECK(buffer.GetPitch() >= 33 * 4 && (buffer.GetPitch() % SWR_SURFACE_ALIGNMENT) == 0);
+	buffer.ReleaseBuffer();
+
+	ZDepthBuffer depth;
+	SWR_CHECK(depth.Initilise(13, 9) == SWR_OK);
+	SWR_CHECK(((size_t)depth.GetBuffer() % SWR_SURFACE_ALIGNMENT) == 0);
+	SWR_CHECK(depth.GetPitch() >= 13 && ((depth.GetPitch() * sizeof(S16)) % SWR_SURFACE_ALIGNMENT) == 0);
+
+	// The depth of a pixel is where the raster kernels look for it.
+	depth.Clear(ZDepthBuffer::MAX_Z_DEPTH);
+	depth.SetZDepth(5, 3, 1234);
+	SWR_CHECK(depth.GetBuffer()[5 + 3 * depth.GetPitch()] == 1234);
+
+	Texture* texture = NULL;
+	SWR_CHECK(TextureManager::Instance().CreateTexture(5, 3, texture) == SWR_OK);
+	SWR_CHECK(((size_t)texture->GetBytes() % SWR_SURFACE_ALIGNMENT) == 0);
+	SWR_CHECK(texture->GetPitch() == SWR_SURFACE_ALIGNMENT);
+	delete texture;
+
+	RenderTarget target;
+	SWR_CHECK(target.Initilise(21, 5, false) == SWR_OK);
+	SWR_CHECK(((size_t)target.GetColour() % SWR_SURFACE_ALIGNMENT) == 0);
+	SWR_CHECK(target.GetPitch() == 2 * SWR_SURFACE_ALIGNMENT);
+}
+
+SWR_TEST(MipLevelsAverageTheLevelAbove)
+{
+	// Wide enough for the four texel SIMD steps, with odd sizes left over at each level.
+	const U16 width = 37, height = 13;
+	Texture* texture = NULL;
+	SWR_CHECK(TextureManager::Instance().CreateTexture(width, height, texture) == SWR_OK);
+	for (U32 v = 0; v < height; v++)
+	{
+		U32* row = (U32*)(texture->GetBytes() + v * texture->GetPitch());
+		for (U32 u = 0; u < width; u++)
+		{
+			row[u] = (u * 7) << 16 | (v * 19) << 8 | ((u ^ v) & 1) * 255;
+		}
+	}
+
+	// Tiled, to check the levels are built and kept in the texture's layout.
+	SWR_CHECK(TextureManager::Instance().SetTextureLayout(texture, TEXLAYOUT_Tiled) == SWR_OK);
+	SWR_CHECK(TextureManager::Instance().GenerateMipmaps(texture) == SWR_OK);
+
+	// 37x13, 18x6, 9x3, 4x1, 2x1, 1x1.
+	SWR_CHECK(texture->GetTotalLevels() == 6);
+	bool averaged = true;
+	for (U32 i = 1; i < texture->GetTotalLevels(); i++)
+	{
+		TextureLevel above = texture->GetLevel(i - 1);
+		TextureLevel level = texture->GetLevel(i);
+		averaged &= level.layout == TEXLAYOUT_Tiled && level.width == (above.width > 1 ? above.width / 2 : 1) && level.height == (above.height > 1 ? above.height / 2 : 1);
+
+		const U32* aboveTexels = (const U32*)above.bytes;
+		const U32* texels = (const U32*)level.bytes;
+		for (U32 v = 0; v < level.height; v++)
+		{
+			for (U32 u = 0; u < level.width; u++)
+			{
+				U32 u1 = u * 2 + 1 < above.width ? u * 2 + 1 : u * 2;
+				U32 v1 = v * 2 + 1 < above.height ? v * 2 + 1 : v * 2;
+				U32 expected = AverageTexels(aboveTexels[above.GetTexelIndex(u * 2, v * 2)], aboveTexels[above.GetTexelIndex(u1, v * 2)],
+					aboveTexels[above.GetTexelIndex(u * 2, v1)], aboveTexels[above.GetTexelIndex(u1, v1)]);
+				averaged &= texels[level.GetTexelIndex(u, v)] == expected;
+			}
+		}
+	}
+
+	// A black and white checker board averages to grey.
+	SWR_CHECK(AverageTexels(0x00FFFFFF, 0, 0, 0x00FFFFFF) == 0x00808080);
+
+	TextureManager::Instance().ReleaseMipmaps(texture);
+	SWR_CHECK(texture->GetTotalLevels() == 1);
+	delete texture;
+
+	SWR_CHECK(averaged);
+}
+
+SWR_TEST(BilinearTexelsWeighTheirNeighbours)
+{
+	// Fractions of 0 take the top left texel, and a constant quad stays constant whatever they are.
+	const U32 quad[4] = { 0x00102030, 0x00FFFFFF, 0x00000000, 0x00804020 };
+	const U32 constant[4] = { 0x00C0FF11, 0x00C0FF11, 0x00C0FF11, 0x00C0FF11 };
+	SWR_CHECK(BilinearTexels(quad, 0, 0) == quad[0]);
+	SWR_CHECK(BilinearTexels(constant, 77, 200) == constant[0]);
+
+	// Halfway between black and white is grey, give or take the truncation.
+	const U32 blackWhite[4] = { 0, 0x00FFFFFF, 0, 0x00FFFFFF };
+	SWR_CHECK(BilinearTexels(blackWhite, 128, 0) == 0x007F7F7F);
+
+	// The two pixel version matches the single one however it was compiled.
+	bool matched = true;
+	for (U32 i = 0; i < 256; i += 5)
+	{
+		U32 quadB[4] = { quad[3] ^ (i << 8), quad[2] + i, quad[1] - i, quad[0] | i };
+		U32 out[2];
+		BilinearTexels2(quad, i, 255 - i, quadB, (i * 7) & 0xFF, i, out);
+		matched &= out[0] == BilinearTexels(quad, i, 255 - i) && out[1] == BilinearTexels(quadB, (i * 7) & 0xFF, i);
+	}
+
+	SWR_CHECK(matched);
+}
+
+SWR_TEST(ModulatedTexelsScaleEachChannel)
+{
+	// White keeps the texel, black clears it, and each channel is scaled on its own.
+	SWR_CHECK(ModulateTexel(0x80C0FF10, 0xFFFFFFFF) == 0x80C0FF10);
+	SWR_CHECK(ModulateTexel(0x80C0FF10, 0x00000000) == 0x00000000);
+	SWR_CHECK(ModulateTexel(0x00FFFFFF, 0x00804020) == 0x00804020);
+
+	// The SIMD version matches, over a count that leaves a tail.
+	U32 texels[11], colours[11], out[11];
+	for (U32 i = 0; i < 11; i++)
+	{
+		texels[i] = 0x01020304 * (i * 37 + 5);
+		colours[i] = 0xFF000000 | (i * 23) << 16 | (255 - i * 11) << 8 | i * 19;
+	}
+
+	ModulateTexels(texels, colours, out, 11);
+	bool matched = true;
+	for (U32 i = 0; i < 11; i++)
+	{
+		matched &= out[i] == ModulateTexel(texels[i], colours[i]);
+	}
+
+	SWR_CHECK(matched);
+}
+
+SWR_TEST(LightTilesOnlyListTheLightsReachingThem)
+{
+	TileGrid grid;
+	grid.tileSize = 16;
+	grid.tilesX = 4;
+	grid.tilesY = 3;
+
+	TiledLightList tiles;
+	SWR_CHECK(tiles.Initilise(grid, 3) == SWR_OK);
+	static U8 storage[1024];
+	SWR_CHECK(tiles.GetStorageSize() <= sizeof(storage));
+	tiles.SetStorage(storage);
+
+	// One light in the top left tile, one across the whole screen and one reaching nothing.
+	LightScreenBounds bounds[3] =
+	{
+		{ 2, 3, 12, 14 },
+		{ 0, 0, 63, 47 },
+		{ 1, 0, 0, 47 },
+	};
+	tiles.Build(bounds, 3, NULL);
+
+	int count = 0;
+	const U16* topLeft = tiles.GetTileLights(0, 0, count);
+	bool topLeftLists = count == 2 && topLeft[0] == 0 && topLeft[1] == 1;
+
+	bool othersLeaveItOut = true;
+	for (U32 y = 0; y < grid.tilesY; y++)
+	{
+		for (U32 x = 0; x < grid.tilesX; x++)
+		{
+			if (x == 0 && y == 0)
+				continue;
+
+			const U16* lights = tiles.GetTileLights(x, y, count);
+			othersLeaveItOut &= count == 1 && lights[0] == 1;
+		}
+	}
+
+	tiles.SetStorage(NULL);
+
+	SWR_CHECK(topLeftLists);
+	SWR_CHECK(othersLeaveItOut);
+}
+
+SWR_TEST(RenderTargetClearLeavesRowPadding)
+{
+	const U32 width = 21, height = 5, pitch = width * 4 + 12;
+	U8 memory[pitch * height];
+	for (U32 i = 0; i < pitch * height; i++)
+	{
+		memory[i] = 0x5A;
+	}
+
+	RenderTarget target;
+	SWR_CHECK(target.Initilise(memory, width, height, pitch, NULL) == SWR_OK);
+	target.Clear(0x00112233);
+
+	for (U32 y = 0; y < height; y++)
+	{
+		const U32* row = (const U32*)(memory + y * pitch);
+		for (U32 x = 0; x < width; x++)
+		{
+			SWR_CHECK(row[x] == 0x00112233);
+		}
+
+		for (U32 i = width * 4; i < pitch; i++)
+		{
+			SWR_CHECK(memory[y * pitch + i] == 0x5A);
+		}
+	}
+}
+
+SWR_TEST(RenderTargetOwnsItsDepth)
+{
+	RenderTarget target;
+	SWR_CHECK(target.Initilise(16, 16, true) == SWR_OK);
+	SWR_CHECK(target.GetDepth() != NULL);
+	SWR_CHECK(target.GetPitch() == 16 * 4);
+
+	target.Release();
+	SWR_CHECK(target.GetDepth() == NULL);
+	SWR_CHECK(target.GetColour() == NULL);
+}
+
+SWR_TEST(FrameArenaGrowsToTheHighWaterMark)
+{
+	FrameArena arena;
+	SWR_CHECK(arena.Initilise(256) == SWR_OK);
+
+	U8* first = (U8*)arena.Allocate(10);
+	U8* second = (U8*)arena.Allocate(100, 64);
+	SWR_CHECK(((size_t)first & 15) == 0 && ((size_t)second & 63) == 0);
+	SWR_CHECK(second >= first + 10);
+
+	// Past the block; the rest of the frame comes from the heap, and the next frames fit.
+	U8* large = (U8*)arena.Allocate(1000);
+	memset(large, 0xCD, 1000);
+	U32 used = arena.GetUsed();
+	SWR_CHECK(used >= 1110 && arena.GetCapacity() == 256);
+
+	arena.Reset();
+	SWR_CHECK(arena.GetUsed() == 0);
+	SWR_CHECK(arena.GetHighWaterMark() == used);
+	SWR_CHECK(arena.GetCapacity() >= used && arena.GetTotalGrowths() == 1);
+
+	for (int frame = 0; frame < 3; frame++)
+	{
+		arena.Allocate(10);
+		arena.Allocate(100, 64);
+		arena.Allocate(1000);
+		arena.Reset();
+	}
+
+	SWR_CHECK(arena.GetTotalGrowths() == 1);
+	arena.Release();
+}
@@ -0,0 +1,80 @@
+//****************************************************************************
+//**
+//**    TestLogger.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "SWRTest.h"
+
+#include "Logger.h"
+
+using namespace SWR;
+
+static void LogFromThread(int thread, int total)
+{
+	for (int i = 0; i < total; i++)
+	{
+		LOGF(LOG_Error, "thread %i record %i", thread, i);
+	}
+}
+
+SWR_TEST(LoggerKeepsEveryRecordFromManyThreads)
+{
+	const char* filename = "swr_test_log.txt";
+	SWR_CHECK(gLogger.SetLogFile(filename) == SWR_OK);
+
+	// Fewer records than the ring holds, so none can be dropped however slow the flush is.
+	const int totalThreads = 4;
+	const int perThread = Logger::CAPACITY / totalThreads / 2;
+	U32 dropped = gLogger.GetTotalDropped();
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < totalThreads; i++)
+	{
+		threads.push_back(std::thread(LogFromThread, i, perThread));
+	}
+
+	for (int i = 0; i < totalThreads; i++)
+	{
+		threads[i].join();
+	}
+
+	gLogger.DumpLog();
+	gLogger.SetLogFile(NULL);
+	SWR_CHECK(gLogger.GetTotalDropped() == dropped);
+
+	// Each thread's records are written in the order it logged them.
+	FILE* file = fopen(filename, "r");
+	SWR_CHECK(file != NULL);
+
+	int next[totalThreads] = { 0 };
+	int lines = 0;
+	bool ordered = true;
+	char line[LogRecord::TEXT_SIZE + 16];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		int thread = -1, record = -1;
+		if (sscanf(line, "Error   : thread %i record %i", &thread, &record) == 2 && thread >= 0 && thread < totalThreads)
+		{
+			ordered = ordered && record == next[thread];
+			next[thread]++;
+			lines++;
+		}
+	}
+
+	fclose(file);
+	remove(filename);
+
+	SWR_CHECK(ordered);
+	SWR_CHECK(lines == totalThreads * perThread);
+}
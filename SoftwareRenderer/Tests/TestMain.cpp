@@ -0,0 +1,75 @@
+//****************************************************************************
+//**
+//**    TestMain.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SWRTest.h"
+
+namespace SWR
+{
+	struct TestCase
+	{
+		const char* name;
+		TestFunc func;
+	};
+
+	// Function local so registration from other files' statics is safe.
+	static std::vector<TestCase>& Tests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	static bool currentTestFailed = false;
+
+	TestRegistrar::TestRegistrar(const char* name, TestFunc func)
+	{
+		TestCase test = { name, func };
+		Tests().push_back(test);
+	}
+
+	void ReportTestFailure(const char* file, int line, const char* expression)
+	{
+		printf("    %s(%i): check failed: %s\n", file, line, expression);
+		currentTestFailed = true;
+	}
+
+}; // End namespace SWR.
+
+using namespace SWR;
+
+// Runs every test, or only those whose name contains the first argument.
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : NULL;
+
+	int run = 0;
+	int failed = 0;
+	std::vector<TestCase> &tests = Tests();
+	for (unsigned int i = 0; i < tests.size(); i++)
+	{
+		if (filter != NULL && strstr(tests[i].name, filter) == NULL)
+			continue;
+
+		currentTestFailed = false;
+		tests[i].func();
+		run++;
+
+		printf("[%s] %s\n", currentTestFailed ? "FAIL" : " OK ", tests[i].name);
+		if (currentTestFailed)
+			failed++;
+	}
+
+	printf("%i test(s) run, %i failed.\n", run, failed);
+	return failed == 0 && run > 0 ? 0 : 1;
+}
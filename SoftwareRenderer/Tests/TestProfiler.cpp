@@ -0,0 +1,237 @@
+//****************************************************************************
+//**
+//**    TestProfiler.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "SWRTest.h"
+
+#include "Profiler.h"
+#include "RenderThreadManager.h"
+
+// Only in builds with SWR_PROFILE (configure with SWR_ENABLE_PROFILER).
+#ifdef SWR_PROFILE
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace SWR;
+
+// An "X" event of a trace; times in microseconds.
+struct TraceEvent
+{
+	std::string name;
+	int tid;
+	double ts;
+	double dur;
+};
+
+// Reads back a trace written by WriteFrameTrace. Checks it is one object holding the traceEvents
+// array, with an object a line and commas between them, and keeps the complete events.
+static bool ReadFrameTrace(const char* filename, std::vector<TraceEvent> &events)
+{
+	FILE* file = fopen(filename, "r");
+	if (file == NULL)
+		return false;
+
+	events.clear();
+	bool valid = true;
+	bool ended = false;
+	bool followsComma = false;
+	char line[512];
+	for (int i = 0; fgets(line, sizeof(line), file) != NULL; i++)
+	{
+		if (i == 0)
+		{
+			valid &= strcmp(line, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n") == 0;
+			continue;
+		}
+
+		// The array closes after an object without a comma, and nothing follows.
+		if (strcmp(line, "]}\n") == 0)
+		{
+			valid &= i > 1 && !followsComma && !ended;
+			ended = true;
+			continue;
+		}
+
+		// Braces balance within each object.
+		int depth = 0;
+		for (const char* c = line; *c != '\0'; c++)
+		{
+			depth += *c == '{' ? 1 : (*c == '}' ? -1 : 0);
+		}
+
+		size_t length = strlen(line);
+		valid &= !ended && line[0] == '{' && depth == 0 && (i == 1 || followsComma);
+		followsComma = length >= 2 && line[length - 2] == ',';
+		if (strstr(line, "\"ph\":\"X\"") == NULL)
+			continue;
+
+		char name[64];
+		TraceEvent e;
+		if (sscanf(line, "{\"name\":\"%63[^\"]\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lf,\"dur\":%lf}", name, &e.tid, &e.ts, &e.dur) != 4)
+		{
+			valid = false;
+			continue;
+		}
+
+		e.name = name;
+		events.push_back(e);
+	}
+
+	fclose(file);
+	return valid && ended;
+}
+
+static int CountEvents(const std::vector<TraceEvent> &events, const char* name)
+{
+	int total = 0;
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		total += events[i].name == name ? 1 : 0;
+	}
+
+	return total;
+}
+
+static const TraceEvent* FindEvent(const std::vector<TraceEvent> &events, const char* name)
+{
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		if (events[i].name == name)
+			return &events[i];
+	}
+
+	return NULL;
+}
+
+SWR_TEST(ProfilerTracesNestedScopesOfTheLastFrame)
+{
+	Profiler &profiler = Profiler::Instance();
+	profiler.Clear();
+	const char* traceFile = "swr_test_trace.json";
+
+	// A scope before the frame, which the trace must leave out.
+	{
+		SWR_PROFILE_SCOPE("BeforeFrame");
+	}
+	SWR_PROFILE_FRAME();
+
+	{
+		SWR_PROFILE_SCOPE("Outer");
+		{
+			SWR_PROFILE_SCOPE("Inner");
+			{
+				SWR_PROFILE_SCOPE("Innermost");
+			}
+		}
+	}
+	SWR_PROFILE_FRAME();
+
+	std::vector<TraceEvent> nested;
+	bool nestedRead = profiler.WriteFrameTrace(traceFile) == SWR_OK && ReadFrameTrace(traceFile, nested);
+
+	// Overfill the ring of this thread in the next frame; only the newest events survive.
+	U32 overwritten = 100;
+	for (U32 i = 0; i < overwritten; i++)
+	{
+		U64 now = Profiler::Now();
+		profiler.Record("Overwritten", now, now);
+	}
+
+	for (U32 i = 0; i < (U32)ProfileRing::CAPACITY; i++)
+	{
+		U64 now = Profiler::Now();
+		profiler.Record("Kept", now, now);
+	}
+	SWR_PROFILE_FRAME();
+
+	std::vector<TraceEvent> wrapped;
+	bool wrappedRead = profiler.WriteFrameTrace(traceFile) == SWR_OK && ReadFrameTrace(traceFile, wrapped);
+
+	remove(traceFile);
+	profiler.Clear();
+
+	SWR_CHECK(nestedRead);
+	SWR_CHECK(CountEvents(nested, "BeforeFrame") == 0);
+	SWR_CHECK(CountEvents(nested, "Outer") == 1 && CountEvents(nested, "Inner") == 1 && CountEvents(nested, "Innermost") == 1);
+
+	// Each scope sits within its parent, on the same thread.
+	const TraceEvent* outer = FindEvent(nested, "Outer");
+	const TraceEvent* inner = FindEvent(nested, "Inner");
+	const TraceEvent* innermost = FindEvent(nested, "Innermost");
+	SWR_CHECK(outer->tid == inner->tid && inner->tid == innermost->tid);
+	SWR_CHECK(outer->ts >= 0.0 && outer->ts <= inner->ts && inner->ts <= innermost->ts);
+	SWR_CHECK(innermost->ts + innermost->dur <= inner->ts + inner->dur + 0.002);
+	SWR_CHECK(inner->ts + inner->dur <= outer->ts + outer->dur + 0.002);
+
+	SWR_CHECK(wrappedRead);
+	SWR_CHECK(CountEvents(wrapped, "Outer") == 0);
+	SWR_CHECK(CountEvents(wrapped, "Overwritten") == 0);
+	SWR_CHECK(CountEvents(wrapped, "Kept") == ProfileRing::CAPACITY);
+}
+
+#ifdef SWR_TRACK_ALLOCATIONS
+// Only in builds with SWR_TRACK_ALLOCATIONS as well.
+
+struct FirstEventJob
+{
+	std::atomic<int> arrived;
+	int totalThreads;
+};
+
+// Holds each thread in its item until every thread has one, so each of them records in the job.
+static void RecordFirstEvent(void* data, int, int)
+{
+	SWR_PROFILE_SCOPE("FirstEvent");
+
+	FirstEventJob* job = (FirstEventJob*)data;
+	job->arrived++;
+
+	U64 giveUp = Profiler::Now() + 2000000000ULL;
+	while (job->arrived.load() < job->totalThreads && Profiler::Now() < giveUp)
+	{
+		std::this_thread::yield();
+	}
+}
+
+SWR_TEST(ProfiledRenderThreadsRecordWithoutAllocating)
+{
+	RenderThreadManager threads;
+	SWR_CHECK(threads.Initilise(4) == SWR_OK);
+
+	FirstEventJob job;
+	job.arrived = 0;
+	job.totalThreads = threads.GetTotalThreads();
+
+	// The workers' first events fall in a frame that mustn't allocate.
+	U32 failedFrames = AllocationTracker::GetTotalFailedFrames();
+	AllocationTracker::EndFrame();
+	AllocationTracker::SetExpectNoAllocations(true);
+	threads.ParallelFor(job.totalThreads, &RecordFirstEvent, &job);
+	AllocationTracker::EndFrame();
+	AllocationTracker::SetExpectNoAllocations(false);
+
+	AllocationCounts counts = AllocationTracker::GetFrameCounts();
+	U32 failedJob = AllocationTracker::GetTotalFailedFrames() - failedFrames;
+	threads.Release();
+	Profiler::Instance().Clear();
+
+	SWR_CHECK(job.arrived.load() == job.totalThreads);
+	SWR_CHECK(counts.allocations == 0);
+	SWR_CHECK(failedJob == 0);
+}
+
+#endif // #ifdef SWR_TRACK_ALLOCATIONS
+
+#endif // #ifdef SWR_PROFILE
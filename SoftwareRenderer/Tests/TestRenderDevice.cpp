@@ -0,0 +1,1227 @@
+//****************************************************************************
+//**
+//**    TestRenderDevice.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SWRTest.h"
+
+#include "RenderDevice.h"
+#include "RenderTarget.h"
+#include "FrameReplay.h"
+#include "TextureManager.h"
+#include "Texture.h"
+#include "LightingManager.h"
+#include "LitVertexCache.h"
+#include "Vertex.h"
+#include "IndexBuffer.h"
+#include "Colour.h"
+#include "FrameArena.h"
+#include "AllocationTracker.h"
+
+using namespace SWR;
+
+static const U32 CLEAR_COLOUR = 0x00101010;
+
+// A headless device looking down +z from the origin at a triangle 5 units away.
+static bool CreateTestDevice(RenderDevice &device, U16 width, U16 height, VertexBuffer* &triangle, IndexBuffer* &triangleIndices)
+{
+	SWRInitParams params;
+	params.bufferWidth = width;
+	params.bufferHeight = height;
+	params.totalRenderThreads = 2;
+	if (device.Initilise(params) != SWR_OK)
+		return false;
+
+	device.SetClipPlanes(1.0f, 100.0f);
+	device.SetFOV(60.0f);
+
+	Matrix4 identity;
+	identity.Identity();
+	device.SetWorldTransform(identity);
+	device.SetCameraTransform(identity);
+	device.CommitMatrixChanges();
+
+	Vertex verts[3] =
+	{
+		Vertex(-2.0f, -2.0f, 5.0f, Colour32(255, 0, 0, 0), 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 0.0f,  2.0f, 5.0f, Colour32(0, 255, 0, 0), 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 2.0f, -2.0f, 5.0f, Colour32(0, 0, 255, 0), 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+	};
+
+	if (CreateVertexBuffer(verts, 3, triangle) != SWR_OK)
+		return false;
+
+	U16 indices[3] = { 0, 1, 2 };
+	if (CreateIndexBuffer(indices, 3, triangleIndices) != SWR_OK)
+		return false;
+
+	device.SetVertexBuffer(triangle);
+	device.SetIndexBuffer(triangleIndices);
+	return true;
+}
+
+static int CountDrawnPixels(const U8* pixels, U32 width, U32 height, U32 pitch)
+{
+	int drawn = 0;
+	for (U32 y = 0; y < height; y++)
+	{
+		const U32* row = (const U32*)(pixels + y * pitch);
+		for (U32 x = 0; x < width; x++)
+		{
+			if (row[x] != CLEAR_COLOUR)
+				drawn++;
+		}
+	}
+
+	return drawn;
+}
+
+SWR_TEST(HeadlessDeviceDrawsTriangle)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.ClearZBuffer();
+	device.DrawTrisColList(true, 1, 0);
+
+	const U8* frame = device.Present();
+	U32 pitch = device.GetBackBufferPitch();
+	int drawn = CountDrawnPixels(frame, 64, 48, pitch);
+
+	// Present can also copy the frame out, into rows of any pitch.
+	static U8 copy[48 * 300];
+	device.Present(copy, 300);
+	bool same = true;
+	for (U32 y = 0; y < 48; y++)
+	{
+		same &= memcmp(copy + y * 300, frame + y * pitch, 64 * 4) == 0;
+	}
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(drawn > 100);
+	SWR_CHECK(same);
+}
+
+SWR_TEST(RenderTargetCapturesDraws)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	device.ClearBackBuffer(CLEAR_COLOUR);
+
+	RenderTarget target;
+	SWR_CHECK(target.Initilise(32, 32, true) == SWR_OK);
+	device.SetRenderTarget(&target);
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColList(true, 1, 0);
+	device.SetRenderTarget(NULL);
+
+	int drawnTarget = CountDrawnPixels(target.GetColour(), 32, 32, target.GetPitch());
+	int drawnBackBuffer = CountDrawnPixels(device.Present(), 64, 48, 64 * 4);
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(drawnTarget > 50);
+	SWR_CHECK(drawnBackBuffer == 0);
+}
+
+SWR_TEST(DeferredMatchesForwardLighting)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	// A point light at the camera, lighting the triangle head on.
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(0.0f, 0.0f, 0.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 50.0f;
+	light.atten[0] = 0.0f;
+	light.atten[1] = 0.125f;
+	light.atten[2] = 0.0f;
+	device.GetLightingManager()->AddLight(light, 0);
+	device.GetLightingManager()->EnableLight(0);
+
+	static U8 forward[64 * 48 * 4];
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColPhongList(true, 1, 0);
+	device.Present(forward, 64 * 4);
+
+	device.SetRenderPipeline(PIPELINE_Deferred);
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColPhongList(true, 1, 0);
+	const U8* deferred = device.Present();
+
+	int maxDifference = 0;
+	for (U32 i = 0; i < 64 * 48 * 4; i++)
+	{
+		int difference = (int)forward[i] - (int)deferred[i];
+		difference = difference < 0 ? -difference : difference;
+		maxDifference = difference > maxDifference ? difference : maxDifference;
+	}
+
+	int drawn = CountDrawnPixels(forward, 64, 48, 64 * 4);
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(drawn > 100);
+	SWR_CHECK(maxDifference <= 2);
+}
+
+// Counts the pixels of b darker than a's and those brighter, by the sum of their channels.
+static void CompareBrightness(const U8* a, const U8* b, U32 width, U32 height, int &darker, int &brighter)
+{
+	darker = 0;
+	brighter = 0;
+	for (U32 i = 0; i < width * height; i++)
+	{
+		int sumA = a[i * 4] + a[i * 4 + 1] + a[i * 4 + 2];
+		int sumB = b[i * 4] + b[i * 4 + 1] + b[i * 4 + 2];
+		darker += sumB < sumA ? 1 : 0;
+		brighter += sumB > sumA ? 1 : 0;
+	}
+}
+
+SWR_TEST(ShadowsDarkenPixelsBehindACaster)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	// The receiver at z = 5, and a smaller caster in front of its upper half.
+	Vertex verts[6] =
+	{
+		Vertex(-2.0f, -2.0f, 5.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 0.0f,  2.0f, 5.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 2.0f, -2.0f, 5.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex(-0.6f,  0.5f, 3.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 0.0f,  1.0f, 3.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 0.6f,  0.5f, 3.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+	};
+	U16 indices[6] = { 0, 1, 2, 3, 4, 5 };
+	VertexBuffer* scene = NULL;
+	IndexBuffer* sceneIndices = NULL;
+	SWR_CHECK(CreateVertexBuffer(verts, 6, scene) == SWR_OK);
+	SWR_CHECK(CreateIndexBuffer(indices, 6, sceneIndices) == SWR_OK);
+	device.SetVertexBuffer(scene);
+	device.SetIndexBuffer(sceneIndices);
+
+	// A point light above the camera, so the caster's shadow falls below it on the receiver.
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(0.0f, 1.0f, 0.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 50.0f;
+	light.atten[0] = 0.0f;
+	light.atten[1] = 0.125f;
+	light.atten[2] = 0.0f;
+	device.GetLightingManager()->AddLight(light, 0);
+	device.GetLightingManager()->EnableLight(0);
+
+	static U8 forwardLit[64 * 48 * 4];
+	static U8 deferredLit[64 * 48 * 4];
+	static U8 forwardShadowed[64 * 48 * 4];
+	static U8 deferredShadowed[64 * 48 * 4];
+	RenderPipeline pipelines[2] = { PIPELINE_Forward, PIPELINE_Deferred };
+	U8* lit[2] = { forwardLit, deferredLit };
+	U8* shadowed[2] = { forwardShadowed, deferredShadowed };
+
+	for (int i = 0; i < 2; i++)
+	{
+		device.SetRenderPipeline(pipelines[i]);
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		device.DrawTrisColPhongList(true, 2, 0);
+		device.Present(lit[i], 64 * 4);
+	}
+
+	Matrix4 lightTransform;
+	TranslateMatrix4(light.position, lightTransform);
+	SWR_CHECK(device.BeginShadowPass(0, lightTransform, 90.0f, 1.0f, 100.0f) == SWR_OK);
+	device.DrawTrisShadowList(true, 2, 0);
+	device.EndShadowPass();
+
+	for (int i = 0; i < 2; i++)
+	{
+		device.SetRenderPipeline(pipelines[i]);
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		device.DrawTrisColPhongList(true, 2, 0);
+		device.Present(shadowed[i], 64 * 4);
+	}
+
+	int drawn = CountDrawnPixels(forwardLit, 64, 48, 64 * 4);
+	int forwardDarker, forwardBrighter, deferredDarker, deferredBrighter;
+	CompareBrightness(forwardLit, forwardShadowed, 64, 48, forwardDarker, forwardBrighter);
+	CompareBrightness(deferredLit, deferredShadowed, 64, 48, deferredDarker, deferredBrighter);
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+	delete scene;
+	delete sceneIndices;
+
+	// Only the strip of the receiver the caster hides from the light darkens.
+	SWR_CHECK(forwardDarker > 20 && forwardDarker < drawn / 4);
+	SWR_CHECK(forwardBrighter == 0);
+	SWR_CHECK(deferredDarker == forwardDarker);
+	SWR_CHECK(deferredBrighter == 0);
+}
+
+SWR_TEST(LightTilesFollowLightChangesBetweenDraws)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	// A light well off to the side, reaching none of the tiles.
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(40.0f, 0.0f, 5.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 10.0f;
+	light.atten[0] = 0.0f;
+	light.atten[1] = 0.125f;
+	light.atten[2] = 0.0f;
+	LightingManager* lights = device.GetLightingManager();
+	lights->AddLight(light, 0);
+	lights->EnableLight(0);
+
+	// Moved onto the triangle through the lighting manager between two draws of a frame.
+	static U8 moved[64 * 48 * 4];
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.ClearZBuffer();
+	device.DrawTrisColPhongList(true, 1, 0);
+	lights->SetLightPosition(0, Vector3(0.0f, 0.0f, 0.0f));
+	device.ClearZBuffer();
+	device.DrawTrisColPhongList(true, 1, 0);
+	device.Present(moved, 64 * 4);
+
+	// The same as if it had been there from the start of the frame.
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.ClearZBuffer();
+	device.DrawTrisColPhongList(true, 1, 0);
+	const U8* fresh = device.Present();
+	bool same = memcmp(moved, fresh, sizeof(moved)) == 0;
+
+	// And lit, rather than black.
+	int lit = 0;
+	for (U32 i = 0; i < 64 * 48; i++)
+	{
+		U32 pixel = ((const U32*)moved)[i];
+		lit += pixel != CLEAR_COLOUR && (pixel & 0x00FFFFFF) != 0;
+	}
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(same);
+	SWR_CHECK(lit > 100);
+}
+
+SWR_TEST(LitCacheRelightsOnlyStaleInstances)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(0.0f, 0.0f, 0.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 50.0f;
+	light.atten[0] = 0.0f;
+	light.atten[1] = 0.125f;
+	light.atten[2] = 0.0f;
+	LightingManager* lights = device.GetLightingManager();
+	lights->AddLight(light, 0);
+	lights->EnableLight(0);
+
+	// Lit once, then reused while nothing changes.
+	device.ResetStatsCounters();
+	device.DrawTrisColLitList(true, 1, 0);
+	device.DrawTrisColLitList(true, 1, 0);
+	device.DrawTrisColLitList(true, 1, 0);
+	bool staticFrame = device.GetLitCacheRelights() == 1 && device.GetLitCacheHits() == 2;
+
+	// Each change to the instance or a light reaching it relights it once.
+	int relights[5];
+	Matrix4 world;
+	TranslateMatrix4(Vector3(0.0f, 0.0f, 1.0f), world);
+	device.SetWorldTransform(world);
+	device.CommitMatrixChanges();
+	device.ResetStatsCounters();
+	device.DrawTrisColLitList(true, 1, 0);
+	device.DrawTrisColLitList(true, 1, 0);
+	relights[0] = device.GetLitCacheRelights();
+
+	device.ResetStatsCounters();
+	lights->SetLightPosition(0, Vector3(0.0f, 1.0f, 0.0f));
+	device.DrawTrisColLitList(true, 1, 0);
+	device.DrawTrisColLitList(true, 1, 0);
+	relights[1] = device.GetLitCacheRelights();
+
+	device.ResetStatsCounters();
+	lights->DisableLight(0);
+	device.DrawTrisColLitList(true, 1, 0);
+	device.DrawTrisColLitList(true, 1, 0);
+	relights[2] = device.GetLitCacheRelights();
+
+	device.ResetStatsCounters();
+	lights->EnableLight(0);
+	device.DrawTrisColLitList(true, 1, 0);
+	device.DrawTrisColLitList(true, 1, 0);
+	relights[3] = device.GetLitCacheRelights();
+
+	// A new buffer is relit, even when it is created where the deleted one was.
+	delete triangle;
+	Vertex verts[3] =
+	{
+		Vertex(-2.0f, -2.0f, 5.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 0.0f,  2.0f, 5.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 2.0f, -2.0f, 5.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+	};
+	SWR_CHECK(CreateVertexBuffer(verts, 3, triangle) == SWR_OK);
+	device.SetVertexBuffer(triangle);
+	device.ResetStatsCounters();
+	device.DrawTrisColLitList(true, 1, 0);
+	relights[4] = device.GetLitCacheRelights();
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(staticFrame);
+	for (int i = 0; i < 5; i++)
+	{
+		SWR_CHECK(relights[i] == 1);
+	}
+}
+
+SWR_TEST(LitCacheDropsEntriesNoLongerDrawn)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(0.0f, 0.0f, 0.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 50.0f;
+	device.GetLightingManager()->AddLight(light, 0);
+	device.GetLightingManager()->EnableLight(0);
+
+	// Two instances of the buffer, then only the first one is drawn.
+	device.SetInstanceID(1);
+	device.DrawTrisColLitList(true, 1, 0);
+	device.SetInstanceID(0);
+	device.DrawTrisColLitList(true, 1, 0);
+	device.Present();
+	int bothDrawn = device.GetTotalLitCacheEntries();
+
+	// The second instance goes unused for a frame short of the limit, then for the last one.
+	for (int frame = 1; frame < LitVertexCache::MAX_UNUSED_FRAMES; frame++)
+	{
+		device.DrawTrisColLitList(true, 1, 0);
+		device.Present();
+	}
+	int beforeEviction = device.GetTotalLitCacheEntries();
+
+	device.DrawTrisColLitList(true, 1, 0);
+	device.Present();
+	int afterEviction = device.GetTotalLitCacheEntries();
+
+	device.InvalidateLightingCache(triangle);
+	int invalidated = device.GetTotalLitCacheEntries();
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(bothDrawn == 2);
+	SWR_CHECK(beforeEviction == 2);
+	SWR_CHECK(afterEviction == 1);
+	SWR_CHECK(invalidated == 0);
+}
+
+typedef U32 (*TexelFunction)(U32 u, U32 v);
+
+// The test device, released along with the triangle, the textures and the textured triangle it
+// made when it goes out of scope.
+struct TestDevice
+{
+	RenderDevice device;
+	VertexBuffer* triangle;
+	IndexBuffer* triangleIndices;
+	VertexBuffer* textured;
+	std::vector<Texture*> textures;
+	bool created;
+
+	TestDevice()
+		: triangle(NULL)
+		, triangleIndices(NULL)
+		, textured(NULL)
+	{
+		created = CreateTestDevice(device, 64, 48, triangle, triangleIndices);
+	}
+
+	~TestDevice()
+	{
+		if (created)
+			device.SetSourceTexture(NULL);
+
+		device.Release();
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			delete textures[i];
+		}
+
+		delete textured;
+		delete triangle;
+		delete triangleIndices;
+	}
+
+	// A texture with each texel set by texel(u, v), or NULL if it couldn't be created.
+	Texture* CreateTexture(U16 width, U16 height, TexelFunction texel)
+	{
+		Texture* texture = NULL;
+		if (TextureManager::Instance().CreateTexture(width, height, texture) != SWR_OK)
+			return NULL;
+
+		textures.push_back(texture);
+		for (U32 v = 0; v < height; v++)
+		{
+			for (U32 u = 0; u < width; u++)
+			{
+				((U32*)texture->GetBytes())[texture->GetTexelIndex(u, v)] = texel(u, v);
+			}
+		}
+
+		return texture;
+	}
+
+	// Draws the test triangle with the texture across it, from uvMin at the top left to uvMax at
+	// the bottom right, into a cleared back-buffer and returns the frame. NULL if the triangle
+	// couldn't be created.
+	const U8* DrawTexturedTriangle(Texture* texture, Real uvMin, Real uvMax)
+	{
+		Vertex verts[3] =
+		{
+			Vertex(-2.0f, -2.0f, 5.0f, Colour32::WHITE, uvMin, uvMax, 0.0f, 0.0f, 1.0f),
+			Vertex( 0.0f,  2.0f, 5.0f, Colour32::WHITE, (uvMin + uvMax) * 0.5f, uvMin, 0.0f, 0.0f, 1.0f),
+			Vertex( 2.0f, -2.0f, 5.0f, Colour32::WHITE, uvMax, uvMax, 0.0f, 0.0f, 1.0f),
+		};
+
+		delete textured;
+		textured = NULL;
+		if (CreateVertexBuffer(verts, 3, textured) != SWR_OK)
+			return NULL;
+
+		device.SetVertexBuffer(textured);
+		device.SetSourceTexture(texture);
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		device.DrawTrisTexList(true, 1, 0);
+		return device.Present();
+	}
+};
+
+static U32 TiledTestTexel(U32 u, U32 v)
+{
+	return (u * 12) << 16 | (v * 19) << 8 | ((u ^ v) & 1) * 255;
+}
+
+SWR_TEST(TiledTexturesDrawLikeLinearOnes)
+{
+	TestDevice test;
+	SWR_CHECK(test.created);
+
+	// An odd size, so the last row of blocks and the rows are both padded.
+	const U16 width = 21, height = 13;
+	Texture* texture = test.CreateTexture(width, height, TiledTestTexel);
+	SWR_CHECK(texture != NULL);
+
+	static U8 linear[64 * 48 * 4];
+	memcpy(linear, test.DrawTexturedTriangle(texture, 0.0f, 0.9f), sizeof(linear));
+	SWR_CHECK(CountDrawnPixels(linear, 64, 48, 64 * 4) > 100);
+
+	SWR_CHECK(TextureManager::Instance().SetTextureLayout(texture, TEXLAYOUT_Tiled) == SWR_OK);
+	SWR_CHECK(memcmp(linear, test.DrawTexturedTriangle(texture, 0.0f, 0.9f), sizeof(linear)) == 0);
+
+	// Back to linear, every texel should be where it started.
+	SWR_CHECK(TextureManager::Instance().SetTextureLayout(texture, TEXLAYOUT_Linear) == SWR_OK);
+	bool roundTrip = texture->GetLayout() == TEXLAYOUT_Linear;
+	for (U32 v = 0; v < height; v++)
+	{
+		const U32* row = (const U32*)(texture->GetBytes() + v * texture->GetPitch());
+		for (U32 u = 0; u < width; u++)
+		{
+			roundTrip &= row[u] == TiledTestTexel(u, v);
+		}
+	}
+
+	SWR_CHECK(roundTrip);
+}
+
+// The first column of the row the colour is found in, or -1.
+static int FindInRow(const U8* pixels, U32 width, U32 pitch, U32 y, U32 colour)
+{
+	const U32* row = (const U32*)(pixels + y * pitch);
+	for (U32 x = 0; x < width; x++)
+	{
+		if ((row[x] & 0x00FFFFFF) == colour)
+			return (int)x;
+	}
+
+	return -1;
+}
+
+// Black on the left half, white on the right.
+static U32 HalfWhiteTexel(U32 u, U32)
+{
+	return u < 8 ? 0x00000000 : 0x00FFFFFF;
+}
+
+SWR_TEST(PerspectiveTexturesFollowTheDepth)
+{
+	TestDevice test;
+	SWR_CHECK(test.created);
+
+	Texture* texture = test.CreateTexture(16, 16, HalfWhiteTexel);
+	SWR_CHECK(texture != NULL);
+
+	// A quad receding to the right, from z = 2 to z = 6. The middle of the texture is at x = 0,
+	// the centre of the screen, and halfway across the quad on screen is well left of it.
+	Vertex verts[4] =
+	{
+		Vertex(-1.0f, -0.5f, 2.0f, Colour32::WHITE, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f),
+		Vertex(-1.0f,  0.5f, 2.0f, Colour32::WHITE, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 1.0f,  0.5f, 6.0f, Colour32::WHITE, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+		Vertex( 1.0f, -0.5f, 6.0f, Colour32::WHITE, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f),
+	};
+	U16 indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	VertexBuffer* quad = NULL;
+	IndexBuffer* quadIndices = NULL;
+	SWR_CHECK(CreateVertexBuffer(verts, 4, quad) == SWR_OK);
+	SWR_CHECK(CreateIndexBuffer(indices, 6, quadIndices) == SWR_OK);
+
+	RenderDevice &device = test.device;
+	device.SetVertexBuffer(quad);
+	device.SetIndexBuffer(quadIndices);
+	device.SetSourceTexture(texture);
+
+	int firstWhite[2];
+	TextureMappingTypeSet mappings[2] = { TEX_MAP_Affine, TEX_MAP_Perspective };
+	for (int i = 0; i < 2; i++)
+	{
+		device.SetTextureMappingType(mappings[i]);
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		device.DrawTrisTexList(true, 2, 0);
+		firstWhite[i] = FindInRow(device.Present(), 64, device.GetBackBufferPitch(), 24, 0x00FFFFFF);
+	}
+
+	delete quad;
+	delete quadIndices;
+
+	SWR_CHECK(firstWhite[0] > 0 && firstWhite[0] < 28);
+	SWR_CHECK(firstWhite[1] >= 31 && firstWhite[1] <= 33);
+}
+
+// A one texel black and white checker board.
+static U32 CheckerTexel(U32 u, U32 v)
+{
+	return (u ^ v) & 1 ? 0x00FFFFFF : 0x00000000;
+}
+
+SWR_TEST(MinifiedTrianglesSampleMipLevels)
+{
+	TestDevice test;
+	SWR_CHECK(test.created);
+
+	// The checker board averages to grey from level 1 on.
+	Texture* texture = test.CreateTexture(256, 256, CheckerTexel);
+	SWR_CHECK(texture != NULL);
+	SWR_CHECK(TextureManager::Instance().GenerateMipmaps(texture) == SWR_OK);
+	SWR_CHECK(texture->GetTotalLevels() == 9);
+
+	// The whole texture across a triangle a few dozen pixels wide.
+	const U8* frame = test.DrawTexturedTriangle(texture, 0.0f, 0.9f);
+	U32 pitch = test.device.GetBackBufferPitch();
+
+	int drawn = 0, grey = 0;
+	for (U32 y = 0; y < 48; y++)
+	{
+		const U32* row = (const U32*)(frame + y * pitch);
+		for (U32 x = 0; x < 64; x++)
+		{
+			drawn += row[x] != CLEAR_COLOUR;
+			grey += row[x] == 0x00808080;
+		}
+	}
+
+	// Level 0 would alias into black and white; a smaller level is all grey.
+	SWR_CHECK(drawn > 100);
+	SWR_CHECK(grey == drawn);
+}
+
+// Each texel is its UV, marked so any texel read from outside the texture shows.
+static U32 UVTexel(U32 u, U32 v)
+{
+	return 0x00A00000 | v << 8 | u;
+}
+
+SWR_TEST(TextureAddressModesKeepUVsInside)
+{
+	TestDevice test;
+	SWR_CHECK(test.created);
+
+	// Powers of 2 take the shift and mask paths, the others the general ones.
+	const U16 sizes[][2] = { { 8, 8 }, { 6, 5 } };
+	bool inside = true;
+	int drawn = 0;
+	int clampEdges[2] = { 0 }, wrapEdges[2] = { 0 };
+	for (int s = 0; s < 2; s++)
+	{
+		U16 width = sizes[s][0], height = sizes[s][1];
+		Texture* texture = test.CreateTexture(width, height, UVTexel);
+		SWR_CHECK(texture != NULL);
+
+		for (int mode = TEXADDRESS_Clamp; mode < TEXADDRESS_Invalid; mode++)
+		{
+			// UVs from -1 to 2, so the triangle runs a whole texture past each edge.
+			texture->SetAddressMode((TextureAddressMode)mode);
+			const U8* frame = test.DrawTexturedTriangle(texture, -1.0f, 2.0f);
+
+			for (U32 y = 0; y < 48; y++)
+			{
+				const U32* row = (const U32*)(frame + y * test.device.GetBackBufferPitch());
+				for (U32 x = 0; x < 64; x++)
+				{
+					if (row[x] == CLEAR_COLOUR)
+						continue;
+
+					U32 u = row[x] & 0xFF, v = (row[x] >> 8) & 0xFF;
+					inside &= (row[x] & 0xFFFF0000) == 0x00A00000 && u < width && v < height;
+					drawn++;
+
+					// Clamped, the two thirds of the U range outside the texture land on the first or last column.
+					bool edge = u == 0 || u == (U32)width - 1;
+					clampEdges[s] += mode == TEXADDRESS_Clamp && edge;
+					wrapEdges[s] += mode == TEXADDRESS_Wrap && edge;
+				}
+			}
+		}
+	}
+
+	SWR_CHECK(drawn > 300);
+	SWR_CHECK(inside);
+	SWR_CHECK(clampEdges[0] * 2 > wrapEdges[0] * 3);
+	SWR_CHECK(clampEdges[1] * 2 > wrapEdges[1] * 3);
+}
+
+// A black texel and a white one.
+static U32 BlackThenWhiteTexel(U32 u, U32)
+{
+	return u == 0 ? 0x00000000 : 0x00FFFFFF;
+}
+
+SWR_TEST(BilinearFilteringBlendsNeighbouringTexels)
+{
+	TestDevice test;
+	SWR_CHECK(test.created);
+
+	Texture* texture = test.CreateTexture(2, 1, BlackThenWhiteTexel);
+	SWR_CHECK(texture != NULL);
+
+	int shades[TEXFILTER_Invalid] = { 0 };
+	bool grey = true;
+	for (int filter = TEXFILTER_Nearest; filter < TEXFILTER_Invalid; filter++)
+	{
+		// Stretched over the whole triangle.
+		texture->SetFilter((TextureFilter)filter);
+		const U8* frame = test.DrawTexturedTriangle(texture, 0.0f, 1.0f);
+
+		bool seen[256] = { false };
+		for (U32 y = 0; y < 48; y++)
+		{
+			const U32* row = (const U32*)(frame + y * test.device.GetBackBufferPitch());
+			for (U32 x = 0; x < 64; x++)
+			{
+				if (row[x] == CLEAR_COLOUR)
+					continue;
+
+				// Blends of black and white are only ever grey.
+				U32 level = row[x] & 0xFF;
+				grey &= row[x] == (level << 16 | level << 8 | level);
+				shades[filter] += seen[level] == false;
+				seen[level] = true;
+			}
+		}
+	}
+
+	SWR_CHECK(grey);
+	SWR_CHECK(shades[TEXFILTER_Nearest] == 2);
+	SWR_CHECK(shades[TEXFILTER_Bilinear] > 16);
+}
+
+static U32 WhiteTexel(U32, U32)
+{
+	return 0x00FFFFFF;
+}
+
+static U32 GreyTexel(U32, U32)
+{
+	return 0x00808080;
+}
+
+SWR_TEST(LitTexturesModulateTheLitColours)
+{
+	TestDevice test;
+	SWR_CHECK(test.created);
+	RenderDevice &device = test.device;
+
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(0.0f, 0.0f, 0.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 50.0f;
+	light.atten[0] = 0.0f;
+	light.atten[1] = 0.125f;
+	light.atten[2] = 0.0f;
+	device.GetLightingManager()->AddLight(light, 0);
+	device.GetLightingManager()->EnableLight(0);
+
+	// The gourad lit triangle, to compare the textured ones with.
+	static U8 solid[64 * 48 * 4];
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColLitList(true, 1, 0);
+	device.Present(solid, 64 * 4);
+	int drawn = CountDrawnPixels(solid, 64, 48, 64 * 4);
+	SWR_CHECK(drawn > 100);
+
+	// A white texture modulates to the lit colour, and a grey one to half of it. Flat on to the
+	// camera, perspective correction changes nothing.
+	Texture* white = test.CreateTexture(2, 2, WhiteTexel);
+	Texture* grey = test.CreateTexture(2, 2, GreyTexel);
+	SWR_CHECK(white != NULL && grey != NULL);
+
+	Texture* textures[] = { white, grey, white };
+	const TextureMappingTypeSet mappings[] = { TEX_MAP_Affine, TEX_MAP_Affine, TEX_MAP_Perspective };
+	for (int t = 0; t < 3; t++)
+	{
+		U32 texel = ((const U32*)textures[t]->GetBytes())[0];
+		device.SetSourceTexture(textures[t]);
+		device.SetTextureMappingType(mappings[t]);
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.DrawTrisTexLitList(true, 1, 0);
+		const U8* frame = device.Present();
+
+		// The two are stepped differently, so only their shared pixels are compared, and loosely.
+		int compared = 0;
+		int maxDifference = 0;
+		for (U32 i = 0; i < 64 * 48; i++)
+		{
+			U32 expected = ((const U32*)solid)[i];
+			U32 pixel = ((const U32*)frame)[i];
+			if (expected == CLEAR_COLOUR || pixel == CLEAR_COLOUR)
+				continue;
+
+			compared++;
+			for (U32 shift = 0; shift < 24; shift += 8)
+			{
+				int channel = (int)((expected >> shift) & 0xFF) * (int)((texel & 0xFF) + 1) >> 8;
+				int difference = channel - (int)((pixel >> shift) & 0xFF);
+				difference = difference < 0 ? -difference : difference;
+				maxDifference = difference > maxDifference ? difference : maxDifference;
+			}
+		}
+
+		SWR_CHECK(compared * 10 > drawn * 9);
+		SWR_CHECK(maxDifference <= 3);
+	}
+}
+
+static U32 GradientCheckerTexel(U32 u, U32 v)
+{
+	return (u * 4) << 16 | (v * 4) << 8 | ((u / 4 ^ v / 4) & 1) * 255;
+}
+
+SWR_TEST(BatchedSpansDrawLikeImmediateOnes)
+{
+	TestDevice test;
+	SWR_CHECK(test.created);
+	RenderDevice &device = test.device;
+
+	// A mipmapped texture, so the smaller triangles sample other levels than the larger ones.
+	Texture* texture = test.CreateTexture(64, 64, GradientCheckerTexel);
+	SWR_CHECK(texture != NULL);
+	SWR_CHECK(TextureManager::Instance().GenerateMipmaps(texture) == SWR_OK);
+
+	// Overlapping triangles of different sizes and colours, so the order they cover each other
+	// in shows. There are enough spans that the batch is filled part way through the draw.
+	const int totalTris = 120;
+	Vertex verts[totalTris * 3];
+	for (int i = 0; i < totalTris; i++)
+	{
+		Real scale = 0.4f + 0.4f * (i % 6);
+		Real x = -1.5f + 0.6f * (i % 6) + 0.02f * (i / 6);
+		Real y = i & 1 ? 0.5f : -0.5f;
+		Colour32 colour((U8)(40 * i), (U8)(255 - 40 * i), (U8)(i * 90), 0);
+		verts[i * 3 + 0] = Vertex(x - scale, y - scale, 5.0f, colour, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+		verts[i * 3 + 1] = Vertex(x, y + scale, 5.0f, colour, 0.5f, 0.0f, 0.0f, 0.0f, 1.0f);
+		verts[i * 3 + 2] = Vertex(x + scale, y - scale, 5.0f, colour, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	VertexBuffer* tris = NULL;
+	SWR_CHECK(CreateVertexBuffer(verts, totalTris * 3, tris) == SWR_OK);
+	device.SetVertexBuffer(tris);
+	device.SetSourceTexture(texture);
+
+	// Each draw immediately, then batched.
+	static U8 frames[2][2][64 * 48 * 4];
+	for (int batched = 0; batched < 2; batched++)
+	{
+		device.EnableSpanBatching(batched != 0);
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.DrawTrisColList(false, totalTris, 0);
+		device.Present(frames[batched][0], 64 * 4);
+
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.DrawTrisTexList(false, totalTris, 0);
+		device.Present(frames[batched][1], 64 * 4);
+	}
+
+	delete tris;
+
+	SWR_CHECK(CountDrawnPixels(frames[0][0], 64, 48, 64 * 4) > 500);
+	SWR_CHECK(CountDrawnPixels(frames[0][1], 64, 48, 64 * 4) > 500);
+	SWR_CHECK(memcmp(frames[0][0], frames[1][0], sizeof(frames[0][0])) == 0);
+	SWR_CHECK(memcmp(frames[0][1], frames[1][1], sizeof(frames[0][1])) == 0);
+}
+
+SWR_TEST(FrameStatsCountTheFrame)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColList(true, 1, 0);
+	int drawnForward = CountDrawnPixels(device.Present(), 64, 48, 64 * 4);
+	RenderStats forward = device.GetFrameStats();
+
+	// Deferred lights every covered pixel exactly once, however many times it was drawn.
+	device.SetRenderPipeline(PIPELINE_Deferred);
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColPhongList(true, 1, 0);
+	int drawnDeferred = CountDrawnPixels(device.Present(), 64, 48, 64 * 4);
+	RenderStats deferred = device.GetFrameStats();
+
+	RenderStats total = device.GetStats();
+	device.ResetStatsCounters();
+	RenderStats reset = device.GetStats();
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(forward.trisSubmitted >= 1);
+	SWR_CHECK(forward.trisDrawn == forward.trisSubmitted);
+	SWR_CHECK(forward.vertsTransformed == forward.trisSubmitted * 3);
+	SWR_CHECK(forward.pixelsShaded >= (U64)drawnForward);
+	SWR_CHECK(forward.bytesWritten == forward.pixelsShaded * 4);
+	SWR_CHECK(forward.targetPixels == 64 * 48);
+	SWR_CHECK(forward.GetCoverageRatio() > 0.0f && forward.GetCoverageRatio() <= 1.0f);
+
+	SWR_CHECK(deferred.pixelsResolved == (U64)drawnDeferred);
+	SWR_CHECK(deferred.pixelsShaded == (U64)drawnDeferred);
+
+	SWR_CHECK(total.trisSubmitted == forward.trisSubmitted + deferred.trisSubmitted);
+	SWR_CHECK(reset.trisSubmitted == 0 && reset.pixelsShaded == 0);
+}
+
+SWR_TEST(FrameArenasSettleAfterTheFirstFrame)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(0.0f, 0.0f, 0.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 50.0f;
+	device.GetLightingManager()->AddLight(light, 0);
+	device.GetLightingManager()->EnableLight(0);
+
+	// The per-pixel lit path takes the light lists from the arena.
+	U64 transientBytes[4];
+	U32 capacity[4];
+	for (int frame = 0; frame < 4; frame++)
+	{
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		device.DrawTrisColPhongList(true, 1, 0);
+		device.Present();
+
+		transientBytes[frame] = device.GetFrameStats().transientBytes;
+		capacity[frame] = device.GetFrameArena().GetCapacity();
+	}
+
+	const FrameArena &arena = device.GetFrameArena();
+	U32 highWaterMark = arena.GetHighWaterMark();
+	bool fits = highWaterMark <= arena.GetCapacity();
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(transientBytes[0] > 0 && transientBytes[0] == transientBytes[3]);
+	SWR_CHECK(capacity[1] == capacity[3]);
+	SWR_CHECK(fits && highWaterMark == transientBytes[3]);
+}
+
+#ifdef SWR_TRACK_ALLOCATIONS
+// Only in builds with SWR_TRACK_ALLOCATIONS.
+SWR_TEST(WarmFramesDoNotAllocate)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(0.0f, 0.0f, 0.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 50.0f;
+	device.GetLightingManager()->AddLight(light, 0);
+	device.GetLightingManager()->EnableLight(0);
+
+	// A smaller target each frame renders to first, so the screen sized structures switch size.
+	RenderTarget target;
+	SWR_CHECK(target.Initilise(32, 32, true) == SWR_OK);
+
+	// Every frame goes through the flat, per-vertex and per-pixel lit paths, forward and deferred.
+	U32 failedFrames = AllocationTracker::GetTotalFailedFrames();
+	AllocationCounts warm[6];
+	for (int frame = 0; frame < 8; frame++)
+	{
+		if (frame == 2)
+		{
+			AllocationTracker::SetExpectNoAllocations(true);
+		}
+
+		device.SetRenderPipeline(frame % 2 == 0 ? PIPELINE_Forward : PIPELINE_Deferred);
+		device.SetRenderTarget(&target);
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		device.DrawTrisColPhongList(true, 1, 0);
+		device.ResolveGBuffer();
+		device.SetRenderTarget(NULL);
+
+		device.ClearBackBuffer(CLEAR_COLOUR);
+		device.ClearZBuffer();
+		device.DrawTrisColList(true, 1, 0);
+		device.DrawTrisColLitList(true, 1, 0);
+		device.DrawTrisColPhongList(true, 1, 0);
+		device.Present();
+
+		if (frame >= 2)
+		{
+			warm[frame - 2] = AllocationTracker::GetFrameCounts();
+		}
+	}
+
+	AllocationTracker::SetExpectNoAllocations(false);
+	U32 failedAfterWarmUp = AllocationTracker::GetTotalFailedFrames() - failedFrames;
+
+	// A deliberate allocation is charged to its scope.
+	void* bytes = NULL;
+	{
+		SWR_ALLOC_SCOPE("TestScope");
+		bytes = SWR_MALLOC(100);
+	}
+
+	device.Present();
+	SWR_FREE(bytes);
+
+	AllocationCounts scoped = { 0, 0 };
+	for (int i = 0; i < AllocationTracker::GetTotalSubsystems(); i++)
+	{
+		if (strcmp(AllocationTracker::GetSubsystemName(i), "TestScope") == 0)
+		{
+			scoped = AllocationTracker::GetSubsystemFrameCounts(i);
+		}
+	}
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	bool noneWarm = true;
+	for (int i = 0; i < 6; i++)
+	{
+		noneWarm = noneWarm && warm[i].allocations == 0;
+	}
+
+	SWR_CHECK(noneWarm);
+	SWR_CHECK(failedAfterWarmUp == 0);
+	SWR_CHECK(scoped.allocations == 1 && scoped.bytes == 100);
+}
+#endif
+
+SWR_TEST(OverdrawViewShowsDrawnPixels)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 128, 96, triangle, triangleIndices));
+
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColList(true, 1, 0);
+	int drawn = CountDrawnPixels(device.Present(), 128, 96, 128 * 4);
+
+	// Every drawn pixel is drawn as often as the rest, so all of them are at full heat.
+	device.SetDebugView(DEBUGVIEW_Overdraw, 0.0f);
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColList(true, 1, 0);
+	const U32* heat = (const U32*)device.Present();
+
+	int hottest = 0, cold = 0;
+	for (U32 i = 0; i < 128 * 96; i++)
+	{
+		hottest += heat[i] == 0x00FF0000 ? 1 : 0;
+		cold += heat[i] == 0 ? 1 : 0;
+	}
+
+	// The counts start over each frame, and the tile costs only cover tiles drawn to. At this
+	// size the triangle leaves the top left tile untouched.
+	device.SetDebugView(DEBUGVIEW_TileCost, 0.0f);
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.DrawTrisColList(true, 1, 0);
+	const U32* tiles = (const U32*)device.Present();
+	U32 cornerTile = tiles[0];
+	U32 centreTile = tiles[48 * 128 + 64];
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+
+	SWR_CHECK(drawn > 100);
+	SWR_CHECK(hottest == drawn);
+	SWR_CHECK(cold == 128 * 96 - drawn);
+	SWR_CHECK(cornerTile == 0);
+	SWR_CHECK(centreTile != 0);
+}
+
+SWR_TEST(CapturedFrameReplaysIdentically)
+{
+	RenderDevice device;
+	VertexBuffer* triangle = NULL;
+	IndexBuffer* triangleIndices = NULL;
+	SWR_CHECK(CreateTestDevice(device, 64, 48, triangle, triangleIndices));
+
+	Light light;
+	light.type = LIGHT_Point;
+	light.position = Vector3(0.0f, 0.0f, 0.0f);
+	light.colour.FromColour32(Colour32::WHITE);
+	light.falloff = 50.0f;
+	light.atten[0] = 0.0f;
+	light.atten[1] = 0.125f;
+	light.atten[2] = 0.0f;
+	device.GetLightingManager()->AddLight(light, 0);
+	device.GetLightingManager()->EnableLight(0);
+	device.SetRenderPipeline(PIPELINE_Deferred);
+
+	Texture* texture = NULL;
+	RenderTarget target;
+	SWR_CHECK(TextureManager::Instance().CreateTexture(16, 16, texture) == SWR_OK);
+	SWR_CHECK(target.Initilise(texture, true) == SWR_OK);
+
+	// A frame that draws into a texture, then lights the scene and draws the texture over it.
+	const char* captureFile = "swr_test_frame.swrc";
+	SWR_CHECK(device.BeginCapture(captureFile) == SWR_OK);
+	SWR_CHECK(device.IsCapturing());
+
+	device.SetRenderTarget(&target);
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.ClearZBuffer();
+	device.DrawTrisColList(true, 1, 0);
+	device.SetRenderTarget(NULL);
+
+	device.ClearBackBuffer(CLEAR_COLOUR);
+	device.ClearZBuffer();
+	device.DrawTrisColPhongList(true, 1, 0);
+	device.ResolveGBuffer();
+	device.DrawTexture2D(2, 2, texture);
+
+	static U8 captured[64 * 48 * 4];
+	memcpy(captured, device.Present(), sizeof(captured));
+	bool stoppedCapturing = device.IsCapturing() == false;
+
+	device.Release();
+	delete triangle;
+	delete triangleIndices;
+	target.Release();
+	delete texture;
+
+	// Played on a device of its own, twice to replay with the resources it created the first time.
+	FrameReplay replay;
+	SWR_CHECK(replay.Load(captureFile) == SWR_OK);
+
+	SWRInitParams params;
+	replay.GetInitParams(params);
+	params.totalRenderThreads = 2;
+
+	RenderDevice replayDevice;
+	SWR_CHECK(replayDevice.Initilise(params) == SWR_OK);
+
+	bool played = replay.Play(replayDevice) == SWR_OK && replay.Play(replayDevice) == SWR_OK;
+	bool same = played && replay.GetFrame() != NULL && memcmp(replay.GetFrame(), captured, sizeof(captured)) == 0;
+	int drawn = CountDrawnPixels(captured, 64, 48, 64 * 4);
+
+	replayDevice.Release();
+	replay.Release();
+	remove(captureFile);
+
+	SWR_CHECK(stoppedCapturing);
+	SWR_CHECK(params.bufferWidth == 64 && params.bufferHeight == 48);
+	SWR_CHECK(drawn > 100);
+	SWR_CHECK(played);
+	SWR_CHECK(same);
+}
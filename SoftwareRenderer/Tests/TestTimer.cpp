@@ -0,0 +1,84 @@
+//****************************************************************************
+//**
+//**    TestTimer.cpp
+//**
+//**    Copyright (c) 2010 Matthew Robbins
+//**
+//**    Author:  Matthew Robbins
+//**    Created: 11/2010
+//**
+//****************************************************************************
+
+#include "SWRTest.h"
+
+#include "Timer.h"
+#include "FrameTimeHistogram.h"
+
+using namespace SWR;
+
+SWR_TEST(FrameTimeHistogramPercentilesRollWithTheWindow)
+{
+	FrameTimeHistogram times(100);
+	SWR_CHECK(times.GetPercentile(50.0) == 0.0 && times.GetMax() == 0.0);
+
+	times.SetBudget(16.0);
+	for (int i = 1; i <= 100; i++)
+	{
+		times.AddSample((double)i);
+	}
+
+	SWR_CHECK(times.GetWindowCount() == 100);
+	SWR_CHECK(times.GetPercentile(50.0) == 50.0);
+	SWR_CHECK(times.GetPercentile(95.0) == 95.0);
+	SWR_CHECK(times.GetPercentile(99.0) == 99.0);
+	SWR_CHECK(times.GetMin() == 1.0 && times.GetMax() == 100.0);
+	SWR_CHECK(times.GetMean() == 50.5);
+	SWR_CHECK(times.GetTotalOverBudget() == 84);
+
+	// A hundred quick frames push the slow ones out of the window, but not out of the session.
+	for (int i = 0; i < 100; i++)
+	{
+		times.AddSample(0.5);
+	}
+
+	SWR_CHECK(times.GetWindowCount() == 100);
+	SWR_CHECK(times.GetPercentile(99.0) == 0.5 && times.GetMax() == 0.5);
+	SWR_CHECK(times.GetTotalSamples() == 200);
+	SWR_CHECK(times.GetSessionMax() == 100.0);
+	SWR_CHECK(times.GetBucketCount(0) == 101);
+	SWR_CHECK(times.GetBucketCount(FrameTimeHistogram::TOTAL_BUCKETS - 1) == 0);
+
+	U64 total = 0;
+	for (int i = 0; i < FrameTimeHistogram::TOTAL_BUCKETS; i++)
+	{
+		total += times.GetBucketCount(i);
+	}
+
+	SWR_CHECK(total == 200);
+}
+
+SWR_TEST(TimerKeepsFrameAndStageTimes)
+{
+	Timer timer;
+	int stage = timer.AddStage("Render", 1.0f);
+	SWR_CHECK(timer.FindStage("Render") == stage && timer.FindStage("Update") == -1);
+
+	// The first tick starts the first frame, it doesn't end one.
+	timer.Tick();
+	for (int i = 0; i < 3; i++)
+	{
+		timer.BeginStage(stage);
+		double start = Timer::Now();
+		while (Timer::Now() - start < 0.001)
+		{
+		}
+		timer.EndStage(stage);
+		timer.Tick();
+	}
+
+	SWR_CHECK(timer.GetFrameTimes().GetTotalSamples() == 3);
+	SWR_CHECK(timer.GetStageTimes(stage).GetTotalSamples() == 3);
+	SWR_CHECK(timer.GetStageTimes(stage).GetMin() >= 1.0);
+	SWR_CHECK(timer.GetFrameTimes().GetMin() >= timer.GetStageTimes(stage).GetMin());
+	SWR_CHECK(timer.GetStageTimes(stage).GetTotalOverBudget() == 0);
+}